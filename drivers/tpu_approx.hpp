@@ -0,0 +1,84 @@
+/**
+ * Bit model of the runtime-selectable FP16 datapath
+ *
+ * Mirrors fp16_selectable_multiplier.v and fp16_selectable_adder.v bit for
+ * bit (truncating, subnormals flushed to zero), so the emulator and offline
+ * tools see the same results as a RUNTIME_PRECISION bitstream at every
+ * ArrayPrecision setting.
+ */
+
+#pragma once
+
+#include "tpu_driver.hpp"
+
+#include <cstdint>
+
+class ApproxFP16 {
+public:
+    static constexpr uint16_t INF = 0x7C00;
+
+    /**
+     * a * b keeping the top multBits mantissa bits (incl. the implicit 1)
+     * of each operand
+     */
+    static uint16_t multiply(uint16_t a, uint16_t b, unsigned multBits) {
+        uint16_t sign = (a ^ b) & 0x8000;
+        unsigned ea = (a >> 10) & 0x1F;
+        unsigned eb = (b >> 10) & 0x1F;
+        if (ea == 0 || eb == 0) return sign;
+        if (ea == 0x1F || eb == 0x1F) return sign | INF;
+
+        unsigned bits = (multBits == 0 || multBits > 11) ? 11 : multBits;
+        uint32_t mask = (0x7FFu << (11 - bits)) & 0x7FF;
+        uint32_t ma = (0x400u | (a & 0x3FF)) & mask;
+        uint32_t mb = (0x400u | (b & 0x3FF)) & mask;
+        uint32_t prod = ma * mb;
+
+        unsigned norm = (prod >> 21) & 1;
+        int e = static_cast<int>(ea + eb) - 15 + static_cast<int>(norm);
+        if (e <= 0) return sign;
+        if (e >= 31) return sign | INF;
+
+        uint16_t mant = static_cast<uint16_t>((norm ? prod >> 11 : prod >> 10) & 0x3FF);
+        return static_cast<uint16_t>(sign | (e << 10) | mant);
+    }
+
+    /**
+     * a + b; the smaller operand is dropped when the exponents differ by
+     * more than alignMax
+     */
+    static uint16_t add(uint16_t a, uint16_t b, unsigned alignMax) {
+        bool aLarger = (a & 0x7FFF) >= (b & 0x7FFF);
+        uint16_t large = aLarger ? a : b;
+        uint16_t small = aLarger ? b : a;
+
+        unsigned el = (large >> 10) & 0x1F;
+        unsigned es = (small >> 10) & 0x1F;
+        uint16_t signLarge = large & 0x8000;
+        if (el == 0x1F) return signLarge | INF;
+
+        uint32_t fl = el == 0 ? 0 : (0x400u | (large & 0x3FF)) << 3;
+        uint32_t fs = es == 0 ? 0 : (0x400u | (small & 0x3FF)) << 3;
+        unsigned diff = el - es;
+        uint32_t aligned = diff > alignMax ? 0 : fs >> diff;
+        uint32_t sum = ((large ^ small) & 0x8000) ? fl - aligned : fl + aligned;
+
+        int e;
+        uint32_t norm;
+        if (sum & (1u << 14)) {
+            norm = sum >> 1;
+            e = static_cast<int>(el) + 1;
+        } else {
+            unsigned lz = 0;
+            for (int i = 0; i <= 13; i++) {
+                if (sum & (1u << i)) lz = 13 - i;
+            }
+            norm = sum << lz;
+            e = static_cast<int>(el) - static_cast<int>(lz);
+        }
+
+        if (sum == 0 || e <= 0) return 0;
+        if (e >= 31) return signLarge | INF;
+        return static_cast<uint16_t>(signLarge | (e << 10) | ((norm >> 3) & 0x3FF));
+    }
+};
@@ -0,0 +1,127 @@
+/**
+ * Scratch arena for driver frames and host-side tiling
+ *
+ * Bump allocation out of blocks that are kept when the arena is rewound, so
+ * once a call of a given shape has run, later calls reuse memory the arena
+ * already owns: no heap traffic in the steady state. Only for trivially
+ * constructible data (bytes, FP16 words, floats); nothing is destroyed.
+ *
+ * Blocks come from StagingMemory, so an arena used for large GEMM scratch
+ * can sit on huge pages near the thread that drives the device.
+ */
+
+#pragma once
+
+#include "tpu_staging.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+class Arena {
+public:
+    explicit Arena(size_t blockSize = 64 * 1024,
+                   const StagingOptions& staging = StagingOptions())
+        : blockSize_(blockSize), staging_(staging) {}
+
+    ~Arena() { release(); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * Change where blocks come from. Drops all blocks, so nothing may be
+     * allocated from the arena at this point.
+     */
+    void setStaging(const StagingOptions& staging) {
+        if (current_ != 0 || used_ != 0) {
+            throw std::logic_error("Arena is in use");
+        }
+        release();
+        staging_ = staging;
+    }
+
+    const StagingOptions& staging() const { return staging_; }
+
+    /**
+     * Backing of the first block (what the hot buffers got)
+     */
+    PageKind pageKind() const {
+        return blocks_.empty() ? PageKind::Heap : blocks_.front().kind;
+    }
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        for (; current_ < blocks_.size(); current_++, used_ = 0) {
+            const auto& b = blocks_[current_];
+            size_t start = (used_ + align - 1) / align * align;
+            if (start + bytes <= b.size) {
+                used_ = start + bytes;
+                return static_cast<unsigned char*>(b.data) + start;
+            }
+        }
+
+        // Block storage (operator new or mmap) is aligned for any fundamental type
+        blocks_.reserve(blocks_.size() + 1);
+        blocks_.push_back(StagingMemory::allocate(std::max(blockSize_, bytes), staging_));
+        current_ = blocks_.size() - 1;
+        used_ = bytes;
+        return blocks_.back().data;
+    }
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * Allocation position, for LIFO release with rewind()
+     */
+    struct Mark {
+        size_t block;
+        size_t used;
+    };
+
+    Mark mark() const { return {current_, used_}; }
+    void rewind(Mark m) { current_ = m.block; used_ = m.used; }
+    void reset() { current_ = 0; used_ = 0; }
+
+    /**
+     * Rewinds the arena when it goes out of scope
+     */
+    class Scope {
+    public:
+        explicit Scope(Arena& arena) : arena_(arena), mark_(arena.mark()) {}
+        ~Scope() { arena_.rewind(mark_); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Arena& arena_;
+        Mark mark_;
+    };
+
+    /**
+     * Bytes owned by the arena (grows only while warming up)
+     */
+    size_t capacity() const {
+        size_t total = 0;
+        for (const auto& b : blocks_) total += b.size;
+        return total;
+    }
+
+private:
+    std::vector<StagingMemory::Block> blocks_;
+    size_t current_ = 0;
+    size_t used_ = 0;
+    size_t blockSize_;
+    StagingOptions staging_;
+
+    void release() {
+        for (const auto& b : blocks_) StagingMemory::release(b);
+        blocks_.clear();
+        current_ = 0;
+        used_ = 0;
+    }
+};
@@ -0,0 +1,848 @@
+/*
+ * TPU Host Runtime Benchmarks
+ * Description: Link-level benchmarks run against the in-process emulator
+ *
+ * Link time is modelled from bytes on the wire at 115200 baud
+ * (10 bits per byte: start + 8 data + stop).
+ *
+ * Build: make bench
+ */
+
+#include "tpu_driver.hpp"
+#include "tpu_emulator.hpp"
+#include "tpu_gemm.hpp"
+#include "tpu_conv.hpp"
+#include "tpu_tuner.hpp"
+#include "tpu_fp16_table.hpp"
+#include "tpu_timing.hpp"
+#include "tpu_trace.hpp"
+#include "tpu_faults.hpp"
+#include "tpu_metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sstream>
+
+// Count every heap allocation made by the process. Kept out of line:
+// once inlined, GCC pairs the malloc/free inside them with the callers'
+// new/delete expressions and reports -Wmismatched-new-delete.
+static std::atomic<uint64_t> g_allocations{0};
+
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void* operator new(size_t size) {
+    g_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+BENCH_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static constexpr double BAUD = 115200.0;
+
+static double linkMillis(uint64_t bytes) {
+    return bytes * 10.0 / BAUD * 1000.0;
+}
+
+static uint64_t linkBytes(const LinkStats& s) {
+    return s.bytesSent + s.bytesReceived;
+}
+
+/**
+ * ReLU(W·A + bias) tiles from a random layer; a larger negative bias
+ * shift gives sparser outputs, as in deeper layers of trained networks
+ */
+static void reluTile(std::mt19937& rng, float biasShift, TPUEmulator::Memory& out) {
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    for (size_t i = 0; i < MATRIX_SIZE; i++) {
+        float bias = dist(rng) * 0.5f + biasShift;
+        for (size_t j = 0; j < MATRIX_SIZE; j++) {
+            float sum = bias;
+            for (size_t k = 0; k < MATRIX_SIZE; k++) {
+                sum += dist(rng) * dist(rng) * 0.35f;
+            }
+            out[i * MATRIX_SIZE + j] = FP16::fromFloat(std::max(sum, 0.0f));
+        }
+    }
+}
+
+static void benchReadbackCompression() {
+    printf("\n[Bench] Readback compression (ReLU outputs, 200 tiles per setting)\n");
+    printf("  %-10s %9s %12s %12s %12s %12s %9s\n",
+           "bias", "zeros", "dense B", "compr. B", "dense ms", "compr. ms", "decode us");
+
+    const int tiles = 200;
+    for (float shift : {0.5f, 0.0f, -0.5f, -1.0f, -1.5f}) {
+        auto emulator = std::make_unique<TPUEmulator>();
+        TPUEmulator& emu = *emulator;
+        TPUDriver tpu(std::move(emulator));
+        tpu.setVerbose(false);
+        std::mt19937 rng(42);
+
+        uint64_t zeros = 0, dense = 0, compressed = 0;
+        double decodeSeconds = 0.0;
+        for (int t = 0; t < tiles; t++) {
+            reluTile(rng, shift, emu.results());
+            for (uint16_t w : emu.results()) zeros += ResultCodec::isZero(w);
+
+            uint64_t before = linkBytes(tpu.linkStats());
+            TPUDriver::Matrix d = tpu.readResults(ReadbackFormat::Dense);
+            dense += linkBytes(tpu.linkStats()) - before;
+
+            before = linkBytes(tpu.linkStats());
+            auto t0 = std::chrono::steady_clock::now();
+            TPUDriver::Matrix c = tpu.readResults(ReadbackFormat::Compressed);
+            decodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            compressed += linkBytes(tpu.linkStats()) - before;
+
+            if (c != d) {
+                printf("  MISMATCH at tile %d\n", t);
+                return;
+            }
+        }
+
+        printf("  %-10.2f %8.1f%% %12.0f %12.0f %12.2f %12.2f %9.2f\n",
+               shift, 100.0 * zeros / (tiles * MATRIX_SIZE * MATRIX_SIZE),
+               double(dense) / tiles, double(compressed) / tiles,
+               linkMillis(dense) / tiles, linkMillis(compressed) / tiles,
+               decodeSeconds * 1e6 / tiles);
+    }
+}
+
+/**
+ * Sliding-window inputs kept as a ring buffer of rows: each step
+ * overwrites the oldest `rowsPerStep` rows of the activation tile
+ */
+static void benchDeltaUpload() {
+    printf("\n[Bench] Activation upload (sliding window, 200 steps)\n");
+    printf("  %-10s %12s %12s %12s %12s\n",
+           "rows/step", "full B", "delta B", "full ms", "delta ms");
+
+    const int steps = 200;
+    for (size_t rowsPerStep : {0, 1, 2, 4, 6, 8}) {
+        uint64_t bytes[2] = {0, 0};
+        for (UploadMode mode : {UploadMode::Full, UploadMode::Delta}) {
+            TPUDriver tpu(std::make_unique<TPUEmulator>());
+            tpu.setVerbose(false);
+            tpu.setUploadMode(mode);
+            std::mt19937 rng(7);
+            std::normal_distribution<float> dist(0.0f, 1.0f);
+
+            TPUDriver::Matrix window{};
+            tpu.writeActivations(window);
+            uint64_t before = tpu.uploadStats().bytesSent;
+            size_t oldest = 0;
+            for (int t = 0; t < steps; t++) {
+                for (size_t r = 0; r < rowsPerStep; r++) {
+                    for (float& x : window[oldest]) x = dist(rng);
+                    oldest = (oldest + 1) % MATRIX_SIZE;
+                }
+                tpu.writeActivations(window);
+            }
+            bytes[mode == UploadMode::Delta] = tpu.uploadStats().bytesSent - before;
+        }
+
+        printf("  %-10zu %12.0f %12.0f %12.2f %12.2f\n", rowsPerStep,
+               double(bytes[0]) / steps, double(bytes[1]) / steps,
+               linkMillis(bytes[0]) / steps, linkMillis(bytes[1]) / steps);
+    }
+}
+
+/**
+ * Host cost of producing wire words for every 8x8 tile of a 512x512
+ * operand: copy into a Matrix first (old path) vs encode from the view
+ */
+static void benchTileEncode() {
+    printf("\n[Bench] Tile encode (512x512 operand, ns per 8x8 tile)\n");
+    printf("  %-14s %12s %12s\n", "layout", "copy+encode", "view");
+
+    const size_t S = 512;
+    std::vector<float> big(S * S);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+    for (float& x : big) x = dist(rng);
+
+    uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+    uint64_t sink = 0;
+    const int reps = 20;
+    for (bool transposed : {false, true}) {
+        double ns[2];
+        for (int useView = 0; useView < 2; useView++) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int rep = 0; rep < reps; rep++) {
+                for (size_t r0 = 0; r0 < S; r0 += MATRIX_SIZE) {
+                    for (size_t c0 = 0; c0 < S; c0 += MATRIX_SIZE) {
+                        TileView v;
+                        v.base = transposed ? big.data() + c0 * S + r0 : big.data() + r0 * S + c0;
+                        v.rowStride = S;
+                        v.transpose = transposed;
+                        if (useView) {
+                            TileEncoder::encode(v, words);
+                        } else {
+                            TPUDriver::Matrix tile;
+                            loadTile(tile, v);
+                            TileEncoder::encode(TPUDriver::view(tile), words);
+                        }
+                        sink += words[7];
+                    }
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            ns[useView] = seconds * 1e9 / (reps * (S / MATRIX_SIZE) * (S / MATRIX_SIZE));
+        }
+        printf("  %-14s %12.1f %12.1f\n", transposed ? "transposed" : "row-major", ns[0], ns[1]);
+    }
+    if (sink == 42) printf(" ");
+}
+
+/**
+ * Result readback decode: branchy scalar vs 256 KB table vs F16C
+ */
+static void benchFP16Decode() {
+    printf("\n[Bench] FP16 result decode (ns per 8x8 tile, 4M results)\n");
+    printf("  %-16s %12s %12s\n", "decoder", "ns/tile", "Gvalues/s");
+
+    const size_t n = size_t(1) << 22;
+    std::vector<uint16_t> words(n);
+    std::mt19937 rng(64);
+    std::normal_distribution<float> dist(0.0f, 4.0f);
+    for (auto& w : words) w = FP16::fromFloat(dist(rng));
+    std::vector<float> out(n);
+
+    const size_t tile = MATRIX_SIZE * MATRIX_SIZE;
+    auto run = [&](const char* name, auto decodeTile) {
+        decodeTile(words.data(), out.data());   // warm the table / dispatch
+        const int reps = 5;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int rep = 0; rep < reps; rep++) {
+            for (size_t i = 0; i < n; i += tile) {
+                decodeTile(words.data() + i, out.data() + i);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        double values = static_cast<double>(reps) * n;
+        printf("  %-16s %12.1f %12.2f\n", name, seconds * 1e9 * tile / values, values / seconds * 1e-9);
+    };
+
+    run("scalar", [&](const uint16_t* in, float* o) {
+        for (size_t j = 0; j < tile; j++) o[j] = FP16::toFloat(in[j]);
+    });
+    run("table", [&](const uint16_t* in, float* o) { FP16Table::toFloatArray(in, o, tile); });
+    run(FP16::hasF16C() ? "f16c" : "array (no f16c)", [&](const uint16_t* in, float* o) {
+        FP16::toFloatArray(in, o, tile);
+    });
+
+    bool same = true;
+    std::vector<float> check(n);
+    FP16Table::toFloatArray(words.data(), check.data(), n);
+    for (size_t i = 0; i < n; i++) same = same && check[i] == FP16::toFloat(words[i]);
+    printf("  table matches scalar: %s\n", same ? "yes" : "NO");
+}
+
+/**
+ * Heap allocations per device tile once caches and arenas are warm
+ */
+static void benchSteadyStateAllocations() {
+    printf("\n[Bench] Steady-state heap allocations (second run of each workload)\n");
+    printf("  %-26s %10s %12s\n", "workload", "tiles", "allocs/tile");
+
+    TPUDriver tpu(std::make_unique<TPUEmulator>());
+    tpu.setVerbose(false);
+
+    const size_t S = 48;
+    std::vector<float> A(S * S), B(S * S), C(S * S);
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (float& x : A) x = dist(rng);
+    for (float& x : B) x = dist(rng);
+
+    Conv2DShape shape;
+    shape.channels = 8;
+    shape.height = 12;
+    shape.width = 12;
+    shape.outChannels = 16;
+    shape.kernelH = 3;
+    shape.kernelW = 3;
+    Conv2DParams params;
+    params.padH = 1;
+    params.padW = 1;
+    std::vector<float> input(shape.channels * shape.height * shape.width, 0.5f);
+    std::vector<float> weights(shape.outChannels * shape.channels * 9, 0.25f);
+    std::vector<float> output(conv2dOutputSize(shape, params));
+
+    GemmOptions strassen;
+    strassen.algorithm = GemmAlgorithm::Strassen1;
+    strassen.workspace = &tpu.arena();
+
+    auto measure = [&](const char* name, auto&& run) {
+        run();                                  // warm-up
+        uint64_t before = g_allocations.load();
+        GemmStats stats = run();
+        uint64_t allocs = g_allocations.load() - before;
+        printf("  %-26s %10zu %12.3f\n", name, stats.tileMultiplies,
+               stats.tileMultiplies ? double(allocs) / stats.tileMultiplies : 0.0);
+    };
+
+    measure("tiled GEMM 48^3", [&] {
+        return tiledGemm(tpu, S, S, S, A.data(), S, B.data(), S, C.data(), S);
+    });
+    measure("Strassen1 GEMM 48^3", [&] {
+        return gemm(tpu, S, S, S, A.data(), S, B.data(), S, C.data(), S, strassen);
+    });
+    measure("conv2d 8->16 3x3 12x12", [&] {
+        return conv2d(tpu, shape, params, input.data(), weights.data(), output.data());
+    });
+    tpu.setUploadMode(UploadMode::Delta);
+    measure("tiled GEMM, delta upload", [&] {
+        return tiledGemm(tpu, S, S, S, A.data(), S, B.data(), S, C.data(), S);
+    });
+}
+
+/**
+ * Host-side passes over a large operand and accumulator, from the heap
+ * vs huge-page staging memory on this thread's NUMA node
+ */
+static void benchStagingMemory() {
+    const size_t S = 4096;
+    printf("\n[Bench] Staging memory (%zux%zu FP32 operand + accumulator, ms per pass)\n", S, S);
+    printf("  %-10s %-10s %14s %14s %14s\n",
+           "backing", "pages", "col-tile enc", "row-tile enc", "accumulate");
+
+    for (PageBacking backing : {PageBacking::Heap, PageBacking::HugePages}) {
+        StagingOptions options;
+        options.backing = backing;
+        StagingBuffer<float> operand(S * S, options), acc(S * S, options);
+        for (size_t i = 0; i < S * S; i++) {       // first touch on this thread
+            operand[i] = static_cast<float>(i % 97) * 0.01f;
+            acc[i] = 0.0f;
+        }
+
+        uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+        uint64_t sink = 0;
+        auto timeMs = [](auto&& fn) {
+            auto t0 = std::chrono::steady_clock::now();
+            fn();
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        };
+
+        // Transposed tiles walk down columns: one page per row at 4 KB
+        double colMs = timeMs([&] {
+            for (size_t c0 = 0; c0 < S; c0 += MATRIX_SIZE) {
+                for (size_t r0 = 0; r0 < S; r0 += MATRIX_SIZE) {
+                    TileView v;
+                    v.base = operand.data() + r0 * S + c0;
+                    v.rowStride = S;
+                    v.transpose = true;
+                    TileEncoder::encode(v, words);
+                    sink += words[0];
+                }
+            }
+        });
+        double rowMs = timeMs([&] {
+            for (size_t r0 = 0; r0 < S; r0 += MATRIX_SIZE) {
+                for (size_t c0 = 0; c0 < S; c0 += MATRIX_SIZE) {
+                    TileView v;
+                    v.base = operand.data() + r0 * S + c0;
+                    v.rowStride = S;
+                    TileEncoder::encode(v, words);
+                    sink += words[0];
+                }
+            }
+        });
+        double accMs = timeMs([&] {
+            blockAccumulate(acc.data(), S, operand.data(), S, 1.0f, S, S);
+        });
+
+        std::ostringstream kind;
+        kind << operand.pageKind();
+        printf("  %-10s %-10s %14.1f %14.1f %14.1f\n",
+               backing == PageBacking::Heap ? "heap" : "staging", kind.str().c_str(),
+               colMs, rowMs, accMs);
+        if (sink == 42) printf(" ");
+    }
+    printf("  NUMA node of this thread: %d\n", StagingMemory::currentNode());
+}
+
+/**
+ * Long-K reduction of one 8x8 output tile: FP16 partials summed on the
+ * host vs kept in FP16 or FP32 device accumulators
+ */
+static void benchDeviceAccumulation() {
+    printf("\n[Bench] Long-K reduction (8x8 output, relative RMS error and link bytes)\n");
+    printf("  %-6s %-22s %12s %12s %12s\n", "K", "accumulation", "rel RMS", "link B", "link ms");
+
+    for (size_t K : {64, 256, 1024}) {
+        const size_t M = 8, N = 8;
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        std::vector<float> A(M * K), B(K * N), C(M * N);
+        for (float& x : A) x = dist(rng);
+        for (float& x : B) x = dist(rng);
+
+        struct Variant { const char* name; AccumulatorMode mode; bool onDevice; };
+        for (const Variant& v : {Variant{"host FP32 (FP16 tiles)", AccumulatorMode::FP32, false},
+                                 Variant{"device FP16", AccumulatorMode::FP16, true},
+                                 Variant{"device FP32", AccumulatorMode::FP32, true}}) {
+            TPUDriver tpu(std::make_unique<TPUEmulator>(v.mode));
+            tpu.setVerbose(false);
+            if (v.onDevice) {
+                deviceAccumulatedGemm(tpu, M, N, K, A.data(), K, B.data(), N, C.data(), N);
+            } else {
+                tiledGemm(tpu, M, N, K, A.data(), K, B.data(), N, C.data(), N);
+            }
+            GemmErrorReport err = measureGemmError(M, N, K, A.data(), K, B.data(), N, C.data(), N);
+            uint64_t bytes = linkBytes(tpu.linkStats());
+            printf("  %-6zu %-22s %12.2e %12llu %12.1f\n", K, v.name, err.relativeRms,
+                   static_cast<unsigned long long>(bytes), linkMillis(bytes));
+        }
+    }
+}
+
+/**
+ * Per-layer precision plans for a 64-128-128-10 MLP at several error
+ * budgets (bit-accurate emulator, FP16 accumulators)
+ */
+static void benchPrecisionTuner() {
+    printf("\n[Bench] Precision tuner (MLP 64-128-128-10, 32 calibration inputs)\n");
+    printf("  %-8s %-24s %12s %12s %10s\n", "budget", "plan (bits/window)", "measured", "rel cost", "tune ms");
+
+    const size_t sizes[] = {64, 128, 128, 10};
+    const size_t batch = 32;
+    std::mt19937 rng(21);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    MlpModel model;
+    for (size_t l = 0; l < 3; l++) {
+        DenseLayer layer;
+        layer.inputs = sizes[l];
+        layer.outputs = sizes[l + 1];
+        layer.weights.resize(layer.inputs * layer.outputs);
+        for (float& w : layer.weights) w = dist(rng) / std::sqrt(float(layer.inputs));
+        layer.bias.assign(layer.outputs, 0.1f);
+        layer.relu = l + 1 < 3;
+        model.push_back(layer);
+    }
+    std::vector<float> calibration(batch * sizes[0]);
+    for (float& x : calibration) x = dist(rng);
+
+    for (double budget : {0.01, 0.02, 0.05, 0.1}) {
+        TunerOptions options;
+        options.errorBudget = budget;
+        auto t0 = std::chrono::steady_clock::now();
+        TunerReport report = tunePrecision(model, calibration.data(), batch, options);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        std::ostringstream plan;
+        for (const auto& p : report.plan.layers) plan << int(p.multBits) << "/" << int(p.alignMax) << " ";
+        printf("  %-8.3f %-24s %12.4f %12.3f %10.0f%s\n", budget, plan.str().c_str(),
+               report.measuredError, report.relativeCost, ms, report.withinBudget ? "" : "  (over budget)");
+    }
+}
+
+/**
+ * Link traffic of a single-tile MLP: host round trip vs on-device chaining
+ */
+static void benchLayerChaining() {
+    printf("\n[Bench] Layer chaining (8-wide MLP, batch 8, per inference)\n");
+    printf("  %-8s %14s %14s %14s %12s\n", "layers", "host bytes", "chained bytes", "saved/layer", "link ms");
+
+    std::mt19937 rng(65);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> input(MATRIX_SIZE * MATRIX_SIZE);
+    for (float& x : input) x = dist(rng);
+
+    for (size_t layers : {2, 4, 8}) {
+        MlpModel model;
+        for (size_t l = 0; l < layers; l++) {
+            DenseLayer layer;
+            layer.inputs = layer.outputs = MATRIX_SIZE;
+            layer.weights.resize(MATRIX_SIZE * MATRIX_SIZE);
+            for (float& w : layer.weights) w = dist(rng) / std::sqrt(float(MATRIX_SIZE));
+            layer.relu = l + 1 < layers;
+            model.push_back(layer);
+        }
+
+        TPUDriver host(std::make_unique<TPUEmulator>());
+        host.setVerbose(false);
+        runMlp(host, model, PrecisionPlan(), input.data(), MATRIX_SIZE);
+        TPUDriver chained(std::make_unique<TPUEmulator>());
+        chained.setVerbose(false);
+        runMlpChained(chained, model, PrecisionPlan(), input.data(), MATRIX_SIZE);
+
+        uint64_t h = linkBytes(host.linkStats()), c = linkBytes(chained.linkStats());
+        printf("  %-8zu %14llu %14llu %14.0f %5.1f->%5.1f\n", layers,
+               static_cast<unsigned long long>(h), static_cast<unsigned long long>(c),
+               double(h - c) / (layers - 1), linkMillis(h), linkMillis(c));
+    }
+}
+
+/**
+ * Tiled GEMM stop-and-wait (one multiply per round trip) vs through the
+ * device job queue. "overlap ms" is the full-duplex bound the queue
+ * allows: job payloads go out while earlier slots come back.
+ */
+static void benchJobQueue() {
+    printf("\n[Bench] Device job queue (GEMM link traffic, %zu queue entries, %zu slots)\n",
+           JOB_QUEUE_DEPTH, RESULT_SLOTS);
+    printf("  %-12s %-14s %10s %10s %12s %12s\n", "size", "mode", "sent B", "recv B", "serial ms", "overlap ms");
+
+    for (size_t n : {16, 32, 64}) {
+        std::mt19937 rng(66);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        std::vector<float> A(n * n), B(n * n), C(n * n);
+        for (float& x : A) x = dist(rng);
+        for (float& x : B) x = dist(rng);
+
+        for (bool queued : {false, true}) {
+            TPUDriver tpu(std::make_unique<TPUEmulator>());
+            tpu.setVerbose(false);
+            if (queued) {
+                queuedGemm(tpu, n, n, n, A.data(), n, B.data(), n, C.data(), n);
+            } else {
+                tiledGemm(tpu, n, n, n, A.data(), n, B.data(), n, C.data(), n);
+            }
+            const LinkStats& s = tpu.linkStats();
+            double overlap = queued ? linkMillis(std::max(s.bytesSent, s.bytesReceived)) : linkMillis(linkBytes(s));
+            printf("  %-12s %-14s %10llu %10llu %12.1f %12.1f\n",
+                   (std::to_string(n) + "^3").c_str(), queued ? "queued" : "stop-and-wait",
+                   static_cast<unsigned long long>(s.bytesSent), static_cast<unsigned long long>(s.bytesReceived),
+                   linkMillis(linkBytes(s)), overlap);
+        }
+    }
+}
+
+static void benchMacPipeline() {
+    printf("\n[Bench] Pipelined MACs (run timing model, 64^3 GEMM on the FP16 bit-accurate emulator)\n");
+    printf("  %-12s %10s %10s %14s %14s %12s\n",
+           "mult/add", "compute", "run cyc", "MMAC/s@100MHz", "break-even MHz", "rel RMS");
+
+    const size_t n = 64;
+    std::mt19937 rng(69);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> A(n * n), B(n * n), C(n * n), ref(n * n, 0.0f);
+    for (float& x : A) x = dist(rng);
+    for (float& x : B) x = dist(rng);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t k = 0; k < n; k++) {
+            for (size_t j = 0; j < n; j++) ref[i * n + j] += A[i * n + k] * B[k * n + j];
+        }
+    }
+
+    TimingModel base;
+    for (MacPipeline p : {MacPipeline{1, 1}, MacPipeline{2, 1}, MacPipeline{2, 2},
+                          MacPipeline{3, 3}, MacPipeline{4, 4}}) {
+        TimingModel model;
+        model.pipeline = p;
+
+        auto emulator = std::make_unique<TPUEmulator>(AccumulatorMode::FP16, EmulatedArithmetic::BitAccurate);
+        emulator->setMacPipeline(p);
+        TPUDriver tpu(std::move(emulator));
+        tpu.setVerbose(false);
+        tpu.setPrecision(ArrayPrecision::exact());
+        tiledGemm(tpu, n, n, n, A.data(), n, B.data(), n, C.data(), n);
+
+        printf("  %-12s %10u %10u %14.1f %14.1f %12.2e\n",
+               (std::to_string(p.multStages) + "/" + std::to_string(p.addStages)).c_str(),
+               model.computeCycles(), model.runCycles(), model.macsPerSecond() / 1e6,
+               100.0 * model.runCycles() / base.runCycles(), relativeRmsError(C, ref));
+    }
+}
+
+static void benchResultCache() {
+    printf("\n[Bench] Result cache (4096 requests over 64 weight x 64 activation tiles, Zipf s=1.1)\n");
+    printf("  %-12s %10s %10s %12s %12s %12s\n", "budget", "hit rate", "evictions", "link ms", "ns/hit", "host ms");
+
+    const size_t weightTiles = 64, activationTiles = 64, requests = 4096;
+    std::mt19937 rng(71);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<TPUDriver::Matrix> weights(weightTiles), activations(activationTiles);
+    for (auto* pool : {&weights, &activations}) {
+        for (auto& m : *pool) {
+            for (auto& row : m) {
+                for (float& x : row) x = dist(rng);
+            }
+        }
+    }
+
+    // Popular (weight, activation) pairs recur, as in recommendation serving
+    std::vector<double> zipf(weightTiles * activationTiles);
+    for (size_t r = 0; r < zipf.size(); r++) zipf[r] = 1.0 / std::pow(r + 1.0, 1.1);
+    std::discrete_distribution<size_t> pick(zipf.begin(), zipf.end());
+    std::vector<size_t> trace(requests);
+    for (size_t& r : trace) r = pick(rng);
+
+    for (size_t budget : {size_t(0), size_t(64) << 10, size_t(256) << 10, size_t(4) << 20}) {
+        TPUDriver tpu(std::make_unique<TPUEmulator>());
+        tpu.setVerbose(false);
+        if (budget) tpu.enableResultCache(budget);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t r : trace) {
+            tpu.matrixMultiply(weights[r % weightTiles], activations[r / weightTiles]);
+        }
+        double hostMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        // Hit cost: the same lookups again, all resident in a big cache
+        double nsPerHit = 0.0;
+        CacheStats stats = tpu.resultCacheStats();
+        if (budget) {
+            TPUDriver warm(std::make_unique<TPUEmulator>());
+            warm.setVerbose(false);
+            warm.enableResultCache(size_t(4) << 20);
+            for (size_t r : trace) warm.matrixMultiply(weights[r % weightTiles], activations[r / weightTiles]);
+            uint64_t hits = warm.resultCacheStats().hits;
+            auto h0 = std::chrono::steady_clock::now();
+            for (size_t r : trace) warm.matrixMultiply(weights[r % weightTiles], activations[r / weightTiles]);
+            nsPerHit = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - h0).count() /
+                       (warm.resultCacheStats().hits - hits);
+        }
+
+        printf("  %-12s %9.1f%% %10llu %12.1f %12s %12.1f\n",
+               budget ? (std::to_string(budget >> 10) + " KiB").c_str() : "off",
+               stats.hitRate() * 100.0, static_cast<unsigned long long>(stats.evictions),
+               linkMillis(linkBytes(tpu.linkStats())),
+               budget ? std::to_string(static_cast<long>(nsPerHit)).c_str() : "-", hostMs);
+    }
+}
+
+static void benchTraceOverhead() {
+    printf("\n[Bench] Link tracing overhead (64^3 tiled GEMM on the emulator, best of 5)\n");
+    printf("  %-10s %10s %10s %12s %12s %10s\n", "tracing", "host ms", "records", "trace KiB", "ns/record", "dropped");
+
+    const size_t n = 64;
+    std::mt19937 rng(72);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> A(n * n), B(n * n), C(n * n);
+    for (float& x : A) x = dist(rng);
+    for (float& x : B) x = dist(rng);
+
+    double plainMs = 0.0;
+    for (bool traced : {false, true}) {
+        double best = 1e30;
+        TraceStats stats;
+        for (int rep = 0; rep < 5; rep++) {
+            std::FILE* file = traced ? std::tmpfile() : nullptr;
+            std::unique_ptr<TraceRecorder> recorder;
+            std::unique_ptr<Transport> link = std::make_unique<TPUEmulator>();
+            if (file) {
+                recorder = std::make_unique<TraceRecorder>(file, 4 << 20);
+                link = std::make_unique<TracingTransport>(std::move(link), *recorder);
+            }
+            TPUDriver tpu(std::move(link));
+            tpu.setVerbose(false);
+
+            auto t0 = std::chrono::steady_clock::now();
+            tiledGemm(tpu, n, n, n, A.data(), n, B.data(), n, C.data(), n);
+            best = std::min(best, std::chrono::duration<double, std::milli>(
+                                      std::chrono::steady_clock::now() - t0).count());
+            if (recorder) {
+                recorder->stop();
+                stats = recorder->stats();
+                std::fclose(file);
+            }
+        }
+        if (!traced) plainMs = best;
+        printf("  %-10s %10.2f %10llu %12.1f %12s %10llu\n", traced ? "on" : "off", best,
+               static_cast<unsigned long long>(stats.records), stats.bytesWritten / 1024.0,
+               traced ? std::to_string(static_cast<long>((best - plainMs) * 1e6 / stats.records)).c_str() : "-",
+               static_cast<unsigned long long>(stats.dropped));
+    }
+}
+
+/**
+ * Outcome of a tile workload over a faulty link. Latency of an operation
+ * is host time plus modelled wire time of its bytes.
+ */
+struct FaultRun {
+    size_t ok = 0;
+    size_t failed = 0;
+    size_t corrupt = 0;       // completed with a wrong result
+    size_t reconnects = 0;    // driver rebuilt after a failure
+    size_t resyncs = 0;       // recovered in place (RecoveryPolicy)
+    double totalMs = 0.0;
+    std::vector<double> latencyMs;
+
+    double percentile(double p) {
+        if (latencyMs.empty()) return 0.0;
+        std::sort(latencyMs.begin(), latencyMs.end());
+        return latencyMs[std::min(latencyMs.size() - 1, static_cast<size_t>(p / 100.0 * latencyMs.size()))];
+    }
+};
+
+static FaultRun runFaultProfile(const FaultProfile& profile, size_t operations, bool recover) {
+    std::mt19937 rng(73);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    TPUDriver::Matrix w{}, a{};
+    for (auto* m : {&w, &a}) {
+        for (auto& row : *m) {
+            for (float& x : row) x = dist(rng);
+        }
+    }
+    TPUDriver reference(std::make_unique<TPUEmulator>());
+    reference.setVerbose(false);
+    const TPUDriver::Matrix expected = reference.matrixMultiply(w, a);
+
+    FaultProfile seeded = profile;
+    auto connect = [&] {
+        // 2 ms read timeout: the serial port's VTIME, scaled down; the
+        // device idle timeout and the resync idle wait likewise
+        auto device = std::make_unique<TPUEmulator>();
+        device->setIdleTimeout(std::chrono::microseconds(1000));
+        auto link = std::make_unique<FaultInjectingTransport>(std::move(device), seeded,
+                                                              std::chrono::microseconds(2000));
+        auto tpu = std::make_unique<TPUDriver>(std::move(link));
+        tpu->setVerbose(false);
+        if (recover) {
+            RecoveryPolicy policy;
+            policy.enabled = true;
+            policy.idleFlush = std::chrono::microseconds(2000);
+            tpu->setRecovery(policy);
+        }
+        seeded.seed++;
+        return tpu;
+    };
+
+    FaultRun run;
+    std::unique_ptr<TPUDriver> tpu = connect();
+    for (size_t op = 0; op < operations; op++) {
+        uint64_t bytesBefore = linkBytes(tpu->linkStats());
+        uint64_t resyncsBefore = tpu->recoveryStats().resyncs;
+        auto t0 = std::chrono::steady_clock::now();
+        bool failed = false;
+        try {
+            run.corrupt += tpu->matrixMultiply(w, a) != expected;
+        } catch (const std::runtime_error&) {
+            failed = true;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() +
+                    linkMillis(linkBytes(tpu->linkStats()) - bytesBefore);
+        run.latencyMs.push_back(ms);
+        run.totalMs += ms;
+        run.resyncs += tpu->recoveryStats().resyncs - resyncsBefore;
+        if (failed) {
+            // Out of step (or recovery gave up): start over
+            run.failed++;
+            run.reconnects++;
+            tpu = connect();
+        } else {
+            run.ok++;
+        }
+    }
+    return run;
+}
+
+static void benchFaultInjection() {
+    const size_t operations = 300;
+    printf("\n[Bench] Fault injection (%zu 8x8 multiplies per profile, latency = host + wire time)\n", operations);
+    printf("  %-16s %-8s %6s %7s %8s %10s %7s %10s %10s %10s\n", "profile", "recovery",
+           "ok", "failed", "corrupt", "reconnect", "resync", "tiles/s", "p50 ms", "p99 ms");
+
+    for (const FaultProfile& profile : {FaultProfile::clean(), FaultProfile::noisy(1e-4), FaultProfile::lossy(1e-4),
+                                        FaultProfile::slow(0.01), FaultProfile::stalling(1e-3)}) {
+        for (bool recover : {false, true}) {
+            FaultRun run = runFaultProfile(profile, operations, recover);
+            printf("  %-16s %-8s %6zu %7zu %8zu %10zu %7zu %10.2f %10.1f %10.1f\n", profile.name.c_str(),
+                   recover ? "resync" : "off", run.ok, run.failed, run.corrupt, run.reconnects, run.resyncs,
+                   (run.ok - run.corrupt) / (run.totalMs / 1000.0), run.percentile(50), run.percentile(99));
+        }
+    }
+}
+
+static void benchMetricsOverhead() {
+    printf("\n[Bench] Metrics instrumentation\n");
+
+    // Hot-path increments from 4 threads: one shared atomic vs sharded
+    // (contention only shows with as many cores as threads)
+    const int threads = 4, adds = 2000000;
+    std::atomic<uint64_t> shared{0};
+    Counter sharded;
+    for (bool useShards : {false, true}) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&] {
+                for (int i = 0; i < adds; i++) {
+                    if (useShards) {
+                        sharded.add();
+                    } else {
+                        shared.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        // Thread time per add: wall time x cores in use / adds
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() *
+                    std::min<unsigned>(threads, cores) / (static_cast<double>(adds) * threads);
+        printf("  %-28s %8.2f ns/add (%d threads, %u cores)\n", useShards ? "sharded Counter" : "single std::atomic",
+               ns, threads, cores);
+    }
+
+    // Instrumented driver on a tiled GEMM
+    const size_t n = 64;
+    std::mt19937 rng(75);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> A(n * n), B(n * n), C(n * n);
+    for (float& x : A) x = dist(rng);
+    for (float& x : B) x = dist(rng);
+
+    MetricsRegistry registry;
+    auto metrics = std::make_shared<DriverMetrics>(registry);
+    double plainMs = 0.0;
+    for (bool instrumented : {false, true}) {
+        double best = 1e30;
+        for (int rep = 0; rep < 5; rep++) {
+            TPUDriver tpu(std::make_unique<TPUEmulator>());
+            tpu.setVerbose(false);
+            if (instrumented) tpu.setMetrics(metrics);
+            auto t0 = std::chrono::steady_clock::now();
+            tiledGemm(tpu, n, n, n, A.data(), n, B.data(), n, C.data(), n);
+            best = std::min(best, std::chrono::duration<double, std::milli>(
+                                      std::chrono::steady_clock::now() - t0).count());
+        }
+        if (!instrumented) plainMs = best;
+        printf("  64^3 GEMM, metrics %-8s %8.2f ms host", instrumented ? "on" : "off", best);
+        if (instrumented) printf(" (%+.1f%%)", (best - plainMs) / plainMs * 100.0);
+        printf("\n");
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::string text;
+    const int scrapes = 1000;
+    for (int i = 0; i < scrapes; i++) text = registry.render();
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / scrapes;
+    printf("  render                       %8.1f us/scrape (%zu bytes)\n", us, text.size());
+}
+
+int main() {
+    printf("============================================\n");
+    printf("TPU Host Runtime Benchmarks\n");
+    printf("============================================\n");
+
+    benchReadbackCompression();
+    benchDeltaUpload();
+    benchTileEncode();
+    benchFP16Decode();
+    benchSteadyStateAllocations();
+    benchStagingMemory();
+    benchDeviceAccumulation();
+    benchPrecisionTuner();
+    benchLayerChaining();
+    benchJobQueue();
+    benchMacPipeline();
+    benchResultCache();
+    benchTraceOverhead();
+    benchFaultInjection();
+    benchMetricsOverhead();
+
+    return 0;
+}
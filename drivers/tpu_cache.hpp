@@ -0,0 +1,246 @@
+/**
+ * Result memoization for repeated tile products
+ *
+ * A (weight tile, activation tile) pair run at the same device
+ * configuration always gives the same result, so the host can answer a
+ * repeat from memory instead of the link. Keys are the two FP16 wire
+ * buffers plus a configuration word (precision, epilogue, readback width),
+ * hashed with XXH64; the full key is stored and compared, so a hash
+ * collision costs a miss, never a wrong result.
+ *
+ * The cache is LRU with a byte budget; CacheStats counts hits, misses and
+ * evictions. TPUDriver::enableResultCache() puts one in front of
+ * matrixMultiply() and multiplyResident().
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <ostream>
+#include <unordered_map>
+
+/**
+ * XXH64 (xxHash, 64-bit variant) of `len` bytes
+ */
+inline uint64_t xxh64(const void* data, size_t len, uint64_t seed = 0) {
+    constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto round = [&](uint64_t acc, uint64_t lane) { return rotl(acc + lane * P2, 31) * P1; };
+    auto merge = [&](uint64_t h, uint64_t v) { return (h ^ round(0, v)) * P1 + P4; };
+    auto load64 = [](const uint8_t* p) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+        return v;
+    };
+    auto load32 = [](const uint8_t* p) {
+        return static_cast<uint64_t>(p[0] | (p[1] << 8) | (p[2] << 16)) |
+               (static_cast<uint64_t>(p[3]) << 24);
+    };
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = round(v1, load64(p));
+            v2 = round(v2, load64(p + 8));
+            v3 = round(v3, load64(p + 16));
+            v4 = round(v4, load64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(h, v1);
+        h = merge(h, v2);
+        h = merge(h, v3);
+        h = merge(h, v4);
+    } else {
+        h = seed + P5;
+    }
+    h += len;
+
+    for (; p + 8 <= end; p += 8) {
+        h = rotl(h ^ round(0, load64(p)), 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+        h = rotl(h ^ (load32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h = rotl(h ^ (*p * P5), 11) * P1;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * Result cache counters
+ */
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;   // held by entries (keys, results, bookkeeping)
+
+    double hitRate() const {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0.0;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const CacheStats& s) {
+        return os << "CacheStats(hits=" << s.hits << ", misses=" << s.misses
+                  << ", hit_rate=" << s.hitRate() * 100.0 << "%"
+                  << ", evictions=" << s.evictions << ", entries=" << s.entries
+                  << ", bytes=" << s.bytes << ")";
+    }
+};
+
+/**
+ * LRU map from (weights, activations, config) to a result tile of N values
+ */
+template <size_t N>
+class TileResultCache {
+public:
+    using Result = std::array<float, N>;
+
+    struct Key {
+        std::array<uint16_t, 2 * N> words;   // weights, then activations
+        uint32_t config = 0;
+        uint64_t hash = 0;
+
+        bool operator==(const Key& o) const {
+            return hash == o.hash && config == o.config && words == o.words;
+        }
+    };
+
+    /**
+     * Bytes one entry costs against the budget: key, result and an
+     * estimate for its list and index nodes
+     */
+    static constexpr size_t ENTRY_BYTES = sizeof(Key) + sizeof(Result) + 8 * sizeof(void*);
+
+    explicit TileResultCache(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+    static Key makeKey(const uint16_t* weights, const uint16_t* activations, uint32_t config) {
+        Key key;
+        std::memcpy(key.words.data(), weights, N * sizeof(uint16_t));
+        std::memcpy(key.words.data() + N, activations, N * sizeof(uint16_t));
+        key.config = config;
+        key.hash = xxh64(key.words.data(), sizeof(key.words), config);
+        return key;
+    }
+
+    /**
+     * Cached result for `key`, made most recently used; null on a miss
+     */
+    const Result* find(const Key& key) {
+        auto it = index_.find(key.hash);
+        if (it != index_.end()) {
+            for (auto entry : it->second) {
+                if (entry->key == key) {
+                    lru_.splice(lru_.begin(), lru_, entry);
+                    stats_.hits++;
+                    return &entry->result;
+                }
+            }
+        }
+        stats_.misses++;
+        return nullptr;
+    }
+
+    /**
+     * Remember a result, evicting least recently used entries to stay
+     * within the budget. A budget below one entry caches nothing.
+     */
+    void insert(const Key& key, const Result& result) {
+        if (ENTRY_BYTES > maxBytes_) {
+            return;
+        }
+        auto it = index_.find(key.hash);
+        if (it != index_.end()) {
+            for (auto entry : it->second) {
+                if (entry->key == key) {
+                    entry->result = result;
+                    lru_.splice(lru_.begin(), lru_, entry);
+                    return;
+                }
+            }
+        }
+        while (stats_.bytes + ENTRY_BYTES > maxBytes_) {
+            evictOldest();
+        }
+        lru_.push_front(Entry{key, result});
+        index_[key.hash].push_front(lru_.begin());
+        stats_.insertions++;
+        stats_.entries++;
+        stats_.bytes += ENTRY_BYTES;
+    }
+
+    /**
+     * Drop all entries (counters are kept)
+     */
+    void clear() {
+        lru_.clear();
+        index_.clear();
+        stats_.entries = 0;
+        stats_.bytes = 0;
+    }
+
+    void setMaxBytes(size_t maxBytes) {
+        maxBytes_ = maxBytes;
+        while (stats_.bytes > maxBytes_) {
+            evictOldest();
+        }
+    }
+
+    size_t maxBytes() const { return maxBytes_; }
+    const CacheStats& stats() const { return stats_; }
+    void resetStats() {
+        CacheStats kept;
+        kept.entries = stats_.entries;
+        kept.bytes = stats_.bytes;
+        stats_ = kept;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Result result;
+    };
+    using Iterator = typename std::list<Entry>::iterator;
+
+    size_t maxBytes_;
+    std::list<Entry> lru_;   // most recently used first
+    std::unordered_map<uint64_t, std::list<Iterator>> index_;
+    CacheStats stats_;
+
+    void evictOldest() {
+        Iterator victim = std::prev(lru_.end());
+        auto bucket = index_.find(victim->key.hash);
+        bucket->second.remove(victim);
+        if (bucket->second.empty()) {
+            index_.erase(bucket);
+        }
+        lru_.erase(victim);
+        stats_.evictions++;
+        stats_.entries--;
+        stats_.bytes -= ENTRY_BYTES;
+    }
+};
@@ -0,0 +1,320 @@
+/**
+ * 2D convolution lowered onto the 8x8 TPU
+ *
+ * conv2d is computed as the GEMM  Out[O][P] = W[O][K] * Col[K][P]  with
+ *   K = C * KH * KW  (input channel, kernel row, kernel column)
+ *   P = N * OH * OW  (image, output row, output column)
+ * The im2col matrix Col is never materialised: each 8x8 activation tile is
+ * gathered straight from the input tensor when it is needed, so host memory
+ * stays at a couple of tiles regardless of image size. Each weight tile is
+ * uploaded once and reused across every output position.
+ *
+ * Weights are OIHW. Input and output share the layout given in the shape
+ * (NCHW or NHWC).
+ *
+ * Grouped and depthwise convolutions (groups > 1) are block-diagonal GEMMs.
+ * Padding each group to its own 8x8 tile wastes most of the array, so
+ * several groups are packed into one tile: their output rows are stacked
+ * and their K slices sit side by side, so each packed weight tile is
+ * block-diagonal and every activation row carries real data.
+ */
+
+#pragma once
+
+#include "tpu_gemm.hpp"
+
+enum class TensorLayout {
+    NCHW,
+    NHWC
+};
+
+struct Conv2DParams {
+    size_t strideH = 1, strideW = 1;
+    size_t padH = 0, padW = 0;
+    size_t dilationH = 1, dilationW = 1;
+};
+
+struct Conv2DShape {
+    size_t batch = 1;
+    size_t channels = 0;        // C
+    size_t height = 0;          // H
+    size_t width = 0;           // W
+    size_t outChannels = 0;     // O
+    size_t kernelH = 1;
+    size_t kernelW = 1;
+    size_t groups = 1;          // channels and outChannels split into groups
+    TensorLayout layout = TensorLayout::NCHW;
+
+    size_t outHeight(const Conv2DParams& p) const {
+        return outExtent(height, kernelH, p.strideH, p.padH, p.dilationH);
+    }
+
+    size_t outWidth(const Conv2DParams& p) const {
+        return outExtent(width, kernelW, p.strideW, p.padW, p.dilationW);
+    }
+
+    static size_t outExtent(size_t in, size_t kernel, size_t stride,
+                            size_t pad, size_t dilation) {
+        size_t span = dilation * (kernel - 1) + 1;
+        if (in + 2 * pad < span) return 0;
+        return (in + 2 * pad - span) / stride + 1;
+    }
+};
+
+/**
+ * Lazy im2col view of an input tensor
+ *
+ * Row k of the virtual matrix is (c, kh, kw), column p is (n, oh, ow).
+ * fillTile() gathers one 8x8 tile, zero-filling padding and edges.
+ */
+class Im2ColView {
+public:
+    Im2ColView(const Conv2DShape& shape, const Conv2DParams& params, const float* input)
+        : shape_(shape), params_(params), input_(input),
+          oh_(shape.outHeight(params)), ow_(shape.outWidth(params)) {
+        rows_ = shape.channels * shape.kernelH * shape.kernelW;
+        cols_ = shape.batch * oh_ * ow_;
+
+        if (shape.layout == TensorLayout::NCHW) {
+            strideN_ = shape.channels * shape.height * shape.width;
+            strideC_ = shape.height * shape.width;
+            strideH_ = shape.width;
+            strideW_ = 1;
+        } else {
+            strideN_ = shape.height * shape.width * shape.channels;
+            strideC_ = 1;
+            strideH_ = shape.width * shape.channels;
+            strideW_ = shape.channels;
+        }
+    }
+
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+
+    /**
+     * Gather Col[k0 .. k0+7][p0 .. p0+7]
+     */
+    void fillTile(TPUDriver::Matrix& tile, size_t k0, size_t p0) const {
+        std::array<size_t, MATRIX_SIZE> kRows;
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            kRows[i] = k0 + i;
+        }
+        fillTileRows(tile, kRows, MATRIX_SIZE, p0);
+    }
+
+    /**
+     * Gather Col[kRows[i]][p0 .. p0+7] for i < count; remaining rows are zero
+     */
+    void fillTileRows(TPUDriver::Matrix& tile, const std::array<size_t, MATRIX_SIZE>& kRows,
+                      size_t count, size_t p0) const {
+        // Decode the tile's row and column indices once
+        std::array<ptrdiff_t, MATRIX_SIZE> kOffset, kh, kw, pOffset, ih0, iw0;
+        std::array<bool, MATRIX_SIZE> kValid, pValid;
+
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            size_t k = kRows[i];
+            kValid[i] = i < count && k < rows_;
+            if (kValid[i]) {
+                size_t c = k / (shape_.kernelH * shape_.kernelW);
+                size_t r = k % (shape_.kernelH * shape_.kernelW);
+                kOffset[i] = static_cast<ptrdiff_t>(c * strideC_);
+                kh[i] = static_cast<ptrdiff_t>((r / shape_.kernelW) * params_.dilationH);
+                kw[i] = static_cast<ptrdiff_t>((r % shape_.kernelW) * params_.dilationW);
+            }
+
+            size_t p = p0 + i;
+            pValid[i] = p < cols_;
+            if (pValid[i]) {
+                size_t n = p / (oh_ * ow_);
+                size_t r = p % (oh_ * ow_);
+                pOffset[i] = static_cast<ptrdiff_t>(n * strideN_);
+                ih0[i] = static_cast<ptrdiff_t>((r / ow_) * params_.strideH) - static_cast<ptrdiff_t>(params_.padH);
+                iw0[i] = static_cast<ptrdiff_t>((r % ow_) * params_.strideW) - static_cast<ptrdiff_t>(params_.padW);
+            }
+        }
+
+        const ptrdiff_t H = static_cast<ptrdiff_t>(shape_.height);
+        const ptrdiff_t W = static_cast<ptrdiff_t>(shape_.width);
+
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            for (size_t j = 0; j < MATRIX_SIZE; j++) {
+                float value = 0.0f;
+                if (kValid[i] && pValid[j]) {
+                    ptrdiff_t ih = ih0[j] + kh[i];
+                    ptrdiff_t iw = iw0[j] + kw[i];
+                    if (ih >= 0 && ih < H && iw >= 0 && iw < W) {
+                        value = input_[pOffset[j] + kOffset[i] +
+                                       ih * static_cast<ptrdiff_t>(strideH_) +
+                                       iw * static_cast<ptrdiff_t>(strideW_)];
+                    }
+                }
+                tile[i][j] = value;
+            }
+        }
+    }
+
+private:
+    Conv2DShape shape_;
+    Conv2DParams params_;
+    const float* input_;
+    size_t oh_, ow_;
+    size_t rows_, cols_;
+    size_t strideN_, strideC_, strideH_, strideW_;
+};
+
+/**
+ * Output tensor offsets for GEMM column p and output channel o
+ */
+class ConvOutputView {
+public:
+    ConvOutputView(const Conv2DShape& shape, const Conv2DParams& params, float* output)
+        : output_(output), outChannels_(shape.outChannels),
+          plane_(shape.outHeight(params) * shape.outWidth(params)),
+          layout_(shape.layout) {}
+
+    size_t offset(size_t o, size_t p) const {
+        size_t n = p / plane_;
+        size_t pos = p % plane_;
+        if (layout_ == TensorLayout::NCHW) {
+            return (n * outChannels_ + o) * plane_ + pos;
+        }
+        return (n * plane_ + pos) * outChannels_ + o;
+    }
+
+    float& at(size_t o, size_t p) const { return output_[offset(o, p)]; }
+
+private:
+    float* output_;
+    size_t outChannels_;
+    size_t plane_;
+    TensorLayout layout_;
+};
+
+/**
+ * Output element count for a convolution
+ */
+inline size_t conv2dOutputSize(const Conv2DShape& shape, const Conv2DParams& params) {
+    return shape.batch * shape.outChannels * shape.outHeight(params) * shape.outWidth(params);
+}
+
+/**
+ * How a (grouped) convolution is cut into 8x8 tiles
+ */
+struct GroupPacking {
+    size_t groupsPerTile = 1;   // groups stacked block-diagonally
+    size_t outPerTile = 1;      // output channels of each group per tile
+    size_t kPerTile = 1;        // K elements of each group per tile
+    size_t tilesPerSweep = 0;   // weight tiles needed to cover the layer
+};
+
+/**
+ * Pick the packing that needs the fewest tiles per output column tile.
+ * groups == 1 reduces to plain 8x8 tiling of the dense GEMM.
+ */
+inline GroupPacking chooseGroupPacking(size_t groups, size_t outPerGroup, size_t kPerGroup) {
+    if (groups == 0 || outPerGroup == 0 || kPerGroup == 0) {
+        throw std::invalid_argument("Group packing needs non-empty groups");
+    }
+    GroupPacking best;
+    size_t outPerTile = std::min(outPerGroup, MATRIX_SIZE);
+
+    for (size_t gp = 1; gp <= std::min(groups, MATRIX_SIZE / outPerTile); gp++) {
+        size_t kPerTile = std::min(kPerGroup, MATRIX_SIZE / gp);
+        size_t tiles = ((groups + gp - 1) / gp) *
+                       ((outPerGroup + outPerTile - 1) / outPerTile) *
+                       ((kPerGroup + kPerTile - 1) / kPerTile);
+        if (best.tilesPerSweep == 0 || tiles < best.tilesPerSweep) {
+            best = {gp, outPerTile, kPerTile, tiles};
+        }
+    }
+    return best;
+}
+
+/**
+ * 2D convolution on the TPU; output must hold conv2dOutputSize() floats.
+ * Weights are OIHW with I = channels / groups.
+ */
+template <typename Engine>
+GemmStats conv2d(Engine& tpu, const Conv2DShape& shape, const Conv2DParams& params,
+                 const float* input, const float* weights, float* output) {
+    if (params.strideH == 0 || params.strideW == 0 ||
+        params.dilationH == 0 || params.dilationW == 0) {
+        throw std::invalid_argument("Stride and dilation must be at least 1");
+    }
+    if (shape.kernelH == 0 || shape.kernelW == 0) {
+        throw std::invalid_argument("Kernel size must be at least 1");
+    }
+    if (shape.channels == 0 || shape.outChannels == 0) {
+        throw std::invalid_argument("Input and output channels must be at least 1");
+    }
+    if (shape.groups == 0 || shape.channels % shape.groups != 0 ||
+        shape.outChannels % shape.groups != 0) {
+        throw std::invalid_argument("Channels must divide evenly into groups");
+    }
+
+    GemmStats stats;
+    Im2ColView col(shape, params, input);
+    ConvOutputView out(shape, params, output);
+
+    const size_t G = shape.groups;
+    const size_t Og = shape.outChannels / G;
+    const size_t Kg = col.rows() / G;
+    const size_t P = col.cols();
+    const GroupPacking pack = chooseGroupPacking(G, Og, Kg);
+
+    std::fill(output, output + conv2dOutputSize(shape, params), 0.0f);
+
+    TPUDriver::Matrix weightTile, activationTile;
+    std::array<size_t, MATRIX_SIZE> kRows;
+
+    for (size_t g0 = 0; g0 < G; g0 += pack.groupsPerTile) {
+        size_t groupCount = std::min(pack.groupsPerTile, G - g0);
+
+        for (size_t o0 = 0; o0 < Og; o0 += pack.outPerTile) {
+            size_t outCount = std::min(pack.outPerTile, Og - o0);
+
+            for (size_t k0 = 0; k0 < Kg; k0 += pack.kPerTile) {
+                size_t kCount = std::min(pack.kPerTile, Kg - k0);
+
+                // Block-diagonal weight tile: group gi owns rows
+                // [gi*outCount, ...) and columns [gi*kCount, ...)
+                for (auto& row : weightTile) row.fill(0.0f);
+                for (size_t gi = 0; gi < groupCount; gi++) {
+                    size_t g = g0 + gi;
+                    for (size_t oi = 0; oi < outCount; oi++) {
+                        // OIHW weights are the row-major W[O][Kg] matrix
+                        const float* src = weights + (g * Og + o0 + oi) * Kg + k0;
+                        for (size_t kj = 0; kj < kCount; kj++) {
+                            weightTile[gi * outCount + oi][gi * kCount + kj] = src[kj];
+                        }
+                    }
+                    for (size_t kj = 0; kj < kCount; kj++) {
+                        kRows[gi * kCount + kj] = g * Kg + k0 + kj;
+                    }
+                }
+                tpu.writeWeights(weightTile);
+                stats.weightUploads++;
+
+                for (size_t p0 = 0; p0 < P; p0 += MATRIX_SIZE) {
+                    size_t cols = std::min(MATRIX_SIZE, P - p0);
+
+                    col.fillTileRows(activationTile, kRows, groupCount * kCount, p0);
+                    auto result = tpu.multiplyResident(activationTile);
+                    stats.tileMultiplies++;
+                    stats.usefulMacs += groupCount * outCount * kCount * cols;
+
+                    for (size_t gi = 0; gi < groupCount; gi++) {
+                        for (size_t oi = 0; oi < outCount; oi++) {
+                            size_t o = (g0 + gi) * Og + o0 + oi;
+                            for (size_t j = 0; j < cols; j++) {
+                                out.at(o, p0 + j) += result[gi * outCount + oi][j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return stats;
+}
@@ -71,40 +71,67 @@ typedef union {
 } fp16_t;
 
 /**
- * Convert float32 to float16
+ * Convert float32 to float16, round to nearest even, subnormals kept
  */
 uint16_t float_to_fp16(float value) {
     uint32_t f32;
     memcpy(&f32, &value, sizeof(float));
     
-    uint32_t sign = (f32 >> 31) & 0x1;
-    uint32_t exp32 = (f32 >> 23) & 0xFF;
-    uint32_t mant32 = f32 & 0x7FFFFF;
+    uint32_t sign = (f32 >> 16) & 0x8000;
+    uint32_t abs = f32 & 0x7FFFFFFF;
     
     // Handle special cases
-    if (exp32 == 0xFF) {  // Inf or NaN
-        return (sign << 15) | 0x7C00 | (mant32 ? 0x200 : 0);
-    }
-    if (exp32 == 0) {  // Zero or denormal
-        return (sign << 15);
-    }
+    if (abs > 0x7F800000) {  // NaN: quiet, top payload bits kept
+        return sign | 0x7E00 | ((abs >> 13) & 0x3FF);
+    }
+    if (abs >= 0x477FF000) {  // 65520 and up (and Inf) round to Inf
+        return sign | 0x7C00;
+    }
+    if (abs < 0x38800000) {  // Below 2^-14: subnormal in units of 2^-24
+        if (abs <= 0x33000000) return sign;  // <= 2^-25 ties to zero
+        uint32_t mant = (abs & 0x7FFFFF) | 0x800000;
+        uint32_t shift = 126 - (abs >> 23);
+        uint32_t half = mant >> shift;
+        uint32_t rest = mant & ((1u << shift) - 1);
+        uint32_t tie = 1u << (shift - 1);
+        if (rest > tie || (rest == tie && (half & 1))) half++;
+        return sign | half;
+    }
+    
+    // Rebias exponent, round mantissa (23-bit to 10-bit) to nearest even;
+    // a carry out of the mantissa bumps the exponent
+    uint32_t bits = abs - ((127 - 15) << 23);
+    bits += 0xFFF + ((bits >> 13) & 1);
+    return sign | (bits >> 13);
+}
+
+/**
+ * Convert float32 to float16 as the datapath does: truncate, flush
+ * subnormals to zero
+ */
+uint16_t float_to_fp16_hw(float value) {
+    uint32_t f32;
+    memcpy(&f32, &value, sizeof(float));
     
-    // Convert exponent
-    int32_t exp16 = exp32 - 127 + 15;
-    if (exp16 <= 0) return (sign << 15);  // Underflow
-    if (exp16 >= 31) return (sign << 15) | 0x7C00;  // Overflow
+    uint32_t sign = (f32 >> 16) & 0x8000;
+    uint32_t abs = f32 & 0x7FFFFFFF;
     
-    // Convert mantissa (23-bit to 10-bit)
-    uint16_t mant16 = mant32 >> 13;
+    if (abs >= 0x7F800000) {  // Inf or NaN
+        return sign | (abs > 0x7F800000 ? 0x7E00 | ((abs >> 13) & 0x3FF) : 0x7C00);
+    }
+    
+    int32_t exp16 = (int32_t)(abs >> 23) - 127 + 15;
+    if (exp16 <= 0) return sign;  // Underflow
+    if (exp16 >= 31) return sign | 0x7C00;  // Overflow
     
-    return (sign << 15) | (exp16 << 10) | mant16;
+    return sign | (exp16 << 10) | ((abs >> 13) & 0x3FF);
 }
 
 /**
- * Convert float16 to float32
+ * Convert float16 to float32 (exact, subnormals included)
  */
 float fp16_to_float(uint16_t fp16) {
-    uint32_t sign = (fp16 >> 15) & 0x1;
+    uint32_t sign = (uint32_t)(fp16 & 0x8000) << 16;
     uint32_t exp16 = (fp16 >> 10) & 0x1F;
     uint32_t mant16 = fp16 & 0x3FF;
     
@@ -112,15 +139,17 @@ float fp16_to_float(uint16_t fp16) {
     
     // Handle special cases
     if (exp16 == 0x1F) {  // Inf or NaN
-        f32 = (sign << 31) | 0x7F800000 | (mant16 << 13);
-    } else if (exp16 == 0) {  // Zero or denormal
-        f32 = (sign << 31);
+        f32 = sign | 0x7F800000 | (mant16 << 13);
+    } else if (exp16 == 0) {  // Zero or subnormal: mant16 * 2^-24
+        float magnitude = (float)mant16 * 5.9604644775390625e-8f;
+        memcpy(&f32, &magnitude, sizeof(float));
+        f32 |= sign;
     } else {
         // Convert exponent
         uint32_t exp32 = exp16 - 15 + 127;
         // Convert mantissa
         uint32_t mant32 = mant16 << 13;
-        f32 = (sign << 31) | (exp32 << 23) | mant32;
+        f32 = sign | (exp32 << 23) | mant32;
     }
     
     float result;
@@ -128,6 +157,16 @@ float fp16_to_float(uint16_t fp16) {
     return result;
 }
 
+/**
+ * Convert float16 to float32 as the datapath reads it: subnormals are zero
+ */
+float fp16_to_float_hw(uint16_t fp16) {
+    if ((fp16 & 0x7C00) == 0) {
+        return (fp16 & 0x8000) ? -0.0f : 0.0f;
+    }
+    return fp16_to_float(fp16);
+}
+
 /**
  * Open serial port
  */
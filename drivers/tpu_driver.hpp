@@ -0,0 +1,2297 @@
+/**
+ * TPU Driver for Basys3 FPGA (C++ Implementation)
+ * FP16 helpers, link transports and the TPUDriver class.
+ *
+ * Header-only: include it from applications and tools, e.g.
+ *   #include "tpu_driver.hpp"
+ * The demo program lives in tpu_driver.cpp.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cmath>
+#include <memory>
+#include <cstddef>
+#include <optional>
+
+#include "tpu_arena.hpp"
+#include "tpu_cache.hpp"
+#include "tpu_metrics.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define TPU_HAVE_SSE2 1
+#endif
+
+// F16C is picked at run time, so the build needs no -mf16c
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #include <immintrin.h>
+    #define TPU_HAVE_F16C 1
+#endif
+
+#ifdef _WIN32
+    #include <windows.h>
+    using serial_handle_t = HANDLE;
+    constexpr serial_handle_t INVALID_SERIAL = INVALID_HANDLE_VALUE;
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <termios.h>
+    using serial_handle_t = int;
+    constexpr serial_handle_t INVALID_SERIAL = -1;
+#endif
+
+constexpr size_t MATRIX_SIZE = 8;
+
+// TPU Commands
+enum class TPUCommand : uint8_t {
+    WriteWeight = 'W',
+    WriteActivation = 'A',
+    Start = 'S',
+    ReadResult = 'R',
+    Status = '?'
+};
+
+// Framed commands served by uart_protocol_handler.v
+enum class ProtocolCommand : uint8_t {
+    WriteMatrixA = 0x01,
+    WriteMatrixB = 0x02,
+    ReadResult = 0x03,
+    StartCompute = 0x04,
+    GetStatus = 0x05,
+    Reset = 0x06,
+    ReadMatrixA = 0x07,
+    ReadMatrixB = 0x08,
+    ReadResultCompressed = 0x09,
+    WriteElements = 0x0A,
+    WriteRange = 0x0B,
+    ReadResultWide = 0x0C,
+    StartAccumulate = 0x0D,
+    SetPrecision = 0x0E,
+    ChainResult = 0x0F,
+    EnqueueJob = 0x10,
+    QueueStatus = 0x11,
+    ReadSlot = 0x12,
+    SlotStatus = 0x13,
+    SetEpilogue = 0x14,
+    Checksum = 0x15
+};
+
+// Buffer operand of WriteElements / WriteRange
+// (matrix A holds activations, matrix B weights on tpu_top_with_io_complete)
+enum class DeviceBuffer : uint8_t {
+    Activations = 0x00,
+    Weights = 0x01,
+    Residual = 0x02,   // 64 elements added by the epilogue
+    Bias = 0x03        // MATRIX_SIZE elements, one per result row (output feature)
+};
+
+/**
+ * Elements in a device buffer
+ */
+inline size_t bufferElements(DeviceBuffer buffer) {
+    return buffer == DeviceBuffer::Bias ? MATRIX_SIZE : MATRIX_SIZE * MATRIX_SIZE;
+}
+
+// Buffer operand of Checksum
+enum class ChecksumBuffer : uint8_t {
+    Activations = 0x00,
+    Weights = 0x01,
+    Result = 0x02,
+    Slot = 0x10        // | slot number
+};
+
+/**
+ * Reply of ProtocolCommand::Checksum: a = sum of the words, b = sum of
+ * the running a, both mod 2^16, as (b << 16) | a. Any single flipped bit
+ * changes a.
+ */
+inline uint32_t bufferChecksum(const uint16_t* words, size_t count) {
+    uint16_t a = 0, b = 0;
+    for (size_t i = 0; i < count; i++) {
+        a = static_cast<uint16_t>(a + words[i]);
+        b = static_cast<uint16_t>(b + a);
+    }
+    return (static_cast<uint32_t>(b) << 16) | a;
+}
+
+/**
+ * Activation applied on the device when results are chained into the
+ * activation buffer (ProtocolCommand::ChainResult); activation_functions.v
+ * encoding, FP16 variants
+ */
+enum class DeviceActivation : uint8_t {
+    None = 0,
+    ReLU = 1,
+    ReLU6 = 2,
+    Sigmoid = 3,
+    Tanh = 4,
+    LeakyReLU = 5,
+    Swish = 6,
+    GELU = 7
+};
+
+/**
+ * Result epilogue applied on the device as results are drained
+ * (ProtocolCommand::SetEpilogue): act(result + bias[row] + residual).
+ * The additions are FP16, truncating; the FP32 (wide) results are not
+ * affected.
+ */
+struct DeviceEpilogue {
+    bool bias = false;
+    bool residual = false;
+    DeviceActivation activation = DeviceActivation::None;
+
+    /**
+     * [0] bias, [1] residual, [4:2] activation
+     */
+    uint8_t encode() const {
+        return static_cast<uint8_t>((bias ? 0x01 : 0) | (residual ? 0x02 : 0) |
+                                    ((static_cast<uint8_t>(activation) & 0x07) << 2));
+    }
+
+    static DeviceEpilogue decode(uint8_t b) {
+        DeviceEpilogue e;
+        e.bias = b & 0x01;
+        e.residual = b & 0x02;
+        e.activation = static_cast<DeviceActivation>((b >> 2) & 0x07);
+        return e;
+    }
+
+    bool enabled() const { return encode() != 0; }
+
+    bool operator==(const DeviceEpilogue& o) const { return encode() == o.encode(); }
+    bool operator!=(const DeviceEpilogue& o) const { return !(*this == o); }
+};
+
+/**
+ * Datapath width of a bitstream built with RUNTIME_PRECISION = 1, sent as
+ * one byte {alignMax, multBits} with ProtocolCommand::SetPrecision. The
+ * register is sticky; it resets to approximate().
+ */
+struct ArrayPrecision {
+    uint8_t multBits = 6;   // multiplier mantissa bits incl. the implicit 1 (1-11)
+    uint8_t alignMax = 4;   // adder alignment window in exponent steps (15 = whole mantissa)
+
+    static constexpr ArrayPrecision exact() { return {11, 15}; }
+    static constexpr ArrayPrecision approximate() { return {6, 4}; }
+
+    uint8_t encode() const {
+        return static_cast<uint8_t>(((alignMax & 0x0F) << 4) | (multBits & 0x0F));
+    }
+
+    static ArrayPrecision decode(uint8_t b) {
+        return {static_cast<uint8_t>(b & 0x0F), static_cast<uint8_t>(b >> 4)};
+    }
+
+    bool operator==(const ArrayPrecision& o) const {
+        return multBits == o.multBits && alignMax == o.alignMax;
+    }
+    bool operator!=(const ArrayPrecision& o) const { return !(*this == o); }
+
+    friend std::ostream& operator<<(std::ostream& os, const ArrayPrecision& p) {
+        return os << "ArrayPrecision(mult_bits=" << int(p.multBits)
+                  << ", align=" << int(p.alignMax) << ")";
+    }
+};
+
+constexpr uint8_t RESP_ACK = 0xAA;
+constexpr uint8_t RESP_NACK = 0x55;
+
+// Job queue of tpu_top_with_io_complete (QUEUE_DEPTH / RESULT_SLOTS parameters)
+constexpr size_t JOB_QUEUE_DEPTH = 4;
+constexpr size_t RESULT_SLOTS = 16;
+
+// Memory addresses
+constexpr uint8_t WEIGHT_BASE = 0;
+constexpr uint8_t ACTIVATION_BASE = 128;
+constexpr uint8_t RESULT_BASE = 192;
+
+/**
+ * TPU Status structure
+ */
+struct TPUStatus {
+    bool busy;
+    bool done;
+    
+    TPUStatus() : busy(false), done(false) {}
+    TPUStatus(uint8_t status_byte) 
+        : busy(status_byte & 0x01), done(status_byte & 0x02) {}
+    
+    friend std::ostream& operator<<(std::ostream& os, const TPUStatus& s) {
+        return os << "TPUStatus(busy=" << s.busy << ", done=" << s.done << ")";
+    }
+};
+
+/**
+ * Host FP16 rounding
+ *   IEEE:     round to nearest even, subnormals kept (what F16C does)
+ *   Hardware: truncate, subnormals flushed to zero (what the datapath does)
+ * The device takes any bit pattern, so uploads default to IEEE; the
+ * emulator uses Hardware to reproduce the array's own rounding.
+ */
+enum class FP16Mode {
+    IEEE,
+    Hardware
+};
+
+/**
+ * FP16 utilities. The scalar conversions are constexpr (see
+ * tpu_fp16_table.hpp); the array converters use F16C when the CPU has it
+ * (checked once at run time) and fall back to the scalar code.
+ */
+class FP16 {
+public:
+    static constexpr uint16_t fromFloat(float value, FP16Mode mode = FP16Mode::IEEE) {
+        uint32_t f32 = floatBits(value);
+        
+        uint32_t sign = (f32 >> 16) & 0x8000;
+        uint32_t abs = f32 & 0x7FFFFFFF;
+        
+        // Inf / NaN (NaNs stay quiet and keep their top payload bits)
+        if (abs >= 0x7F800000) {
+            return static_cast<uint16_t>(sign | (abs > 0x7F800000 ? 0x7E00 | ((abs >> 13) & 0x3FF) : 0x7C00));
+        }
+        
+        if (mode == FP16Mode::Hardware) {
+            int32_t exp16 = static_cast<int32_t>(abs >> 23) - 127 + 15;
+            if (exp16 <= 0) return static_cast<uint16_t>(sign);
+            if (exp16 >= 31) return static_cast<uint16_t>(sign | 0x7C00);
+            return static_cast<uint16_t>(sign | (exp16 << 10) | ((abs >> 13) & 0x3FF));
+        }
+        
+        // 65520 and up round to infinity
+        if (abs >= 0x477FF000) return static_cast<uint16_t>(sign | 0x7C00);
+        
+        // Below 2^-14: subnormal result in units of 2^-24
+        if (abs < 0x38800000) {
+            if (abs <= 0x33000000) return static_cast<uint16_t>(sign);   // <= 2^-25 ties to +-0
+            uint32_t mant = (abs & 0x7FFFFF) | 0x800000;
+            uint32_t shift = 126 - (abs >> 23);
+            uint32_t half = mant >> shift;
+            uint32_t rest = mant & ((1u << shift) - 1);
+            uint32_t tie = 1u << (shift - 1);
+            if (rest > tie || (rest == tie && (half & 1))) half++;
+            return static_cast<uint16_t>(sign | half);   // may carry into the smallest normal
+        }
+        
+        // Rebias, then round to nearest even; a mantissa carry bumps the exponent
+        uint32_t bits = abs - ((127 - 15) << 23);
+        bits += 0xFFF + ((bits >> 13) & 1);
+        return static_cast<uint16_t>(sign | (bits >> 13));
+    }
+    
+    static constexpr float toFloat(uint16_t fp16, FP16Mode mode = FP16Mode::IEEE) {
+        uint32_t sign = (fp16 & 0x8000u) << 16;
+        uint32_t exp16 = (fp16 >> 10) & 0x1F;
+        uint32_t mant16 = fp16 & 0x3FF;
+        
+        uint32_t f32 = 0;
+        
+        if (exp16 == 0x1F) {
+            f32 = sign | 0x7F800000 | (mant16 << 13);
+        } else if (exp16 == 0) {
+            if (mant16 == 0 || mode == FP16Mode::Hardware) {
+                f32 = sign;
+            } else {
+                f32 = sign | floatBits(static_cast<float>(mant16) * 0x1p-24f);   // exact
+            }
+        } else {
+            f32 = sign | ((exp16 - 15 + 127) << 23) | (mant16 << 13);
+        }
+        
+        return __builtin_bit_cast(float, f32);
+    }
+    
+    /**
+     * IEEE bit pattern of a float; constexpr through __builtin_bit_cast
+     * (GCC 11, Clang 9, MSVC 19.27)
+     */
+    static constexpr uint32_t floatBits(float value) {
+        return __builtin_bit_cast(uint32_t, value);
+    }
+    
+    static void fromFloatArray(const float* in, uint16_t* out, size_t n,
+                               FP16Mode mode = FP16Mode::IEEE) {
+        size_t i = 0;
+#ifdef TPU_HAVE_F16C
+        if (mode == FP16Mode::IEEE && hasF16C()) {
+            i = fromFloatF16C(in, out, n);
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] = fromFloat(in[i], mode);
+        }
+    }
+    
+    static void toFloatArray(const uint16_t* in, float* out, size_t n,
+                             FP16Mode mode = FP16Mode::IEEE) {
+        size_t i = 0;
+#ifdef TPU_HAVE_F16C
+        if (mode == FP16Mode::IEEE && hasF16C()) {
+            i = toFloatF16C(in, out, n);
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] = toFloat(in[i], mode);
+        }
+    }
+    
+    static bool hasF16C() {
+#ifdef TPU_HAVE_F16C
+        static const bool supported = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+        return supported;
+#else
+        return false;
+#endif
+    }
+    
+private:
+#ifdef TPU_HAVE_F16C
+    /**
+     * Whole groups of 8; returns the number of elements converted
+     */
+    __attribute__((target("avx,f16c")))
+    static size_t fromFloatF16C(const float* in, uint16_t* out, size_t n) {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+        }
+        return i;
+    }
+    
+    __attribute__((target("avx,f16c")))
+    static size_t toFloatF16C(const uint16_t* in, float* out, size_t n) {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+        }
+        return i;
+    }
+#endif
+};
+
+/**
+ * Result readback encodings
+ *
+ * Compressed: an 8-byte bitmap (byte r, bit c set when result[r][c] is
+ * non-zero, -0 counts as zero) followed by the non-zero FP16 values in
+ * row-major order, low byte first. Readback cost scales with density,
+ * which pays off after ReLU.
+ *
+ * Wide: the 64 FP32 accumulators, 4 bytes each, little-endian. Reads the
+ * unrounded sum of a run of StartAccumulate passes.
+ */
+enum class ReadbackFormat {
+    Dense,
+    Compressed,
+    Wide
+};
+
+class ResultCodec {
+public:
+    static constexpr size_t BITMAP_BYTES = MATRIX_SIZE * MATRIX_SIZE / 8;
+
+    static bool isZero(uint16_t fp16) { return (fp16 & 0x7FFF) == 0; }
+
+    /**
+     * Encode 64 FP16 results as the hardware does; returns bytes written
+     * (out must hold BITMAP_BYTES + 128)
+     */
+    static size_t encode(const uint16_t* words, uint8_t* out) {
+        size_t n = BITMAP_BYTES;
+        for (size_t r = 0; r < MATRIX_SIZE; r++) {
+            uint8_t bits = 0;
+            for (size_t c = 0; c < MATRIX_SIZE; c++) {
+                uint16_t w = words[r * MATRIX_SIZE + c];
+                if (!isZero(w)) {
+                    bits |= static_cast<uint8_t>(1u << c);
+                    out[n++] = w & 0xFF;
+                    out[n++] = (w >> 8) & 0xFF;
+                }
+            }
+            out[r] = bits;
+        }
+        return n;
+    }
+
+    /**
+     * Number of non-zero values announced by a bitmap
+     */
+    static size_t countNonZero(const uint8_t* bitmap) {
+        size_t count = 0;
+        for (size_t r = 0; r < BITMAP_BYTES; r++) {
+            for (uint8_t b = bitmap[r]; b; b &= b - 1) count++;
+        }
+        return count;
+    }
+
+    /**
+     * Expand bitmap + packed values into 64 FP16 words
+     */
+    static void decode(const uint8_t* bitmap, const uint8_t* values, uint16_t* words) {
+        size_t n = 0;
+        for (size_t r = 0; r < MATRIX_SIZE; r++) {
+            for (size_t c = 0; c < MATRIX_SIZE; c++) {
+                uint16_t w = 0;
+                if (bitmap[r] & (1u << c)) {
+                    w = static_cast<uint16_t>(values[n] | (values[n + 1] << 8));
+                    n += 2;
+                }
+                words[r * MATRIX_SIZE + c] = w;
+            }
+        }
+    }
+};
+
+/**
+ * Operand block read in place from caller memory (no intermediate tile).
+ *
+ * Tile element (i, j) is base[i * rowStride + j * colStride], or
+ * base[j * rowStride + i * colStride] when transpose is set, so a sub-block
+ * of a large row-major matrix, a column-major matrix and a transposed
+ * weight are all just different strides. Elements outside rows x cols
+ * read as zero and are never touched in memory.
+ */
+struct TileView {
+    const float* base = nullptr;
+    ptrdiff_t rowStride = MATRIX_SIZE;
+    ptrdiff_t colStride = 1;
+    size_t rows = MATRIX_SIZE;
+    size_t cols = MATRIX_SIZE;
+    bool transpose = false;
+
+    float at(size_t i, size_t j) const {
+        if (i >= rows || j >= cols) return 0.0f;
+        return transpose ? base[j * rowStride + i * colStride]
+                         : base[i * rowStride + j * colStride];
+    }
+};
+
+/**
+ * Encode a TileView into the 64 row-major FP16 words the device expects
+ */
+class TileEncoder {
+public:
+    static void encode(const TileView& v, uint16_t* words) {
+        // Memory strides between consecutive tile rows / columns
+        ptrdiff_t rowStep = v.transpose ? v.colStride : v.rowStride;
+        ptrdiff_t colStep = v.transpose ? v.rowStride : v.colStride;
+        size_t rows = v.rows, cols = v.cols;
+        
+        if (rowStep == 1 && colStep != 1) {
+            // Tile columns are contiguous: convert them in memory order,
+            // then transpose the 8x8 block of words
+            uint16_t colMajor[MATRIX_SIZE * MATRIX_SIZE] = {};
+            for (size_t j = 0; j < cols; j++) {
+                FP16::fromFloatArray(v.base + j * colStep, colMajor + j * MATRIX_SIZE, rows);
+            }
+            transpose8x8(colMajor, words);
+            return;
+        }
+        
+        if (colStep == 1) {
+            // Tile rows are contiguous: convert each in one pass
+            std::fill(words, words + MATRIX_SIZE * MATRIX_SIZE, 0);
+            for (size_t i = 0; i < rows; i++) {
+                FP16::fromFloatArray(v.base + i * rowStep, words + i * MATRIX_SIZE, cols);
+            }
+            return;
+        }
+        
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            const float* row = v.base + i * rowStep;
+            for (size_t j = 0; j < MATRIX_SIZE; j++) {
+                words[i * MATRIX_SIZE + j] =
+                    (i < rows && j < cols) ? FP16::fromFloat(row[j * colStep]) : 0;
+            }
+        }
+    }
+    
+    static void transpose8x8Scalar(const uint16_t* in, uint16_t* out) {
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            for (size_t j = 0; j < MATRIX_SIZE; j++) {
+                out[j * MATRIX_SIZE + i] = in[i * MATRIX_SIZE + j];
+            }
+        }
+    }
+    
+#ifdef TPU_HAVE_SSE2
+    /**
+     * 16-bit 8x8 transpose in three unpack stages (16, 32, 64 bit)
+     */
+    static void transpose8x8(const uint16_t* in, uint16_t* out) {
+        const __m128i* src = reinterpret_cast<const __m128i*>(in);
+        __m128i r0 = _mm_loadu_si128(src + 0), r1 = _mm_loadu_si128(src + 1);
+        __m128i r2 = _mm_loadu_si128(src + 2), r3 = _mm_loadu_si128(src + 3);
+        __m128i r4 = _mm_loadu_si128(src + 4), r5 = _mm_loadu_si128(src + 5);
+        __m128i r6 = _mm_loadu_si128(src + 6), r7 = _mm_loadu_si128(src + 7);
+        
+        __m128i t0 = _mm_unpacklo_epi16(r0, r1), t1 = _mm_unpackhi_epi16(r0, r1);
+        __m128i t2 = _mm_unpacklo_epi16(r2, r3), t3 = _mm_unpackhi_epi16(r2, r3);
+        __m128i t4 = _mm_unpacklo_epi16(r4, r5), t5 = _mm_unpackhi_epi16(r4, r5);
+        __m128i t6 = _mm_unpacklo_epi16(r6, r7), t7 = _mm_unpackhi_epi16(r6, r7);
+        
+        __m128i u0 = _mm_unpacklo_epi32(t0, t2), u1 = _mm_unpackhi_epi32(t0, t2);
+        __m128i u2 = _mm_unpacklo_epi32(t1, t3), u3 = _mm_unpackhi_epi32(t1, t3);
+        __m128i u4 = _mm_unpacklo_epi32(t4, t6), u5 = _mm_unpackhi_epi32(t4, t6);
+        __m128i u6 = _mm_unpacklo_epi32(t5, t7), u7 = _mm_unpackhi_epi32(t5, t7);
+        
+        __m128i* dst = reinterpret_cast<__m128i*>(out);
+        _mm_storeu_si128(dst + 0, _mm_unpacklo_epi64(u0, u4));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi64(u0, u4));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi64(u1, u5));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi64(u1, u5));
+        _mm_storeu_si128(dst + 4, _mm_unpacklo_epi64(u2, u6));
+        _mm_storeu_si128(dst + 5, _mm_unpackhi_epi64(u2, u6));
+        _mm_storeu_si128(dst + 6, _mm_unpacklo_epi64(u3, u7));
+        _mm_storeu_si128(dst + 7, _mm_unpackhi_epi64(u3, u7));
+    }
+#else
+    static void transpose8x8(const uint16_t* in, uint16_t* out) {
+        transpose8x8Scalar(in, out);
+    }
+#endif
+};
+
+/**
+ * Byte link to the board. SerialPort is the real one; tools and tests can
+ * plug in an emulator (tpu_emulator.hpp) or wrappers.
+ */
+class Transport {
+public:
+    virtual ~Transport() = default;
+    virtual size_t write(const uint8_t* data, size_t len) = 0;
+    virtual size_t read(uint8_t* buffer, size_t len) = 0;
+    
+    /**
+     * The next write starts a protocol transaction. Only a marker for
+     * wrappers (tracing); links ignore it.
+     */
+    virtual void beginCommand() {}
+    
+    /**
+     * Throw away whatever the device has sent and the host not yet read
+     * (resync after a protocol error)
+     */
+    virtual void discardInput() {
+        uint8_t scratch[256];
+        for (size_t total = 0; total < 65536; ) {
+            size_t n = read(scratch, sizeof(scratch));
+            if (n == 0) break;
+            total += n;
+        }
+    }
+};
+
+/**
+ * Serial port wrapper
+ */
+class SerialPort : public Transport {
+private:
+    serial_handle_t handle_;
+    std::string port_;
+    
+public:
+    SerialPort(const std::string& port, int baudrate = 115200) 
+        : handle_(INVALID_SERIAL), port_(port) {
+        open(baudrate);
+    }
+    
+    ~SerialPort() {
+        close();
+    }
+    
+    // Disable copy
+    SerialPort(const SerialPort&) = delete;
+    SerialPort& operator=(const SerialPort&) = delete;
+    
+    // Enable move
+    SerialPort(SerialPort&& other) noexcept 
+        : handle_(other.handle_), port_(std::move(other.port_)) {
+        other.handle_ = INVALID_SERIAL;
+    }
+    
+    void open(int baudrate) {
+#ifdef _WIN32
+        handle_ = CreateFileA(port_.c_str(), GENERIC_READ | GENERIC_WRITE,
+                             0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (handle_ == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to open " + port_);
+        }
+        
+        DCB dcb = {0};
+        dcb.DCBlength = sizeof(DCB);
+        GetCommState(handle_, &dcb);
+        dcb.BaudRate = baudrate;
+        dcb.ByteSize = 8;
+        dcb.Parity = NOPARITY;
+        dcb.StopBits = ONESTOPBIT;
+        SetCommState(handle_, &dcb);
+        
+        COMMTIMEOUTS timeouts = {0};
+        timeouts.ReadIntervalTimeout = 50;
+        timeouts.ReadTotalTimeoutConstant = 100;
+        timeouts.ReadTotalTimeoutMultiplier = 10;
+        SetCommTimeouts(handle_, &timeouts);
+#else
+        handle_ = ::open(port_.c_str(), O_RDWR | O_NOCTTY);
+        if (handle_ == -1) {
+            throw std::runtime_error("Failed to open " + port_);
+        }
+        
+        termios options;
+        tcgetattr(handle_, &options);
+        cfsetispeed(&options, B115200);
+        cfsetospeed(&options, B115200);
+        options.c_cflag &= ~PARENB;
+        options.c_cflag &= ~CSTOPB;
+        options.c_cflag &= ~CSIZE;
+        options.c_cflag |= CS8;
+        options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+        options.c_iflag &= ~(IXON | IXOFF | IXANY);
+        options.c_oflag &= ~OPOST;
+        options.c_cc[VMIN] = 0;
+        options.c_cc[VTIME] = 10;
+        tcsetattr(handle_, TCSANOW, &options);
+        tcflush(handle_, TCIOFLUSH);
+#endif
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    
+    void close() {
+        if (handle_ != INVALID_SERIAL) {
+#ifdef _WIN32
+            CloseHandle(handle_);
+#else
+            ::close(handle_);
+#endif
+            handle_ = INVALID_SERIAL;
+        }
+    }
+    
+    size_t write(const uint8_t* data, size_t len) override {
+#ifdef _WIN32
+        DWORD written;
+        if (!WriteFile(handle_, data, len, &written, nullptr)) {
+            throw std::runtime_error("Write failed");
+        }
+        return written;
+#else
+        ssize_t n = ::write(handle_, data, len);
+        if (n < 0) {
+            throw std::runtime_error("Write failed");
+        }
+        return n;
+#endif
+    }
+    
+    size_t read(uint8_t* buffer, size_t len) override {
+#ifdef _WIN32
+        DWORD read_bytes;
+        if (!ReadFile(handle_, buffer, len, &read_bytes, nullptr)) {
+            throw std::runtime_error("Read failed");
+        }
+        return read_bytes;
+#else
+        ssize_t n = ::read(handle_, buffer, len);
+        if (n < 0) {
+            throw std::runtime_error("Read failed");
+        }
+        return n;
+#endif
+    }
+    
+    void discardInput() override {
+#ifdef _WIN32
+        PurgeComm(handle_, PURGE_RXCLEAR);
+#else
+        tcflush(handle_, TCIFLUSH);
+#endif
+    }
+    
+    bool isOpen() const {
+        return handle_ != INVALID_SERIAL;
+    }
+};
+
+/**
+ * Missing or garbled response on the link (as opposed to a usage error or
+ * a device timeout). TPUDriver can recover from these, see RecoveryPolicy.
+ */
+class LinkError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Bytes moved over the link
+ */
+struct LinkStats {
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+};
+
+/**
+ * How writeActivations() reaches the device.
+ *
+ * Full sends the whole tile as one framed write (ProtocolCommand::WriteMatrixA,
+ * 1 + 128 bytes). Delta keeps a shadow of the device activation buffer and sends only the
+ * changed FP16 elements (ProtocolCommand::WriteElements: cmd, buffer, count,
+ * ACK, then count x (index, low, high)). When that would cost more than a
+ * framed full-matrix write, the full write is used instead.
+ */
+enum class UploadMode {
+    Full,
+    Delta
+};
+
+/**
+ * Activation upload counters
+ */
+struct UploadStats {
+    uint64_t fullWrites = 0;
+    uint64_t deltaWrites = 0;
+    uint64_t skippedWrites = 0;   // nothing changed
+    uint64_t elementsSent = 0;
+    uint64_t bytesSent = 0;
+};
+
+/**
+ * One array run for the device job queue (ProtocolCommand::EnqueueJob).
+ * An operand with a null base is not sent: the job reuses what the
+ * previous run left in that buffer. The result is kept in result slot
+ * `slot` (ANY_SLOT: a free one chosen by the driver) until collected.
+ */
+struct DeviceJob {
+    static constexpr uint8_t ANY_SLOT = 0xFF;
+
+    TileView weights{};
+    TileView activations{};
+    bool accumulate = false;   // add onto the accumulators instead of clearing
+    uint8_t slot = ANY_SLOT;
+
+    bool loadsWeights() const { return weights.base != nullptr; }
+    bool loadsActivations() const { return activations.base != nullptr; }
+
+    /**
+     * [7:4] slot, [2] accumulate, [1] load activations, [0] load weights
+     */
+    uint8_t descriptor() const {
+        return static_cast<uint8_t>((slot << 4) | (accumulate ? 0x04 : 0) |
+                                    (loadsActivations() ? 0x02 : 0) | (loadsWeights() ? 0x01 : 0));
+    }
+};
+
+/**
+ * Handle of a submitted job: its position in submission order and slot
+ */
+struct JobTicket {
+    uint64_t sequence = 0;
+    uint8_t slot = 0;
+};
+
+/**
+ * Queue occupancy (ProtocolCommand::QueueStatus)
+ */
+struct QueueStatus {
+    size_t freeEntries = 0;
+    uint64_t jobsCompleted = 0;   // since the driver was constructed
+};
+
+/**
+ * Automatic recovery from link errors (TPUDriver::setRecovery). An
+ * operation that hits a LinkError resyncs the device (TPUDriver::resync)
+ * and runs again, up to maxRetries times. Operations that cannot be
+ * repeated safely (accumulating runs) resync and then throw.
+ */
+struct RecoveryPolicy {
+    bool enabled = false;
+    int maxRetries = 3;
+    int resyncAttempts = 3;   // the idle wait grows with each attempt
+    // Quiet time before the reset: longer than the device's RX idle
+    // timeout (uart_protocol_handler.v: 256 byte times, 22 ms at 115200)
+    std::chrono::microseconds idleFlush{30000};
+};
+
+/**
+ * Recovery counters since construction
+ */
+struct RecoveryStats {
+    uint64_t linkErrors = 0;
+    uint64_t resyncs = 0;
+    uint64_t failedResyncs = 0;
+    uint64_t retries = 0;            // operations run again after a resync
+    uint64_t failedOperations = 0;   // link errors passed on to the caller
+    std::chrono::nanoseconds downtime{0};   // spent in resync()
+
+    friend std::ostream& operator<<(std::ostream& os, const RecoveryStats& s) {
+        return os << "RecoveryStats(link_errors=" << s.linkErrors << ", resyncs=" << s.resyncs
+                  << ", failed_resyncs=" << s.failedResyncs << ", retries=" << s.retries
+                  << ", failed_operations=" << s.failedOperations
+                  << ", downtime=" << s.downtime.count() / 1e6 << "ms)";
+    }
+};
+
+/**
+ * Result cache of the driver (TPUDriver::enableResultCache)
+ */
+using ResultCache = TileResultCache<MATRIX_SIZE * MATRIX_SIZE>;
+
+/**
+ * TPU Driver class
+ */
+class TPUDriver {
+private:
+    std::unique_ptr<Transport> link_;
+    LinkStats linkStats_;
+    bool verbose_ = true;
+    Arena arena_{16 * 1024};   // transmit/receive frames, caller scratch
+    
+    UploadMode uploadMode_ = UploadMode::Full;
+    UploadStats uploadStats_;
+    std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE> activationShadow_{};
+    bool shadowValid_ = false;
+    
+    ArrayPrecision precision_;        // last value written to the device
+    bool precisionKnown_ = false;
+    DeviceEpilogue epilogue_;         // last value written to the device
+    bool epilogueKnown_ = false;
+    
+    // Result cache. A hit skips the device, so the device buffers can lag
+    // behind what the caller loaded; the *Deferred_ flags mark that and
+    // the sync*() helpers catch the device up before anything relies on
+    // its buffers. Without a cache the flags stay false.
+    std::unique_ptr<ResultCache> resultCache_;
+    std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE> residentWeights_{};
+    std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE> residentActivations_{};
+    bool residentWeightsKnown_ = false;
+    bool residentActivationsKnown_ = false;
+    bool weightsDeferred_ = false;       // device weights != residentWeights_
+    bool activationsDeferred_ = false;   // device activations != residentActivations_
+    bool resultsDeferred_ = false;       // last run was answered from the cache
+    std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE> elidedWeights_{};
+    std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE> elidedActivations_{};
+    
+    uint64_t jobsSubmitted_ = 0;      // jobs the device has accepted (tickets and discarded jobs)
+    uint64_t jobsCompleted_ = 0;      // extended from the device's 8-bit counter
+    bool jobCountsSynced_ = false;    // jobsSubmitted_ aligned with the device's counters
+    uint32_t busySlots_ = 0;          // slots whose job has not been collected
+    bool queuePending_ = false;       // jobs may still be queued or running
+    std::array<JobTicket, RESULT_SLOTS> slotTickets_{};
+    
+    RecoveryPolicy recovery_;
+    RecoveryStats recoveryStats_;
+    bool inOperation_ = false;   // a recoverable() operation is running
+    
+    // Metrics. Link bytes are counted in linkStats_ and published when a
+    // phase ends, not per frame.
+    std::shared_ptr<DriverMetrics> metrics_;   // null: not instrumented
+    LinkStats publishedLink_;
+    
+    Histogram* uploadPhase() const { return metrics_ ? &metrics_->upload : nullptr; }
+    Histogram* computePhase() const { return metrics_ ? &metrics_->compute : nullptr; }
+    Histogram* readbackPhase() const { return metrics_ ? &metrics_->readback : nullptr; }
+    
+    /**
+     * Times a phase into its histogram and publishes the link bytes
+     */
+    class PhaseTimer {
+    public:
+        PhaseTimer(TPUDriver& driver, Histogram* phase) : driver_(driver), timer_(phase) {}
+        ~PhaseTimer() {
+            if (driver_.metrics_) driver_.publishLinkBytes();
+        }
+        
+    private:
+        TPUDriver& driver_;
+        ScopedTimer timer_;
+    };
+    
+    void publishLinkBytes() {
+        metrics_->bytesTx.add(linkStats_.bytesSent - publishedLink_.bytesSent);
+        metrics_->bytesRx.add(linkStats_.bytesReceived - publishedLink_.bytesReceived);
+        publishedLink_ = linkStats_;
+    }
+    
+    void countTile() {
+        if (metrics_) metrics_->tiles.add();
+    }
+    
+    /**
+     * Concrete slot for a job; a slot is owned from submit until collect
+     */
+    uint8_t claimableSlot(uint8_t requested) const {
+        if (requested == DeviceJob::ANY_SLOT) {
+            for (uint8_t s = 0; s < RESULT_SLOTS; s++) {
+                if (!(busySlots_ & (1u << s))) return s;
+            }
+            throw std::runtime_error("All result slots hold uncollected jobs");
+        }
+        if (requested >= RESULT_SLOTS) {
+            throw std::invalid_argument("Result slot out of range");
+        }
+        if (busySlots_ & (1u << requested)) {
+            throw std::logic_error("Result slot holds an uncollected job");
+        }
+        return requested;
+    }
+    
+    void send(const uint8_t* data, size_t len) {
+        link_->write(data, len);
+        linkStats_.bytesSent += len;
+    }
+    
+    /**
+     * First frame of a protocol transaction (starts with the command byte)
+     */
+    void sendCommand(const uint8_t* data, size_t len) {
+        link_->beginCommand();
+        send(data, len);
+    }
+    
+    /**
+     * Read exactly len bytes (the port may return short reads)
+     */
+    void receive(uint8_t* buffer, size_t len, const char* what) {
+        size_t got = 0;
+        while (got < len) {
+            size_t n = link_->read(buffer + got, len - got);
+            if (n == 0) {
+                throw LinkError(what);
+            }
+            got += n;
+        }
+        linkStats_.bytesReceived += len;
+    }
+    
+    void expectAck(const char* what) {
+        uint8_t ack;
+        receive(&ack, 1, what);
+        if (ack != RESP_ACK) {
+            throw LinkError(what);
+        }
+    }
+    
+    /**
+     * Data phase of a framed write. The handler does not acknowledge it,
+     * so under a RecoveryPolicy a status probe follows: when payload bytes
+     * were lost the write swallows the probe, which then goes unanswered
+     * and fails the operation while it can still be repeated.
+     */
+    void sendPayload(const uint8_t* data, size_t len) {
+        send(data, len);
+        if (!recovery_.enabled) {
+            return;
+        }
+        uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::GetStatus);
+        sendCommand(&cmd, 1);
+        expectAck("Write not confirmed");
+        uint8_t status[4];
+        receive(status, sizeof(status), "Write not confirmed");
+    }
+    
+    /**
+     * Compare a device buffer with the words the driver expects in it
+     * (ProtocolCommand::Checksum). Frames carry no check of their own, so
+     * under a RecoveryPolicy this is how a flipped payload or readback
+     * byte turns into a LinkError; a lost byte leaves the frame
+     * unanswered, as with the status probe.
+     */
+    void verifyChecksum(uint8_t buffer, const uint16_t* words, const char* what) {
+        uint8_t frame[2] = {static_cast<uint8_t>(ProtocolCommand::Checksum), buffer};
+        sendCommand(frame, sizeof(frame));
+        expectAck(what);
+        uint8_t sums[4];
+        receive(sums, sizeof(sums), what);
+        uint32_t reported = sums[0] | (sums[1] << 8) | (sums[2] << 16) |
+                            (static_cast<uint32_t>(sums[3]) << 24);
+        if (reported != bufferChecksum(words, MATRIX_SIZE * MATRIX_SIZE)) {
+            throw LinkError(what);
+        }
+    }
+    
+    /**
+     * Wait until submitted jobs have finished. Queued jobs own the array
+     * memories: the handler NACKs direct writes, starts and chaining until
+     * the queue is empty, and a job reusing the resident operands must
+     * still find them as they were when it was queued.
+     */
+    void drainQueue(int timeout_ms = 10000) {
+        auto start = std::chrono::steady_clock::now();
+        while (queuePending_ && queueStatus().freeEntries < JOB_QUEUE_DEPTH) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+            if (elapsed.count() > timeout_ms) {
+                throw std::runtime_error("Timeout waiting for queued jobs");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
+    /**
+     * Framed 128-byte write of a whole operand buffer. Under a
+     * RecoveryPolicy the buffer checksum stands in for the status probe.
+     */
+    void writeMatrixFramed(ProtocolCommand cmd, const uint16_t* words) {
+        drainQueue();
+        uint8_t c = static_cast<uint8_t>(cmd);
+        sendCommand(&c, 1);
+        expectAck("Matrix write not acknowledged");
+        
+        Arena::Scope frame(arena_);
+        uint8_t* payload = arena_.allocateArray<uint8_t>(MATRIX_SIZE * MATRIX_SIZE * 2);
+        for (size_t i = 0; i < MATRIX_SIZE * MATRIX_SIZE; i++) {
+            payload[2 * i] = words[i] & 0xFF;
+            payload[2 * i + 1] = (words[i] >> 8) & 0xFF;
+        }
+        send(payload, MATRIX_SIZE * MATRIX_SIZE * 2);
+        if (recovery_.enabled) {
+            ChecksumBuffer buffer = cmd == ProtocolCommand::WriteMatrixA
+                ? ChecksumBuffer::Activations : ChecksumBuffer::Weights;
+            verifyChecksum(static_cast<uint8_t>(buffer), words, "Matrix write not confirmed");
+        }
+    }
+    
+    /**
+     * Framed read of a 64-word FP16 buffer (command frame, ACK, 128 bytes)
+     * into MATRIX_SIZE rows; checked against the checksum of `buffer`
+     * under a RecoveryPolicy
+     */
+    void readMatrixFramed(const uint8_t* frame, size_t len, uint8_t buffer,
+                          std::array<float, MATRIX_SIZE>* rows, const char* what) {
+        sendCommand(frame, len);
+        expectAck(what);
+        
+        Arena::Scope scope(arena_);
+        uint8_t* bytes = arena_.allocateArray<uint8_t>(MATRIX_SIZE * MATRIX_SIZE * 2);
+        receive(bytes, MATRIX_SIZE * MATRIX_SIZE * 2, what);
+        
+        uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+        for (size_t i = 0; i < MATRIX_SIZE * MATRIX_SIZE; i++) {
+            words[i] = static_cast<uint16_t>(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+        }
+        if (recovery_.enabled) {
+            verifyChecksum(buffer, words, what);
+        }
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            FP16::toFloatArray(words + i * MATRIX_SIZE, rows[i].data(), MATRIX_SIZE);
+        }
+    }
+    
+    /**
+     * Burst write of consecutive FP16 words (ProtocolCommand::WriteRange)
+     */
+    void writeRangeWords(DeviceBuffer buffer, size_t offset, const uint16_t* words, size_t count) {
+        if (offset + count > bufferElements(buffer)) {
+            throw std::out_of_range("Range exceeds the device buffer");
+        }
+        drainQueue();
+        
+        uint8_t header[4] = {static_cast<uint8_t>(ProtocolCommand::WriteRange),
+                             static_cast<uint8_t>(buffer),
+                             static_cast<uint8_t>(offset),
+                             static_cast<uint8_t>(count)};
+        sendCommand(header, sizeof(header));
+        expectAck("Range write not acknowledged");
+        
+        Arena::Scope frame(arena_);
+        uint8_t* payload = arena_.allocateArray<uint8_t>(2 * count);
+        for (size_t i = 0; i < count; i++) {
+            payload[2 * i] = words[i] & 0xFF;
+            payload[2 * i + 1] = (words[i] >> 8) & 0xFF;
+        }
+        sendPayload(payload, 2 * count);
+        
+        if (buffer == DeviceBuffer::Activations && shadowValid_) {
+            std::copy(words, words + count, activationShadow_.begin() + offset);
+        }
+    }
+    
+    /**
+     * Send only the elements that differ from the shadow copy, as
+     * contiguous runs, scattered elements or a full write, whichever
+     * puts the fewest bytes on the link
+     */
+    void writeActivationsDelta(const std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE>& words) {
+        constexpr size_t N = MATRIX_SIZE * MATRIX_SIZE;
+        bool dirty[N];
+        size_t changed = 0;
+        for (size_t i = 0; i < N; i++) {
+            dirty[i] = !shadowValid_ || words[i] != activationShadow_[i];
+            changed += dirty[i];
+        }
+        shadowValid_ = false;   // until the write below completes
+        
+        // Runs: 4-byte header + 2 bytes per word. Bridging a one-word
+        // gap (2 bytes) is cheaper than opening a new run.
+        size_t runStart[N], runLength[N], runs = 0, runBytes = 0;
+        for (size_t i = 0; i < N; ) {
+            if (!dirty[i]) { i++; continue; }
+            size_t end = i + 1;
+            while (end < N && (dirty[end] || (end + 1 < N && dirty[end + 1]))) end++;
+            runStart[runs] = i;
+            runLength[runs] = end - i;
+            runBytes += 4 + 2 * (end - i);
+            runs++;
+            i = end;
+        }
+        size_t elementBytes = 3 + 3 * changed;
+        size_t fullBytes = 1 + 2 * N;
+        
+        bool full = fullBytes <= runBytes && fullBytes <= elementBytes;
+        
+        if (changed == 0) {
+            uploadStats_.skippedWrites++;
+        } else if (full) {
+            writeMatrixFramed(ProtocolCommand::WriteMatrixA, words.data());
+            uploadStats_.fullWrites++;
+            uploadStats_.elementsSent += N;
+        } else if (runBytes <= elementBytes) {
+            for (size_t r = 0; r < runs; r++) {
+                writeRangeWords(DeviceBuffer::Activations, runStart[r],
+                                words.data() + runStart[r], runLength[r]);
+                uploadStats_.elementsSent += runLength[r];
+            }
+            uploadStats_.deltaWrites++;
+        } else {
+            drainQueue();
+            uint8_t header[3] = {static_cast<uint8_t>(ProtocolCommand::WriteElements),
+                                 static_cast<uint8_t>(DeviceBuffer::Activations),
+                                 static_cast<uint8_t>(changed)};
+            Arena::Scope frame(arena_);
+            uint8_t* triples = arena_.allocateArray<uint8_t>(3 * changed);
+            size_t n = 0;
+            for (size_t i = 0; i < N; i++) {
+                if (!dirty[i]) continue;
+                triples[n++] = static_cast<uint8_t>(i);
+                triples[n++] = words[i] & 0xFF;
+                triples[n++] = (words[i] >> 8) & 0xFF;
+            }
+            sendCommand(header, sizeof(header));
+            expectAck("Element write not acknowledged");
+            sendPayload(triples, n);
+            uploadStats_.deltaWrites++;
+            uploadStats_.elementsSent += changed;
+        }
+        // Delta pieces are only probed; check the whole tile once
+        if (changed > 0 && !full && recovery_.enabled) {
+            verifyChecksum(static_cast<uint8_t>(ChecksumBuffer::Activations), words.data(),
+                           "Activation update not confirmed");
+        }
+        
+        if (verbose_) std::cout << "✓ Uploaded " << changed << " changed activations" << std::endl;
+    }
+    
+    /**
+     * 'W'/'A' byte write ('K' acknowledged) of the uart_interface.v byte
+     * protocol, without the tracking of writeByte()
+     */
+    void sendByte(uint8_t addr, uint8_t data) {
+        drainQueue();
+        uint8_t cmd = (addr < 128) 
+            ? static_cast<uint8_t>(TPUCommand::WriteWeight)
+            : static_cast<uint8_t>(TPUCommand::WriteActivation);
+        
+        uint8_t buffer[3] = {cmd, addr, data};
+        sendCommand(buffer, 3);
+        
+        uint8_t ack;
+        receive(&ack, 1, "Failed to receive ACK");
+        if (ack != 'K') {
+            throw LinkError("Failed to receive ACK");
+        }
+    }
+    
+    /**
+     * Upload a weight tile; it becomes the resident one
+     */
+    void loadWeightWords(const uint16_t* words) {
+        PhaseTimer timer(*this, uploadPhase());
+        weightsDeferred_ = false;
+        residentWeightsKnown_ = false;   // until the upload completes
+        writeMatrixFramed(ProtocolCommand::WriteMatrixB, words);
+        std::copy(words, words + MATRIX_SIZE * MATRIX_SIZE, residentWeights_.begin());
+        residentWeightsKnown_ = true;
+        
+        if (verbose_) std::cout << "✓ Wrote " << MATRIX_SIZE * MATRIX_SIZE << " weights" << std::endl;
+    }
+    
+    /**
+     * Upload an activation tile (full or delta, see UploadMode); it
+     * becomes the resident one
+     */
+    void loadActivationWords(const std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE>& words) {
+        PhaseTimer timer(*this, uploadPhase());
+        uint64_t sentBefore = linkStats_.bytesSent;
+        activationsDeferred_ = false;
+        residentActivationsKnown_ = false;
+        
+        if (uploadMode_ == UploadMode::Delta) {
+            writeActivationsDelta(words);
+        } else {
+            shadowValid_ = false;
+            writeMatrixFramed(ProtocolCommand::WriteMatrixA, words.data());
+            uploadStats_.fullWrites++;
+            uploadStats_.elementsSent += words.size();
+            if (verbose_) std::cout << "✓ Wrote " << MATRIX_SIZE * MATRIX_SIZE << " activations" << std::endl;
+        }
+        
+        activationShadow_ = words;
+        shadowValid_ = true;
+        residentActivations_ = words;
+        residentActivationsKnown_ = true;
+        uploadStats_.bytesSent += linkStats_.bytesSent - sentBefore;
+    }
+    
+    /**
+     * Make `words` the resident weights without uploading them yet
+     */
+    void stageWeights(const uint16_t* words) {
+        if (residentWeightsKnown_ &&
+            std::equal(words, words + MATRIX_SIZE * MATRIX_SIZE, residentWeights_.begin())) {
+            return;
+        }
+        std::copy(words, words + MATRIX_SIZE * MATRIX_SIZE, residentWeights_.begin());
+        residentWeightsKnown_ = true;
+        weightsDeferred_ = true;
+    }
+    
+    void stageActivations(const std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE>& words) {
+        if (residentActivationsKnown_ && words == residentActivations_) {
+            return;
+        }
+        residentActivations_ = words;
+        residentActivationsKnown_ = true;
+        activationsDeferred_ = true;
+    }
+    
+    void syncWeights() {
+        if (weightsDeferred_) loadWeightWords(residentWeights_.data());
+    }
+    
+    void syncActivations() {
+        if (activationsDeferred_) loadActivationWords(residentActivations_);
+    }
+    
+    /**
+     * Run the last product answered from the cache on the device after
+     * all, for callers that read its result buffer or accumulate onto it.
+     * The resident operands are staged again afterwards.
+     */
+    void syncResults() {
+        if (!resultsDeferred_) return;
+        resultsDeferred_ = false;
+        auto weights = residentWeights_;
+        auto activations = residentActivations_;
+        bool weightsKnown = residentWeightsKnown_;
+        bool activationsKnown = residentActivationsKnown_;
+        loadWeightWords(elidedWeights_.data());
+        loadActivationWords(elidedActivations_);
+        start();
+        waitUntilDone();
+        if (weightsKnown) stageWeights(weights.data());
+        if (activationsKnown) stageActivations(activations);
+    }
+    
+    void syncDevice() {
+        syncResults();
+        syncWeights();
+        syncActivations();
+    }
+    
+    /**
+     * Cache key configuration for the current device settings: [7:0]
+     * precision, [8] precision never set, [20:16] epilogue, [21] epilogue
+     * never set, [24] FP32 readback. Nothing when the result also depends
+     * on the bias or residual buffer.
+     */
+    std::optional<uint32_t> cacheConfig(ReadbackFormat format) const {
+        if (epilogueKnown_ && (epilogue_.bias || epilogue_.residual)) {
+            return std::nullopt;
+        }
+        uint32_t config = precisionKnown_ ? precision_.encode() : 0x100;
+        config |= epilogueKnown_ ? static_cast<uint32_t>(epilogue_.encode()) << 16 : 0x200000;
+        if (format == ReadbackFormat::Wide) config |= 0x1000000;
+        return config;
+    }
+    
+    /**
+     * One product through the result cache: a hit returns without device
+     * I/O and defers the operands (see syncDevice), a miss runs on the
+     * device and is remembered
+     */
+    std::array<std::array<float, MATRIX_SIZE>, MATRIX_SIZE>
+    cachedMultiply(const uint16_t* weights,
+                   const std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE>& activations,
+                   uint32_t config, ReadbackFormat format) {
+        std::array<std::array<float, MATRIX_SIZE>, MATRIX_SIZE> results;
+        static_assert(sizeof(results) == sizeof(ResultCache::Result), "tile layout");
+        
+        ResultCache::Key key = ResultCache::makeKey(weights, activations.data(), config);
+        if (const ResultCache::Result* hit = resultCache_->find(key)) {
+            std::memcpy(&results, hit->data(), sizeof(results));
+            std::copy(weights, weights + MATRIX_SIZE * MATRIX_SIZE, elidedWeights_.begin());
+            elidedActivations_ = activations;
+            stageWeights(weights);
+            stageActivations(activations);
+            resultsDeferred_ = true;
+            if (metrics_) metrics_->cacheHits.add();
+            if (verbose_) std::cout << "✓ Result from cache" << std::endl;
+            return results;
+        }
+        
+        if (metrics_) metrics_->cacheMisses.add();
+        stageWeights(weights);
+        loadActivationWords(activations);
+        start();
+        waitUntilDone();
+        results = readResults(format);
+        
+        ResultCache::Result flat;
+        std::memcpy(flat.data(), &results, sizeof(results));
+        resultCache_->insert(key, flat);
+        return results;
+    }
+    
+    /**
+     * Run one public operation under the RecoveryPolicy: on a LinkError
+     * resync and, when `repeatable`, run it again. Nested operations
+     * belong to the outermost one, which is repeated as a whole.
+     */
+    template <typename Op>
+    auto recoverable(Op&& op, bool repeatable = true) -> decltype(op()) {
+        if (!recovery_.enabled || inOperation_) {
+            return op();
+        }
+        for (int attempt = 0; ; attempt++) {
+            try {
+                struct Scope {
+                    bool& flag;
+                    explicit Scope(bool& f) : flag(f) { flag = true; }
+                    ~Scope() { flag = false; }
+                } scope(inOperation_);
+                return op();
+            } catch (const LinkError&) {
+                recoveryStats_.linkErrors++;
+                if (metrics_) metrics_->linkErrors.add();
+                resync();
+                if (!repeatable || attempt >= recovery_.maxRetries) {
+                    recoveryStats_.failedOperations++;
+                    throw;
+                }
+                recoveryStats_.retries++;
+                if (metrics_) metrics_->retries.add();
+            }
+        }
+    }
+    
+    /**
+     * Jobs the device has accepted: completed plus still queued (the
+     * queue entry is freed in the cycle the completion is counted)
+     */
+    uint64_t acceptedJobs() {
+        QueueStatus status = queueStatus();
+        return status.jobsCompleted + (JOB_QUEUE_DEPTH - status.freeEntries);
+    }
+    
+    JobTicket issueTicket(const DeviceJob& job) {
+        JobTicket ticket;
+        ticket.sequence = jobsSubmitted_++;
+        ticket.slot = job.slot;
+        busySlots_ |= 1u << job.slot;
+        slotTickets_[job.slot] = ticket;
+        countTile();
+        return ticket;
+    }
+    
+public:
+    using Matrix = std::array<std::array<float, MATRIX_SIZE>, MATRIX_SIZE>;
+    
+    /**
+     * Constructor
+     */
+    explicit TPUDriver(const std::string& port, int baudrate = 115200) {
+        auto serial = std::make_unique<SerialPort>(port, baudrate);
+        if (!serial->isOpen()) {
+            throw std::runtime_error("Failed to open serial port");
+        }
+        link_ = std::move(serial);
+        std::cout << "✓ Connected to TPU on " << port << std::endl;
+    }
+    
+    /**
+     * Construct over an already open transport (emulator, wrappers)
+     */
+    explicit TPUDriver(std::unique_ptr<Transport> link)
+        : link_(std::move(link)) {
+        if (!link_) {
+            throw std::invalid_argument("Transport must not be null");
+        }
+    }
+    
+    /**
+     * Destructor
+     */
+    ~TPUDriver() {
+        if (verbose_) std::cout << "✓ Disconnected from TPU" << std::endl;
+    }
+    
+    /**
+     * Link byte counters since construction
+     */
+    const LinkStats& linkStats() const { return linkStats_; }
+    
+    /**
+     * Per-driver scratch arena. Frames are carved from it and released at
+     * the end of each transaction; callers may use it too (e.g.
+     * GemmOptions::workspace) as long as they release in LIFO order.
+     */
+    Arena& arena() { return arena_; }
+    
+    /**
+     * Activation upload counters since construction
+     */
+    const UploadStats& uploadStats() const { return uploadStats_; }
+    
+    /**
+     * Select full or delta activation uploads (see UploadMode)
+     */
+    void setUploadMode(UploadMode mode) { uploadMode_ = mode; }
+    
+    /**
+     * Forget the shadow copy, e.g. after the device was reset or its
+     * activation buffer was written behind the driver's back
+     */
+    void invalidateActivationShadow() { shadowValid_ = false; }
+    
+    /**
+     * Answer repeated (weights, activations) products from a host LRU
+     * cache of at most maxBytes (see tpu_cache.hpp). matrixMultiply() and
+     * multiplyResident() look it up before any device I/O, and weight
+     * uploads wait for the first run that misses. Results that depend on
+     * the bias or residual buffers bypass the cache.
+     */
+    void enableResultCache(size_t maxBytes) {
+        if (resultCache_) {
+            resultCache_->setMaxBytes(maxBytes);
+        } else {
+            resultCache_ = std::make_unique<ResultCache>(maxBytes);
+        }
+    }
+    
+    /**
+     * Drop the cache; deferred uploads are sent first
+     */
+    void disableResultCache() {
+        syncDevice();
+        resultCache_.reset();
+    }
+    
+    /**
+     * The result cache, or null when disabled
+     */
+    ResultCache* resultCache() { return resultCache_.get(); }
+    
+    CacheStats resultCacheStats() const {
+        return resultCache_ ? resultCache_->stats() : CacheStats();
+    }
+    
+    /**
+     * Report into `metrics` (see tpu_metrics.hpp); null stops reporting.
+     * Drivers of several threads may share one.
+     */
+    void setMetrics(std::shared_ptr<DriverMetrics> metrics) {
+        if (metrics_) publishLinkBytes();
+        metrics_ = std::move(metrics);
+        publishedLink_ = linkStats_;
+    }
+    const std::shared_ptr<DriverMetrics>& metrics() const { return metrics_; }
+    
+    /**
+     * Resync automatically after link errors (see RecoveryPolicy)
+     */
+    void setRecovery(const RecoveryPolicy& policy) { recovery_ = policy; }
+    const RecoveryPolicy& recovery() const { return recovery_; }
+    const RecoveryStats& recoveryStats() const { return recoveryStats_; }
+    
+    /**
+     * Bring the link back to a frame boundary after a protocol error: stay
+     * quiet past the device's RX idle timeout (it drops a partial frame),
+     * discard stale input, then CMD_RESET and a status probe. The operand
+     * buffers are re-uploaded before they are next used (a garbled frame
+     * may have written into them) and the precision and epilogue registers
+     * are re-applied. Queued jobs and uncollected slots survive the reset.
+     * Throws LinkError when the device does not answer.
+     */
+    void resync() {
+        auto began = std::chrono::steady_clock::now();
+        bool synced = false;
+        for (int attempt = 0; attempt < std::max(1, recovery_.resyncAttempts) && !synced; attempt++) {
+            std::this_thread::sleep_for(recovery_.idleFlush * (attempt + 1));
+            link_->discardInput();
+            try {
+                uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::Reset);
+                sendCommand(&cmd, 1);
+                expectAck("Reset not acknowledged");
+                cmd = static_cast<uint8_t>(ProtocolCommand::GetStatus);
+                sendCommand(&cmd, 1);
+                expectAck("Status probe not acknowledged");
+                uint8_t status[4];
+                receive(status, sizeof(status), "Status probe incomplete");
+                
+                if (precisionKnown_) {
+                    uint8_t frame[2] = {static_cast<uint8_t>(ProtocolCommand::SetPrecision),
+                                        precision_.encode()};
+                    sendCommand(frame, 2);
+                    expectAck("Precision not acknowledged");
+                }
+                if (epilogueKnown_) {
+                    uint8_t frame[2] = {static_cast<uint8_t>(ProtocolCommand::SetEpilogue),
+                                        epilogue_.encode()};
+                    sendCommand(frame, 2);
+                    expectAck("Epilogue not acknowledged");
+                }
+                synced = true;
+            } catch (const LinkError&) {
+            }
+        }
+        recoveryStats_.downtime += std::chrono::steady_clock::now() - began;
+        if (!synced) {
+            recoveryStats_.failedResyncs++;
+            throw LinkError("Device resync failed");
+        }
+        recoveryStats_.resyncs++;
+        if (metrics_) metrics_->resyncs.add();
+        
+        shadowValid_ = false;
+        weightsDeferred_ = residentWeightsKnown_;
+        activationsDeferred_ = residentActivationsKnown_;
+        if (verbose_) std::cout << "✓ Resynchronised with TPU" << std::endl;
+    }
+    
+    /**
+     * Enable/disable per-call progress messages
+     * (tiled workloads issue thousands of calls)
+     */
+    void setVerbose(bool verbose) { verbose_ = verbose; }
+    
+    /**
+     * Write a single byte ('W'/'A' byte protocol: tpu_top_with_io only;
+     * tpu_top_with_io_complete answers NACK)
+     */
+    void writeByte(uint8_t addr, uint8_t data) {
+        return recoverable([&] {
+            syncDevice();
+            if (addr >= ACTIVATION_BASE) {
+                shadowValid_ = false;
+                residentActivationsKnown_ = false;
+            } else {
+                residentWeightsKnown_ = false;
+            }
+            sendByte(addr, data);
+        });
+    }
+    
+    /**
+     * Read a single result byte ('R' byte protocol, as writeByte())
+     */
+    uint8_t readByte(uint8_t addr) {
+        return recoverable([&] {
+            syncDevice();
+            uint8_t cmd = static_cast<uint8_t>(TPUCommand::ReadResult);
+            uint8_t buffer[2] = {cmd, addr};
+            sendCommand(buffer, 2);
+            
+            uint8_t data;
+            receive(&data, 1, "Failed to read data");
+            return data;
+        });
+    }
+    
+    /**
+     * Write FP16 value
+     */
+    void writeFP16(uint8_t addr, float value) {
+        if (addr % 2 != 0) {
+            throw std::invalid_argument("FP16 address must be even");
+        }
+        
+        uint16_t fp16 = FP16::fromFloat(value);
+        writeByte(addr, fp16 & 0xFF);
+        writeByte(addr + 1, (fp16 >> 8) & 0xFF);
+    }
+    
+    /**
+     * Read FP16 value
+     */
+    float readFP16(uint8_t addr) {
+        if (addr % 2 != 0) {
+            throw std::invalid_argument("FP16 address must be even");
+        }
+        
+        uint8_t low = readByte(addr);
+        uint8_t high = readByte(addr + 1);
+        uint16_t fp16 = (static_cast<uint16_t>(high) << 8) | low;
+        return FP16::toFloat(fp16);
+    }
+    
+    /**
+     * View of a whole Matrix
+     */
+    static TileView view(const Matrix& m) {
+        TileView v;
+        v.base = m[0].data();
+        return v;
+    }
+    
+    /**
+     * Write weight matrix
+     */
+    void writeWeights(const Matrix& weights) {
+        writeWeights(view(weights));
+    }
+    
+    /**
+     * Write a weight tile straight from caller memory (strided/transposed)
+     */
+    void writeWeights(const TileView& weights) {
+        return recoverable([&] {
+            if (verbose_) std::cout << "Writing weights to TPU..." << std::endl;
+            uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+            TileEncoder::encode(weights, words);
+            
+            // With a result cache the upload waits for the first run that
+            // misses, so tiles answered from the cache cost no link traffic
+            if (resultCache_) {
+                stageWeights(words);
+            } else {
+                loadWeightWords(words);
+            }
+        });
+    }
+    
+    /**
+     * Write activation matrix
+     */
+    void writeActivations(const Matrix& activations) {
+        writeActivations(view(activations));
+    }
+    
+    /**
+     * Write an activation tile straight from caller memory (strided/transposed)
+     */
+    void writeActivations(const TileView& activations) {
+        return recoverable([&] {
+            if (verbose_) std::cout << "Writing activations to TPU..." << std::endl;
+            std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE> words;
+            TileEncoder::encode(activations, words.data());
+            loadActivationWords(words);
+        });
+    }
+    
+    /**
+     * Write `count` consecutive FP16 values starting at element `offset`
+     * (row-major) in one burst: cmd, buffer, offset, count, ACK, payload.
+     * Updates part of a tile without re-sending the rest.
+     */
+    void writeRange(DeviceBuffer buffer, size_t offset, const float* values, size_t count) {
+        return recoverable([&] {
+            if (offset + count > bufferElements(buffer)) {
+                throw std::out_of_range("Range exceeds the device buffer");
+            }
+            
+            if (buffer == DeviceBuffer::Weights) {
+                syncWeights();
+            } else if (buffer == DeviceBuffer::Activations) {
+                syncActivations();
+            }
+            
+            PhaseTimer timer(*this, uploadPhase());
+            uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+            FP16::fromFloatArray(values, words, count);
+            writeRangeWords(buffer, offset, words, count);
+            
+            if (buffer == DeviceBuffer::Weights) {
+                std::copy(words, words + count, residentWeights_.begin() + offset);
+            } else if (buffer == DeviceBuffer::Activations) {
+                std::copy(words, words + count, residentActivations_.begin() + offset);
+            }
+            
+            if (verbose_) std::cout << "✓ Wrote " << count << " values at offset " << offset << std::endl;
+        });
+    }
+    
+    /**
+     * Set the array precision for the following computations. Skipped
+     * when the device already has it, so per-call selection is free for
+     * runs of layers at the same setting.
+     */
+    void setPrecision(ArrayPrecision precision) {
+        return recoverable([&] {
+            if (precisionKnown_ && precision == precision_) {
+                return;
+            }
+            uint8_t frame[2] = {static_cast<uint8_t>(ProtocolCommand::SetPrecision), precision.encode()};
+            sendCommand(frame, 2);
+            expectAck("Precision not acknowledged");
+            precision_ = precision;
+            precisionKnown_ = true;
+        });
+    }
+    
+    /**
+     * Set the result epilogue for the following computations (queued jobs
+     * included); skipped when unchanged
+     */
+    void setEpilogue(const DeviceEpilogue& epilogue) {
+        return recoverable([&] {
+            if (epilogueKnown_ && epilogue == epilogue_) {
+                return;
+            }
+            uint8_t frame[2] = {static_cast<uint8_t>(ProtocolCommand::SetEpilogue), epilogue.encode()};
+            sendCommand(frame, 2);
+            expectAck("Epilogue not acknowledged");
+            epilogue_ = epilogue;
+            epilogueKnown_ = true;
+        });
+    }
+    
+    /**
+     * Per-output bias for the epilogue; missing entries are zero
+     */
+    void writeBias(const float* bias, size_t count) {
+        if (count > MATRIX_SIZE) {
+            throw std::invalid_argument("Bias has more entries than result rows");
+        }
+        float padded[MATRIX_SIZE] = {};
+        std::copy(bias, bias + count, padded);
+        writeRange(DeviceBuffer::Bias, 0, padded, MATRIX_SIZE);
+    }
+    
+    /**
+     * Residual tile added by the epilogue (same layout as the results)
+     */
+    void writeResidual(const TileView& residual) {
+        return recoverable([&] {
+            PhaseTimer timer(*this, uploadPhase());
+            uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+            TileEncoder::encode(residual, words);
+            writeRangeWords(DeviceBuffer::Residual, 0, words, MATRIX_SIZE * MATRIX_SIZE);
+        });
+    }
+    
+    /**
+     * Start computation
+     */
+    void start() {
+        return recoverable([&] {
+            syncWeights();
+            syncActivations();
+            PhaseTimer timer(*this, computePhase());
+            if (verbose_) std::cout << "Starting computation..." << std::endl;
+            drainQueue();
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::StartCompute);
+            sendCommand(&cmd, 1);
+            expectAck("Failed to start TPU");
+            resultsDeferred_ = false;
+            countTile();
+        });
+    }
+    
+    /**
+     * Start computation on top of the previous accumulators instead of
+     * clearing them (ProtocolCommand::StartAccumulate)
+     */
+    void startAccumulate() {
+        return recoverable([&] {
+            syncDevice();
+            PhaseTimer timer(*this, computePhase());
+            if (verbose_) std::cout << "Starting accumulation..." << std::endl;
+            drainQueue();
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::StartAccumulate);
+            sendCommand(&cmd, 1);
+            expectAck("Failed to start accumulation");
+            countTile();
+        }, false);
+    }
+    
+    /**
+     * Copy the result buffer into the activation buffer on the device,
+     * through `activation` (cmd, activation, ACK). The next layer then
+     * starts without reading back and re-uploading 256 bytes.
+     */
+    void chainResults(DeviceActivation activation = DeviceActivation::None) {
+        return recoverable([&] {
+            syncResults();
+            PhaseTimer timer(*this, computePhase());
+            drainQueue();
+            uint8_t frame[2] = {static_cast<uint8_t>(ProtocolCommand::ChainResult),
+                                static_cast<uint8_t>(activation)};
+            sendCommand(frame, 2);
+            expectAck("Result chaining not acknowledged");
+            shadowValid_ = false;   // activations now come from the device
+            residentActivationsKnown_ = false;
+            activationsDeferred_ = false;
+            if (verbose_) std::cout << "✓ Chained results into activations" << std::endl;
+        });
+    }
+    
+    /**
+     * Multiply the activations already on the device (e.g. chained
+     * results) by a new weight tile; nothing is read back
+     */
+    void computeOnResident(const TileView& weights) {
+        return recoverable([&] {
+            writeWeights(weights);
+            start();
+            waitUntilDone();
+        });
+    }
+    
+    /**
+     * Get status (ProtocolCommand::GetStatus: ACK, status byte, 3 cycle-count bytes)
+     */
+    TPUStatus getStatus() {
+        return recoverable([&] {
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::GetStatus);
+            sendCommand(&cmd, 1);
+            expectAck("Status not acknowledged");
+            
+            uint8_t status[4];
+            receive(status, sizeof(status), "Failed to read status");
+            
+            return TPUStatus(status[0]);
+        });
+    }
+    
+    /**
+     * Wait until an acknowledged start has finished. Polls for busy to
+     * clear: done is only high for the ~11 cycles of the DONE state
+     * (tpu_top_with_io_complete.v), far shorter than a status round trip.
+     */
+    void waitUntilDone(int timeout_ms = 10000) {
+        return recoverable([&] {
+            PhaseTimer timer(*this, computePhase());
+            auto start = std::chrono::steady_clock::now();
+            
+            while (true) {
+                auto status = getStatus();
+                if (!status.busy) {
+                    if (verbose_) std::cout << "✓ Computation complete" << std::endl;
+                    return;
+                }
+            
+                auto now = std::chrono::steady_clock::now();
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+                if (elapsed.count() > timeout_ms) {
+                    throw std::runtime_error("Timeout waiting for TPU");
+                }
+            
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+    }
+    
+    /**
+     * Read result matrix
+     */
+    Matrix readResults(ReadbackFormat format = ReadbackFormat::Dense) {
+        return recoverable([&] {
+            syncDevice();
+            if (format == ReadbackFormat::Compressed) {
+                return readResultsCompressed();
+            }
+            if (format == ReadbackFormat::Wide) {
+                return readResultsWide();
+            }
+            
+            PhaseTimer timer(*this, readbackPhase());
+            if (verbose_) std::cout << "Reading results from TPU..." << std::endl;
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::ReadResult);
+            Matrix results;
+            readMatrixFramed(&cmd, 1, static_cast<uint8_t>(ChecksumBuffer::Result),
+                             results.data(), "Failed to read results");
+            
+            if (verbose_) std::cout << "✓ Read " << MATRIX_SIZE * MATRIX_SIZE << " results" << std::endl;
+            return results;
+        });
+    }
+    
+    /**
+     * Read results as zero bitmap + non-zero values (ProtocolCommand::ReadResultCompressed)
+     */
+    Matrix readResultsCompressed() {
+        return recoverable([&] {
+            syncDevice();
+            PhaseTimer timer(*this, readbackPhase());
+            if (verbose_) std::cout << "Reading compressed results from TPU..." << std::endl;
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::ReadResultCompressed);
+            sendCommand(&cmd, 1);
+            expectAck("Compressed readback not acknowledged");
+            
+            uint8_t bitmap[ResultCodec::BITMAP_BYTES];
+            receive(bitmap, sizeof(bitmap), "Failed to read result bitmap");
+            
+            size_t nonZero = ResultCodec::countNonZero(bitmap);
+            Arena::Scope frame(arena_);
+            uint8_t* values = arena_.allocateArray<uint8_t>(nonZero * 2);
+            receive(values, nonZero * 2, "Failed to read result values");
+            
+            uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+            ResultCodec::decode(bitmap, values, words);
+            
+            Matrix results;
+            for (size_t i = 0; i < MATRIX_SIZE; i++) {
+                FP16::toFloatArray(words + i * MATRIX_SIZE, results[i].data(), MATRIX_SIZE);
+            }
+            
+            if (verbose_) std::cout << "✓ Read " << nonZero << " non-zero results" << std::endl;
+            return results;
+        });
+    }
+    
+    /**
+     * Read the FP32 accumulators (ProtocolCommand::ReadResultWide)
+     */
+    Matrix readResultsWide() {
+        return recoverable([&] {
+            syncDevice();
+            PhaseTimer timer(*this, readbackPhase());
+            if (verbose_) std::cout << "Reading FP32 results from TPU..." << std::endl;
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::ReadResultWide);
+            sendCommand(&cmd, 1);
+            expectAck("Wide readback not acknowledged");
+            
+            Arena::Scope frame(arena_);
+            uint8_t* bytes = arena_.allocateArray<uint8_t>(MATRIX_SIZE * MATRIX_SIZE * 4);
+            receive(bytes, MATRIX_SIZE * MATRIX_SIZE * 4, "Failed to read FP32 results");
+            
+            Matrix results;
+            for (size_t i = 0; i < MATRIX_SIZE * MATRIX_SIZE; i++) {
+                const uint8_t* b = bytes + 4 * i;
+                uint32_t bits = b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<uint32_t>(b[3]) << 24);
+                std::memcpy(&results[i / MATRIX_SIZE][i % MATRIX_SIZE], &bits, sizeof(float));
+            }
+            
+            if (verbose_) std::cout << "✓ Read " << MATRIX_SIZE * MATRIX_SIZE << " FP32 results" << std::endl;
+            return results;
+        });
+    }
+    
+    /**
+     * Perform matrix multiplication
+     */
+    Matrix matrixMultiply(const Matrix& weights, const Matrix& activations,
+                          ReadbackFormat format = ReadbackFormat::Dense) {
+        if (metrics_) metrics_->matmuls.add();
+        return recoverable([&] {
+            std::optional<uint32_t> config;
+            if (resultCache_ && (config = cacheConfig(format))) {
+                uint16_t w[MATRIX_SIZE * MATRIX_SIZE];
+                std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE> a;
+                TileEncoder::encode(view(weights), w);
+                TileEncoder::encode(view(activations), a.data());
+                return cachedMultiply(w, a, *config, format);
+            }
+            writeWeights(weights);
+            writeActivations(activations);
+            start();
+            waitUntilDone();
+            return readResults(format);
+        });
+    }
+    
+    Matrix multiplyResident(const Matrix& activations, ArrayPrecision precision,
+                            ReadbackFormat format = ReadbackFormat::Dense) {
+        return multiplyResident(view(activations), precision, format);
+    }
+    
+    Matrix multiplyResident(const TileView& activations, ArrayPrecision precision,
+                            ReadbackFormat format = ReadbackFormat::Dense) {
+        setPrecision(precision);
+        return multiplyResident(activations, format);
+    }
+    
+    /**
+     * Matrix multiplication at a given array precision, e.g. exact() for
+     * error-sensitive layers and approximate() for tolerant ones
+     */
+    Matrix matrixMultiply(const Matrix& weights, const Matrix& activations,
+                          ArrayPrecision precision,
+                          ReadbackFormat format = ReadbackFormat::Dense) {
+        setPrecision(precision);
+        return matrixMultiply(weights, activations, format);
+    }
+    
+    /**
+     * Multiply new activations against the weights already on the TPU.
+     * Lets tiled callers upload a weight tile once and reuse it.
+     */
+    Matrix multiplyResident(const Matrix& activations,
+                            ReadbackFormat format = ReadbackFormat::Dense) {
+        return multiplyResident(view(activations), format);
+    }
+    
+    Matrix multiplyResident(const TileView& activations,
+                            ReadbackFormat format = ReadbackFormat::Dense) {
+        if (metrics_) metrics_->matmuls.add();
+        return recoverable([&] {
+            std::optional<uint32_t> config;
+            if (resultCache_ && residentWeightsKnown_ && (config = cacheConfig(format))) {
+                std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE> a;
+                TileEncoder::encode(activations, a.data());
+                return cachedMultiply(residentWeights_.data(), a, *config, format);
+            }
+            writeActivations(activations);
+            start();
+            waitUntilDone();
+            return readResults(format);
+        });
+    }
+    
+    /**
+     * Multiply a weight/activation tile pair into the device accumulators:
+     * cleared first when `clear`, otherwise added on top. A K-long
+     * reduction stays on the TPU until one readResults(ReadbackFormat::Wide).
+     */
+    void multiplyAccumulate(const TileView& weights, const TileView& activations, bool clear) {
+        return recoverable([&] {
+            writeWeights(weights);
+            writeActivations(activations);
+            if (clear) {
+                start();
+            } else {
+                startAccumulate();
+            }
+            waitUntilDone();
+        }, clear);
+    }
+    
+    /**
+     * Queue a job on the device (cmd, descriptor, ACK, then 128 bytes per
+     * loaded operand, weights first). Returns nothing when the device
+     * answered NACK because its queue is full; no payload is sent then.
+     *
+     * After a link error past the descriptor the device may or may not
+     * have queued the job, so the retry first counts what it accepted
+     * (jobs completed + jobs queued). A job without payload that was
+     * queued is the job as sent and gets its ticket. A job with payload
+     * that was queued may carry damaged operands: its sequence number is
+     * used up and the job is sent again, unless it accumulates, which
+     * would add twice. Tickets thus keep the device's job order.
+     */
+    std::optional<JobTicket> tryEnqueue(DeviceJob job) {
+        bool descriptorSent = false;
+        return recoverable([&]() -> std::optional<JobTicket> {
+            if (!jobCountsSynced_) {
+                jobsSubmitted_ = acceptedJobs();
+                jobCountsSynced_ = true;
+            }
+            if (descriptorSent) {
+                descriptorSent = false;
+                if (acceptedJobs() > jobsSubmitted_) {
+                    if (!job.loadsWeights() && !job.loadsActivations()) {
+                        return issueTicket(job);
+                    }
+                    jobsSubmitted_++;
+                    if (job.accumulate) {
+                        throw std::runtime_error("Accumulating job may have run with damaged operands");
+                    }
+                }
+            }
+            job.slot = claimableSlot(job.slot);
+            if (job.accumulate) syncResults();
+            if (!job.loadsWeights()) syncWeights();
+            if (!job.loadsActivations()) syncActivations();
+            PhaseTimer timer(*this, uploadPhase());
+            uint8_t header[2] = {static_cast<uint8_t>(ProtocolCommand::EnqueueJob), job.descriptor()};
+            sendCommand(header, 2);
+            descriptorSent = true;
+            uint8_t resp;
+            receive(&resp, 1, "Failed to enqueue job");
+            if (resp == RESP_NACK) {
+                descriptorSent = false;
+                return std::nullopt;
+            }
+            if (resp != RESP_ACK) {
+                throw LinkError("Failed to enqueue job");
+            }
+            queuePending_ = true;
+            
+            const size_t tileBytes = MATRIX_SIZE * MATRIX_SIZE * 2;
+            Arena::Scope frame(arena_);
+            uint8_t* payload = arena_.allocateArray<uint8_t>(2 * tileBytes);
+            uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+            size_t len = 0;
+            for (const TileView* operand : {&job.weights, &job.activations}) {
+                if (!operand->base) continue;
+                TileEncoder::encode(*operand, words);
+                for (uint16_t w : words) {
+                    payload[len++] = w & 0xFF;
+                    payload[len++] = (w >> 8) & 0xFF;
+                }
+                if (operand == &job.weights) {
+                    std::copy(words, words + MATRIX_SIZE * MATRIX_SIZE, residentWeights_.begin());
+                } else {
+                    std::copy(words, words + MATRIX_SIZE * MATRIX_SIZE, residentActivations_.begin());
+                }
+            }
+            sendPayload(payload, len);
+            descriptorSent = false;
+            
+            if (job.loadsWeights()) {
+                residentWeightsKnown_ = true;
+                weightsDeferred_ = false;
+            }
+            if (job.loadsActivations()) {
+                shadowValid_ = false;
+                residentActivationsKnown_ = true;
+                activationsDeferred_ = false;
+            }
+            return issueTicket(job);
+        });
+    }
+    
+    /**
+     * Free queue entries and completed jobs
+     */
+    QueueStatus queueStatus() {
+        return recoverable([&] {
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::QueueStatus);
+            sendCommand(&cmd, 1);
+            expectAck("Queue status not acknowledged");
+            uint8_t reply[2];
+            receive(reply, 2, "Failed to read queue status");
+            
+            // The device counts completions mod 256; exact as long as fewer
+            // than 256 jobs finish between two polls
+            jobsCompleted_ += static_cast<uint8_t>(reply[1] - static_cast<uint8_t>(jobsCompleted_));
+            
+            queuePending_ = reply[0] < JOB_QUEUE_DEPTH;
+            QueueStatus status;
+            status.freeEntries = reply[0];
+            status.jobsCompleted = jobsCompleted_;
+            return status;
+        });
+    }
+    
+    /**
+     * Slots whose latest job has completed (ProtocolCommand::SlotStatus)
+     */
+    uint16_t readySlots() {
+        return recoverable([&] {
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::SlotStatus);
+            sendCommand(&cmd, 1);
+            expectAck("Slot status not acknowledged");
+            uint8_t reply[2];
+            receive(reply, 2, "Failed to read slot status");
+            return static_cast<uint16_t>(reply[0] | (reply[1] << 8));
+        });
+    }
+    
+    /**
+     * Submitted jobs not yet collected
+     */
+    size_t jobsInFlight() const {
+        size_t n = 0;
+        for (uint32_t b = busySlots_; b; b &= b - 1) n++;
+        return n;
+    }
+    
+    /**
+     * Queue a job, polling while the device queue is full. The job's slot
+     * (or the free slot picked for ANY_SLOT) is owned until collected.
+     */
+    JobTicket submit(const DeviceJob& job, int timeout_ms = 10000) {
+        auto start = std::chrono::steady_clock::now();
+        std::optional<JobTicket> ticket;
+        while (!(ticket = tryEnqueue(job))) {
+            while (queueStatus().freeEntries == 0) {
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start);
+                if (elapsed.count() > timeout_ms) {
+                    throw std::runtime_error("Timeout waiting for a free queue entry");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        return *ticket;
+    }
+    
+    /**
+     * Wait for a submitted job and read its result slot, in any order
+     * relative to other jobs
+     */
+    Matrix collect(const JobTicket& ticket, int timeout_ms = 10000) {
+        return recoverable([&] {
+            if (ticket.slot >= RESULT_SLOTS || !(busySlots_ & (1u << ticket.slot)) ||
+                slotTickets_[ticket.slot].sequence != ticket.sequence) {
+                throw std::logic_error("Job is not in flight");
+            }
+            // Jobs run in order, so the completion count decides. The slot's
+            // ready bit does not: a discarded job for the same slot sets it too.
+            auto start = std::chrono::steady_clock::now();
+            while (jobsCompleted_ <= ticket.sequence && queueStatus().jobsCompleted <= ticket.sequence) {
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start);
+                if (elapsed.count() > timeout_ms) {
+                    throw std::runtime_error("Timeout waiting for queued job");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            Matrix result = readSlot(ticket.slot);
+            busySlots_ &= ~(1u << ticket.slot);
+            return result;
+        });
+    }
+    
+    /**
+     * Collect some completed in-flight job without waiting. Returns false
+     * when none has finished yet.
+     */
+    bool collectAny(JobTicket& ticket, Matrix& result) {
+        if (!busySlots_) {
+            return false;
+        }
+        uint32_t ready = readySlots() & busySlots_;
+        if (!ready) {
+            return false;
+        }
+        uint8_t slot = 0;
+        while (!(ready & (1u << slot))) slot++;
+        ticket = slotTickets_[slot];
+        result = collect(ticket);
+        return true;
+    }
+    
+    /**
+     * Read one result slot (cmd, slot, ACK, 128 bytes)
+     */
+    Matrix readSlot(uint8_t slot) {
+        return recoverable([&] {
+            if (slot >= RESULT_SLOTS) {
+                throw std::invalid_argument("Result slot out of range");
+            }
+            PhaseTimer timer(*this, readbackPhase());
+            uint8_t frame[2] = {static_cast<uint8_t>(ProtocolCommand::ReadSlot), slot};
+            Matrix results;
+            readMatrixFramed(frame, sizeof(frame),
+                             static_cast<uint8_t>(ChecksumBuffer::Slot) | slot,
+                             results.data(), "Failed to read result slot");
+            return results;
+        });
+    }
+};
@@ -0,0 +1,659 @@
+/**
+ * In-process TPU emulator
+ *
+ * A Transport that answers the host the way the FPGA does, so the driver,
+ * the tiled runtime and the tools can run without a board. It speaks the
+ * framed commands of uart_protocol_handler.v (ProtocolCommand), the only
+ * protocol of the tpu_top_with_io_complete bitstream (matrix A =
+ * activations, matrix B = weights). The byte protocol of uart_interface.v
+ * ('W' 'A' 'R' 'S' '?', tpu_top_with_io) is NACKed like any unknown
+ * command, byte by byte, unless setByteProtocol() enables it; it then
+ * shares the same memories.
+ *
+ * Products are computed in FP32 from the stored FP16 operands and rounded
+ * back the way the array does (FP16Mode::Hardware: truncate, flush
+ * subnormals). The accumulators persist between runs for
+ * StartAccumulate; AccumulatorMode::FP16 rounds them after every add, as
+ * the array does without ACC_FP32.
+ *
+ * Queued jobs (ProtocolCommand::EnqueueJob) run as soon as their payload
+ * has arrived, in order, unless the queue is held for a test; each sets
+ * its slot's ready bit when it stores its result.
+ *
+ * The result epilogue (ProtocolCommand::SetEpilogue) rewrites the FP16
+ * results after every run as the drain path does: ApproxFP16::add with the
+ * full alignment window, then the activation unit.
+ *
+ * EmulatedArithmetic::BitAccurate replaces the FP32 products with the
+ * selectable datapath (ApproxFP16) at the precision register setting.
+ * With a pipelined MacPipeline (setMacPipeline) its FP16 accumulators sum
+ * in the interleaved-lane order of fp16_pipelined_mac_unit.v.
+ *
+ * setIdleTimeout() models the RX_IDLE_TIMEOUT of uart_protocol_handler.v:
+ * a frame left incomplete for longer is dropped (off by default, so a
+ * slow test host never loses a frame).
+ */
+
+#pragma once
+
+#include "tpu_driver.hpp"
+#include "tpu_approx.hpp"
+#include "tpu_timing.hpp"
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+enum class AccumulatorMode {
+    FP16,   // default bitstream
+    FP32    // ACC_FP32 = 1
+};
+
+enum class EmulatedArithmetic {
+    Float,        // FP32 products of the FP16 operands; ignores the precision register
+    BitAccurate   // RUNTIME_PRECISION bitstream at the current ArrayPrecision
+};
+
+class TPUEmulator : public Transport {
+public:
+    using Memory = std::array<uint16_t, MATRIX_SIZE * MATRIX_SIZE>;
+    using Accumulators = std::array<float, MATRIX_SIZE * MATRIX_SIZE>;
+
+    explicit TPUEmulator(AccumulatorMode mode = AccumulatorMode::FP32,
+                         EmulatedArithmetic arithmetic = EmulatedArithmetic::Float)
+        : mode_(mode), arithmetic_(arithmetic) {}
+
+    size_t write(const uint8_t* data, size_t len) override {
+        if (idleTimeout_.count() > 0 && len > 0) {
+            auto now = std::chrono::steady_clock::now();
+            if (phase_ != Phase::Command && now - lastByte_ > idleTimeout_) {
+                phase_ = Phase::Command;   // partial frame timed out
+                droppedFrames_++;
+            }
+            lastByte_ = now;
+        }
+        for (size_t i = 0; i < len; i++) {
+            consume(data[i]);
+        }
+        return len;
+    }
+
+    size_t read(uint8_t* buffer, size_t len) override {
+        size_t n = std::min(len, tx_.size() - txHead_);
+        std::copy(tx_.begin() + txHead_, tx_.begin() + txHead_ + n, buffer);
+        txHead_ += n;
+        if (txHead_ == tx_.size()) {
+            tx_.clear();   // keeps capacity: no allocation once warmed up
+            txHead_ = 0;
+        }
+        return n;
+    }
+
+    // Device state, exposed for tests and benchmarks
+    Memory& weights() { return weights_; }
+    Memory& activations() { return activations_; }
+    Memory& results() { return results_; }
+    const Accumulators& accumulators() const { return accum_; }
+    size_t computeCount() const { return computeCount_; }
+    ArrayPrecision precision() const { return precision_; }
+    const Memory& resultSlot(size_t slot) const { return slots_.at(slot); }
+    size_t queuedJobs() const { return queue_.size(); }
+    uint16_t slotReady() const { return slotReady_; }
+    const std::array<uint16_t, MATRIX_SIZE>& bias() const { return bias_; }
+    const Memory& residual() const { return residual_; }
+    DeviceEpilogue epilogue() const { return DeviceEpilogue::decode(epilogue_); }
+    MacPipeline macPipeline() const { return pipeline_; }
+    size_t droppedFrames() const { return droppedFrames_; }
+
+    /**
+     * PE build being emulated (MAC_MULT_STAGES / MAC_ADD_STAGES)
+     */
+    void setMacPipeline(MacPipeline pipeline) {
+        pipeline.validate();
+        pipeline_ = pipeline;
+    }
+
+    /**
+     * Also answer the byte protocol of uart_interface.v (off by default,
+     * as on tpu_top_with_io_complete)
+     */
+    void setByteProtocol(bool enabled) { byteProtocol_ = enabled; }
+
+    /**
+     * Drop a partially received frame after `timeout` without input, as
+     * the hardware does after RX_IDLE_TIMEOUT byte times; zero disables
+     */
+    void setIdleTimeout(std::chrono::microseconds timeout) { idleTimeout_ = timeout; }
+
+    /**
+     * Stop running queued jobs (to fill the queue in tests); releasing
+     * runs everything pending
+     */
+    void holdQueue(bool hold) {
+        holdQueue_ = hold;
+        if (!deferJobs_) runQueue();
+    }
+
+    /**
+     * Leave queued jobs pending until the host polls for them: each
+     * QueueStatus or SlotStatus runs the oldest one, as if the queue were
+     * still busy whenever anything else arrives. Direct writes, starts and
+     * chaining are refused (NACK) while jobs are pending, as on hardware.
+     */
+    void deferJobs(bool defer) { deferJobs_ = defer; }
+
+private:
+    enum class Phase { Command, Header, Payload };
+
+    Memory weights_{};
+    Memory activations_{};
+    Memory results_{};
+    Accumulators accum_{};
+    AccumulatorMode mode_;
+    EmulatedArithmetic arithmetic_;
+    ArrayPrecision precision_ = ArrayPrecision::approximate();
+    MacPipeline pipeline_;
+    std::array<uint16_t, MATRIX_SIZE> bias_{};
+    Memory residual_{};
+    uint8_t epilogue_ = 0;
+    bool done_ = false;
+    size_t computeCount_ = 0;
+
+    struct Job {
+        uint8_t descriptor;
+        Memory weights;
+        Memory activations;
+    };
+    std::deque<Job> queue_;
+    std::array<Memory, RESULT_SLOTS> slots_{};
+    uint8_t jobsDone_ = 0;
+    uint16_t slotReady_ = 0;
+    bool holdQueue_ = false;
+    bool deferJobs_ = false;
+    bool byteProtocol_ = false;
+
+    std::vector<uint8_t> tx_;   // bytes waiting for the host to read
+    size_t txHead_ = 0;
+
+    Phase phase_ = Phase::Command;
+    std::chrono::microseconds idleTimeout_{0};
+    std::chrono::steady_clock::time_point lastByte_{};
+    size_t droppedFrames_ = 0;
+    uint8_t cmd_ = 0;
+    std::vector<uint8_t> header_;
+    std::vector<uint8_t> payload_;
+    size_t headerNeeded_ = 0;
+    size_t payloadNeeded_ = 0;
+
+    void reply(uint8_t b) { tx_.push_back(b); }
+
+    void replyWords(const Memory& mem) {
+        for (uint16_t w : mem) {
+            reply(w & 0xFF);
+            reply((w >> 8) & 0xFF);
+        }
+    }
+
+    static void storeByte(Memory& mem, size_t byteAddr, uint8_t data) {
+        uint16_t& w = mem[(byteAddr / 2) % mem.size()];
+        if (byteAddr % 2 == 0) {
+            w = static_cast<uint16_t>((w & 0xFF00) | data);
+        } else {
+            w = static_cast<uint16_t>((w & 0x00FF) | (data << 8));
+        }
+    }
+
+    static uint8_t loadByte(const Memory& mem, size_t byteAddr) {
+        uint16_t w = mem[(byteAddr / 2) % mem.size()];
+        return (byteAddr % 2 == 0) ? (w & 0xFF) : ((w >> 8) & 0xFF);
+    }
+
+    static void storeWords(Memory& mem, const uint8_t* bytes) {
+        for (size_t i = 0; i < mem.size(); i++) {
+            mem[i] = static_cast<uint16_t>(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+        }
+    }
+
+    void replyWide(const Accumulators& acc) {
+        for (float v : acc) {
+            uint32_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            for (int b = 0; b < 4; b++) {
+                reply((bits >> (8 * b)) & 0xFF);
+            }
+        }
+    }
+
+    void compute(bool accumulate = false) {
+        if (arithmetic_ == EmulatedArithmetic::BitAccurate) {
+            computeBitAccurate(accumulate);
+            return;
+        }
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            for (size_t j = 0; j < MATRIX_SIZE; j++) {
+                float sum = accumulate ? accum_[i * MATRIX_SIZE + j] : 0.0f;
+                for (size_t k = 0; k < MATRIX_SIZE; k++) {
+                    sum += FP16::toFloat(weights_[i * MATRIX_SIZE + k], FP16Mode::Hardware) *
+                           FP16::toFloat(activations_[k * MATRIX_SIZE + j], FP16Mode::Hardware);
+                    if (mode_ == AccumulatorMode::FP16) {
+                        sum = FP16::toFloat(FP16::fromFloat(sum, FP16Mode::Hardware));
+                    }
+                }
+                accum_[i * MATRIX_SIZE + j] = sum;
+                results_[i * MATRIX_SIZE + j] = FP16::fromFloat(sum, FP16Mode::Hardware);
+            }
+        }
+        applyEpilogue();
+        done_ = true;
+        computeCount_++;
+    }
+
+    void computeBitAccurate(bool accumulate) {
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            for (size_t j = 0; j < MATRIX_SIZE; j++) {
+                float& acc = accum_[i * MATRIX_SIZE + j];
+                uint16_t acc16 = FP16::fromFloat(acc, FP16Mode::Hardware);   // exact: FP16 accumulators hold FP16 values
+                if (mode_ == AccumulatorMode::FP16 && pipeline_.pipelined()) {
+                    uint16_t prods[MATRIX_SIZE];
+                    for (size_t k = 0; k < MATRIX_SIZE; k++) {
+                        prods[k] = ApproxFP16::multiply(weights_[i * MATRIX_SIZE + k],
+                                                        activations_[k * MATRIX_SIZE + j],
+                                                        precision_.multBits);
+                    }
+                    acc16 = accumulateLanes(prods, MATRIX_SIZE, pipeline_.lanes(),
+                                            precision_.alignMax, accumulate ? acc16 : 0);
+                    acc = FP16::toFloat(acc16);
+                    results_[i * MATRIX_SIZE + j] = acc16;
+                    continue;
+                }
+                for (size_t k = 0; k < MATRIX_SIZE; k++) {
+                    uint16_t prod = ApproxFP16::multiply(weights_[i * MATRIX_SIZE + k],
+                                                         activations_[k * MATRIX_SIZE + j],
+                                                         precision_.multBits);
+                    bool load = k == 0 && !accumulate;   // acc_clear loads the first product
+                    if (mode_ == AccumulatorMode::FP32) {
+                        acc = (load ? 0.0f : acc) + FP16::toFloat(prod);
+                    } else {
+                        acc16 = load ? prod : ApproxFP16::add(acc16, prod, precision_.alignMax);
+                        acc = FP16::toFloat(acc16);
+                    }
+                }
+                results_[i * MATRIX_SIZE + j] = FP16::fromFloat(acc, FP16Mode::Hardware);
+            }
+        }
+        applyEpilogue();
+        done_ = true;
+        computeCount_++;
+    }
+
+    /**
+     * EPILOGUE state of tpu_top_with_io_complete.v
+     */
+    void applyEpilogue() {
+        if ((epilogue_ & 0x1F) == 0) return;
+        for (size_t n = 0; n < results_.size(); n++) {
+            uint16_t v = results_[n];
+            if (epilogue_ & 0x01) v = ApproxFP16::add(v, bias_[n / MATRIX_SIZE], 15);
+            if (epilogue_ & 0x02) v = ApproxFP16::add(v, residual_[n], 15);
+            results_[n] = activate(v, (epilogue_ >> 2) & 0x07);
+        }
+    }
+
+    /**
+     * Element `index` of a WriteElements / WriteRange buffer operand
+     * (bias addresses wrap as mem_addr[2:0] does)
+     */
+    uint16_t& bufferWord(uint8_t buffer, size_t index) {
+        switch (buffer & 0x03) {
+            case 0x00: return activations_[index % activations_.size()];
+            case 0x01: return weights_[index % weights_.size()];
+            case 0x02: return residual_[index % residual_.size()];
+            default:   return bias_[index % bias_.size()];
+        }
+    }
+
+    /**
+     * FP16 branch of activation_functions.v, quirks included (LeakyReLU
+     * shifts the bit pattern, Sigmoid/Tanh are coarse piecewise constants)
+     */
+    static uint16_t activate(uint16_t x, uint8_t type) {
+        bool negative = x & 0x8000;
+        unsigned exp = (x >> 10) & 0x1F;
+        switch (static_cast<DeviceActivation>(type)) {
+            case DeviceActivation::ReLU:
+            case DeviceActivation::Swish:
+            case DeviceActivation::GELU:
+                return negative ? 0 : x;
+            case DeviceActivation::ReLU6:
+                return negative ? 0 : std::min<uint16_t>(x, 0x4600);
+            case DeviceActivation::Sigmoid:
+                return exp > 0x12 ? 0x3C00 : 0x3800;
+            case DeviceActivation::Tanh:
+                return exp > 0x11 ? 0x3C00 : x;
+            case DeviceActivation::LeakyReLU:
+                return negative ? static_cast<uint16_t>(x >> 7) : x;
+            default:
+                return x;
+        }
+    }
+
+    /**
+     * Run queued jobs the way JOB_LOAD / JOB_STORE do: load the flagged
+     * operands, compute, copy the results into the job's slot
+     */
+    void runQueue(size_t limit = SIZE_MAX) {
+        while (!holdQueue_ && !queue_.empty() && limit-- > 0) {
+            const Job& job = queue_.front();
+            if (job.descriptor & 0x01) weights_ = job.weights;
+            if (job.descriptor & 0x02) activations_ = job.activations;
+            compute(job.descriptor & 0x04);
+            slots_[(job.descriptor >> 4) % RESULT_SLOTS] = results_;
+            slotReady_ |= 1u << ((job.descriptor >> 4) % RESULT_SLOTS);
+            jobsDone_++;
+            queue_.pop_front();
+        }
+    }
+
+    void pushJob(const Job& job) {
+        slotReady_ &= ~(1u << ((job.descriptor >> 4) % RESULT_SLOTS));
+        queue_.push_back(job);
+        if (!deferJobs_) runQueue();
+    }
+
+    /**
+     * Commands the handler NACKs while queued jobs own the array memories
+     * (queue_busy in uart_protocol_handler.v)
+     */
+    static bool needsIdleArray(uint8_t cmd) {
+        switch (cmd) {
+            case static_cast<uint8_t>(ProtocolCommand::WriteMatrixA):
+            case static_cast<uint8_t>(ProtocolCommand::WriteMatrixB):
+            case static_cast<uint8_t>(ProtocolCommand::StartCompute):
+            case static_cast<uint8_t>(ProtocolCommand::StartAccumulate):
+            case static_cast<uint8_t>(ProtocolCommand::ChainResult):
+            case static_cast<uint8_t>(ProtocolCommand::WriteElements):
+            case static_cast<uint8_t>(ProtocolCommand::WriteRange):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Bytes that follow the command byte before the device responds
+     */
+    size_t headerLength(uint8_t cmd) const {
+        switch (cmd) {
+            case 'W': case 'A': return byteProtocol_ ? 2 : 0;   // addr, data
+            case 'R': return byteProtocol_ ? 1 : 0;             // addr
+            case static_cast<uint8_t>(ProtocolCommand::WriteElements):
+                return 2;                   // buffer, count
+            case static_cast<uint8_t>(ProtocolCommand::WriteRange):
+                return 3;                   // buffer, offset, count
+            case static_cast<uint8_t>(ProtocolCommand::SetPrecision):
+                return 1;                   // {alignMax, multBits}
+            case static_cast<uint8_t>(ProtocolCommand::SetEpilogue):
+                return 1;                   // epilogue byte
+            case static_cast<uint8_t>(ProtocolCommand::ChainResult):
+                return 1;                   // activation type
+            case static_cast<uint8_t>(ProtocolCommand::EnqueueJob):
+                return 1;                   // descriptor
+            case static_cast<uint8_t>(ProtocolCommand::ReadSlot):
+                return 1;                   // slot
+            case static_cast<uint8_t>(ProtocolCommand::Checksum):
+                return 1;                   // ChecksumBuffer
+            default: return 0;
+        }
+    }
+
+    void consume(uint8_t b) {
+        switch (phase_) {
+            case Phase::Command:
+                cmd_ = b;
+                header_.clear();
+                headerNeeded_ = headerLength(b);
+                if (headerNeeded_ == 0) {
+                    onHeader();
+                } else {
+                    phase_ = Phase::Header;
+                }
+                break;
+
+            case Phase::Header:
+                header_.push_back(b);
+                if (header_.size() == headerNeeded_) {
+                    phase_ = Phase::Command;
+                    onHeader();
+                }
+                break;
+
+            case Phase::Payload:
+                payload_.push_back(b);
+                if (payload_.size() == payloadNeeded_) {
+                    phase_ = Phase::Command;
+                    onPayload();
+                }
+                break;
+        }
+    }
+
+    void expectPayload(size_t bytes) {
+        payload_.clear();
+        payloadNeeded_ = bytes;
+        phase_ = Phase::Payload;
+    }
+
+    /**
+     * Byte protocol of uart_interface.v (setByteProtocol)
+     */
+    void onByteCommand() {
+        switch (cmd_) {
+            case 'W':
+                storeByte(weights_, header_[0], header_[1]);
+                reply('K');
+                break;
+            case 'A':
+                storeByte(activations_, static_cast<uint8_t>(header_[0] - ACTIVATION_BASE), header_[1]);
+                reply('K');
+                break;
+            case 'R':
+                reply(loadByte(results_, static_cast<uint8_t>(header_[0] - RESULT_BASE)));
+                break;
+            case 'S':
+                compute();
+                reply('K');
+                break;
+            case '?':
+                reply(done_ ? 0x02 : 0x00);
+                break;
+        }
+    }
+
+    void onHeader() {
+        if (!queue_.empty() && needsIdleArray(cmd_)) {
+            reply(RESP_NACK);
+            return;
+        }
+        switch (cmd_) {
+            // Byte protocol (uart_interface.v)
+            case 'W': case 'A': case 'R': case 'S': case '?':
+                if (!byteProtocol_) {
+                    reply(RESP_NACK);
+                    break;
+                }
+                onByteCommand();
+                break;
+
+            // Framed protocol (uart_protocol_handler.v)
+            case static_cast<uint8_t>(ProtocolCommand::WriteMatrixA):
+            case static_cast<uint8_t>(ProtocolCommand::WriteMatrixB):
+                reply(RESP_ACK);
+                expectPayload(MATRIX_SIZE * MATRIX_SIZE * 2);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::ReadResult):
+                reply(RESP_ACK);
+                replyWords(results_);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::StartCompute):
+                compute();
+                reply(RESP_ACK);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::GetStatus):
+                // Runs finish before the frame is answered, and the
+                // DONE state is long gone by then: idle, done clear
+                reply(RESP_ACK);
+                reply(0x00);
+                reply(0x00);
+                reply(0x00);
+                reply(0x00);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::Reset):
+                // Protocol reset: tpu_top_with_io_complete does not feed
+                // tpu_reset to the controller, so runs, results and the
+                // job queue are kept
+                reply(RESP_ACK);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::ReadMatrixA):
+                reply(RESP_ACK);
+                replyWords(activations_);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::ReadMatrixB):
+                reply(RESP_ACK);
+                replyWords(weights_);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::WriteElements):
+                reply(RESP_ACK);
+                if (header_[1] > 0) {
+                    expectPayload(3 * header_[1]);
+                }
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::WriteRange):
+                if (header_[1] + header_[2] > MATRIX_SIZE * MATRIX_SIZE) {
+                    reply(RESP_NACK);
+                    break;
+                }
+                reply(RESP_ACK);
+                if (header_[2] > 0) {
+                    expectPayload(2 * header_[2]);
+                }
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::ReadResultWide):
+                reply(RESP_ACK);
+                replyWide(accum_);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::SetPrecision):
+                precision_ = ArrayPrecision::decode(header_[0]);
+                reply(RESP_ACK);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::SetEpilogue):
+                epilogue_ = header_[0];
+                reply(RESP_ACK);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::StartAccumulate):
+                compute(true);
+                reply(RESP_ACK);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::ChainResult):
+                for (size_t i = 0; i < activations_.size(); i++) {
+                    activations_[i] = activate(results_[i], header_[0] & 0x07);
+                }
+                reply(RESP_ACK);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::EnqueueJob): {
+                if (queue_.size() == JOB_QUEUE_DEPTH) {
+                    reply(RESP_NACK);
+                    break;
+                }
+                reply(RESP_ACK);
+                size_t operands = (header_[0] & 0x01) + ((header_[0] >> 1) & 0x01);
+                if (operands == 0) {
+                    pushJob(Job{header_[0], {}, {}});
+                } else {
+                    expectPayload(operands * MATRIX_SIZE * MATRIX_SIZE * 2);
+                }
+                break;
+            }
+            case static_cast<uint8_t>(ProtocolCommand::QueueStatus):
+                if (deferJobs_) runQueue(1);
+                reply(RESP_ACK);
+                reply(static_cast<uint8_t>(JOB_QUEUE_DEPTH - queue_.size()));
+                reply(jobsDone_);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::SlotStatus):
+                if (deferJobs_) runQueue(1);
+                reply(RESP_ACK);
+                reply(slotReady_ & 0xFF);
+                reply((slotReady_ >> 8) & 0xFF);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::ReadSlot):
+                reply(RESP_ACK);
+                replyWords(slots_[header_[0] % RESULT_SLOTS]);
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::Checksum): {
+                // Decoded like the handler: bit 4 a slot, else bit 1 the
+                // result, else bit 0 matrix B
+                uint8_t buffer = header_[0];
+                const Memory& mem = (buffer & 0x10) ? slots_[buffer & 0x0F]
+                                  : (buffer & 0x02) ? results_
+                                  : (buffer & 0x01) ? weights_ : activations_;
+                uint32_t sums = bufferChecksum(mem.data(), mem.size());
+                reply(RESP_ACK);
+                for (int i = 0; i < 4; i++) {
+                    reply(static_cast<uint8_t>(sums >> (8 * i)));
+                }
+                break;
+            }
+            case static_cast<uint8_t>(ProtocolCommand::ReadResultCompressed): {
+                uint8_t frame[ResultCodec::BITMAP_BYTES + MATRIX_SIZE * MATRIX_SIZE * 2];
+                size_t n = ResultCodec::encode(results_.data(), frame);
+                reply(RESP_ACK);
+                tx_.insert(tx_.end(), frame, frame + n);
+                break;
+            }
+
+            default:
+                reply(RESP_NACK);
+                break;
+        }
+    }
+
+    void onPayload() {
+        switch (cmd_) {
+            case static_cast<uint8_t>(ProtocolCommand::WriteMatrixA):
+                storeWords(activations_, payload_.data());
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::WriteMatrixB):
+                storeWords(weights_, payload_.data());
+                break;
+            case static_cast<uint8_t>(ProtocolCommand::WriteElements): {
+                for (size_t i = 0; i + 2 < payload_.size(); i += 3) {
+                    bufferWord(header_[0], payload_[i]) =
+                        static_cast<uint16_t>(payload_[i + 1] | (payload_[i + 2] << 8));
+                }
+                break;
+            }
+            case static_cast<uint8_t>(ProtocolCommand::EnqueueJob): {
+                Job job{header_[0], {}, {}};
+                const uint8_t* bytes = payload_.data();
+                if (job.descriptor & 0x01) {
+                    storeWords(job.weights, bytes);
+                    bytes += MATRIX_SIZE * MATRIX_SIZE * 2;
+                }
+                if (job.descriptor & 0x02) {
+                    storeWords(job.activations, bytes);
+                }
+                pushJob(job);
+                break;
+            }
+            case static_cast<uint8_t>(ProtocolCommand::WriteRange): {
+                for (size_t i = 0; i < header_[2]; i++) {
+                    bufferWord(header_[0], header_[1] + i) =
+                        static_cast<uint16_t>(payload_[2 * i] | (payload_[2 * i + 1] << 8));
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+};
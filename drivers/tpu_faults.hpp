@@ -0,0 +1,198 @@
+/**
+ * Fault-injecting link for resilience and tail-latency testing
+ *
+ * FaultInjectingTransport wraps a Transport (TPUEmulator, a SerialPort on a
+ * pty, ...) and perturbs the traffic the way a marginal UART does:
+ *   - dropped bytes (either direction): the byte never arrives
+ *   - bit flips (either direction): one random bit of the byte inverted
+ *   - delayed responses: a read waits `delay` before data shows up
+ *   - stalls: the link goes quiet for `stall`; reads during a stall time
+ *     out (return 0) after `readTimeout`, as the serial port does
+ * Faults are drawn from a seeded generator, so a profile is reproducible.
+ */
+
+#pragma once
+
+#include "tpu_driver.hpp"
+
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <thread>
+
+struct FaultProfile {
+    std::string name = "clean";
+    double dropByte = 0.0;         // per byte
+    double flipBit = 0.0;          // per byte
+    double delayResponse = 0.0;    // per read
+    std::chrono::microseconds delay{0};
+    double stallLink = 0.0;        // per read
+    std::chrono::microseconds stall{0};
+    uint64_t seed = 1;
+
+    static FaultProfile clean() { return FaultProfile(); }
+
+    static FaultProfile noisy(double flip = 1e-4) {
+        FaultProfile p;
+        p.name = "bit flips";
+        p.flipBit = flip;
+        return p;
+    }
+
+    static FaultProfile lossy(double drop = 1e-4) {
+        FaultProfile p;
+        p.name = "dropped bytes";
+        p.dropByte = drop;
+        return p;
+    }
+
+    static FaultProfile slow(double probability = 0.01,
+                             std::chrono::microseconds delay = std::chrono::microseconds(2000)) {
+        FaultProfile p;
+        p.name = "delays";
+        p.delayResponse = probability;
+        p.delay = delay;
+        return p;
+    }
+
+    static FaultProfile stalling(double probability = 1e-3,
+                                 std::chrono::microseconds stall = std::chrono::microseconds(20000)) {
+        FaultProfile p;
+        p.name = "stalls";
+        p.stallLink = probability;
+        p.stall = stall;
+        return p;
+    }
+};
+
+/**
+ * Faults injected so far
+ */
+struct FaultStats {
+    uint64_t droppedBytes = 0;
+    uint64_t flippedBytes = 0;
+    uint64_t delays = 0;
+    uint64_t stalls = 0;
+    uint64_t timeouts = 0;   // reads that returned nothing because of a stall
+
+    uint64_t total() const { return droppedBytes + flippedBytes + delays + stalls; }
+
+    friend std::ostream& operator<<(std::ostream& os, const FaultStats& s) {
+        return os << "FaultStats(dropped=" << s.droppedBytes << ", flipped=" << s.flippedBytes
+                  << ", delays=" << s.delays << ", stalls=" << s.stalls
+                  << ", timeouts=" << s.timeouts << ")";
+    }
+};
+
+class FaultInjectingTransport : public Transport {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FaultInjectingTransport(std::unique_ptr<Transport> inner, const FaultProfile& profile,
+                            std::chrono::microseconds readTimeout = std::chrono::microseconds(0))
+        : inner_(std::move(inner)), profile_(profile), readTimeout_(readTimeout), rng_(profile.seed) {
+        if (!inner_) {
+            throw std::invalid_argument("Transport must not be null");
+        }
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        uint8_t out[256];
+        size_t n = 0;
+        for (size_t i = 0; i < len; i++) {
+            uint8_t b = data[i];
+            if (perturb(b)) {
+                out[n++] = b;
+            }
+            if (n == sizeof(out)) {
+                forward(out, n);
+                n = 0;
+            }
+        }
+        forward(out, n);
+        return len;   // the host cannot tell that bytes were lost
+    }
+
+    size_t read(uint8_t* buffer, size_t len) override {
+        if (chance(profile_.stallLink)) {
+            stallUntil_ = Clock::now() + profile_.stall;
+            stats_.stalls++;
+        }
+        Clock::time_point now = Clock::now();
+        if (now < stallUntil_) {
+            if (stallUntil_ - now > readTimeout_) {
+                std::this_thread::sleep_for(readTimeout_);
+                stats_.timeouts++;
+                return 0;
+            }
+            std::this_thread::sleep_until(stallUntil_);
+        }
+        if (chance(profile_.delayResponse)) {
+            std::this_thread::sleep_for(profile_.delay);
+            stats_.delays++;
+        }
+
+        size_t got = inner_->read(buffer, len);
+        size_t kept = 0;
+        for (size_t i = 0; i < got; i++) {
+            uint8_t b = buffer[i];
+            if (perturb(b)) {
+                buffer[kept++] = b;
+            }
+        }
+        if (got > 0 && kept == 0) {
+            // Everything in this read was lost: the port times out
+            std::this_thread::sleep_for(readTimeout_);
+        }
+        return kept;
+    }
+
+    void beginCommand() override { inner_->beginCommand(); }
+    void discardInput() override { inner_->discardInput(); }
+
+    /**
+     * Change the profile (e.g. clean for a recovery step); the generator
+     * keeps its state
+     */
+    void setProfile(const FaultProfile& profile) { profile_ = profile; }
+    const FaultProfile& profile() const { return profile_; }
+    const FaultStats& stats() const { return stats_; }
+    Transport& inner() { return *inner_; }
+
+private:
+    std::unique_ptr<Transport> inner_;
+    FaultProfile profile_;
+    std::chrono::microseconds readTimeout_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> unit_{0.0, 1.0};
+    Clock::time_point stallUntil_{};
+    FaultStats stats_;
+
+    bool chance(double p) { return p > 0.0 && unit_(rng_) < p; }
+
+    /**
+     * Apply byte faults; false when the byte is dropped
+     */
+    bool perturb(uint8_t& b) {
+        if (chance(profile_.dropByte)) {
+            stats_.droppedBytes++;
+            return false;
+        }
+        if (chance(profile_.flipBit)) {
+            b ^= static_cast<uint8_t>(1u << (rng_() & 7));
+            stats_.flippedBytes++;
+        }
+        return true;
+    }
+
+    void forward(const uint8_t* data, size_t len) {
+        size_t sent = 0;
+        while (sent < len) {
+            size_t n = inner_->write(data + sent, len - sent);
+            if (n == 0) throw std::runtime_error("Write failed");
+            sent += n;
+        }
+    }
+};
@@ -0,0 +1,71 @@
+/**
+ * Compile-time FP16 utilities
+ *
+ * FP16_DECODE_TABLE is FP16::toFloat of all 65,536 FP16 values (256 KB),
+ * generated by the compiler, so decoding a result word is one load with no
+ * branches. Include this header only where the table is wanted: it adds
+ * 256 KB of read-only data and a couple of seconds of compile time.
+ *
+ * fp16Constants encodes a float array at compile time, so constant tensors
+ * (e.g. weights) can be embedded in a binary already in device format:
+ *   constexpr auto W = fp16Constants({0.5f, -1.0f, 2.0f, 0.25f});
+ */
+
+#pragma once
+
+#include "tpu_driver.hpp"
+
+constexpr size_t FP16_VALUES = 0x10000;
+
+constexpr std::array<float, FP16_VALUES> makeFP16DecodeTable(FP16Mode mode = FP16Mode::IEEE) {
+    std::array<float, FP16_VALUES> table{};
+    for (size_t h = 0; h < FP16_VALUES; h++) {
+        table[h] = FP16::toFloat(static_cast<uint16_t>(h), mode);
+    }
+    return table;
+}
+
+inline constexpr std::array<float, FP16_VALUES> FP16_DECODE_TABLE = makeFP16DecodeTable();
+
+/**
+ * Table-driven decode, same results as FP16::toFloat (IEEE)
+ */
+class FP16Table {
+public:
+    static constexpr float toFloat(uint16_t fp16) {
+        return FP16_DECODE_TABLE[fp16];
+    }
+
+    static void toFloatArray(const uint16_t* in, float* out, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = FP16_DECODE_TABLE[in[i]];
+        }
+    }
+};
+
+/**
+ * FP16 words of `values`, evaluated at compile time when used in a
+ * constant expression
+ */
+template <size_t N>
+constexpr std::array<uint16_t, N> fp16Constants(const float (&values)[N],
+                                                FP16Mode mode = FP16Mode::IEEE) {
+    std::array<uint16_t, N> words{};
+    for (size_t i = 0; i < N; i++) {
+        words[i] = FP16::fromFloat(values[i], mode);
+    }
+    return words;
+}
+
+/**
+ * Float values of constant FP16 words
+ */
+template <size_t N>
+constexpr std::array<float, N> fp16Decode(const std::array<uint16_t, N>& words,
+                                          FP16Mode mode = FP16Mode::IEEE) {
+    std::array<float, N> values{};
+    for (size_t i = 0; i < N; i++) {
+        values[i] = FP16::toFloat(words[i], mode);
+    }
+    return values;
+}
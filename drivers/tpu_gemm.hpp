@@ -0,0 +1,537 @@
+/**
+ * Tiled GEMM on top of the 8x8 TPU
+ *
+ * Splits C = A * B (A is MxK, B is KxN, all row-major with leading
+ * dimensions) into MATRIX_SIZE x MATRIX_SIZE tiles. Each A tile is uploaded
+ * once as the weight operand and reused for every B tile of its row band;
+ * partial products over K are accumulated on the host in FP32.
+ *
+ * The functions are templates over the engine so the same code drives the
+ * real board (TPUDriver) or a software model. An engine must provide:
+ *   void              writeWeights(const TPUDriver::Matrix&)
+ *   void              writeWeights(const TileView&)
+ *   TPUDriver::Matrix multiplyResident(const TPUDriver::Matrix&)
+ *   TPUDriver::Matrix multiplyResident(const TileView&)
+ * GEMM operands are passed as TileViews into the caller's matrices, so no
+ * intermediate tiles are copied on the way to the wire.
+ */
+
+#pragma once
+
+#include "tpu_driver.hpp"
+#include "tpu_arena.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+/**
+ * Device work issued by a tiled operation
+ */
+struct GemmStats {
+    size_t weightUploads = 0;   // 8x8 weight tiles sent
+    size_t tileMultiplies = 0;  // 8x8x8 products run on the TPU
+    size_t usefulMacs = 0;      // MACs that contribute to the output
+
+    GemmStats& operator+=(const GemmStats& other) {
+        weightUploads += other.weightUploads;
+        tileMultiplies += other.tileMultiplies;
+        usefulMacs += other.usefulMacs;
+        return *this;
+    }
+
+    /**
+     * Fraction of issued MACs that were not zero padding
+     */
+    double utilization() const {
+        size_t issued = tileMultiplies * MATRIX_SIZE * MATRIX_SIZE * MATRIX_SIZE;
+        return issued ? static_cast<double>(usefulMacs) / issued : 0.0;
+    }
+
+    /**
+     * FP16 operand bytes sent (one weight tile per upload, one
+     * activation tile per multiply)
+     */
+    size_t uploadedBytes() const {
+        return (weightUploads + tileMultiplies) * MATRIX_SIZE * MATRIX_SIZE * 2;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const GemmStats& s) {
+        return os << "GemmStats(tiles=" << s.tileMultiplies
+                  << ", weight_uploads=" << s.weightUploads
+                  << ", utilization=" << s.utilization() * 100.0 << "%"
+                  << ", macs_per_byte=" << (s.uploadedBytes() ? static_cast<double>(s.usefulMacs) / s.uploadedBytes() : 0.0)
+                  << ")";
+    }
+};
+
+/**
+ * Number of tiles needed to cover n elements
+ */
+inline size_t tileCount(size_t n) {
+    return (n + MATRIX_SIZE - 1) / MATRIX_SIZE;
+}
+
+/**
+ * Materialise a view as a zero-padded 8x8 tile (for software engines)
+ */
+inline void loadTile(TPUDriver::Matrix& tile, const TileView& view) {
+    for (size_t i = 0; i < MATRIX_SIZE; i++) {
+        for (size_t j = 0; j < MATRIX_SIZE; j++) {
+            tile[i][j] = view.at(i, j);
+        }
+    }
+}
+
+/**
+ * Add the valid part of a result tile into C
+ */
+inline void accumulateTile(float* dst, size_t ld, const TPUDriver::Matrix& tile,
+                           size_t rows, size_t cols) {
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            dst[i * ld + j] += tile[i][j];
+        }
+    }
+}
+
+/**
+ * C = A * B using 8x8 device tiles.
+ * With transposeA, A is stored K x M (op(A) = A^T, lda is its row stride);
+ * likewise transposeB stores B as N x K.
+ */
+template <typename Engine>
+GemmStats tiledGemm(Engine& tpu, size_t M, size_t N, size_t K,
+                    const float* A, size_t lda,
+                    const float* B, size_t ldb,
+                    float* C, size_t ldc,
+                    bool transposeA = false, bool transposeB = false) {
+    GemmStats stats;
+
+    for (size_t i = 0; i < M; i++) {
+        std::fill(C + i * ldc, C + i * ldc + N, 0.0f);
+    }
+
+    // Start of the block holding op(X)[r0.., c0..]
+    auto blockBase = [](const float* X, size_t ld, bool transposed, size_t r0, size_t c0) {
+        return transposed ? X + c0 * ld + r0 : X + r0 * ld + c0;
+    };
+
+    TileView weightTile, activationTile;
+    weightTile.rowStride = static_cast<ptrdiff_t>(lda);
+    weightTile.transpose = transposeA;
+    activationTile.rowStride = static_cast<ptrdiff_t>(ldb);
+    activationTile.transpose = transposeB;
+
+    for (size_t m0 = 0; m0 < M; m0 += MATRIX_SIZE) {
+        size_t rows = std::min(MATRIX_SIZE, M - m0);
+
+        for (size_t k0 = 0; k0 < K; k0 += MATRIX_SIZE) {
+            size_t depth = std::min(MATRIX_SIZE, K - k0);
+
+            weightTile.base = blockBase(A, lda, transposeA, m0, k0);
+            weightTile.rows = rows;
+            weightTile.cols = depth;
+            tpu.writeWeights(weightTile);
+            stats.weightUploads++;
+
+            for (size_t n0 = 0; n0 < N; n0 += MATRIX_SIZE) {
+                size_t cols = std::min(MATRIX_SIZE, N - n0);
+
+                activationTile.base = blockBase(B, ldb, transposeB, k0, n0);
+                activationTile.rows = depth;
+                activationTile.cols = cols;
+                auto result = tpu.multiplyResident(activationTile);
+                stats.tileMultiplies++;
+                stats.usefulMacs += rows * depth * cols;
+
+                accumulateTile(C + m0 * ldc + n0, ldc, result, rows, cols);
+            }
+        }
+    }
+
+    return stats;
+}
+
+/**
+ * tiledGemm through the device job queue: tile products are submitted as
+ * jobs while earlier results are still being read back, so the link
+ * streams instead of waiting for each multiply. Up to RESULT_SLOTS jobs
+ * are in flight (all slots must be free on entry); results are collected
+ * and accumulated in submission order, so C matches tiledGemm bit for bit.
+ * The engine must provide
+ *   JobTicket         submit(const DeviceJob&)
+ *   TPUDriver::Matrix collect(const JobTicket&)
+ */
+template <typename Engine>
+GemmStats queuedGemm(Engine& tpu, size_t M, size_t N, size_t K,
+                     const float* A, size_t lda,
+                     const float* B, size_t ldb,
+                     float* C, size_t ldc,
+                     bool transposeA = false, bool transposeB = false) {
+    GemmStats stats;
+
+    for (size_t i = 0; i < M; i++) {
+        std::fill(C + i * ldc, C + i * ldc + N, 0.0f);
+    }
+
+    auto blockBase = [](const float* X, size_t ld, bool transposed, size_t r0, size_t c0) {
+        return transposed ? X + c0 * ld + r0 : X + r0 * ld + c0;
+    };
+
+    struct InFlight {
+        JobTicket ticket;
+        float* dst;
+        size_t rows, cols;
+    };
+    std::deque<InFlight> inFlight;
+    auto retireOldest = [&] {
+        const InFlight& f = inFlight.front();
+        accumulateTile(f.dst, ldc, tpu.collect(f.ticket), f.rows, f.cols);
+        inFlight.pop_front();
+    };
+
+    DeviceJob job;
+    job.weights.rowStride = static_cast<ptrdiff_t>(lda);
+    job.weights.transpose = transposeA;
+    job.activations.rowStride = static_cast<ptrdiff_t>(ldb);
+    job.activations.transpose = transposeB;
+
+    for (size_t m0 = 0; m0 < M; m0 += MATRIX_SIZE) {
+        size_t rows = std::min(MATRIX_SIZE, M - m0);
+
+        for (size_t k0 = 0; k0 < K; k0 += MATRIX_SIZE) {
+            size_t depth = std::min(MATRIX_SIZE, K - k0);
+
+            for (size_t n0 = 0; n0 < N; n0 += MATRIX_SIZE) {
+                size_t cols = std::min(MATRIX_SIZE, N - n0);
+
+                // The weight tile rides along with the first job of its band
+                job.weights.base = n0 == 0 ? blockBase(A, lda, transposeA, m0, k0) : nullptr;
+                job.weights.rows = rows;
+                job.weights.cols = depth;
+                job.activations.base = blockBase(B, ldb, transposeB, k0, n0);
+                job.activations.rows = depth;
+                job.activations.cols = cols;
+
+                if (inFlight.size() == RESULT_SLOTS) {
+                    retireOldest();   // frees a slot for this job
+                }
+                inFlight.push_back({tpu.submit(job), C + m0 * ldc + n0, rows, cols});
+                if (n0 == 0) stats.weightUploads++;
+                stats.tileMultiplies++;
+                stats.usefulMacs += rows * depth * cols;
+            }
+        }
+    }
+
+    while (!inFlight.empty()) {
+        retireOldest();
+    }
+    return stats;
+}
+
+/**
+ * C = A * B with the K reduction kept in the device accumulators.
+ * Each output tile is built by K/8 multiplyAccumulate passes (the first
+ * clears) and read back once as FP32, so there is no FP16 rounding of
+ * partial products and no host accumulation pass. Weight tiles are not
+ * reused across output tiles. The engine must provide
+ *   void              multiplyAccumulate(const TileView&, const TileView&, bool clear)
+ *   TPUDriver::Matrix readResults(ReadbackFormat)
+ */
+template <typename Engine>
+GemmStats deviceAccumulatedGemm(Engine& tpu, size_t M, size_t N, size_t K,
+                                const float* A, size_t lda,
+                                const float* B, size_t ldb,
+                                float* C, size_t ldc,
+                                bool transposeA = false, bool transposeB = false) {
+    GemmStats stats;
+
+    auto blockBase = [](const float* X, size_t ld, bool transposed, size_t r0, size_t c0) {
+        return transposed ? X + c0 * ld + r0 : X + r0 * ld + c0;
+    };
+
+    TileView weightTile, activationTile;
+    weightTile.rowStride = static_cast<ptrdiff_t>(lda);
+    weightTile.transpose = transposeA;
+    activationTile.rowStride = static_cast<ptrdiff_t>(ldb);
+    activationTile.transpose = transposeB;
+
+    for (size_t m0 = 0; m0 < M; m0 += MATRIX_SIZE) {
+        size_t rows = std::min(MATRIX_SIZE, M - m0);
+
+        for (size_t n0 = 0; n0 < N; n0 += MATRIX_SIZE) {
+            size_t cols = std::min(MATRIX_SIZE, N - n0);
+
+            for (size_t k0 = 0; k0 < K; k0 += MATRIX_SIZE) {
+                size_t depth = std::min(MATRIX_SIZE, K - k0);
+
+                weightTile.base = blockBase(A, lda, transposeA, m0, k0);
+                weightTile.rows = rows;
+                weightTile.cols = depth;
+                activationTile.base = blockBase(B, ldb, transposeB, k0, n0);
+                activationTile.rows = depth;
+                activationTile.cols = cols;
+                tpu.multiplyAccumulate(weightTile, activationTile, k0 == 0);
+                stats.weightUploads++;
+                stats.tileMultiplies++;
+                stats.usefulMacs += rows * depth * cols;
+            }
+
+            auto result = tpu.readResults(ReadbackFormat::Wide);
+            for (size_t i = 0; i < rows; i++) {
+                for (size_t j = 0; j < cols; j++) {
+                    C[(m0 + i) * ldc + n0 + j] = K ? result[i][j] : 0.0f;
+                }
+            }
+        }
+    }
+
+    return stats;
+}
+
+/**
+ * Algorithm used above the tiler
+ *
+ * Strassen levels split C = A * B into 2x2 blocks and form the product from
+ * 7 block multiplications instead of 8, moving the extra additions to the
+ * host. Each level removes 12.5% of the device tile multiplications, at
+ * the cost of more error growth on the approximate datapath (the block
+ * sums have a larger range than the original operands).
+ */
+enum class GemmAlgorithm {
+    Tiled,
+    Strassen1,  // one level:  7/8  of the tile multiplications
+    Strassen2   // two levels: 49/64 of the tile multiplications
+};
+
+struct GemmOptions {
+    GemmAlgorithm algorithm = GemmAlgorithm::Tiled;
+    Arena* workspace = nullptr;   // Strassen/padding scratch; a per-call arena if null
+};
+
+/**
+ * Error of a device GEMM against an FP32 host reference
+ */
+struct GemmErrorReport {
+    double maxAbsError = 0.0;
+    double meanAbsError = 0.0;
+    double relativeRms = 0.0;   // ||C - ref|| / ||ref||
+
+    friend std::ostream& operator<<(std::ostream& os, const GemmErrorReport& r) {
+        return os << "GemmErrorReport(max_abs=" << r.maxAbsError
+                  << ", mean_abs=" << r.meanAbsError
+                  << ", rel_rms=" << r.relativeRms << ")";
+    }
+};
+
+/**
+ * dst = a + sign * b over a rows x cols block.
+ * Contiguous inner loops so the compiler vectorises them.
+ */
+inline void blockAdd(float* dst, size_t ldd,
+                     const float* a, size_t lda,
+                     const float* b, size_t ldb,
+                     float sign, size_t rows, size_t cols) {
+    for (size_t i = 0; i < rows; i++) {
+        float* d = dst + i * ldd;
+        const float* x = a + i * lda;
+        const float* y = b + i * ldb;
+        for (size_t j = 0; j < cols; j++) {
+            d[j] = x[j] + sign * y[j];
+        }
+    }
+}
+
+/**
+ * dst += sign * src over a rows x cols block
+ */
+inline void blockAccumulate(float* dst, size_t ldd, const float* src, size_t lds,
+                            float sign, size_t rows, size_t cols) {
+    for (size_t i = 0; i < rows; i++) {
+        float* d = dst + i * ldd;
+        const float* s = src + i * lds;
+        for (size_t j = 0; j < cols; j++) {
+            d[j] += sign * s[j];
+        }
+    }
+}
+
+/**
+ * Strassen recursion; m, n, k must be multiples of MATRIX_SIZE << levels.
+ * Block sums and products live in `scratch` and are released on return.
+ */
+template <typename Engine>
+GemmStats strassenGemm(Engine& tpu, size_t levels, size_t m, size_t n, size_t k,
+                       const float* A, size_t lda,
+                       const float* B, size_t ldb,
+                       float* C, size_t ldc,
+                       Arena& scratch) {
+    if (levels == 0) {
+        return tiledGemm(tpu, m, n, k, A, lda, B, ldb, C, ldc);
+    }
+
+    const size_t hm = m / 2, hn = n / 2, hk = k / 2;
+    const float* A11 = A;
+    const float* A12 = A + hk;
+    const float* A21 = A + hm * lda;
+    const float* A22 = A + hm * lda + hk;
+    const float* B11 = B;
+    const float* B12 = B + hn;
+    const float* B21 = B + hk * ldb;
+    const float* B22 = B + hk * ldb + hn;
+    float* C11 = C;
+    float* C12 = C + hn;
+    float* C21 = C + hm * ldc;
+    float* C22 = C + hm * ldc + hn;
+
+    Arena::Scope scope(scratch);
+    float* sa = scratch.allocateArray<float>(hm * hk);
+    float* sb = scratch.allocateArray<float>(hk * hn);
+    float* prod = scratch.allocateArray<float>(hm * hn);
+    GemmStats stats;
+
+    for (size_t i = 0; i < m; i++) {
+        std::fill(C + i * ldc, C + i * ldc + n, 0.0f);
+    }
+
+    // One Strassen product: prod = (a1 + aSign*a2) * (b1 + bSign*b2);
+    // a2/b2 may be null when the operand is a single block
+    auto product = [&](const float* a1, const float* a2, float aSign,
+                       const float* b1, const float* b2, float bSign) {
+        const float* left = a1;
+        size_t ldl = lda;
+        if (a2) {
+            blockAdd(sa, hk, a1, lda, a2, lda, aSign, hm, hk);
+            left = sa;
+            ldl = hk;
+        }
+        const float* right = b1;
+        size_t ldr = ldb;
+        if (b2) {
+            blockAdd(sb, hn, b1, ldb, b2, ldb, bSign, hk, hn);
+            right = sb;
+            ldr = hn;
+        }
+        stats += strassenGemm(tpu, levels - 1, hm, hn, hk, left, ldl, right, ldr,
+                              prod, hn, scratch);
+    };
+
+    product(A11, A22, 1.0f, B11, B22, 1.0f);             // M1
+    blockAccumulate(C11, ldc, prod, hn, 1.0f, hm, hn);
+    blockAccumulate(C22, ldc, prod, hn, 1.0f, hm, hn);
+
+    product(A21, A22, 1.0f, B11, nullptr, 0.0f);         // M2
+    blockAccumulate(C21, ldc, prod, hn, 1.0f, hm, hn);
+    blockAccumulate(C22, ldc, prod, hn, -1.0f, hm, hn);
+
+    product(A11, nullptr, 0.0f, B12, B22, -1.0f);        // M3
+    blockAccumulate(C12, ldc, prod, hn, 1.0f, hm, hn);
+    blockAccumulate(C22, ldc, prod, hn, 1.0f, hm, hn);
+
+    product(A22, nullptr, 0.0f, B21, B11, -1.0f);        // M4
+    blockAccumulate(C11, ldc, prod, hn, 1.0f, hm, hn);
+    blockAccumulate(C21, ldc, prod, hn, 1.0f, hm, hn);
+
+    product(A11, A12, 1.0f, B22, nullptr, 0.0f);         // M5
+    blockAccumulate(C11, ldc, prod, hn, -1.0f, hm, hn);
+    blockAccumulate(C12, ldc, prod, hn, 1.0f, hm, hn);
+
+    product(A21, A11, -1.0f, B11, B12, 1.0f);            // M6
+    blockAccumulate(C22, ldc, prod, hn, 1.0f, hm, hn);
+
+    product(A12, A22, -1.0f, B21, B22, 1.0f);            // M7
+    blockAccumulate(C11, ldc, prod, hn, 1.0f, hm, hn);
+
+    return stats;
+}
+
+/**
+ * Compare C against an FP32 (double-accumulated) host product
+ */
+inline GemmErrorReport measureGemmError(size_t M, size_t N, size_t K,
+                                        const float* A, size_t lda,
+                                        const float* B, size_t ldb,
+                                        const float* C, size_t ldc) {
+    GemmErrorReport report;
+    double errSq = 0.0, refSq = 0.0, errSum = 0.0;
+
+    for (size_t i = 0; i < M; i++) {
+        for (size_t j = 0; j < N; j++) {
+            double ref = 0.0;
+            for (size_t k = 0; k < K; k++) {
+                ref += static_cast<double>(A[i * lda + k]) * B[k * ldb + j];
+            }
+            double err = std::fabs(C[i * ldc + j] - ref);
+            report.maxAbsError = std::max(report.maxAbsError, err);
+            errSum += err;
+            errSq += err * err;
+            refSq += ref * ref;
+        }
+    }
+
+    if (M * N > 0) report.meanAbsError = errSum / (M * N);
+    if (refSq > 0.0) report.relativeRms = std::sqrt(errSq / refSq);
+    return report;
+}
+
+/**
+ * C = A * B with a per-call algorithm choice. Operands are zero-padded on
+ * the host when Strassen needs dimensions divisible by 8 * 2^levels.
+ * Pass a report to get the error against an FP32 host reference.
+ */
+template <typename Engine>
+GemmStats gemm(Engine& tpu, size_t M, size_t N, size_t K,
+               const float* A, size_t lda,
+               const float* B, size_t ldb,
+               float* C, size_t ldc,
+               const GemmOptions& options = GemmOptions(),
+               GemmErrorReport* report = nullptr) {
+    size_t levels = 0;
+    switch (options.algorithm) {
+        case GemmAlgorithm::Tiled:     levels = 0; break;
+        case GemmAlgorithm::Strassen1: levels = 1; break;
+        case GemmAlgorithm::Strassen2: levels = 2; break;
+    }
+
+    GemmStats stats;
+    if (levels == 0) {
+        stats = tiledGemm(tpu, M, N, K, A, lda, B, ldb, C, ldc);
+    } else {
+        const size_t block = MATRIX_SIZE << levels;
+        auto roundUp = [block](size_t x) { return (x + block - 1) / block * block; };
+        const size_t Mp = roundUp(M), Np = roundUp(N), Kp = roundUp(K);
+
+        Arena local(0);
+        Arena& scratch = options.workspace ? *options.workspace : local;
+
+        if (Mp == M && Np == N && Kp == K) {
+            stats = strassenGemm(tpu, levels, M, N, K, A, lda, B, ldb, C, ldc, scratch);
+        } else {
+            Arena::Scope scope(scratch);
+            float* Ap = scratch.allocateArray<float>(Mp * Kp);
+            float* Bp = scratch.allocateArray<float>(Kp * Np);
+            float* Cp = scratch.allocateArray<float>(Mp * Np);
+            std::fill(Ap, Ap + Mp * Kp, 0.0f);
+            std::fill(Bp, Bp + Kp * Np, 0.0f);
+            for (size_t i = 0; i < M; i++) {
+                std::copy(A + i * lda, A + i * lda + K, Ap + i * Kp);
+            }
+            for (size_t i = 0; i < K; i++) {
+                std::copy(B + i * ldb, B + i * ldb + N, Bp + i * Np);
+            }
+            stats = strassenGemm(tpu, levels, Mp, Np, Kp, Ap, Kp, Bp, Np, Cp, Np, scratch);
+            for (size_t i = 0; i < M; i++) {
+                std::copy(Cp + i * Np, Cp + i * Np + N, C + i * ldc);
+            }
+        }
+    }
+
+    if (report) {
+        *report = measureGemmError(M, N, K, A, lda, B, ldb, C, ldc);
+    }
+    return stats;
+}
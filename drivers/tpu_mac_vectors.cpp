@@ -0,0 +1,138 @@
+/*
+ * Pipelined MAC Test Vectors
+ * Description: Writes the vectors fp16_pipelined_mac_testbench.v checks the
+ * RTL against. Each case is one product run from acc_clear, a drain, and a
+ * second run continued without acc_clear; the expected acc_out after each
+ * drain comes from accumulateLanes for every lane count (ADD_STAGES 1-4).
+ * Before writing, the same stimulus is clocked through PipelinedMac for
+ * every MULT_STAGES / ADD_STAGES pair and must give those results.
+ *
+ * Usage: tpu_mac_vectors [output.hex]
+ *   default output ../hardware/verilog/fp16_pipelined_mac_vectors.hex
+ *
+ * Build: make mac-vectors (builds and regenerates the default output)
+ */
+
+#include "tpu_driver.hpp"
+#include "tpu_timing.hpp"
+
+#include <cstdio>
+#include <random>
+
+namespace {
+
+// Layout shared with fp16_pipelined_mac_testbench.v
+constexpr size_t CASES = 8;
+constexpr size_t RUN1 = 13;             // products from acc_clear
+constexpr size_t RUN2 = 9;              // products continuing the total
+constexpr size_t PRODUCTS = RUN1 + RUN2;
+constexpr unsigned MAX_STAGES = 4;
+constexpr unsigned DRAIN = 24;          // largest DRAIN_CYCLES (4 + 4 * 5)
+
+const ArrayPrecision PRECISIONS[] = {
+    ArrayPrecision::exact(), ArrayPrecision::approximate(), {8, 6}, {11, 4},
+};
+
+struct MacCase {
+    ArrayPrecision precision;
+    uint16_t act[PRODUCTS];
+    uint16_t wt[PRODUCTS];
+    uint16_t run1[MAX_STAGES];          // expected acc_out, index = lanes - 1
+    uint16_t run2[MAX_STAGES];
+};
+
+MacCase makeCase(size_t index, std::mt19937& rng) {
+    MacCase c{};
+    c.precision = PRECISIONS[index % 4];
+    // Odd cases spread the exponents so the alignment window clips addends
+    int spread = (index & 1) ? 6 : 1;
+    std::uniform_real_distribution<float> mant(-2.0f, 2.0f);
+    std::uniform_int_distribution<int> exp(-spread, spread);
+    for (size_t k = 0; k < PRODUCTS; k++) {
+        c.act[k] = FP16::fromFloat(std::ldexp(mant(rng), exp(rng)), FP16Mode::Hardware);
+        c.wt[k] = FP16::fromFloat(mant(rng), FP16Mode::Hardware);
+    }
+
+    uint16_t prods[PRODUCTS];
+    for (size_t k = 0; k < PRODUCTS; k++) {
+        prods[k] = ApproxFP16::multiply(c.act[k], c.wt[k], c.precision.multBits);
+    }
+    for (unsigned lanes = 1; lanes <= MAX_STAGES; lanes++) {
+        c.run1[lanes - 1] = accumulateLanes(prods, RUN1, lanes, c.precision.alignMax);
+        c.run2[lanes - 1] = accumulateLanes(prods + RUN1, RUN2, lanes, c.precision.alignMax,
+                                            c.run1[lanes - 1]);
+    }
+    return c;
+}
+
+// Clocks one run through the cycle model the way the testbench drives the RTL
+uint16_t clockRun(PipelinedMac& mac, const MacCase& c, size_t first, size_t n, bool clear) {
+    for (size_t k = first; k < first + n; k++) {
+        mac.clock(true, clear && k == first, false, c.act[k], c.wt[k]);
+    }
+    for (unsigned cycle = 0; cycle < DRAIN; cycle++) {
+        mac.clock(true, false, true, 0, 0);
+    }
+    return mac.parked() ? mac.accOut() : 0xFFFF;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : "../hardware/verilog/fp16_pipelined_mac_vectors.hex";
+
+    std::mt19937 rng(2024);
+    std::vector<MacCase> cases;
+    for (size_t i = 0; i < CASES; i++) {
+        cases.push_back(makeCase(i, rng));
+    }
+
+    // The testbench keeps one instance per configuration across all cases
+    int mismatches = 0;
+    for (unsigned m = 1; m <= MAX_STAGES; m++) {
+        for (unsigned s = 1; s <= MAX_STAGES; s++) {
+            PipelinedMac mac({m, s});
+            for (size_t i = 0; i < CASES; i++) {
+                const MacCase& c = cases[i];
+                mac.setPrecision(c.precision);
+                uint16_t run1 = clockRun(mac, c, 0, RUN1, true);
+                uint16_t run2 = clockRun(mac, c, RUN1, RUN2, false);
+                if (run1 != c.run1[s - 1] || run2 != c.run2[s - 1]) {
+                    printf("Mismatch: mult_stages=%u add_stages=%u case %zu: "
+                           "0x%04X/0x%04X, expected 0x%04X/0x%04X\n",
+                           m, s, i, run1, run2, c.run1[s - 1], c.run2[s - 1]);
+                    mismatches++;
+                }
+            }
+        }
+    }
+    if (mismatches) {
+        printf("PipelinedMac disagrees with accumulateLanes; %s not written\n", path);
+        return 1;
+    }
+
+    FILE* f = std::fopen(path, "w");
+    if (!f) {
+        printf("Cannot write %s\n", path);
+        return 1;
+    }
+    std::fprintf(f, "// Generated by drivers/tpu_mac_vectors.cpp (make mac-vectors); do not edit\n");
+    std::fprintf(f, "// %zu cases of %zu words: precision, act[%zu], wt[%zu],\n",
+                 CASES, 1 + 2 * PRODUCTS + 2 * MAX_STAGES, PRODUCTS, PRODUCTS);
+    std::fprintf(f, "// acc_out after run 1 (%zu products) and run 2 (%zu more) for ADD_STAGES 1-4\n",
+                 RUN1, RUN2);
+    for (size_t i = 0; i < CASES; i++) {
+        const MacCase& c = cases[i];
+        std::fprintf(f, "// case %zu: mult_bits=%u align_max=%u\n", i,
+                     unsigned(c.precision.multBits), unsigned(c.precision.alignMax));
+        std::fprintf(f, "%04X\n", unsigned(c.precision.encode()));
+        for (size_t k = 0; k < PRODUCTS; k++) std::fprintf(f, "%04X\n", unsigned(c.act[k]));
+        for (size_t k = 0; k < PRODUCTS; k++) std::fprintf(f, "%04X\n", unsigned(c.wt[k]));
+        for (unsigned l = 0; l < MAX_STAGES; l++) std::fprintf(f, "%04X\n", unsigned(c.run1[l]));
+        for (unsigned l = 0; l < MAX_STAGES; l++) std::fprintf(f, "%04X\n", unsigned(c.run2[l]));
+    }
+    std::fclose(f);
+
+    printf("✓ Wrote %zu cases to %s (PipelinedMac agrees for all 16 pipelines)\n", CASES, path);
+    return 0;
+}
@@ -0,0 +1,484 @@
+/**
+ * Runtime metrics in the Prometheus text format
+ *
+ * MetricsRegistry holds counters, histograms and scrape-time gauges.
+ * Counters and histograms are sharded: a thread updates its own
+ * cache-line-sized cell with a relaxed atomic add, and a scrape sums the
+ * cells, so instrumented calls never take a lock or share a line with
+ * another thread. Registration and rendering lock (cold paths).
+ *
+ * MetricsServer answers HTTP GETs of /metrics with the rendered registry
+ * on 127.0.0.1:<port> or on a Unix socket:
+ *   curl http://127.0.0.1:9464/metrics
+ *   curl --unix-socket /tmp/tpu.sock http://localhost/metrics
+ *
+ * DriverMetrics is the set of series TPUDriver::setMetrics() reports into.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+constexpr size_t METRIC_SHARDS = 16;
+
+/**
+ * Shard of the calling thread (threads are spread round-robin)
+ */
+inline size_t metricShard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+/**
+ * Monotonic counter; render() multiplies by `scale` (e.g. 1e-9 for a
+ * counter of nanoseconds exported in seconds)
+ */
+class Counter {
+public:
+    void add(uint64_t n = 1) {
+        cells_[metricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const Cell& c : cells_) total += c.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Cell, METRIC_SHARDS> cells_;
+};
+
+/**
+ * Duration histogram with fixed upper bounds (seconds)
+ */
+class Histogram {
+public:
+    static constexpr size_t MAX_BOUNDS = 15;
+
+    explicit Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+        if (bounds_.size() > MAX_BOUNDS) {
+            throw std::invalid_argument("Too many histogram buckets");
+        }
+        for (size_t i = 0; i < bounds_.size(); i++) {
+            boundsNs_[i] = static_cast<uint64_t>(bounds_[i] * 1e9);
+        }
+    }
+
+    void observe(std::chrono::nanoseconds d) {
+        uint64_t ns = d.count() > 0 ? static_cast<uint64_t>(d.count()) : 0;
+        size_t b = 0;
+        while (b < bounds_.size() && ns > boundsNs_[b]) b++;
+        Cell& cell = cells_[metricShard()];
+        cell.buckets[b].fetch_add(1, std::memory_order_relaxed);
+        cell.sumNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    /**
+     * Observations per bucket (the last one is +Inf), not cumulative
+     */
+    std::vector<uint64_t> buckets() const {
+        std::vector<uint64_t> counts(bounds_.size() + 1, 0);
+        for (const Cell& c : cells_) {
+            for (size_t b = 0; b < counts.size(); b++) {
+                counts[b] += c.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+        return counts;
+    }
+
+    double sumSeconds() const {
+        uint64_t ns = 0;
+        for (const Cell& c : cells_) ns += c.sumNs.load(std::memory_order_relaxed);
+        return ns * 1e-9;
+    }
+
+    const std::vector<double>& bounds() const { return bounds_; }
+
+    /**
+     * 10 us .. 10 s, for host-side operations over a UART
+     */
+    static std::vector<double> latencyBounds() {
+        return {1e-5, 5e-5, 1e-4, 5e-4, 1e-3, 5e-3, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0, 10.0};
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::array<std::atomic<uint64_t>, MAX_BOUNDS + 1> buckets{};
+        std::atomic<uint64_t> sumNs{0};
+    };
+    std::vector<double> bounds_;
+    std::array<uint64_t, MAX_BOUNDS> boundsNs_{};
+    std::array<Cell, METRIC_SHARDS> cells_;
+};
+
+/**
+ * Observes the time until the end of the scope; does nothing without a
+ * histogram
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram* histogram) : histogram_(histogram) {
+        if (histogram_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (histogram_) histogram_->observe(std::chrono::steady_clock::now() - start_);
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram* histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Named series, rendered in registration order. A series is identified by
+ * its name and label set (`phase="upload"`); registering it again returns
+ * the existing one, which must have the same type (and counter scale).
+ */
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help,
+                     const std::string& labels = "", double scale = 1.0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& s = series(name, help, "counter", labels);
+        if (!s.counter) {
+            counters_.emplace_back();
+            s.counter = &counters_.back();
+            s.scale = scale;
+        } else if (s.scale != scale) {
+            throw std::invalid_argument("Metric " + name + " registered with another scale");
+        }
+        return *s.counter;
+    }
+
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         const std::string& labels = "",
+                         std::vector<double> bounds = Histogram::latencyBounds()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& s = series(name, help, "histogram", labels);
+        if (!s.histogram) {
+            histograms_.emplace_back(std::move(bounds));
+            s.histogram = &histograms_.back();
+        }
+        return *s.histogram;
+    }
+
+    /**
+     * Value computed at scrape time; it may run on the server thread
+     */
+    void gauge(const std::string& name, const std::string& help,
+               std::function<double()> value, const std::string& labels = "") {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& s = series(name, help, "gauge", labels);
+        if (!s.gauge) s.gauge = std::move(value);
+    }
+
+    /**
+     * Text exposition format 0.0.4
+     */
+    std::string render() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string out;
+        for (const Family& f : families_) {
+            out += "# HELP " + f.name + " " + f.help + "\n";
+            out += "# TYPE " + f.name + " " + f.type + "\n";
+            for (const Series& s : f.series) {
+                if (s.counter) {
+                    line(out, f.name, s.labels, "", s.counter->value() * s.scale);
+                } else if (s.gauge) {
+                    line(out, f.name, s.labels, "", s.gauge());
+                } else if (s.histogram) {
+                    std::vector<uint64_t> counts = s.histogram->buckets();
+                    const std::vector<double>& bounds = s.histogram->bounds();
+                    uint64_t cumulative = 0;
+                    char le[32];
+                    for (size_t b = 0; b < counts.size(); b++) {
+                        cumulative += counts[b];
+                        if (b < bounds.size()) {
+                            std::snprintf(le, sizeof(le), "le=\"%g\"", bounds[b]);
+                        } else {
+                            std::snprintf(le, sizeof(le), "le=\"+Inf\"");
+                        }
+                        line(out, f.name + "_bucket", s.labels, le, static_cast<double>(cumulative));
+                    }
+                    line(out, f.name + "_sum", s.labels, "", s.histogram->sumSeconds());
+                    line(out, f.name + "_count", s.labels, "", static_cast<double>(cumulative));
+                }
+            }
+        }
+        return out;
+    }
+
+private:
+    struct Series {
+        std::string labels;
+        Counter* counter = nullptr;
+        double scale = 1.0;
+        Histogram* histogram = nullptr;
+        std::function<double()> gauge;
+    };
+    struct Family {
+        std::string name, help, type;
+        std::vector<Series> series;
+    };
+
+    mutable std::mutex mutex_;
+    std::deque<Family> families_;
+    std::deque<Counter> counters_;       // deques: references stay valid
+    std::deque<Histogram> histograms_;
+
+    Series& series(const std::string& name, const std::string& help,
+                   const char* type, const std::string& labels) {
+        Family* family = nullptr;
+        for (Family& f : families_) {
+            if (f.name == name) family = &f;
+        }
+        if (!family) {
+            families_.push_back(Family{name, help, type, {}});
+            family = &families_.back();
+        } else if (family->type != type) {
+            throw std::invalid_argument("Metric " + name + " registered with another type");
+        }
+        for (Series& s : family->series) {
+            if (s.labels == labels) return s;
+        }
+        family->series.emplace_back();
+        family->series.back().labels = labels;
+        return family->series.back();
+    }
+
+    static void line(std::string& out, const std::string& name, const std::string& labels,
+                     const char* extra, double value) {
+        out += name;
+        if (!labels.empty() || *extra) {
+            out += "{" + labels;
+            if (!labels.empty() && *extra) out += ",";
+            out += std::string(extra) + "}";
+        }
+        char number[32];
+        std::snprintf(number, sizeof(number), " %.10g\n", value);
+        out += number;
+    }
+};
+
+/**
+ * HTTP endpoint serving MetricsRegistry::render() at /metrics, on a
+ * background thread until destroyed
+ */
+class MetricsServer {
+public:
+    /**
+     * Listen on 127.0.0.1:port (0 picks a free port, see port())
+     */
+    MetricsServer(const MetricsRegistry& registry, uint16_t port) : registry_(registry) {
+#ifdef _WIN32
+        (void)port;
+        throw std::runtime_error("Metrics endpoint is not supported on Windows");
+#else
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd_ < 0) throw std::runtime_error("Failed to create metrics socket");
+        int on = 1;
+        setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd_, 8) < 0) {
+            ::close(fd_);
+            throw std::runtime_error("Failed to listen on metrics port " + std::to_string(port));
+        }
+        socklen_t len = sizeof(addr);
+        getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { serve(); });
+#endif
+    }
+
+    /**
+     * Listen on a Unix socket at `path` (replaced if it exists)
+     */
+    MetricsServer(const MetricsRegistry& registry, const std::string& path) : registry_(registry) {
+#ifdef _WIN32
+        (void)path;
+        throw std::runtime_error("Metrics endpoint is not supported on Windows");
+#else
+        sockaddr_un addr{};
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            throw std::invalid_argument("Invalid metrics socket path");
+        }
+        fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd_ < 0) throw std::runtime_error("Failed to create metrics socket");
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        ::unlink(path.c_str());
+        if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd_, 8) < 0) {
+            ::close(fd_);
+            throw std::runtime_error("Failed to listen on " + path);
+        }
+        path_ = path;
+        thread_ = std::thread([this] { serve(); });
+#endif
+    }
+
+    ~MetricsServer() { stop(); }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    void stop() {
+#ifndef _WIN32
+        stopping_ = true;
+        if (thread_.joinable()) thread_.join();
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+            if (!path_.empty()) ::unlink(path_.c_str());
+        }
+#endif
+    }
+
+    /**
+     * TCP port being served (0 for a Unix socket)
+     */
+    uint16_t port() const { return port_; }
+    uint64_t scrapes() const { return scrapes_; }
+
+private:
+    const MetricsRegistry& registry_;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::string path_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> scrapes_{0};
+    std::thread thread_;
+
+#ifndef _WIN32
+    void serve() {
+        while (!stopping_) {
+            pollfd p{fd_, POLLIN, 0};
+            if (::poll(&p, 1, 100) <= 0) continue;
+            int client = ::accept(fd_, nullptr, nullptr);
+            if (client < 0) continue;
+            respond(client);
+            ::close(client);
+        }
+    }
+
+    void respond(int client) {
+        // Request line and headers; a scraper sends them in one go
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            pollfd p{client, POLLIN, 0};
+            if (::poll(&p, 1, 1000) <= 0) return;
+            ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0) return;
+            request.append(buffer, static_cast<size_t>(n));
+        }
+
+        std::string status = "200 OK", body;
+        if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+            body = registry_.render();
+            scrapes_++;
+        } else if (request.compare(0, 4, "GET ") == 0) {
+            status = "404 Not Found";
+        } else {
+            status = "405 Method Not Allowed";
+        }
+        std::string response = "HTTP/1.1 " + status + "\r\n"
+                               "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n" + body;
+        sendAll(client, response);
+    }
+
+    static void sendAll(int client, const std::string& data) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;   // a scraper hanging up must not raise SIGPIPE
+#else
+        const int flags = 0;
+#endif
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(client, data.data() + sent, data.size() - sent, flags);
+            if (n <= 0) return;
+            sent += static_cast<size_t>(n);
+        }
+    }
+#endif
+};
+
+/**
+ * Series a TPUDriver reports into. One instance can be shared by the
+ * drivers of several threads; their updates land in separate shards.
+ * Link bytes are published at the end of each phase, so a scrape can lag
+ * an in-progress status poll by a few bytes.
+ */
+struct DriverMetrics {
+    Counter& matmuls;
+    Counter& tiles;
+    Counter& bytesTx;
+    Counter& bytesRx;
+    Histogram& upload;
+    Histogram& compute;
+    Histogram& readback;
+    Counter& linkErrors;
+    Counter& resyncs;
+    Counter& retries;
+    Counter& cacheHits;
+    Counter& cacheMisses;
+
+    explicit DriverMetrics(MetricsRegistry& registry)
+        : matmuls(registry.counter("tpu_matmuls_total", "Matrix multiplications requested")),
+          tiles(registry.counter("tpu_tiles_total", "Array runs on the device (queued jobs included)")),
+          bytesTx(registry.counter("tpu_link_bytes_total", "Bytes moved over the link", "direction=\"tx\"")),
+          bytesRx(registry.counter("tpu_link_bytes_total", "Bytes moved over the link", "direction=\"rx\"")),
+          upload(registry.histogram("tpu_phase_seconds", "Time per driver phase", "phase=\"upload\"")),
+          compute(registry.histogram("tpu_phase_seconds", "Time per driver phase", "phase=\"compute\"")),
+          readback(registry.histogram("tpu_phase_seconds", "Time per driver phase", "phase=\"readback\"")),
+          linkErrors(registry.counter("tpu_link_errors_total", "Missing or garbled responses")),
+          resyncs(registry.counter("tpu_resyncs_total", "Device resynchronisations")),
+          retries(registry.counter("tpu_retries_total", "Operations run again after a resync")),
+          cacheHits(registry.counter("tpu_cache_hits_total", "Products answered from the result cache")),
+          cacheMisses(registry.counter("tpu_cache_misses_total", "Result cache lookups that went to the device")) {
+        // Compute phase (start to done observed) over wall time since the
+        // series were registered; rate(tpu_phase_seconds_sum{phase="compute"})
+        // gives the same over a scrape window
+        Histogram* busy = &compute;
+        auto since = std::chrono::steady_clock::now();
+        registry.gauge("tpu_device_utilization", "Fraction of time the device spent in compute phases",
+                       [busy, since] {
+                           double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+                           return wall > 0 ? std::min(1.0, busy->sumSeconds() / wall) : 0.0;
+                       });
+    }
+};
@@ -0,0 +1,265 @@
+/**
+ * Multi-layer perceptron runner
+ *
+ * Dense layers y = act(W x + b), W stored outputs x inputs, run on the
+ * tiler as C = W * X with activations kept feature-major (features x batch),
+ * so each layer's result is the next layer's operand without a transpose.
+ *
+ * A PrecisionPlan gives the array precision of every layer (see
+ * tpu_tuner.hpp); the runner sets it before the layer's GEMM. The engine
+ * must provide what tiledGemm needs plus
+ *   void setPrecision(ArrayPrecision)
+ *
+ * runMlpChained keeps single-tile models on the device: bias and ReLU are
+ * applied by the device epilogue and each layer's result is copied into
+ * the activation buffer there instead of being read back and re-uploaded.
+ * Its engine provides
+ *   void writeActivations(const TileView&)
+ *   void writeBias(const float*, size_t)
+ *   void setEpilogue(const DeviceEpilogue&)
+ *   void computeOnResident(const TileView& weights)
+ *   void chainResults(DeviceActivation)
+ *   Matrix readResults()
+ */
+
+#pragma once
+
+#include "tpu_gemm.hpp"
+
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+struct DenseLayer {
+    size_t inputs = 0;
+    size_t outputs = 0;
+    std::vector<float> weights;   // outputs x inputs, row-major
+    std::vector<float> bias;      // outputs, or empty
+    bool relu = true;
+
+    size_t macs(size_t batch) const { return inputs * outputs * batch; }
+};
+
+using MlpModel = std::vector<DenseLayer>;
+
+/**
+ * Per-layer array precision. Text form, one layer per line:
+ *   # comment
+ *   <mult_bits> <align>
+ */
+struct PrecisionPlan {
+    std::vector<ArrayPrecision> layers;
+
+    void save(std::ostream& os) const {
+        os << "# mult_bits align\n";
+        for (const auto& p : layers) {
+            os << int(p.multBits) << " " << int(p.alignMax) << "\n";
+        }
+    }
+
+    static PrecisionPlan load(std::istream& is) {
+        PrecisionPlan plan;
+        std::string line;
+        while (std::getline(is, line)) {
+            size_t hash = line.find('#');
+            if (hash != std::string::npos) line.erase(hash);
+            std::istringstream fields(line);
+            int bits, align;
+            if (!(fields >> bits)) continue;   // blank line
+            if (!(fields >> align) || bits < 1 || bits > 11 || align < 0 || align > 15) {
+                throw std::runtime_error("Malformed precision plan line: " + line);
+            }
+            plan.layers.push_back({static_cast<uint8_t>(bits), static_cast<uint8_t>(align)});
+        }
+        return plan;
+    }
+};
+
+/**
+ * Relative RMS difference ||out - ref|| / ||ref||
+ */
+inline double relativeRmsError(const std::vector<float>& out, const std::vector<float>& ref) {
+    double errSq = 0.0, refSq = 0.0;
+    for (size_t i = 0; i < ref.size(); i++) {
+        double d = static_cast<double>(out[i]) - ref[i];
+        errSq += d * d;
+        refSq += static_cast<double>(ref[i]) * ref[i];
+    }
+    return refSq > 0.0 ? std::sqrt(errSq / refSq) : std::sqrt(errSq);
+}
+
+/**
+ * Bias and ReLU on a feature-major layer output (outputs x batch)
+ */
+inline void applyDenseEpilogue(const DenseLayer& layer, float* y, size_t batch) {
+    for (size_t o = 0; o < layer.outputs; o++) {
+        float b = layer.bias.empty() ? 0.0f : layer.bias[o];
+        float* row = y + o * batch;
+        for (size_t n = 0; n < batch; n++) {
+            float v = row[n] + b;
+            row[n] = (layer.relu && v < 0.0f) ? 0.0f : v;
+        }
+    }
+}
+
+/**
+ * FP32 host forward pass of one layer; x is inputs x batch
+ */
+inline void denseReference(const DenseLayer& layer, const float* x, size_t batch, float* y) {
+    for (size_t o = 0; o < layer.outputs; o++) {
+        const float* w = layer.weights.data() + o * layer.inputs;
+        for (size_t n = 0; n < batch; n++) {
+            double sum = 0.0;
+            for (size_t i = 0; i < layer.inputs; i++) {
+                sum += static_cast<double>(w[i]) * x[i * batch + n];
+            }
+            y[o * batch + n] = static_cast<float>(sum);
+        }
+    }
+    applyDenseEpilogue(layer, y, batch);
+}
+
+/**
+ * One layer on the TPU; x is inputs x batch, y is outputs x batch
+ */
+template <typename Engine>
+GemmStats denseDevice(Engine& tpu, const DenseLayer& layer, const float* x, size_t batch, float* y) {
+    GemmStats stats = tiledGemm(tpu, layer.outputs, batch, layer.inputs,
+                                layer.weights.data(), layer.inputs, x, batch, y, batch);
+    applyDenseEpilogue(layer, y, batch);
+    return stats;
+}
+
+/**
+ * cols x rows copy of a row-major rows x cols matrix (batch-major <-> feature-major)
+ */
+inline std::vector<float> transposed(const float* src, size_t rows, size_t cols) {
+    std::vector<float> t(rows * cols);
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t c = 0; c < cols; c++) {
+            t[c * rows + r] = src[r * cols + c];
+        }
+    }
+    return t;
+}
+
+/**
+ * Run the model on `batch` inputs (batch x inputs, row-major); returns
+ * batch x outputs. An empty plan leaves the device precision alone.
+ */
+template <typename Engine>
+std::vector<float> runMlp(Engine& tpu, const MlpModel& model, const PrecisionPlan& plan,
+                          const float* input, size_t batch, GemmStats* stats = nullptr) {
+    if (!plan.layers.empty() && plan.layers.size() != model.size()) {
+        throw std::invalid_argument("Precision plan does not match the model");
+    }
+    if (model.empty()) {
+        return std::vector<float>();
+    }
+
+    std::vector<float> x = transposed(input, batch, model.front().inputs);
+    std::vector<float> y;
+    for (size_t l = 0; l < model.size(); l++) {
+        if (!plan.layers.empty()) {
+            tpu.setPrecision(plan.layers[l]);
+        }
+        y.assign(model[l].outputs * batch, 0.0f);
+        GemmStats s = denseDevice(tpu, model[l], x.data(), batch, y.data());
+        if (stats) *stats += s;
+        x.swap(y);
+    }
+
+    return transposed(x.data(), model.back().outputs, batch);
+}
+
+/**
+ * Whether runMlpChained can run the model: every layer and the batch fit
+ * one tile
+ */
+inline bool chainableOnDevice(const MlpModel& model, size_t batch) {
+    if (model.empty() || batch == 0 || batch > MATRIX_SIZE) return false;
+    for (const auto& layer : model) {
+        if (layer.inputs > MATRIX_SIZE || layer.outputs > MATRIX_SIZE) return false;
+    }
+    return true;
+}
+
+/**
+ * runMlp with the activations kept on the device between layers: one
+ * activation upload and one result readback for the whole model. Padded
+ * rows stay zero through every layer (zero weight rows and bias, and
+ * ReLU(0) = 0); padded batch columns pick up the bias but never mix into
+ * real columns. Bias is added in FP16 on the device, so biased models
+ * differ from runMlp by FP16 rounding.
+ */
+template <typename Engine>
+std::vector<float> runMlpChained(Engine& tpu, const MlpModel& model, const PrecisionPlan& plan,
+                                 const float* input, size_t batch) {
+    if (!plan.layers.empty() && plan.layers.size() != model.size()) {
+        throw std::invalid_argument("Precision plan does not match the model");
+    }
+    if (!chainableOnDevice(model, batch)) {
+        throw std::invalid_argument("Model does not fit on-device chaining");
+    }
+
+    std::vector<float> x = transposed(input, batch, model.front().inputs);
+    TileView activations;
+    activations.base = x.data();
+    activations.rowStride = static_cast<ptrdiff_t>(batch);
+    activations.rows = model.front().inputs;
+    activations.cols = batch;
+    tpu.writeActivations(activations);
+
+    for (size_t l = 0; l < model.size(); l++) {
+        const DenseLayer& layer = model[l];
+        if (!plan.layers.empty()) {
+            tpu.setPrecision(plan.layers[l]);
+        }
+        TileView weights;
+        weights.base = layer.weights.data();
+        weights.rowStride = static_cast<ptrdiff_t>(layer.inputs);
+        weights.rows = layer.outputs;
+        weights.cols = layer.inputs;
+        DeviceEpilogue epilogue;
+        epilogue.bias = !layer.bias.empty();
+        epilogue.activation = layer.relu ? DeviceActivation::ReLU : DeviceActivation::None;
+        if (epilogue.bias) {
+            tpu.writeBias(layer.bias.data(), layer.bias.size());
+        }
+        tpu.setEpilogue(epilogue);
+        tpu.computeOnResident(weights);
+        if (l + 1 < model.size()) {
+            tpu.chainResults(DeviceActivation::None);
+        }
+    }
+    tpu.setEpilogue(DeviceEpilogue());
+
+    // Device outputs are final
+    const DenseLayer& last = model.back();
+    auto result = tpu.readResults();
+    std::vector<float> y(batch * last.outputs);
+    for (size_t n = 0; n < batch; n++) {
+        for (size_t o = 0; o < last.outputs; o++) {
+            y[n * last.outputs + o] = result[o][n];
+        }
+    }
+    return y;
+}
+
+/**
+ * FP32 host reference of runMlp
+ */
+inline std::vector<float> runMlpReference(const MlpModel& model, const float* input, size_t batch) {
+    if (model.empty()) {
+        return std::vector<float>();
+    }
+    std::vector<float> x = transposed(input, batch, model.front().inputs);
+    std::vector<float> y;
+    for (const auto& layer : model) {
+        y.assign(layer.outputs * batch, 0.0f);
+        denseReference(layer, x.data(), batch, y.data());
+        x.swap(y);
+    }
+    return transposed(x.data(), model.back().outputs, batch);
+}
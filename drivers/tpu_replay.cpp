@@ -0,0 +1,95 @@
+/*
+ * TPU Trace Replay
+ * Description: Re-drives a recorded link trace (tpu_trace.hpp) against the
+ * in-process emulator or a board and reports per-command timing deltas.
+ *
+ * Usage: tpu_replay <trace> [serial port] [--realtime] [--bit-accurate] [--byte-protocol]
+ *   no port         replay against TPUEmulator (--bit-accurate: FP16 model)
+ *   --realtime      keep the recorded gaps between commands
+ *   --byte-protocol emulator also answers 'W'/'A'/'R'/'S'/'?' (traces from
+ *                   tpu_top_with_io, or from drivers that still used them)
+ *
+ * Build: make replay
+ */
+
+#include "tpu_driver.hpp"
+#include "tpu_emulator.hpp"
+#include "tpu_trace.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char* argv[]) {
+    const char* tracePath = nullptr;
+    const char* port = nullptr;
+    ReplayOptions options;
+    bool bitAccurate = false;
+    bool byteProtocol = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--realtime") == 0) {
+            options.realTime = true;
+        } else if (std::strcmp(argv[i], "--bit-accurate") == 0) {
+            bitAccurate = true;
+        } else if (std::strcmp(argv[i], "--byte-protocol") == 0) {
+            byteProtocol = true;
+        } else if (!tracePath) {
+            tracePath = argv[i];
+        } else {
+            port = argv[i];
+        }
+    }
+    if (!tracePath) {
+        printf("Usage: %s <trace> [serial port] [--realtime] [--bit-accurate] [--byte-protocol]\n",
+               argv[0]);
+        return 1;
+    }
+
+    try {
+        std::vector<TraceRecord> records = readTrace(tracePath);
+
+        std::unique_ptr<Transport> link;
+        if (port) {
+            auto serial = std::make_unique<SerialPort>(port);
+            if (!serial->isOpen()) throw std::runtime_error("Failed to open serial port");
+            link = std::move(serial);
+        } else {
+            auto emulator = bitAccurate
+                ? std::make_unique<TPUEmulator>(AccumulatorMode::FP16, EmulatedArithmetic::BitAccurate)
+                : std::make_unique<TPUEmulator>();
+            emulator->setByteProtocol(byteProtocol);
+            link = std::move(emulator);
+        }
+
+        ReplayReport report = replayTrace(records, *link, options);
+
+        printf("Replayed %zu records, %zu commands against %s\n",
+               records.size(), report.commands.size(), port ? port : "the emulator");
+        printf("  recorded   %12.3f ms\n", report.recordedNs / 1e6);
+        printf("  replayed   %12.3f ms\n", report.replayedNs / 1e6);
+        printf("  delta p50  %12.3f us\n", report.deltaPercentileNs(50) / 1e3);
+        printf("  delta p99  %12.3f us\n", report.deltaPercentileNs(99) / 1e3);
+        printf("  mismatched responses: %zu\n", report.mismatches);
+        if (report.droppedGaps) {
+            printf("  warning: the recording dropped records at %zu places\n", report.droppedGaps);
+        }
+
+        // Commands that got slowest relative to the recording
+        std::vector<const ReplayedCommand*> worst;
+        for (const auto& c : report.commands) worst.push_back(&c);
+        std::sort(worst.begin(), worst.end(), [](const ReplayedCommand* a, const ReplayedCommand* b) {
+            return a->deltaNs() > b->deltaNs();
+        });
+        printf("  %-8s %-8s %14s %14s %14s\n", "command", "opcode", "recorded us", "replayed us", "delta us");
+        for (size_t i = 0; i < std::min<size_t>(worst.size(), 10); i++) {
+            const ReplayedCommand& c = *worst[i];
+            printf("  %-8zu 0x%02X%s %14.1f %14.1f %14.1f\n",
+                   static_cast<size_t>(&c - report.commands.data()), c.opcode,
+                   c.responseMatches ? "    " : " (!)",
+                   c.recordedNs / 1e3, c.replayedNs / 1e3, c.deltaNs() / 1e3);
+        }
+        return report.mismatches ? 2 : 0;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+}
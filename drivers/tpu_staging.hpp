@@ -0,0 +1,228 @@
+/**
+ * Staging memory for large host-side buffers
+ *
+ * Operand panels, Strassen scratch and FP32 accumulators for big GEMMs span
+ * many MB; with 4 KB pages they thrash the TLB, and with several boards
+ * driven from different threads they end up on the wrong NUMA node.
+ * StagingMemory hands out page-backed blocks that try, in order:
+ *   1. explicit huge pages (mmap MAP_HUGETLB, needs reserved hugepages)
+ *   2. transparent huge pages (2 MB aligned mmap + madvise(MADV_HUGEPAGE))
+ *   3. plain pages
+ * and optionally prefer the NUMA node of a given (or the calling) thread.
+ * Huge pages and NUMA binding are Linux-only; elsewhere this is the heap.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+
+#ifdef __linux__
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+enum class PageBacking {
+    Heap,            // operator new, no placement control
+    HugePages        // best effort: HUGETLB, then THP, then plain pages
+};
+
+/**
+ * What a block actually got
+ */
+enum class PageKind {
+    Heap,
+    Plain,
+    Transparent,
+    HugeTLB
+};
+
+inline std::ostream& operator<<(std::ostream& os, PageKind kind) {
+    switch (kind) {
+        case PageKind::Heap:        return os << "heap";
+        case PageKind::Plain:       return os << "4k pages";
+        case PageKind::Transparent: return os << "THP";
+        case PageKind::HugeTLB:     return os << "hugetlb";
+    }
+    return os;
+}
+
+struct StagingOptions {
+    static constexpr int ANY_NODE = -1;       // no NUMA preference
+    static constexpr int CURRENT_NODE = -2;   // node of the allocating thread
+
+    PageBacking backing = PageBacking::Heap;
+    int numaNode = CURRENT_NODE;
+};
+
+class StagingMemory {
+public:
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    struct Block {
+        void* data = nullptr;
+        size_t size = 0;       // bytes usable (rounded up for mmap)
+        PageKind kind = PageKind::Heap;
+        int node = StagingOptions::ANY_NODE;
+    };
+
+    /**
+     * NUMA node of the calling thread, or ANY_NODE if unknown
+     */
+    static int currentNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+        unsigned cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+            return static_cast<int>(node);
+        }
+#endif
+        return StagingOptions::ANY_NODE;
+    }
+
+    static Block allocate(size_t bytes, const StagingOptions& options) {
+        Block block;
+        if (options.backing == PageBacking::Heap) {
+            block.data = ::operator new(bytes);
+            block.size = bytes;
+            return block;
+        }
+
+#ifdef __linux__
+        size_t size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        block.size = size;
+        block.kind = PageKind::HugeTLB;
+        void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (p == MAP_FAILED) {
+            p = mapAligned(size);
+            block.kind = PageKind::Plain;
+#ifdef MADV_HUGEPAGE
+            if (p != MAP_FAILED && madvise(p, size, MADV_HUGEPAGE) == 0) {
+                block.kind = PageKind::Transparent;
+            }
+#endif
+        }
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        block.data = p;
+
+        int node = options.numaNode == StagingOptions::CURRENT_NODE ? currentNode() : options.numaNode;
+        if (node >= 0 && preferNode(p, size, node)) {
+            block.node = node;
+        }
+        return block;
+#else
+        block.data = ::operator new(bytes);
+        block.size = bytes;
+        return block;
+#endif
+    }
+
+    static void release(const Block& block) {
+        if (!block.data) return;
+#ifdef __linux__
+        if (block.kind != PageKind::Heap) {
+            munmap(block.data, block.size);
+            return;
+        }
+#endif
+        ::operator delete(block.data);
+    }
+
+private:
+#ifdef __linux__
+    /**
+     * Anonymous mapping aligned to the huge page size, so THP can back
+     * all of it
+     */
+    static void* mapAligned(size_t size) {
+        size_t padded = size + HUGE_PAGE_SIZE;
+        void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) return MAP_FAILED;
+
+        uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        if (aligned > start) {
+            munmap(raw, aligned - start);
+        }
+        size_t tail = (start + padded) - (aligned + size);
+        if (tail > 0) {
+            munmap(reinterpret_cast<void*>(aligned + size), tail);
+        }
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    /**
+     * mbind(MPOL_PREFERRED) via syscall, so no libnuma dependency.
+     * Pages are placed on first touch, which the caller does from the
+     * thread driving the device.
+     */
+    static bool preferNode(void* p, size_t size, int node) {
+#ifdef SYS_mbind
+        constexpr int MPOL_PREFERRED = 1;
+        if (node >= 63) return false;
+        unsigned long mask = 1UL << node;
+        return syscall(SYS_mbind, p, size, MPOL_PREFERRED, &mask,
+                       sizeof(mask) * 8, 0) == 0;
+#else
+        (void)p; (void)size; (void)node;
+        return false;
+#endif
+    }
+#endif
+};
+
+/**
+ * Owning staging array of trivially constructible T (e.g. FP32 accumulators)
+ */
+template <typename T>
+class StagingBuffer {
+public:
+    StagingBuffer() = default;
+
+    StagingBuffer(size_t count, const StagingOptions& options)
+        : block_(StagingMemory::allocate(count * sizeof(T), options)), count_(count) {}
+
+    ~StagingBuffer() { StagingMemory::release(block_); }
+
+    StagingBuffer(StagingBuffer&& other) noexcept
+        : block_(other.block_), count_(other.count_) {
+        other.block_ = StagingMemory::Block();
+        other.count_ = 0;
+    }
+
+    StagingBuffer& operator=(StagingBuffer&& other) noexcept {
+        if (this != &other) {
+            StagingMemory::release(block_);
+            block_ = other.block_;
+            count_ = other.count_;
+            other.block_ = StagingMemory::Block();
+            other.count_ = 0;
+        }
+        return *this;
+    }
+
+    StagingBuffer(const StagingBuffer&) = delete;
+    StagingBuffer& operator=(const StagingBuffer&) = delete;
+
+    T* data() { return static_cast<T*>(block_.data); }
+    const T* data() const { return static_cast<const T*>(block_.data); }
+    size_t size() const { return count_; }
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+
+    PageKind pageKind() const { return block_.kind; }
+    int numaNode() const { return block_.node; }
+
+private:
+    StagingMemory::Block block_;
+    size_t count_ = 0;
+};
@@ -0,0 +1,211 @@
+/**
+ * MAC pipeline and run timing model
+ *
+ * MacPipeline describes the PE build of a bitstream (MAC_MULT_STAGES /
+ * MAC_ADD_STAGES of tpu_top_with_io_complete.v). Deeper stages raise the
+ * clock the array closes timing at; the cost is a drain at the end of every
+ * run, while the adder lanes are folded, and a different summation order:
+ * product k of a run accumulates into lane k mod addStages, and the lanes
+ * are summed ((lane0 + lane1) + lane2) + lane3.
+ *
+ *   accumulateLanes  - bit model of that order (the emulator uses it)
+ *   PipelinedMac     - cycle model of fp16_pipelined_mac_unit.v
+ *   TimingModel      - FSM cycles of a run at the bitstream's clock, and
+ *                      link time, for throughput predictions
+ */
+
+#pragma once
+
+#include "tpu_approx.hpp"
+
+#include <vector>
+
+struct MacPipeline {
+    unsigned multStages = 1;   // multiplier registers (1-4)
+    unsigned addStages = 1;    // adder registers = accumulator lanes (1-4)
+
+    static constexpr MacPipeline single() { return {1, 1}; }
+
+    bool pipelined() const { return multStages > 1 || addStages > 1; }
+    unsigned lanes() const { return addStages; }
+
+    /**
+     * Enabled cycles the PEs need after the last product to fold the lanes
+     * (DRAIN_CYCLES of fp16_approx_systolic_array.v)
+     */
+    unsigned drainCycles() const {
+        return pipelined() ? multStages + addStages * (addStages + 1) : 0;
+    }
+
+    void validate() const {
+        if (multStages < 1 || multStages > 4 || addStages < 1 || addStages > 4) {
+            throw std::invalid_argument("MAC pipeline stages must be 1-4");
+        }
+    }
+
+    bool operator==(const MacPipeline& o) const {
+        return multStages == o.multStages && addStages == o.addStages;
+    }
+    bool operator!=(const MacPipeline& o) const { return !(*this == o); }
+
+    friend std::ostream& operator<<(std::ostream& os, const MacPipeline& p) {
+        return os << "MacPipeline(mult_stages=" << p.multStages
+                  << ", add_stages=" << p.addStages << ")";
+    }
+};
+
+/**
+ * FP16 accumulation of n products in the pipelined PE's order, starting
+ * from `start` in lane 0 (0 after acc_clear)
+ */
+inline uint16_t accumulateLanes(const uint16_t* products, size_t n, unsigned lanes,
+                                unsigned alignMax, uint16_t start = 0) {
+    uint16_t lane[4] = {start, 0, 0, 0};
+    for (size_t k = 0; k < n; k++) {
+        uint16_t& acc = lane[k % lanes];
+        acc = ApproxFP16::add(acc, products[k], alignMax);
+    }
+    uint16_t total = lane[0];
+    for (unsigned l = 1; l < lanes; l++) {
+        total = ApproxFP16::add(total, lane[l], alignMax);
+    }
+    return total;
+}
+
+/**
+ * Cycle model of one fp16_pipelined_mac_unit (selectable datapath): one
+ * clock() per posedge, registers updated together from the values before
+ * the edge
+ */
+class PipelinedMac {
+public:
+    explicit PipelinedMac(MacPipeline pipeline,
+                          ArrayPrecision precision = ArrayPrecision::exact())
+        : pipeline_(pipeline), precision_(precision) {
+        pipeline.validate();
+        mult_.assign(pipeline.multStages, 0);
+        valid_.assign(pipeline.multStages, false);
+        clear_.assign(pipeline.multStages, false);
+        add_.assign(pipeline.addStages, 0);
+    }
+
+    void clock(bool enable, bool accClear, bool drain, uint16_t a, uint16_t w) {
+        if (!enable) return;
+        const unsigned lanes = pipeline_.lanes();
+
+        bool prodValid = valid_.back();
+        bool prodClear = clear_.back();
+        uint16_t product = mult_.back();
+        uint16_t feedback = add_.back();
+
+        bool draining = !prodValid && !parked_;
+        bool foldStart = draining && !foldActive_ && phase_ == 0;
+        bool folding = foldActive_ || foldStart;
+        bool foldTake = draining && folding && phase_ == foldPeriod_ + 1;
+        bool foldAdd = draining && foldActive_ && phase_ == 0 &&
+                       foldPeriod_ != 0 && foldPeriod_ < lanes;
+        bool foldDone = draining && foldActive_ && phase_ == 0 && foldPeriod_ == lanes;
+        bool loopEnable = prodValid || (!parked_ && !foldDone);
+
+        uint16_t addA = ((prodValid && prodClear) || foldTake) ? 0 : feedback;
+        uint16_t addB = prodValid ? product : (foldAdd ? hold_ : 0);
+
+        shiftIn(mult_, ApproxFP16::multiply(a, w, precision_.multBits));
+        shiftIn(valid_, !drain);
+        shiftIn(clear_, accClear || clearLeft_ != 0);
+        if (accClear) {
+            clearLeft_ = lanes - 1;
+        } else if (clearLeft_ != 0) {
+            clearLeft_--;
+        }
+
+        if (loopEnable) {
+            shiftIn(add_, ApproxFP16::add(addA, addB, precision_.alignMax));
+        }
+        unsigned phase = phase_;
+        if (loopEnable) {
+            phase_ = phase == lanes - 1 ? 0 : phase + 1;
+        }
+
+        if (prodValid) {
+            parked_ = false;
+            foldActive_ = false;
+            foldPeriod_ = 0;
+        }
+        if (foldTake) hold_ = feedback;
+        if (foldStart) foldActive_ = true;
+        if (draining && folding && !foldDone && phase == lanes - 1) foldPeriod_++;
+        if (foldDone) {
+            accOut_ = feedback;
+            parked_ = true;
+            foldActive_ = false;
+            foldPeriod_ = 0;
+        }
+    }
+
+    uint16_t accOut() const { return accOut_; }
+    bool parked() const { return parked_; }
+
+    // The precision input; the RTL samples it every cycle, so change it while parked
+    void setPrecision(ArrayPrecision precision) { precision_ = precision; }
+
+private:
+    MacPipeline pipeline_;
+    ArrayPrecision precision_;
+    std::vector<uint16_t> mult_;
+    std::vector<bool> valid_;
+    std::vector<bool> clear_;
+    std::vector<uint16_t> add_;
+    unsigned clearLeft_ = 0;
+    unsigned phase_ = 0;
+    bool parked_ = true;
+    bool foldActive_ = false;
+    unsigned foldPeriod_ = 0;
+    uint16_t hold_ = 0;
+    uint16_t accOut_ = 0;
+
+    template <typename T>
+    static void shiftIn(std::vector<T>& stages, T value) {
+        for (size_t s = stages.size() - 1; s > 0; s--) {
+            stages[s] = stages[s - 1];
+        }
+        stages[0] = value;
+    }
+};
+
+/**
+ * Run timing of tpu_top_with_io_complete at the bitstream's clock.
+ * A run is IDLE -> COMPUTE (31 streaming cycles + drain) ->
+ * APPLY_ACTIVATION -> STORE_RESULT (9) [-> EPILOGUE (65)] [-> JOB_STORE (64)]
+ * -> DONE; one run is MATRIX_SIZE^3 MACs.
+ */
+struct TimingModel {
+    double clockHz = 100e6;   // Basys3 system clock
+    MacPipeline pipeline;
+    double baud = 115200.0;
+
+    static constexpr unsigned STREAM_CYCLES = 31;
+
+    unsigned computeCycles() const { return STREAM_CYCLES + pipeline.drainCycles(); }
+
+    unsigned runCycles(bool epilogue = false, bool job = false) const {
+        return 1 + computeCycles() + 1 + 9 + (epilogue ? 65 : 0) + (job ? 64 : 0);
+    }
+
+    double runSeconds(bool epilogue = false, bool job = false) const {
+        return runCycles(epilogue, job) / clockHz;
+    }
+
+    /**
+     * Array throughput with back-to-back runs (no link time)
+     */
+    double macsPerSecond(bool epilogue = false, bool job = false) const {
+        return static_cast<double>(MATRIX_SIZE * MATRIX_SIZE * MATRIX_SIZE) /
+               runSeconds(epilogue, job);
+    }
+
+    /**
+     * Wire time of `bytes` at 8N1
+     */
+    double linkSeconds(size_t bytes) const { return bytes * 10.0 / baud; }
+};
@@ -0,0 +1,428 @@
+/**
+ * Link transaction tracing and replay
+ *
+ * TracingTransport wraps any Transport (SerialPort, TPUEmulator, ...) and
+ * hands every write and read to a TraceRecorder: a timestamp, the
+ * direction, the bytes, and whether the write starts a protocol command.
+ * The recorder appends records to a lock-free single-producer ring; a
+ * background thread moves them to a file, so the driver thread never
+ * blocks on I/O. When the ring is full a record is dropped (counted, and
+ * the next record is flagged) rather than stalling the link.
+ *
+ * Trace file: "TPUTRACE", u32 version, then records of
+ *   u64 time_ns (since the recorder started), u8 direction, u8 flags,
+ *   u16 length, length bytes
+ * little-endian. Writes longer than 65535 bytes become several records.
+ *
+ * replayTrace() re-drives a trace against a transport (emulator or board),
+ * compares every response with the recorded one and reports per-command
+ * timing deltas; tpu_replay.cpp is the command-line front end.
+ */
+
+#pragma once
+
+#include "tpu_driver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class TraceDirection : uint8_t {
+    Tx = 0,   // host -> device
+    Rx = 1    // device -> host
+};
+
+namespace TraceFlags {
+    constexpr uint8_t COMMAND = 0x01;   // write starts a protocol command
+    constexpr uint8_t DROPPED = 0x02;   // records were dropped before this one
+}
+
+struct TraceRecord {
+    uint64_t timeNs = 0;
+    TraceDirection direction = TraceDirection::Tx;
+    uint8_t flags = 0;
+    std::vector<uint8_t> bytes;
+};
+
+/**
+ * Recorder counters
+ */
+struct TraceStats {
+    uint64_t records = 0;        // accepted into the ring
+    uint64_t dropped = 0;        // ring full
+    uint64_t bytesWritten = 0;   // to the trace file
+    uint64_t writeErrors = 0;    // failed file writes (data lost)
+};
+
+class TraceRecorder {
+public:
+    static constexpr char MAGIC[8] = {'T', 'P', 'U', 'T', 'R', 'A', 'C', 'E'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t RECORD_HEADER = 12;
+
+    /**
+     * Record into `path`; ringBytes is rounded up to a power of two
+     */
+    explicit TraceRecorder(const std::string& path, size_t ringBytes = 1 << 20,
+                           std::chrono::milliseconds flushInterval = std::chrono::milliseconds(5))
+        : TraceRecorder(std::fopen(path.c_str(), "wb"), ringBytes, flushInterval, true) {}
+
+    /**
+     * Record into an open file (not closed by the recorder)
+     */
+    TraceRecorder(std::FILE* file, size_t ringBytes = 1 << 20,
+                  std::chrono::milliseconds flushInterval = std::chrono::milliseconds(5),
+                  bool ownsFile = false)
+        : file_(file), ownsFile_(ownsFile), flushInterval_(flushInterval) {
+        if (!file_) {
+            throw std::runtime_error("Failed to open trace file");
+        }
+        size_t capacity = 64;
+        while (capacity < ringBytes) capacity <<= 1;
+        ring_.assign(capacity, 0);
+        mask_ = capacity - 1;
+
+        uint8_t header[12];
+        std::copy(MAGIC, MAGIC + 8, header);
+        for (int i = 0; i < 4; i++) header[8 + i] = static_cast<uint8_t>(VERSION >> (8 * i));
+        if (!output(header, sizeof(header))) {
+            if (ownsFile_) std::fclose(file_);
+            throw std::runtime_error("Failed to write trace");
+        }
+
+        start_ = std::chrono::steady_clock::now();
+        flusher_ = std::thread([this] { flushLoop(); });
+    }
+
+    ~TraceRecorder() {
+        stop();
+        if (ownsFile_) std::fclose(file_);
+    }
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    /**
+     * Append one record (producer side: one thread, the driver's). Never
+     * blocks; a record that does not fit is dropped.
+     */
+    void record(TraceDirection direction, uint8_t flags, const uint8_t* data, size_t len) {
+        uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        do {
+            size_t chunk = std::min<size_t>(len, 0xFFFF);
+            size_t need = RECORD_HEADER + chunk;
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            if (stopped_ || need > ring_.size() - (head - tail_.load(std::memory_order_acquire))) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                dropPending_ = true;
+                return;
+            }
+            uint8_t header[RECORD_HEADER];
+            for (int i = 0; i < 8; i++) header[i] = static_cast<uint8_t>(now >> (8 * i));
+            header[8] = static_cast<uint8_t>(direction);
+            header[9] = flags | (dropPending_ ? TraceFlags::DROPPED : 0);
+            header[10] = chunk & 0xFF;
+            header[11] = (chunk >> 8) & 0xFF;
+            put(head, header, RECORD_HEADER);
+            put(head + RECORD_HEADER, data, chunk);
+            head_.store(head + need, std::memory_order_release);
+            records_.fetch_add(1, std::memory_order_relaxed);
+            dropPending_ = false;
+            flags &= ~TraceFlags::COMMAND;
+            data += chunk;
+            len -= chunk;
+        } while (len > 0);
+    }
+
+    /**
+     * Flush what is buffered and stop the background thread; later
+     * records are dropped
+     */
+    void stop() {
+        if (stopped_) return;
+        stopped_ = true;
+        running_.store(false, std::memory_order_release);
+        if (flusher_.joinable()) flusher_.join();
+        drain();
+        std::fflush(file_);
+    }
+
+    TraceStats stats() const {
+        TraceStats s;
+        s.records = records_.load(std::memory_order_relaxed);
+        s.dropped = dropped_.load(std::memory_order_relaxed);
+        s.bytesWritten = bytesWritten_.load(std::memory_order_relaxed);
+        s.writeErrors = writeErrors_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    std::FILE* file_;
+    bool ownsFile_;
+    std::chrono::milliseconds flushInterval_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::vector<uint8_t> ring_;
+    size_t mask_ = 0;
+    std::atomic<uint64_t> head_{0};   // written by the producer
+    std::atomic<uint64_t> tail_{0};   // written by the flusher
+    bool dropPending_ = false;        // producer only
+    bool stopped_ = false;            // producer/owner only
+
+    std::atomic<bool> running_{true};
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> bytesWritten_{0};
+    std::atomic<uint64_t> writeErrors_{0};
+    std::thread flusher_;
+
+    void put(uint64_t pos, const uint8_t* data, size_t len) {
+        size_t at = pos & mask_;
+        size_t first = std::min(len, ring_.size() - at);
+        std::copy(data, data + first, ring_.begin() + at);
+        std::copy(data + first, data + len, ring_.begin());
+    }
+
+    bool output(const uint8_t* data, size_t len) {
+        if (std::fwrite(data, 1, len, file_) != len) {
+            writeErrors_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        bytesWritten_.fetch_add(len, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Move every published record to the file (consumer side)
+     */
+    void drain() {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) return;
+        size_t at = tail & mask_;
+        size_t len = head - tail;
+        size_t first = std::min(len, ring_.size() - at);
+        output(ring_.data() + at, first);
+        output(ring_.data(), len - first);
+        tail_.store(head, std::memory_order_release);
+    }
+
+    void flushLoop() {
+        while (running_.load(std::memory_order_acquire)) {
+            drain();
+            std::this_thread::sleep_for(flushInterval_);
+        }
+    }
+};
+
+/**
+ * Transport decorator that records all traffic to a TraceRecorder
+ */
+class TracingTransport : public Transport {
+public:
+    TracingTransport(std::unique_ptr<Transport> inner, TraceRecorder& recorder)
+        : inner_(std::move(inner)), recorder_(recorder) {
+        if (!inner_) {
+            throw std::invalid_argument("Transport must not be null");
+        }
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        size_t n = inner_->write(data, len);
+        recorder_.record(TraceDirection::Tx, command_ ? TraceFlags::COMMAND : 0, data, n);
+        command_ = false;
+        return n;
+    }
+
+    size_t read(uint8_t* buffer, size_t len) override {
+        size_t n = inner_->read(buffer, len);
+        if (n > 0) {
+            recorder_.record(TraceDirection::Rx, 0, buffer, n);
+        }
+        return n;
+    }
+
+    void beginCommand() override {
+        command_ = true;
+        inner_->beginCommand();
+    }
+
+    void discardInput() override { inner_->discardInput(); }
+
+    Transport& inner() { return *inner_; }
+
+private:
+    std::unique_ptr<Transport> inner_;
+    TraceRecorder& recorder_;
+    bool command_ = false;
+};
+
+/**
+ * Load a trace written by TraceRecorder
+ */
+inline std::vector<TraceRecord> readTrace(std::FILE* file) {
+    uint8_t header[12];
+    if (std::fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        !std::equal(header, header + 8, TraceRecorder::MAGIC)) {
+        throw std::runtime_error("Not a TPU trace");
+    }
+    uint32_t version = header[8] | (header[9] << 8) | (header[10] << 16) |
+                       (static_cast<uint32_t>(header[11]) << 24);
+    if (version != TraceRecorder::VERSION) {
+        throw std::runtime_error("Unsupported trace version");
+    }
+
+    std::vector<TraceRecord> records;
+    uint8_t h[TraceRecorder::RECORD_HEADER];
+    while (std::fread(h, 1, sizeof(h), file) == sizeof(h)) {
+        TraceRecord r;
+        for (int i = 7; i >= 0; i--) r.timeNs = (r.timeNs << 8) | h[i];
+        r.direction = static_cast<TraceDirection>(h[8]);
+        r.flags = h[9];
+        r.bytes.resize(h[10] | (h[11] << 8));
+        if (std::fread(r.bytes.data(), 1, r.bytes.size(), file) != r.bytes.size()) {
+            throw std::runtime_error("Truncated trace record");
+        }
+        records.push_back(std::move(r));
+    }
+    return records;
+}
+
+inline std::vector<TraceRecord> readTrace(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Failed to open trace " + path);
+    }
+    try {
+        auto records = readTrace(file);
+        std::fclose(file);
+        return records;
+    } catch (...) {
+        std::fclose(file);
+        throw;
+    }
+}
+
+/**
+ * One command of a replay: from its first write to its last response byte
+ */
+struct ReplayedCommand {
+    uint8_t opcode = 0;
+    size_t firstRecord = 0;
+    uint64_t recordedNs = 0;
+    uint64_t replayedNs = 0;
+    bool responseMatches = true;
+
+    int64_t deltaNs() const {
+        return static_cast<int64_t>(replayedNs) - static_cast<int64_t>(recordedNs);
+    }
+};
+
+struct ReplayOptions {
+    bool realTime = false;        // keep the recorded gaps between commands
+    int readTimeoutMs = 1000;     // per response record
+};
+
+struct ReplayReport {
+    std::vector<ReplayedCommand> commands;
+    size_t mismatches = 0;        // commands whose response differed
+    size_t droppedGaps = 0;       // places where the recording lost records
+    uint64_t recordedNs = 0;      // first to last record
+    uint64_t replayedNs = 0;
+
+    /**
+     * Percentile (0-100) of per-command replayed - recorded time
+     */
+    int64_t deltaPercentileNs(double p) const {
+        if (commands.empty()) return 0;
+        std::vector<int64_t> d;
+        d.reserve(commands.size());
+        for (const auto& c : commands) d.push_back(c.deltaNs());
+        std::sort(d.begin(), d.end());
+        size_t i = static_cast<size_t>(p / 100.0 * (d.size() - 1) + 0.5);
+        return d[std::min(i, d.size() - 1)];
+    }
+};
+
+/**
+ * Re-drive a recorded session: every Tx record is written to `link`, every
+ * Rx record is read back in full and compared with the recording. Runs as
+ * fast as the link answers unless options.realTime.
+ */
+inline ReplayReport replayTrace(const std::vector<TraceRecord>& records, Transport& link,
+                                const ReplayOptions& options = ReplayOptions()) {
+    using Clock = std::chrono::steady_clock;
+    ReplayReport report;
+    if (records.empty()) return report;
+    report.recordedNs = records.back().timeNs - records.front().timeNs;
+
+    const Clock::time_point begin = Clock::now();
+    auto elapsedNs = [&] {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - begin).count());
+    };
+
+    // Both clocks are read when a record's I/O has completed, as the
+    // recorder does
+    ReplayedCommand* current = nullptr;
+    uint64_t commandStart = 0;
+    std::vector<uint8_t> got;
+    for (size_t i = 0; i < records.size(); i++) {
+        const TraceRecord& r = records[i];
+        if (r.flags & TraceFlags::DROPPED) report.droppedGaps++;
+
+        bool starts = false;
+        if (r.direction == TraceDirection::Tx) {
+            starts = (r.flags & TraceFlags::COMMAND) || !current;
+            if (starts) {
+                if (options.realTime) {
+                    uint64_t due = r.timeNs - records.front().timeNs;
+                    uint64_t now = elapsedNs();
+                    if (due > now) std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+                }
+                report.commands.emplace_back();
+                current = &report.commands.back();
+                current->opcode = r.bytes.empty() ? 0 : r.bytes[0];
+                current->firstRecord = i;
+                link.beginCommand();
+            }
+            size_t sent = 0;
+            while (sent < r.bytes.size()) {
+                size_t n = link.write(r.bytes.data() + sent, r.bytes.size() - sent);
+                if (n == 0) throw std::runtime_error("Replay write failed");
+                sent += n;
+            }
+        } else {
+            got.resize(r.bytes.size());
+            size_t have = 0;
+            Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(options.readTimeoutMs);
+            while (have < got.size() && Clock::now() < deadline) {
+                have += link.read(got.data() + have, got.size() - have);
+            }
+            if (current && (have != got.size() || got != r.bytes)) {
+                current->responseMatches = false;
+            }
+        }
+
+        uint64_t now = elapsedNs();
+        if (starts) commandStart = now;
+        if (current) {
+            current->recordedNs = r.timeNs - records[current->firstRecord].timeNs;
+            current->replayedNs = now - commandStart;
+        }
+    }
+
+    report.replayedNs = elapsedNs();
+    for (const auto& c : report.commands) {
+        report.mismatches += !c.responseMatches;
+    }
+    return report;
+}
@@ -0,0 +1,222 @@
+/**
+ * Offline per-layer precision tuner
+ *
+ * Runs an MlpModel through the bit-accurate emulator of the selectable
+ * datapath on calibration inputs and picks an ArrayPrecision per layer:
+ *   1. sensitivity: for every layer and candidate setting, run that layer
+ *      on the emulator (the rest in FP32) and record the error of the
+ *      model output against the FP32 reference;
+ *   2. selection: start every layer at its cheapest setting and buy the
+ *      upgrade with the best error reduction per unit of cost until the
+ *      summed per-layer error fits the budget;
+ *   3. verification: run the whole plan on the emulator and keep
+ *      upgrading while the measured error is over budget.
+ * Cost is MAC-weighted, so wide layers get the narrow datapath first.
+ * The resulting PrecisionPlan feeds runMlp() directly.
+ */
+
+#pragma once
+
+#include "tpu_model.hpp"
+#include "tpu_emulator.hpp"
+
+#include <functional>
+
+/**
+ * Relative energy of one MAC at a precision setting (exact() = 1).
+ * Multiplier switching grows with the square of the kept mantissa bits,
+ * the alignment shifter with the window; approximate() comes out at
+ * ~0.4, in line with the 0.8 vs 2.0 nJ/op of docs/COMPARISON.md.
+ */
+inline double relativeMacCost(ArrayPrecision p) {
+    double bits = std::min<unsigned>(p.multBits ? p.multBits : 11, 11);
+    double window = std::min<unsigned>(p.alignMax, 15) + 1;
+    return 0.1 + 0.7 * (bits * bits) / 121.0 + 0.2 * window / 16.0;
+}
+
+/**
+ * Multiplier widths 4-11 x alignment windows 2, 4, 8, 15
+ */
+inline std::vector<ArrayPrecision> defaultPrecisionCandidates() {
+    std::vector<ArrayPrecision> candidates;
+    for (uint8_t bits = 4; bits <= 11; bits++) {
+        for (uint8_t align : {2, 4, 8, 15}) {
+            candidates.push_back({bits, align});
+        }
+    }
+    return candidates;
+}
+
+struct TunerOptions {
+    double errorBudget = 0.01;   // relative RMS error of the model output
+    std::vector<ArrayPrecision> candidates = defaultPrecisionCandidates();
+    std::function<double(ArrayPrecision)> cost = relativeMacCost;
+    AccumulatorMode accumulator = AccumulatorMode::FP16;   // bitstream being tuned for
+};
+
+struct TunerReport {
+    PrecisionPlan plan;
+    std::vector<double> layerError;   // model output error with only this layer approximated
+    double predictedError = 0.0;      // sum of layerError
+    double measuredError = 0.0;       // whole plan on the emulator
+    double relativeCost = 0.0;        // MAC-weighted cost vs all-exact
+    bool withinBudget = false;
+
+    friend std::ostream& operator<<(std::ostream& os, const TunerReport& r) {
+        return os << "TunerReport(layers=" << r.plan.layers.size()
+                  << ", predicted=" << r.predictedError
+                  << ", measured=" << r.measuredError
+                  << ", relative_cost=" << r.relativeCost
+                  << ", within_budget=" << r.withinBudget << ")";
+    }
+};
+
+class PrecisionTuner {
+public:
+    PrecisionTuner(const MlpModel& model, const float* calibration, size_t batch,
+                   const TunerOptions& options = TunerOptions())
+        : model_(model), batch_(batch), options_(options),
+          tpu_(std::make_unique<TPUEmulator>(options.accumulator, EmulatedArithmetic::BitAccurate)) {
+        tpu_.setVerbose(false);
+        if (model.empty() || options.candidates.empty()) {
+            throw std::invalid_argument("Tuner needs a model and candidate settings");
+        }
+
+        // FP32 activations entering each layer, and the reference output
+        layerInputs_.push_back(transposed(calibration, batch, model.front().inputs));
+        for (const auto& layer : model) {
+            std::vector<float> y(layer.outputs * batch);
+            denseReference(layer, layerInputs_.back().data(), batch, y.data());
+            layerInputs_.push_back(std::move(y));
+        }
+        reference_ = layerInputs_.back();
+    }
+
+    TunerReport tune() {
+        const size_t L = model_.size();
+
+        // Per-layer Pareto frontier over (cost, error), cheapest first
+        std::vector<std::vector<Option>> frontier(L);
+        for (size_t l = 0; l < L; l++) {
+            std::vector<Option> all;
+            for (const auto& p : options_.candidates) {
+                all.push_back({p, options_.cost(p), layerOnlyError(l, p)});
+            }
+            std::sort(all.begin(), all.end(), [](const Option& a, const Option& b) {
+                return a.cost < b.cost || (a.cost == b.cost && a.error < b.error);
+            });
+            for (const auto& o : all) {
+                if (frontier[l].empty() || o.error < frontier[l].back().error) {
+                    frontier[l].push_back(o);
+                }
+            }
+        }
+
+        std::vector<size_t> choice(L, 0);
+        auto predicted = [&] {
+            double sum = 0.0;
+            for (size_t l = 0; l < L; l++) sum += frontier[l][choice[l]].error;
+            return sum;
+        };
+
+        // Best error reduction per unit of MAC-weighted cost
+        auto upgrade = [&] {
+            size_t best = L;
+            double bestGain = -1.0;
+            for (size_t l = 0; l < L; l++) {
+                if (choice[l] + 1 >= frontier[l].size()) continue;
+                const Option& cur = frontier[l][choice[l]];
+                const Option& next = frontier[l][choice[l] + 1];
+                double dCost = (next.cost - cur.cost) * model_[l].macs(batch_);
+                double gain = (cur.error - next.error) / std::max(dCost, 1e-12);
+                if (gain > bestGain) {
+                    bestGain = gain;
+                    best = l;
+                }
+            }
+            if (best == L) return false;
+            choice[best]++;
+            return true;
+        };
+
+        while (predicted() > options_.errorBudget && upgrade()) {
+        }
+
+        TunerReport report;
+        auto fill = [&] {
+            report.plan.layers.clear();
+            report.layerError.clear();
+            for (size_t l = 0; l < L; l++) {
+                report.plan.layers.push_back(frontier[l][choice[l]].precision);
+                report.layerError.push_back(frontier[l][choice[l]].error);
+            }
+            report.predictedError = predicted();
+            report.measuredError = relativeRmsError(runPlan(report.plan), reference_);
+        };
+
+        fill();
+        while (report.measuredError > options_.errorBudget && upgrade()) {
+            fill();
+        }
+
+        double cost = 0.0, exactCost = 0.0;
+        for (size_t l = 0; l < L; l++) {
+            cost += options_.cost(report.plan.layers[l]) * model_[l].macs(batch_);
+            exactCost += options_.cost(ArrayPrecision::exact()) * model_[l].macs(batch_);
+        }
+        report.relativeCost = exactCost > 0.0 ? cost / exactCost : 0.0;
+        report.withinBudget = report.measuredError <= options_.errorBudget;
+        return report;
+    }
+
+private:
+    struct Option {
+        ArrayPrecision precision;
+        double cost;
+        double error;
+    };
+
+    const MlpModel& model_;
+    size_t batch_;
+    TunerOptions options_;
+    TPUDriver tpu_;
+    std::vector<std::vector<float>> layerInputs_;   // feature-major, [L] = output
+    std::vector<float> reference_;
+
+    /**
+     * Model output error with layer l on the emulator at p, the rest FP32
+     */
+    double layerOnlyError(size_t l, ArrayPrecision p) {
+        tpu_.setPrecision(p);
+        std::vector<float> x(model_[l].outputs * batch_);
+        denseDevice(tpu_, model_[l], layerInputs_[l].data(), batch_, x.data());
+        for (size_t k = l + 1; k < model_.size(); k++) {
+            std::vector<float> y(model_[k].outputs * batch_);
+            denseReference(model_[k], x.data(), batch_, y.data());
+            x.swap(y);
+        }
+        return relativeRmsError(x, reference_);
+    }
+
+    /**
+     * Whole plan on the emulator; feature-major output
+     */
+    std::vector<float> runPlan(const PrecisionPlan& plan) {
+        std::vector<float> x = layerInputs_.front();
+        for (size_t l = 0; l < model_.size(); l++) {
+            tpu_.setPrecision(plan.layers[l]);
+            std::vector<float> y(model_[l].outputs * batch_);
+            denseDevice(tpu_, model_[l], x.data(), batch_, y.data());
+            x.swap(y);
+        }
+        return x;
+    }
+};
+
+/**
+ * Tune a plan for `model` on `batch` calibration inputs (batch x inputs)
+ */
+inline TunerReport tunePrecision(const MlpModel& model, const float* calibration, size_t batch,
+                                 const TunerOptions& options = TunerOptions()) {
+    return PrecisionTuner(model, calibration, batch, options).tune();
+}
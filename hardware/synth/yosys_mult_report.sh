@@ -0,0 +1,104 @@
+#!/bin/bash
+
+################################################################################
+# Yosys resource report: LUT vs DSP48E1 mantissa multipliers
+# Description: Synthesizes the MAC building blocks with synth_xilinx (xc7)
+#              and scales them to fp16_configurable_systolic_array:
+#                - fp16_approx_mac_unit, multiplier in LUTs (-nodsp)
+#                - fp16_approx_mac_pair, USE_DSP=0 (two LUT products)
+#                - fp16_approx_mac_pair, USE_DSP=1 (two products per DSP48E1)
+#              and scales them to the all-LUT, mixed (DSP_COLUMN_PAIRS packed
+#              pairs per row, the rest in LUTs) and all-packed arrays,
+#              checked against the Basys3 (xc7a35t).
+# Usage: hardware/synth/yosys_mult_report.sh [SIZE] [DSP_COLUMN_PAIRS]
+#        (defaults 16 and 5; APPROX_MULT_BITS from the environment, default 6)
+################################################################################
+
+set -e
+
+SIZE=${1:-16}
+PAIRS=${2:-5}
+BITS=${APPROX_MULT_BITS:-6}
+VERILOG="$(cd "$(dirname "$0")/../verilog" && pwd)"
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# Basys3 (xc7a35t) resources
+AVAIL_LUT=20800
+AVAIL_FF=41600
+AVAIL_DSP=90
+
+if ! command -v yosys > /dev/null; then
+    echo "yosys not found (https://github.com/YosysHQ/yosys)"
+    exit 1
+fi
+if [ $((PAIRS * 2)) -gt "$SIZE" ]; then
+    echo "DSP_COLUMN_PAIRS must be <= SIZE/2"
+    exit 1
+fi
+
+MAC_SRC="$VERILOG/fp16_approx_mac_unit.v $VERILOG/fp16_approximate_multiplier.v \
+$VERILOG/fp16_approximate_adder.v $VERILOG/fp32_adder.v \
+$VERILOG/fp16_selectable_multiplier.v $VERILOG/fp16_selectable_adder.v"
+PAIR_SRC="$VERILOG/fp16_approx_mac_pair.v $VERILOG/fp16_dual_approx_multiplier.v \
+$VERILOG/fp16_approximate_adder.v"
+
+# synth <name> <top> <chparam args> <synth_xilinx flags> <sources...>
+# Leaves "LUT FF DSP CARRY4" in $TMP/<name>
+synth() {
+    local name=$1 top=$2 params=$3 flags=$4
+    shift 4
+    yosys -q -p "read_verilog $*; chparam $params $top; \
+        synth_xilinx -family xc7 -top $top $flags; tee -q -o $TMP/$name.stat stat"
+    awk '
+        NF >= 2 {
+            if ($1 ~ /^[0-9]+$/) { n = $1; c = $2 } else { c = $1; n = $2 }
+            if (n !~ /^[0-9]+$/) next
+            if (c ~ /^LUT[1-6]$/) lut += n
+            else if (c ~ /^FD[CPRSE]+$/) ff += n
+            else if (c == "DSP48E1") dsp += n
+            else if (c == "CARRY4") carry += n
+        }
+        END { printf "%d %d %d %d\n", lut, ff, dsp, carry }
+    ' "$TMP/$name.stat" > "$TMP/$name"
+}
+
+echo "=============================================="
+echo " Mantissa multiplier mapping (synth_xilinx, xc7)"
+echo " APPROX_MULT_BITS=$BITS"
+echo "=============================================="
+
+synth mac_lut fp16_approx_mac_unit "-set APPROX_MULT_BITS $BITS" "-nodsp" $MAC_SRC
+synth pair_lut fp16_approx_mac_pair "-set APPROX_MULT_BITS $BITS -set USE_DSP 0" "-nodsp" $PAIR_SRC
+synth pair_dsp fp16_approx_mac_pair "-set APPROX_MULT_BITS $BITS -set USE_DSP 1" "" $PAIR_SRC
+
+printf "\n%-28s %8s %8s %8s %8s\n" "block" "LUT" "FF" "DSP48E1" "CARRY4"
+row() {
+    read -r lut ff dsp carry < "$TMP/$2"
+    printf "%-28s %8d %8d %8d %8d\n" "$1" "$lut" "$ff" "$dsp" "$carry"
+}
+row "MAC, LUT multiplier" mac_lut
+row "MAC pair, LUT multipliers" pair_lut
+row "MAC pair, packed DSP48E1" pair_dsp
+
+read -r L_LUT L_FF L_DSP _ < "$TMP/mac_lut"
+read -r P_LUT P_FF P_DSP _ < "$TMP/pair_dsp"
+
+PES=$((SIZE * SIZE))
+PACKED=$((SIZE * PAIRS))            # pairs on DSPs
+REST=$((PES - 2 * PACKED))          # PEs left in LUTs
+
+printf "\n%dx%d array (PEs only)              %8s %8s %8s %6s\n" "$SIZE" "$SIZE" "LUT" "FF" "DSP48E1" "fits"
+total() {
+    local fits=yes
+    if [ "$2" -gt $AVAIL_LUT ] || [ "$3" -gt $AVAIL_FF ] || [ "$4" -gt $AVAIL_DSP ]; then fits=no; fi
+    printf "%-34s %8d %8d %8d %6s\n" "$1" "$2" "$3" "$4" "$fits"
+}
+total "all LUT" $((PES * L_LUT)) $((PES * L_FF)) $((PES * L_DSP))
+total "packed, DSP_COLUMN_PAIRS=$PAIRS" \
+    $((PACKED * P_LUT + REST * L_LUT)) \
+    $((PACKED * P_FF + REST * L_FF)) \
+    $((PACKED * P_DSP + REST * L_DSP))
+total "all packed" $((PES / 2 * P_LUT)) $((PES / 2 * P_FF)) $((PES / 2 * P_DSP))
+echo ""
+echo "Basys3: $AVAIL_LUT LUTs, $AVAIL_FF FFs, $AVAIL_DSP DSP48E1"
@@ -0,0 +1,83 @@
+// Pair of Approximate FP16 MAC Units sharing an activation
+// Two fp16_approx_mac_unit datapaths (fixed precision, FP16 accumulators)
+// for neighbouring columns of a row that see the same activation, with the
+// two multiplications in one fp16_dual_approx_multiplier. USE_DSP = 1 packs
+// both mantissa products into a single DSP48E1. Results are identical to
+// two fp16_approx_mac_unit instances.
+
+module fp16_approx_mac_pair #(
+    parameter APPROX_MULT_BITS = 6,  // Mantissa bits for multiplication
+    parameter APPROX_ALIGN = 4,      // Max alignment shift for addition
+    parameter USE_DSP = 1            // 1 = one DSP48E1 for both products
+)(
+    input wire clk,
+    input wire rst_n,
+    input wire enable,
+    input wire acc_clear,
+
+    input wire [15:0] a_in,      // Shared activation (FP16)
+    input wire [15:0] w_in0,     // Weight, first column (FP16)
+    input wire [15:0] w_in1,     // Weight, second column (FP16)
+
+    output reg [15:0] acc_out0,  // Accumulated result, first column
+    output reg [15:0] acc_out1   // Accumulated result, second column
+);
+
+    wire [15:0] mult_result0, mult_result1;
+    reg [15:0] mult_result_reg0, mult_result_reg1;  // Pipeline stage 1
+    wire [15:0] add_result0, add_result1;
+    reg [15:0] accumulator0, accumulator1;
+
+    fp16_dual_approx_multiplier #(
+        .APPROX_BITS(APPROX_MULT_BITS),
+        .USE_DSP(USE_DSP)
+    ) mult (
+        .a(a_in),
+        .b0(w_in0),
+        .b1(w_in1),
+        .result0(mult_result0),
+        .result1(mult_result1)
+    );
+
+    fp16_approximate_adder #(
+        .APPROX_ALIGN(APPROX_ALIGN)
+    ) adder0 (
+        .a(accumulator0),
+        .b(mult_result_reg0),
+        .result(add_result0)
+    );
+
+    fp16_approximate_adder #(
+        .APPROX_ALIGN(APPROX_ALIGN)
+    ) adder1 (
+        .a(accumulator1),
+        .b(mult_result_reg1),
+        .result(add_result1)
+    );
+
+    always @(posedge clk or negedge rst_n) begin
+        if (!rst_n) begin
+            mult_result_reg0 <= 16'h0000;
+            mult_result_reg1 <= 16'h0000;
+            accumulator0 <= 16'h0000;
+            accumulator1 <= 16'h0000;
+            acc_out0 <= 16'h0000;
+            acc_out1 <= 16'h0000;
+        end else if (enable) begin
+            mult_result_reg0 <= mult_result0;
+            mult_result_reg1 <= mult_result1;
+
+            if (acc_clear) begin
+                accumulator0 <= mult_result_reg0;
+                accumulator1 <= mult_result_reg1;
+            end else begin
+                accumulator0 <= add_result0;
+                accumulator1 <= add_result1;
+            end
+
+            acc_out0 <= accumulator0;
+            acc_out1 <= accumulator1;
+        end
+    end
+
+endmodule
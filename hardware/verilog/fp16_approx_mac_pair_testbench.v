@@ -0,0 +1,229 @@
+`timescale 1ns / 1ps
+
+// Testbench for the packed-DSP PE pair
+// fp16_dual_approx_multiplier must match two fp16_approximate_multiplier
+// instances bit for bit (USE_DSP = 1 and 0, APPROX_BITS 6 and the packing
+// limit 8), and fp16_approx_mac_pair must match two fp16_approx_mac_unit
+// instances cycle for cycle. The pair is only used by
+// fp16_configurable_systolic_array (DSP_COLUMN_PAIRS), which has no UART
+// top level, so it is checked here against the PEs it replaces.
+
+module fp16_approx_mac_pair_testbench;
+
+    parameter CLK_PERIOD = 10;
+    parameter MULT_VECTORS = 20000;
+    parameter MAC_CYCLES = 4000;
+
+    reg clk;
+    reg rst_n;
+    reg enable;
+    reg acc_clear;
+    reg [15:0] a;
+    reg [15:0] b0;
+    reg [15:0] b1;
+
+    integer n;
+    integer checks;
+    integer errors;
+
+    // Clock generation
+    initial begin
+        clk = 0;
+        forever #(CLK_PERIOD/2) clk = ~clk;
+    end
+
+    // ------------------------------------------------------------------
+    // Multipliers: packed and LUT dual multipliers against the reference
+    // ------------------------------------------------------------------
+
+    wire [15:0] ref6_0, ref6_1, ref8_0, ref8_1;
+    wire [15:0] dsp6_0, dsp6_1, lut6_0, lut6_1, dsp8_0, dsp8_1;
+
+    fp16_approximate_multiplier #(.APPROX_BITS(6)) ref6_mult0 (.a(a), .b(b0), .result(ref6_0));
+    fp16_approximate_multiplier #(.APPROX_BITS(6)) ref6_mult1 (.a(a), .b(b1), .result(ref6_1));
+    fp16_approximate_multiplier #(.APPROX_BITS(8)) ref8_mult0 (.a(a), .b(b0), .result(ref8_0));
+    fp16_approximate_multiplier #(.APPROX_BITS(8)) ref8_mult1 (.a(a), .b(b1), .result(ref8_1));
+
+    fp16_dual_approx_multiplier #(.APPROX_BITS(6), .USE_DSP(1)) dsp6 (
+        .a(a), .b0(b0), .b1(b1), .result0(dsp6_0), .result1(dsp6_1)
+    );
+    fp16_dual_approx_multiplier #(.APPROX_BITS(6), .USE_DSP(0)) lut6 (
+        .a(a), .b0(b0), .b1(b1), .result0(lut6_0), .result1(lut6_1)
+    );
+    fp16_dual_approx_multiplier #(.APPROX_BITS(8), .USE_DSP(1)) dsp8 (
+        .a(a), .b0(b0), .b1(b1), .result0(dsp8_0), .result1(dsp8_1)
+    );
+
+    // ------------------------------------------------------------------
+    // MACs: one pair against two single PEs on the same inputs
+    // ------------------------------------------------------------------
+
+    wire [15:0] pair_acc0, pair_acc1, single_acc0, single_acc1;
+
+    fp16_approx_mac_pair #(.USE_DSP(1)) pair (
+        .clk(clk),
+        .rst_n(rst_n),
+        .enable(enable),
+        .acc_clear(acc_clear),
+        .a_in(a),
+        .w_in0(b0),
+        .w_in1(b1),
+        .acc_out0(pair_acc0),
+        .acc_out1(pair_acc1)
+    );
+
+    fp16_approx_mac_unit single0 (
+        .clk(clk),
+        .rst_n(rst_n),
+        .enable(enable),
+        .acc_clear(acc_clear),
+        .precision(8'h00),
+        .a_in(a),
+        .w_in(b0),
+        .acc_in(16'h0000),
+        .a_out(),
+        .w_out(),
+        .acc_out(single_acc0),
+        .acc_out_wide()
+    );
+
+    fp16_approx_mac_unit single1 (
+        .clk(clk),
+        .rst_n(rst_n),
+        .enable(enable),
+        .acc_clear(acc_clear),
+        .precision(8'h00),
+        .a_in(a),
+        .w_in(b1),
+        .acc_in(16'h0000),
+        .a_out(),
+        .w_out(),
+        .acc_out(single_acc1),
+        .acc_out_wide()
+    );
+
+    // Operand mix: special encodings (zeros, subnormals, Inf, NaN, extremes),
+    // mid-range values that accumulate without overflowing, and raw bits
+    function [15:0] random_fp16;
+        input integer pick;
+        reg [31:0] r;
+        begin
+            r = $random;
+            case (pick % 8)
+                0: begin
+                    case (r[3:0])
+                        4'd0: random_fp16 = 16'h0000;
+                        4'd1: random_fp16 = 16'h8000;
+                        4'd2: random_fp16 = 16'h0001;
+                        4'd3: random_fp16 = 16'h03FF;
+                        4'd4: random_fp16 = 16'h0400;
+                        4'd5: random_fp16 = 16'h7BFF;
+                        4'd6: random_fp16 = 16'h7C00;
+                        4'd7: random_fp16 = 16'hFC00;
+                        4'd8: random_fp16 = 16'h7E00;
+                        4'd9: random_fp16 = 16'h3C00;
+                        4'd10: random_fp16 = 16'hBC00;
+                        4'd11: random_fp16 = 16'h3FFF;
+                        default: random_fp16 = r[31:16];
+                    endcase
+                end
+                1, 2: random_fp16 = r[15:0];
+                default: random_fp16 = {r[15], 5'd12 + {2'b00, r[14:12]} % 5'd7, r[9:0]};
+            endcase
+        end
+    endfunction
+
+    task check;
+        input cond;
+        input [8*56-1:0] what;
+        begin
+            checks = checks + 1;
+            if (cond) begin
+                $display("  PASS: %0s", what);
+            end else begin
+                errors = errors + 1;
+                $display("  FAIL: %0s", what);
+            end
+        end
+    endtask
+
+    integer mult_mismatches;
+    integer mac_mismatches;
+
+    // Test procedure
+    initial begin
+        $display("=== FP16 MAC Pair (packed DSP) Testbench ===");
+        rst_n = 0;
+        enable = 0;
+        acc_clear = 0;
+        a = 16'h0000;
+        b0 = 16'h0000;
+        b1 = 16'h0000;
+        checks = 0;
+        errors = 0;
+        mult_mismatches = 0;
+        mac_mismatches = 0;
+
+        #(CLK_PERIOD*5);
+        rst_n = 1;
+        #(CLK_PERIOD*2);
+
+        $display("\n--- Dual multiplier, %0d operand triples ---", MULT_VECTORS);
+        for (n = 0; n < MULT_VECTORS; n = n + 1) begin
+            a = random_fp16(n);
+            b0 = random_fp16(n + 3);
+            b1 = random_fp16(n + 5);
+            #1;
+            if (dsp6_0 !== ref6_0 || dsp6_1 !== ref6_1 ||
+                lut6_0 !== ref6_0 || lut6_1 !== ref6_1 ||
+                dsp8_0 !== ref8_0 || dsp8_1 !== ref8_1) begin
+                if (mult_mismatches < 10)
+                    $display("  a=%h b0=%h b1=%h: dsp6 %h/%h lut6 %h/%h ref6 %h/%h dsp8 %h/%h ref8 %h/%h",
+                             a, b0, b1, dsp6_0, dsp6_1, lut6_0, lut6_1, ref6_0, ref6_1,
+                             dsp8_0, dsp8_1, ref8_0, ref8_1);
+                mult_mismatches = mult_mismatches + 1;
+            end
+        end
+        check(mult_mismatches == 0, "Packed and LUT products match fp16_approximate_multiplier");
+
+        $display("\n--- MAC pair against two PEs, %0d cycles ---", MAC_CYCLES);
+        // Inputs change at negedge; outputs compared just before each posedge
+        for (n = 0; n < MAC_CYCLES; n = n + 1) begin
+            @(negedge clk);
+            if (pair_acc0 !== single_acc0 || pair_acc1 !== single_acc1) begin
+                if (mac_mismatches < 10)
+                    $display("  cycle %0d: pair %h/%h, PEs %h/%h",
+                             n, pair_acc0, pair_acc1, single_acc0, single_acc1);
+                mac_mismatches = mac_mismatches + 1;
+            end
+            enable = (n % 13) != 12;            // stalls hold every register
+            acc_clear = (n % 24) == 0;          // runs of 24 cycles
+            a = random_fp16(n + 2);
+            b0 = random_fp16(n + 6);
+            b1 = random_fp16(n + 7);
+        end
+        check(mac_mismatches == 0, "Pair accumulates like two fp16_approx_mac_units");
+
+        $display("\n=== Results ===");
+        $display("Checks: %0d, failures: %0d", checks, errors);
+        if (errors == 0)
+            $display("*** TEST PASSED ***");
+        else
+            $display("*** TEST FAILED ***");
+        $finish;
+    end
+
+    // Timeout watchdog
+    initial begin
+        #(CLK_PERIOD*200000);
+        $display("ERROR: Testbench timeout!");
+        $finish;
+    end
+
+    // Waveform dump for debugging
+    initial begin
+        $dumpfile("fp16_approx_mac_pair_tb.vcd");
+        $dumpvars(0, fp16_approx_mac_pair_testbench);
+    end
+
+endmodule
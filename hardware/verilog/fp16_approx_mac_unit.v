@@ -3,15 +3,26 @@
 // Features approximate computing for reduced circuit area
 //
 // Note: FP16 exact MAC unit has been separated into fp16_exact_mac_unit.v
+//
+// ACC_FP32 = 1 accumulates in FP32 (fp32_adder.v) so long reductions keep
+// their precision on device; acc_out then carries the accumulator rounded
+// down to FP16 and acc_out_wide the full FP32 value.
+//
+// RUNTIME_PRECISION = 1 swaps in the full-width selectable multiplier/adder
+// (fp16_selectable_*.v): precision[3:0] = multiplier mantissa bits,
+// precision[7:4] = adder alignment window, chosen per call by the host.
 
 module fp16_approx_mac_unit #(
     parameter APPROX_MULT_BITS = 6,  // Mantissa bits for multiplication
-    parameter APPROX_ALIGN = 4        // Max alignment shift for addition
+    parameter APPROX_ALIGN = 4,       // Max alignment shift for addition
+    parameter ACC_FP32 = 0,           // 1 = FP32 accumulator
+    parameter RUNTIME_PRECISION = 0   // 1 = precision input selects the datapath width
 )(
     input wire clk,
     input wire rst_n,
     input wire enable,
     input wire acc_clear,
+    input wire [7:0] precision,  // {align_max, mult_bits}, used when RUNTIME_PRECISION = 1
     
     // FP16 inputs
     input wire [15:0] a_in,      // Activation (FP16)
@@ -21,31 +32,87 @@ module fp16_approx_mac_unit #(
     // FP16 outputs
     output reg [15:0] a_out,     // Pass-through activation
     output reg [15:0] w_out,     // Pass-through weight
-    output reg [15:0] acc_out    // Accumulated result
+    output reg [15:0] acc_out,   // Accumulated result
+    output reg [31:0] acc_out_wide  // Accumulated result (FP32)
 );
 
+    // FP16 -> FP32 (exact; subnormals flushed to zero)
+    function [31:0] fp16_to_fp32;
+        input [15:0] h;
+        begin
+            if (h[14:10] == 5'd0)
+                fp16_to_fp32 = {h[15], 31'd0};
+            else if (h[14:10] == 5'h1F)
+                fp16_to_fp32 = {h[15], 8'hFF, h[9:0], 13'd0};
+            else
+                fp16_to_fp32 = {h[15], {3'b000, h[14:10]} + 8'd112, h[9:0], 13'd0};
+        end
+    endfunction
+
+    // FP32 -> FP16 (truncating; overflow to inf, underflow to zero)
+    function [15:0] fp32_to_fp16;
+        input [31:0] f;
+        begin
+            if (f[30:23] == 8'hFF || f[30:23] > 8'd142)
+                fp32_to_fp16 = {f[31], 5'h1F, (f[30:23] == 8'hFF) ? f[22:13] : 10'd0};
+            else if (f[30:23] < 8'd113)
+                fp32_to_fp16 = {f[31], 15'd0};
+            else
+                fp32_to_fp16 = {f[31], f[27:23] - 5'd16, f[22:13]};
+        end
+    endfunction
+
+
     // Internal wires and pipeline registers
     wire [15:0] mult_result;
     reg [15:0] mult_result_reg;  // Pipeline stage 1
     wire [15:0] add_result;
     reg [15:0] accumulator;
+    wire [31:0] add_result_wide;
+    reg [31:0] accumulator_wide;
     
-    // Approximate FP16 Multiplier
-    fp16_approximate_multiplier #(
-        .APPROX_BITS(APPROX_MULT_BITS)
-    ) mult (
-        .a(a_in),
-        .b(w_in),
-        .result(mult_result)
-    );
-    
-    // Approximate FP16 Adder (uses pipelined mult result)
-    fp16_approximate_adder #(
-        .APPROX_ALIGN(APPROX_ALIGN)
-    ) adder (
-        .a(accumulator),
-        .b(mult_result_reg),
-        .result(add_result)
+    generate
+        if (RUNTIME_PRECISION) begin : gen_selectable
+            // Full-width datapath, narrowed at runtime
+            fp16_selectable_multiplier mult (
+                .a(a_in),
+                .b(w_in),
+                .mult_bits(precision[3:0]),
+                .result(mult_result)
+            );
+            
+            fp16_selectable_adder adder (
+                .a(accumulator),
+                .b(mult_result_reg),
+                .align_max(precision[7:4]),
+                .result(add_result)
+            );
+        end else begin : gen_fixed
+            // Approximate FP16 Multiplier
+            fp16_approximate_multiplier #(
+                .APPROX_BITS(APPROX_MULT_BITS)
+            ) mult (
+                .a(a_in),
+                .b(w_in),
+                .result(mult_result)
+            );
+            
+            // Approximate FP16 Adder (uses pipelined mult result)
+            fp16_approximate_adder #(
+                .APPROX_ALIGN(APPROX_ALIGN)
+            ) adder (
+                .a(accumulator),
+                .b(mult_result_reg),
+                .result(add_result)
+            );
+        end
+    endgenerate
+
+    // FP32 accumulator adder (pruned by synthesis when ACC_FP32 = 0)
+    fp32_adder wide_adder (
+        .a(accumulator_wide),
+        .b(fp16_to_fp32(mult_result_reg)),
+        .result(add_result_wide)
     );
     
     // Pipeline and accumulation
@@ -53,9 +120,11 @@ module fp16_approx_mac_unit #(
         if (!rst_n) begin
             mult_result_reg <= 16'h0000;  // Pipeline register
             accumulator <= 16'h0000;  // +0.0 in FP16
+            accumulator_wide <= 32'h00000000;
             a_out <= 16'h0000;
             w_out <= 16'h0000;
             acc_out <= 16'h0000;
+            acc_out_wide <= 32'h00000000;
         end else if (enable) begin
             // Pipeline stage 1: Register multiplier output
             mult_result_reg <= mult_result;
@@ -67,11 +136,19 @@ module fp16_approx_mac_unit #(
             // Accumulate
             if (acc_clear) begin
                 accumulator <= mult_result_reg;
+                accumulator_wide <= fp16_to_fp32(mult_result_reg);
             end else begin
                 accumulator <= add_result;
+                accumulator_wide <= add_result_wide;
             end
             
-            acc_out <= accumulator;
+            if (ACC_FP32) begin
+                acc_out <= fp32_to_fp16(accumulator_wide);
+                acc_out_wide <= accumulator_wide;
+            end else begin
+                acc_out <= accumulator;
+                acc_out_wide <= fp16_to_fp32(accumulator);
+            end
         end
     end
 
@@ -3,16 +3,27 @@
 // Approximate computing for reduced area
 //
 // Note: Configurable systolic array has been separated into fp16_configurable_systolic_array.v
+//
+// MULT_STAGES / ADD_STAGES > 1 build the array from fp16_pipelined_mac_unit
+// (FP16 accumulators only; ACC_FP32 keeps fp16_approx_mac_unit): hold drain
+// for DRAIN_CYCLES enabled cycles at the end of each run, after which the
+// acc_out ports carry the results.
 
 module fp16_approx_systolic_array #(
     parameter SIZE = 8,              // 8x8 array (64 PEs)
     parameter APPROX_MULT_BITS = 6,  // Reduced mantissa bits
-    parameter APPROX_ALIGN = 4       // Reduced alignment shift
+    parameter APPROX_ALIGN = 4,      // Reduced alignment shift
+    parameter ACC_FP32 = 0,          // 1 = FP32 accumulators (see fp16_approx_mac_unit.v)
+    parameter RUNTIME_PRECISION = 0, // 1 = precision input selects the datapath width
+    parameter MULT_STAGES = 1,       // Multiplier pipeline depth (fp16_pipelined_mac_unit.v)
+    parameter ADD_STAGES = 1         // Adder pipeline depth = accumulator lanes
 )(
     input wire clk,
     input wire rst_n,
     input wire enable,
     input wire acc_clear,
+    input wire drain,                // end of run (pipelined PEs only)
+    input wire [7:0] precision,      // {align_max, mult_bits} (RUNTIME_PRECISION = 1)
     
     // FP16 Activation inputs (one per row)
     input wire [15:0] a_in_0, a_in_1, a_in_2, a_in_3,
@@ -30,7 +41,10 @@ module fp16_approx_systolic_array #(
     output wire [15:0] acc_out_40, acc_out_41, acc_out_42, acc_out_43, acc_out_44, acc_out_45, acc_out_46, acc_out_47,
     output wire [15:0] acc_out_50, acc_out_51, acc_out_52, acc_out_53, acc_out_54, acc_out_55, acc_out_56, acc_out_57,
     output wire [15:0] acc_out_60, acc_out_61, acc_out_62, acc_out_63, acc_out_64, acc_out_65, acc_out_66, acc_out_67,
-    output wire [15:0] acc_out_70, acc_out_71, acc_out_72, acc_out_73, acc_out_74, acc_out_75, acc_out_76, acc_out_77
+    output wire [15:0] acc_out_70, acc_out_71, acc_out_72, acc_out_73, acc_out_74, acc_out_75, acc_out_76, acc_out_77,
+    
+    // FP32 accumulated outputs, PE (row, col) at [(row*SIZE+col)*32 +: 32]
+    output wire [SIZE*SIZE*32-1:0] acc_out_wide_flat
 );
 
     // Internal interconnect wires for activation data flow (horizontal)
@@ -143,26 +157,57 @@ module fp16_approx_systolic_array #(
     assign acc_out_76 = acc_wire[7][6];
     assign acc_out_77 = acc_wire[7][7];
     
+    localparam PIPELINED = (MULT_STAGES > 1 || ADD_STAGES > 1) && !ACC_FP32;
+    localparam DRAIN_CYCLES = PIPELINED ? MULT_STAGES + ADD_STAGES * (ADD_STAGES + 1) : 0;
+    
     // Generate 8x8 array of approximate MAC units
     genvar row, col;
     generate
         for (row = 0; row < SIZE; row = row + 1) begin : gen_row
             for (col = 0; col < SIZE; col = col + 1) begin : gen_col
-                fp16_approx_mac_unit #(
-                    .APPROX_MULT_BITS(APPROX_MULT_BITS),
-                    .APPROX_ALIGN(APPROX_ALIGN)
-                ) pe (
-                    .clk(clk),
-                    .rst_n(rst_n),
-                    .enable(enable),
-                    .acc_clear(acc_clear),
-                    .a_in(a_wire[row][col]),
-                    .w_in(w_wire[row][col]),
-                    .acc_in(16'h0000),
-                    .a_out(a_wire[row][col+1]),
-                    .w_out(w_wire[row+1][col]),
-                    .acc_out(acc_wire[row][col])
-                );
+                if (PIPELINED) begin : gen_pipelined
+                    fp16_pipelined_mac_unit #(
+                        .APPROX_MULT_BITS(APPROX_MULT_BITS),
+                        .APPROX_ALIGN(APPROX_ALIGN),
+                        .RUNTIME_PRECISION(RUNTIME_PRECISION),
+                        .MULT_STAGES(MULT_STAGES),
+                        .ADD_STAGES(ADD_STAGES)
+                    ) pe (
+                        .clk(clk),
+                        .rst_n(rst_n),
+                        .enable(enable),
+                        .acc_clear(acc_clear),
+                        .drain(drain),
+                        .precision(precision),
+                        .a_in(a_wire[row][col]),
+                        .w_in(w_wire[row][col]),
+                        .acc_in(16'h0000),
+                        .a_out(a_wire[row][col+1]),
+                        .w_out(w_wire[row+1][col]),
+                        .acc_out(acc_wire[row][col]),
+                        .acc_out_wide(acc_out_wide_flat[(row*SIZE+col)*32 +: 32])
+                    );
+                end else begin : gen_single
+                    fp16_approx_mac_unit #(
+                        .APPROX_MULT_BITS(APPROX_MULT_BITS),
+                        .APPROX_ALIGN(APPROX_ALIGN),
+                        .ACC_FP32(ACC_FP32),
+                        .RUNTIME_PRECISION(RUNTIME_PRECISION)
+                    ) pe (
+                        .clk(clk),
+                        .rst_n(rst_n),
+                        .enable(enable),
+                        .acc_clear(acc_clear),
+                        .precision(precision),
+                        .a_in(a_wire[row][col]),
+                        .w_in(w_wire[row][col]),
+                        .acc_in(16'h0000),
+                        .a_out(a_wire[row][col+1]),
+                        .w_out(w_wire[row+1][col]),
+                        .acc_out(acc_wire[row][col]),
+                        .acc_out_wide(acc_out_wide_flat[(row*SIZE+col)*32 +: 32])
+                    );
+                end
             end
         end
     endgenerate
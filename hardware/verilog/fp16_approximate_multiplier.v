@@ -42,7 +42,9 @@ module fp16_approximate_multiplier #(
     wire [APPROX_BITS-1:0] mant_a_approx = mant_a_full[10:10-APPROX_BITS+1];
     wire [APPROX_BITS-1:0] mant_b_approx = mant_b_full[10:10-APPROX_BITS+1];
     
-    // Reduced-width multiplication (saves ~60% area)
+    // Reduced-width multiplication (saves ~60% area); kept in LUTs so the
+    // DSP48E1s stay free for fp16_dual_approx_multiplier
+    (* use_dsp = "no" *)
     wire [2*APPROX_BITS-1:0] mant_mult_approx = mant_a_approx * mant_b_approx;
     
     // Normalize and extract mantissa
@@ -1,8 +1,16 @@
 // Configurable Systolic Array - Choose between 4x4, 8x8, or 16x16
+//
+// The PEs of a row share a_in, so column pairs can share a multiplier:
+// the first DSP_COLUMN_PAIRS pairs of every row use fp16_approx_mac_pair
+// with both mantissa products packed into one DSP48E1, the rest stay in
+// LUTs. A 16x16 array with DSP_COLUMN_PAIRS = 5 uses 80 of the Basys3's 90
+// DSP48E1s for 160 of its 256 products. Resource report:
+// hardware/synth/yosys_mult_report.sh
 module fp16_configurable_systolic_array #(
-    parameter SIZE = 8,
+    parameter SIZE = 8,               // PEs per side (even, <= 16)
     parameter APPROX_MULT_BITS = 6,
-    parameter APPROX_ALIGN = 4
+    parameter APPROX_ALIGN = 4,
+    parameter DSP_COLUMN_PAIRS = 0    // column pairs per row on packed DSP48E1s (<= SIZE/2)
 )(
     input wire clk,
     input wire rst_n,
@@ -51,25 +59,59 @@ module fp16_configurable_systolic_array #(
         end
     endgenerate
     
-    // Instantiate processing elements (simplified - full implementation would be larger)
+    // Instantiate processing elements, two columns at a time
     generate
-        for (i = 0; i < 8; i = i + 1) begin : gen_pe_row
-            for (j = 0; j < 8; j = j + 1) begin : gen_pe_col
-                fp16_approx_mac_unit #(
-                    .APPROX_MULT_BITS(APPROX_MULT_BITS),
-                    .APPROX_ALIGN(APPROX_ALIGN)
-                ) pe (
-                    .clk(clk),
-                    .rst_n(rst_n),
-                    .enable(enable),
-                    .acc_clear(acc_clear),
-                    .a_in(a_in[i]),
-                    .w_in(w_in[j]),
-                    .acc_in(16'h0000),
-                    .a_out(),  // Not used in this simplified version
-                    .w_out(),  // Not used in this simplified version
-                    .acc_out(acc_internal[i][j])
-                );
+        for (i = 0; i < SIZE; i = i + 1) begin : gen_pe_row
+            for (j = 0; j < SIZE; j = j + 2) begin : gen_pe_col
+                if (j / 2 < DSP_COLUMN_PAIRS) begin : gen_dsp_pair
+                    fp16_approx_mac_pair #(
+                        .APPROX_MULT_BITS(APPROX_MULT_BITS),
+                        .APPROX_ALIGN(APPROX_ALIGN),
+                        .USE_DSP(1)
+                    ) pe_pair (
+                        .clk(clk),
+                        .rst_n(rst_n),
+                        .enable(enable),
+                        .acc_clear(acc_clear),
+                        .a_in(a_in[i]),
+                        .w_in0(w_in[j]),
+                        .w_in1(w_in[j+1]),
+                        .acc_out0(acc_internal[i][j]),
+                        .acc_out1(acc_internal[i][j+1])
+                    );
+                end else begin : gen_lut_pair
+                    fp16_approx_mac_unit #(
+                        .APPROX_MULT_BITS(APPROX_MULT_BITS),
+                        .APPROX_ALIGN(APPROX_ALIGN)
+                    ) pe0 (
+                        .clk(clk),
+                        .rst_n(rst_n),
+                        .enable(enable),
+                        .acc_clear(acc_clear),
+                        .a_in(a_in[i]),
+                        .w_in(w_in[j]),
+                        .acc_in(16'h0000),
+                        .a_out(),  // Not used in this simplified version
+                        .w_out(),  // Not used in this simplified version
+                        .acc_out(acc_internal[i][j])
+                    );
+
+                    fp16_approx_mac_unit #(
+                        .APPROX_MULT_BITS(APPROX_MULT_BITS),
+                        .APPROX_ALIGN(APPROX_ALIGN)
+                    ) pe1 (
+                        .clk(clk),
+                        .rst_n(rst_n),
+                        .enable(enable),
+                        .acc_clear(acc_clear),
+                        .a_in(a_in[i]),
+                        .w_in(w_in[j+1]),
+                        .acc_in(16'h0000),
+                        .a_out(),
+                        .w_out(),
+                        .acc_out(acc_internal[i][j+1])
+                    );
+                end
             end
         end
     endgenerate
@@ -0,0 +1,97 @@
+// Dual FP16 Approximate Multiplier (shared operand)
+// a * b0 and a * b1 with the same truncation, normalization and special
+// cases as fp16_approximate_multiplier.v, bit for bit.
+//
+// USE_DSP = 1 computes both mantissa products with one multiplier, mapped
+// to a single DSP48E1:
+//     {mb1, 0^APPROX_BITS, mb0} * ma = (mb1 * ma) << 2*APPROX_BITS + mb0 * ma
+// mb0 * ma < 2^(2*APPROX_BITS), so the two products never overlap. The
+// packed operand is 3*APPROX_BITS wide and must fit the 25-bit signed A
+// port: APPROX_BITS <= 8.
+// USE_DSP = 0 builds two separate products in LUTs (use_dsp = "no").
+
+module fp16_dual_approx_multiplier #(
+    parameter APPROX_BITS = 6,  // Mantissa bits kept (<= 8 with USE_DSP)
+    parameter USE_DSP = 1       // 1 = both mantissa products in one DSP48E1
+)(
+    input wire [15:0] a,        // Shared FP16 input (activation)
+    input wire [15:0] b0,       // FP16 input (weight, first column)
+    input wire [15:0] b1,       // FP16 input (weight, second column)
+    output wire [15:0] result0, // a * b0
+    output wire [15:0] result1  // a * b1
+);
+
+    localparam PW = 2 * APPROX_BITS;   // product width
+
+    // Top APPROX_BITS bits of the 11-bit mantissa (implicit 1 included)
+    function [APPROX_BITS-1:0] mant_approx;
+        input [15:0] h;
+        reg [10:0] full;
+        begin
+            full = (h[14:10] == 0) ? {1'b0, h[9:0]} : {1'b1, h[9:0]};
+            mant_approx = full[10:10-APPROX_BITS+1];
+        end
+    endfunction
+
+    // Sign, exponent and normalization of fp16_approximate_multiplier
+    function [15:0] finish;
+        input [15:0] x;
+        input [15:0] y;
+        input [PW-1:0] prod;
+        reg [5:0] exp_unbiased;
+        reg [4:0] exp_result;
+        reg [9:0] mant_result;
+        begin
+            exp_unbiased = x[14:10] + y[14:10] - 6'd15;
+            if (x[14:10] == 0 || y[14:10] == 0) begin
+                exp_result = 5'b00000;
+                mant_result = 10'b0;
+            end else if (x[14:10] == 5'b11111 || y[14:10] == 5'b11111) begin
+                exp_result = 5'b11111;
+                mant_result = 10'b0;
+            end else begin
+                if (prod[PW-1]) begin
+                    exp_result = exp_unbiased[4:0] + 1;
+                    mant_result = {prod[PW-2:PW-2-5], 4'b0};
+                end else begin
+                    exp_result = exp_unbiased[4:0];
+                    mant_result = {prod[PW-3:PW-3-5], 4'b0};
+                end
+
+                if (exp_unbiased[5] == 1'b1) begin  // Underflow
+                    exp_result = 5'b00000;
+                    mant_result = 10'b0;
+                end else if (exp_result >= 5'b11111) begin  // Overflow
+                    exp_result = 5'b11111;
+                    mant_result = 10'b0;
+                end
+            end
+            finish = {x[15] ^ y[15], exp_result, mant_result};
+        end
+    endfunction
+
+    wire [APPROX_BITS-1:0] ma = mant_approx(a);
+    wire [APPROX_BITS-1:0] mb0 = mant_approx(b0);
+    wire [APPROX_BITS-1:0] mb1 = mant_approx(b1);
+    wire [PW-1:0] prod0;
+    wire [PW-1:0] prod1;
+
+    generate
+        if (USE_DSP) begin : gen_dsp
+            wire [PW+APPROX_BITS-1:0] packed_b = {mb1, {APPROX_BITS{1'b0}}, mb0};
+            (* use_dsp = "yes" *)
+            wire [2*PW-1:0] packed_prod = packed_b * ma;
+            assign prod0 = packed_prod[PW-1:0];
+            assign prod1 = packed_prod[2*PW-1:PW];
+        end else begin : gen_lut
+            (* use_dsp = "no" *) wire [PW-1:0] lut_prod0 = ma * mb0;
+            (* use_dsp = "no" *) wire [PW-1:0] lut_prod1 = ma * mb1;
+            assign prod0 = lut_prod0;
+            assign prod1 = lut_prod1;
+        end
+    endgenerate
+
+    assign result0 = finish(a, b0, prod0);
+    assign result1 = finish(a, b1, prod1);
+
+endmodule
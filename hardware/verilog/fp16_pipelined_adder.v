@@ -0,0 +1,62 @@
+// FP16 Adder, STAGES-deep pipeline
+// The approximate (or, with RUNTIME_PRECISION = 1, selectable) adder
+// followed by STAGES output registers, retimed by synthesis
+// (synth_design -retiming) into alignment / add / normalize stages.
+// Latency: STAGES enabled cycles. Results are those of the combinational
+// adder (bit model: ApproxFP16::add for the selectable datapath).
+//
+// In a feedback loop (fp16_pipelined_mac_unit.v) the STAGES registers
+// hold STAGES independent partial sums.
+
+module fp16_pipelined_adder #(
+    parameter APPROX_ALIGN = 4,       // Max alignment shift (RUNTIME_PRECISION = 0)
+    parameter RUNTIME_PRECISION = 0,  // 1 = align_max selects the window
+    parameter STAGES = 2              // Pipeline registers (>= 1)
+)(
+    input wire clk,
+    input wire rst_n,
+    input wire enable,
+    input wire [15:0] a,
+    input wire [15:0] b,
+    input wire [3:0] align_max,   // used when RUNTIME_PRECISION = 1
+    output wire [15:0] result     // a + b, STAGES cycles later
+);
+
+    wire [15:0] sum;
+
+    generate
+        if (RUNTIME_PRECISION) begin : gen_selectable
+            fp16_selectable_adder adder (
+                .a(a),
+                .b(b),
+                .align_max(align_max),
+                .result(sum)
+            );
+        end else begin : gen_fixed
+            fp16_approximate_adder #(
+                .APPROX_ALIGN(APPROX_ALIGN)
+            ) adder (
+                .a(a),
+                .b(b),
+                .result(sum)
+            );
+        end
+    endgenerate
+
+    reg [15:0] stage [0:STAGES-1];
+    integer s;
+
+    always @(posedge clk or negedge rst_n) begin
+        if (!rst_n) begin
+            for (s = 0; s < STAGES; s = s + 1)
+                stage[s] <= 16'h0000;
+        end else if (enable) begin
+            stage[0] <= sum;
+            for (s = 1; s < STAGES; s = s + 1)
+                stage[s] <= stage[s-1];
+        end
+    end
+
+    assign result = stage[STAGES-1];
+
+endmodule
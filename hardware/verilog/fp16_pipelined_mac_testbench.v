@@ -0,0 +1,172 @@
+`timescale 1ns / 1ps
+
+// Testbench for the Pipelined FP16 MAC Unit
+// One fp16_pipelined_mac_unit per MULT_STAGES / ADD_STAGES pair (1-4 each),
+// all fed the same stream. Each case is a run from acc_clear and a drain,
+// then a run continued without acc_clear and another drain; after each
+// drain every acc_out must equal accumulateLanes for that many lanes.
+// Vectors: fp16_pipelined_mac_vectors.hex, from drivers/tpu_mac_vectors.cpp
+// (make -C drivers mac-vectors)
+module fp16_pipelined_mac_testbench;
+
+    parameter CLK_PERIOD = 10;
+    parameter CASES = 8;
+    parameter PRODUCTS = 22;                   // per case: RUN1 + continued run
+    parameter RUN1 = 13;                       // products from acc_clear
+    parameter CASE_WORDS = 1 + 2 * PRODUCTS + 8;
+    parameter DRAIN = 24;                      // DRAIN_CYCLES of MULT_STAGES 4, ADD_STAGES 4
+
+    reg clk;
+    reg rst_n;
+    reg enable;
+    reg acc_clear;
+    reg drain;
+    reg [7:0] precision;
+    reg [15:0] a_in;
+    reg [15:0] w_in;
+    wire [16*16-1:0] acc_flat;                 // instance (MULT_STAGES-1)*4 + (ADD_STAGES-1)
+
+    // Per case: precision, act[PRODUCTS], wt[PRODUCTS],
+    // acc_out after run 1 and after run 2 for ADD_STAGES 1-4
+    reg [15:0] vectors [0:CASES*CASE_WORDS-1];
+
+    integer c;
+    integer base;
+    integer checks;
+    integer errors;
+
+    // Clock generation
+    initial begin
+        clk = 0;
+        forever #(CLK_PERIOD/2) clk = ~clk;
+    end
+
+    genvar gm, gs;
+    generate
+        for (gm = 1; gm <= 4; gm = gm + 1) begin : mult
+            for (gs = 1; gs <= 4; gs = gs + 1) begin : add
+                fp16_pipelined_mac_unit #(
+                    .RUNTIME_PRECISION(1),
+                    .MULT_STAGES(gm),
+                    .ADD_STAGES(gs)
+                ) mac (
+                    .clk(clk),
+                    .rst_n(rst_n),
+                    .enable(enable),
+                    .acc_clear(acc_clear),
+                    .drain(drain),
+                    .precision(precision),
+                    .a_in(a_in),
+                    .w_in(w_in),
+                    .acc_in(16'h0000),
+                    .a_out(),
+                    .w_out(),
+                    .acc_out(acc_flat[((gm-1)*4 + (gs-1))*16 +: 16]),
+                    .acc_out_wide()
+                );
+            end
+        end
+    endgenerate
+
+    // Stream products first..first+n-1 of the current case (acc_clear with
+    // the first one when clear is set), then hold drain for DRAIN cycles
+    task run_products;
+        input integer first;
+        input integer n;
+        input clear;
+        integer p;
+        begin
+            for (p = first; p < first + n; p = p + 1) begin
+                @(negedge clk);
+                a_in = vectors[base + 1 + p];
+                w_in = vectors[base + 1 + PRODUCTS + p];
+                acc_clear = clear && (p == first);
+                drain = 1'b0;
+            end
+            @(negedge clk);
+            a_in = 16'h0000;
+            w_in = 16'h0000;
+            acc_clear = 1'b0;
+            drain = 1'b1;
+            repeat (DRAIN) @(negedge clk);
+        end
+    endtask
+
+    // Compare every instance with the expected sum for its lane count
+    // (offset 0: after run 1, 4: after the continued run)
+    task check_outputs;
+        input integer offset;
+        integer i;
+        reg [15:0] expected;
+        reg [15:0] actual;
+        begin
+            for (i = 0; i < 16; i = i + 1) begin
+                expected = vectors[base + 1 + 2 * PRODUCTS + offset + (i % 4)];
+                actual = acc_flat[i*16 +: 16];
+                checks = checks + 1;
+                if (actual !== expected) begin
+                    errors = errors + 1;
+                    $display("  FAIL case %0d %s: MULT_STAGES=%0d ADD_STAGES=%0d acc_out=%h, expected %h",
+                             c, (offset == 0) ? "run 1    " : "continued", i / 4 + 1, i % 4 + 1,
+                             actual, expected);
+                end
+            end
+        end
+    endtask
+
+    // Test sequence
+    initial begin
+        $display("=== FP16 Pipelined MAC Testbench ===");
+        $readmemh("fp16_pipelined_mac_vectors.hex", vectors);
+
+        // Idle with drain held: a low drain feeds products
+        rst_n = 0;
+        enable = 1;
+        acc_clear = 0;
+        drain = 1;
+        precision = 8'h00;
+        a_in = 16'h0000;
+        w_in = 16'h0000;
+        checks = 0;
+        errors = 0;
+
+        #(CLK_PERIOD*5);
+        rst_n = 1;
+        #(CLK_PERIOD*2);
+
+        for (c = 0; c < CASES; c = c + 1) begin
+            base = c * CASE_WORDS;
+            @(negedge clk);
+            precision = vectors[base][7:0];
+            $display("Case %0d: mult_bits=%0d align_max=%0d", c, precision[3:0], precision[7:4]);
+
+            run_products(0, RUN1, 1'b1);
+            check_outputs(0);
+
+            run_products(RUN1, PRODUCTS - RUN1, 1'b0);
+            check_outputs(4);
+        end
+
+        $display("\n=== Results ===");
+        $display("Checks: %0d, mismatches: %0d", checks, errors);
+        if (errors == 0)
+            $display("*** TEST PASSED ***");
+        else
+            $display("*** TEST FAILED ***");
+        $finish;
+    end
+
+    // Timeout watchdog
+    initial begin
+        #(CLK_PERIOD*20000);
+        $display("ERROR: Testbench timeout!");
+        $finish;
+    end
+
+    // Waveform dump for debugging
+    initial begin
+        $dumpfile("fp16_pipelined_mac_tb.vcd");
+        $dumpvars(0, fp16_pipelined_mac_testbench);
+    end
+
+endmodule
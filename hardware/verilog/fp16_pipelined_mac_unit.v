@@ -0,0 +1,177 @@
+// Pipelined FP16 MAC Unit (interleaved accumulators)
+// Higher-clock variant of fp16_approx_mac_unit.v: the multiplier runs
+// MULT_STAGES deep and the accumulator adder ADD_STAGES deep
+// (fp16_pipelined_*.v), so no path holds more than a fraction of a
+// multiply or an add.
+//
+// An ADD_STAGES-deep adder in the accumulator feedback loop holds
+// LANES = ADD_STAGES partial sums at once: product k of a run goes to lane
+// k mod LANES, one product per cycle, with no stall for the add latency.
+// acc_clear starts a run: each lane loads its first product.
+//
+// drain ends a run. Products already in the multiplier land first, then
+// the lanes are folded into lane 0 through the same adder,
+// ((lane0 + lane1) + lane2) + lane3, and the loop parks with the total in
+// lane 0 and the other lanes at zero; acc_out is valid and a following run
+// without acc_clear continues from the total. A drain takes at most
+// DRAIN_CYCLES enabled cycles; extra drain cycles are harmless.
+// Models: accumulateLanes (bit) and PipelinedMac (cycle) in drivers/tpu_timing.hpp
+//
+// FP16 accumulators only (no ACC_FP32); acc_out_wide is acc_out widened.
+
+module fp16_pipelined_mac_unit #(
+    parameter APPROX_MULT_BITS = 6,  // Mantissa bits for multiplication
+    parameter APPROX_ALIGN = 4,      // Max alignment shift for addition
+    parameter RUNTIME_PRECISION = 0, // 1 = precision input selects the datapath width
+    parameter MULT_STAGES = 2,       // Multiplier pipeline depth (1-4)
+    parameter ADD_STAGES = 2         // Adder pipeline depth = accumulator lanes (1-4)
+)(
+    input wire clk,
+    input wire rst_n,
+    input wire enable,
+    input wire acc_clear,
+    input wire drain,            // no new products; fold the lanes into acc_out
+    input wire [7:0] precision,  // {align_max, mult_bits}, used when RUNTIME_PRECISION = 1
+
+    // FP16 inputs
+    input wire [15:0] a_in,      // Activation (FP16)
+    input wire [15:0] w_in,      // Weight (FP16)
+    input wire [15:0] acc_in,    // Accumulator input (unused, as in fp16_approx_mac_unit)
+
+    // FP16 outputs
+    output reg [15:0] a_out,     // Pass-through activation
+    output reg [15:0] w_out,     // Pass-through weight
+    output reg [15:0] acc_out,   // Accumulated result, updated at the end of a drain
+    output reg [31:0] acc_out_wide  // acc_out as FP32
+);
+
+    localparam LANES = ADD_STAGES;
+    localparam DRAIN_CYCLES = MULT_STAGES + LANES * (LANES + 1);
+
+    // FP16 -> FP32 (exact; subnormals flushed to zero)
+    function [31:0] fp16_to_fp32;
+        input [15:0] h;
+        begin
+            if (h[14:10] == 5'd0)
+                fp16_to_fp32 = {h[15], 31'd0};
+            else if (h[14:10] == 5'h1F)
+                fp16_to_fp32 = {h[15], 8'hFF, h[9:0], 13'd0};
+            else
+                fp16_to_fp32 = {h[15], {3'b000, h[14:10]} + 8'd112, h[9:0], 13'd0};
+        end
+    endfunction
+
+    // Product pipeline; valid/clear tags travel alongside
+    wire [15:0] product;
+    reg [MULT_STAGES-1:0] valid_pipe;
+    reg [MULT_STAGES-1:0] clear_pipe;
+    reg [2:0] clear_left;           // lanes still to be loaded after acc_clear
+    wire clear_tag = acc_clear || (clear_left != 3'd0);
+    wire prod_valid = valid_pipe[MULT_STAGES-1];
+    wire prod_clear = clear_pipe[MULT_STAGES-1];
+
+    fp16_pipelined_multiplier #(
+        .APPROX_BITS(APPROX_MULT_BITS),
+        .RUNTIME_PRECISION(RUNTIME_PRECISION),
+        .STAGES(MULT_STAGES)
+    ) mult (
+        .clk(clk),
+        .rst_n(rst_n),
+        .enable(enable),
+        .a(a_in),
+        .b(w_in),
+        .mult_bits(precision[3:0]),
+        .result(product)
+    );
+
+    // Accumulator loop: the adder's pipeline registers are the lanes and
+    // its output is the lane whose turn it is (lane `phase`)
+    wire [15:0] feedback;
+    reg [2:0] phase;
+    reg parked;                     // loop stopped on lane 0 after a drain
+    reg fold_active;
+    reg [2:0] fold_period;          // completed passes over the lanes while folding
+    reg [15:0] hold;                // lane waiting to be added into lane 0
+
+    wire draining = !prod_valid && !parked;
+    wire fold_start = draining && !fold_active && (phase == 3'd0);
+    wire folding = fold_active || fold_start;
+    wire fold_take = draining && folding && (phase == fold_period + 3'd1);
+    wire fold_add = draining && fold_active && (phase == 3'd0) &&
+                    (fold_period != 3'd0) && (fold_period < LANES);
+    wire fold_done = draining && fold_active && (phase == 3'd0) && (fold_period == LANES);
+
+    wire loop_enable = enable && (prod_valid || (!parked && !fold_done));
+
+    wire [15:0] add_a = ((prod_valid && prod_clear) || fold_take) ? 16'h0000 : feedback;
+    wire [15:0] add_b = prod_valid ? product : (fold_add ? hold : 16'h0000);
+
+    fp16_pipelined_adder #(
+        .APPROX_ALIGN(APPROX_ALIGN),
+        .RUNTIME_PRECISION(RUNTIME_PRECISION),
+        .STAGES(ADD_STAGES)
+    ) adder (
+        .clk(clk),
+        .rst_n(rst_n),
+        .enable(loop_enable),
+        .a(add_a),
+        .b(add_b),
+        .align_max(precision[7:4]),
+        .result(feedback)
+    );
+
+    always @(posedge clk or negedge rst_n) begin
+        if (!rst_n) begin
+            valid_pipe <= {MULT_STAGES{1'b0}};
+            clear_pipe <= {MULT_STAGES{1'b0}};
+            clear_left <= 3'd0;
+            phase <= 3'd0;
+            parked <= 1'b1;
+            fold_active <= 1'b0;
+            fold_period <= 3'd0;
+            hold <= 16'h0000;
+            a_out <= 16'h0000;
+            w_out <= 16'h0000;
+            acc_out <= 16'h0000;
+            acc_out_wide <= 32'h00000000;
+        end else if (enable) begin
+            // Pass data to next PE
+            a_out <= a_in;
+            w_out <= w_in;
+
+            // Tag the product entering the multiplier
+            valid_pipe <= (valid_pipe << 1) | !drain;
+            clear_pipe <= (clear_pipe << 1) | clear_tag;
+            if (acc_clear)
+                clear_left <= LANES - 1;
+            else if (clear_left != 3'd0)
+                clear_left <= clear_left - 3'd1;
+
+            if (loop_enable)
+                phase <= (phase == LANES - 1) ? 3'd0 : phase + 3'd1;
+
+            if (prod_valid) begin
+                parked <= 1'b0;
+                fold_active <= 1'b0;
+                fold_period <= 3'd0;
+            end
+
+            // Fold: take lane p in pass p-1, add it into lane 0 in pass p
+            if (fold_take)
+                hold <= feedback;
+            if (fold_start)
+                fold_active <= 1'b1;
+            if (draining && folding && !fold_done && phase == LANES - 1)
+                fold_period <= fold_period + 3'd1;
+
+            if (fold_done) begin
+                acc_out <= feedback;
+                acc_out_wide <= fp16_to_fp32(feedback);
+                parked <= 1'b1;
+                fold_active <= 1'b0;
+                fold_period <= 3'd0;
+            end
+        end
+    end
+
+endmodule
@@ -0,0 +1,60 @@
+// FP16 Multiplier, STAGES-deep pipeline
+// The approximate (or, with RUNTIME_PRECISION = 1, selectable) multiplier
+// followed by STAGES output registers. Synthesize with register retiming
+// (synth_design -retiming) so the tools spread the registers through the
+// mantissa product and normalization instead of leaving them at the end.
+// Latency: STAGES enabled cycles. Results are those of the combinational
+// multiplier.
+
+module fp16_pipelined_multiplier #(
+    parameter APPROX_BITS = 6,        // Mantissa bits (RUNTIME_PRECISION = 0)
+    parameter RUNTIME_PRECISION = 0,  // 1 = mult_bits selects the width
+    parameter STAGES = 2              // Pipeline registers (>= 1)
+)(
+    input wire clk,
+    input wire rst_n,
+    input wire enable,
+    input wire [15:0] a,          // FP16 input A
+    input wire [15:0] b,          // FP16 input B
+    input wire [3:0] mult_bits,   // used when RUNTIME_PRECISION = 1
+    output wire [15:0] result     // a * b, STAGES cycles later
+);
+
+    wire [15:0] product;
+
+    generate
+        if (RUNTIME_PRECISION) begin : gen_selectable
+            fp16_selectable_multiplier mult (
+                .a(a),
+                .b(b),
+                .mult_bits(mult_bits),
+                .result(product)
+            );
+        end else begin : gen_fixed
+            fp16_approximate_multiplier #(
+                .APPROX_BITS(APPROX_BITS)
+            ) mult (
+                .a(a),
+                .b(b),
+                .result(product)
+            );
+        end
+    endgenerate
+
+    reg [15:0] stage [0:STAGES-1];
+    integer s;
+
+    always @(posedge clk or negedge rst_n) begin
+        if (!rst_n) begin
+            for (s = 0; s < STAGES; s = s + 1)
+                stage[s] <= 16'h0000;
+        end else if (enable) begin
+            stage[0] <= product;
+            for (s = 1; s < STAGES; s = s + 1)
+                stage[s] <= stage[s-1];
+        end
+    end
+
+    assign result = stage[STAGES-1];
+
+endmodule
@@ -0,0 +1,73 @@
+// FP16 Adder with Runtime-Selectable Alignment Window
+// The smaller operand is aligned with 3 guard bits; when the exponents
+// differ by more than align_max it is dropped (align_max = 15 covers the
+// whole mantissa, i.e. exact truncating addition). No subnormals.
+// Bit model: ApproxFP16::add in drivers/tpu_approx.hpp
+
+module fp16_selectable_adder (
+    input wire [15:0] a,
+    input wire [15:0] b,
+    input wire [3:0] align_max,   // largest exponent difference still aligned
+    output reg [15:0] result
+);
+
+    // Extract fields
+    wire [4:0] exp_a = a[14:10];
+    wire [4:0] exp_b = b[14:10];
+
+    // Determine larger operand
+    wire a_larger = (a[14:0] >= b[14:0]);
+
+    wire [4:0] exp_large = a_larger ? exp_a : exp_b;
+    wire [4:0] exp_small = a_larger ? exp_b : exp_a;
+    wire [9:0] mant_large = a_larger ? a[9:0] : b[9:0];
+    wire [9:0] mant_small = a_larger ? b[9:0] : a[9:0];
+    wire sign_large = a_larger ? a[15] : b[15];
+    wire sign_small = a_larger ? b[15] : a[15];
+
+    // Implicit 1 plus 3 guard bits (exponent 0 is flushed to zero)
+    wire [13:0] mant_large_full = (exp_large == 0) ? 14'd0 : {1'b1, mant_large, 3'b000};
+    wire [13:0] mant_small_full = (exp_small == 0) ? 14'd0 : {1'b1, mant_small, 3'b000};
+
+    // Align inside the window
+    wire [4:0] exp_diff = exp_large - exp_small;
+    wire [13:0] mant_small_aligned = (exp_diff > {1'b0, align_max}) ? 14'd0 : (mant_small_full >> exp_diff);
+
+    // Add or subtract
+    wire [14:0] mant_sum = (sign_large == sign_small) ?
+                           ({1'b0, mant_large_full} + {1'b0, mant_small_aligned}) :
+                           ({1'b0, mant_large_full} - {1'b0, mant_small_aligned});
+
+    // Normalize
+    reg [3:0] lead_zeros;
+    reg [14:0] mant_norm;
+    reg [6:0] exp_result;
+    integer i;
+
+    always @(*) begin
+        lead_zeros = 4'd0;
+        for (i = 0; i <= 13; i = i + 1) begin
+            if (mant_sum[i]) lead_zeros = 13 - i;
+        end
+
+        if (mant_sum[14]) begin
+            mant_norm = mant_sum >> 1;
+            exp_result = {2'b00, exp_large} + 7'd1;
+        end else begin
+            mant_norm = mant_sum << lead_zeros;
+            exp_result = {2'b00, exp_large} - {3'b000, lead_zeros};
+        end
+
+        // Handle special cases
+        if (exp_large == 5'h1F) begin
+            result = {sign_large, 5'h1F, 10'd0};
+        end else if (mant_sum == 0 || exp_result[6] || exp_result == 0) begin
+            result = 16'h0000;
+        end else if (exp_result >= 7'd31) begin
+            result = {sign_large, 5'h1F, 10'd0};
+        end else begin
+            result = {sign_large, exp_result[4:0], mant_norm[12:3]};
+        end
+    end
+
+endmodule
@@ -0,0 +1,50 @@
+// FP16 Multiplier with Runtime-Selectable Precision
+// Full 11x11 mantissa multiplier; mult_bits selects how many mantissa MSBs
+// (including the implicit 1) of each operand take part, so one bitstream
+// serves both exact and approximate layers. Truncating, no subnormals.
+// Bit model: ApproxFP16::multiply in drivers/tpu_approx.hpp
+
+module fp16_selectable_multiplier (
+    input wire [15:0] a,          // FP16 input A
+    input wire [15:0] b,          // FP16 input B
+    input wire [3:0] mult_bits,   // 1-11 mantissa bits kept (0 or >11 = 11)
+    output reg [15:0] result      // FP16 result
+);
+
+    // Extract fields from FP16
+    wire sign_result = a[15] ^ b[15];
+    wire [4:0] exp_a = a[14:10];
+    wire [4:0] exp_b = b[14:10];
+
+    // Keep the top mult_bits bits of each 11-bit mantissa
+    wire [3:0] bits = (mult_bits == 4'd0 || mult_bits > 4'd11) ? 4'd11 : mult_bits;
+    wire [10:0] keep_mask = 11'h7FF << (4'd11 - bits);
+    wire [10:0] mant_a_full = {1'b1, a[9:0]} & keep_mask;
+    wire [10:0] mant_b_full = {1'b1, b[9:0]} & keep_mask;
+
+    wire [21:0] mant_prod = mant_a_full * mant_b_full;
+    wire normalize = mant_prod[21];
+
+    // Exponent with headroom for over/underflow
+    wire [6:0] exp_result = {2'b00, exp_a} + {2'b00, exp_b} - 7'd15 + {6'd0, normalize};
+
+    always @(*) begin
+        if (exp_a == 5'd0 || exp_b == 5'd0) begin
+            // Zero or subnormal
+            result = {sign_result, 15'd0};
+        end else if (exp_a == 5'h1F || exp_b == 5'h1F) begin
+            // Infinity or NaN
+            result = {sign_result, 5'h1F, 10'd0};
+        end else if (exp_result[6] || exp_result == 7'd0) begin
+            // Underflow
+            result = {sign_result, 15'd0};
+        end else if (exp_result >= 7'd31) begin
+            // Overflow
+            result = {sign_result, 5'h1F, 10'd0};
+        end else begin
+            result = {sign_result, exp_result[4:0],
+                      normalize ? mant_prod[20:11] : mant_prod[19:10]};
+        end
+    end
+
+endmodule
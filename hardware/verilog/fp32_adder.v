@@ -0,0 +1,75 @@
+// FP32 Adder
+// Wide accumulator adder for the FP32 accumulation mode of the MAC unit
+// Full alignment, truncating rounding, subnormals flushed to zero
+module fp32_adder (
+    input wire [31:0] a,
+    input wire [31:0] b,
+    output reg [31:0] result
+);
+
+    // Extract fields
+    wire sign_a = a[31];
+    wire sign_b = b[31];
+    wire [7:0] exp_a = a[30:23];
+    wire [7:0] exp_b = b[30:23];
+    wire [22:0] mant_a = a[22:0];
+    wire [22:0] mant_b = b[22:0];
+
+    // Determine larger operand
+    wire a_larger = (exp_a > exp_b) || ((exp_a == exp_b) && (mant_a >= mant_b));
+
+    // Select larger and smaller
+    wire [7:0] exp_large = a_larger ? exp_a : exp_b;
+    wire [7:0] exp_small = a_larger ? exp_b : exp_a;
+    wire [22:0] mant_large = a_larger ? mant_a : mant_b;
+    wire [22:0] mant_small = a_larger ? mant_b : mant_a;
+    wire sign_large = a_larger ? sign_a : sign_b;
+    wire sign_small = a_larger ? sign_b : sign_a;
+
+    // Implicit leading 1 plus 3 guard bits (exponent 0 is flushed to zero)
+    wire [26:0] mant_large_full = (exp_large == 0) ? 27'd0 : {1'b1, mant_large, 3'b000};
+    wire [26:0] mant_small_full = (exp_small == 0) ? 27'd0 : {1'b1, mant_small, 3'b000};
+
+    // Align smaller mantissa
+    wire [7:0] exp_diff = exp_large - exp_small;
+    wire [26:0] mant_small_aligned = (exp_diff > 8'd26) ? 27'd0 : (mant_small_full >> exp_diff);
+
+    // Add or subtract
+    wire [27:0] mant_sum = (sign_large == sign_small) ?
+                           ({1'b0, mant_large_full} + {1'b0, mant_small_aligned}) :
+                           ({1'b0, mant_large_full} - {1'b0, mant_small_aligned});
+
+    // Normalize
+    reg [4:0] lead_zeros;
+    reg [27:0] mant_norm;
+    reg [9:0] exp_result;   // signed headroom for over/underflow
+    integer i;
+
+    always @(*) begin
+        lead_zeros = 5'd0;
+        for (i = 0; i <= 26; i = i + 1) begin
+            if (mant_sum[i]) lead_zeros = 26 - i;
+        end
+
+        if (mant_sum[27]) begin
+            // Carry out, shift right
+            mant_norm = mant_sum >> 1;
+            exp_result = {2'b00, exp_large} + 10'd1;
+        end else begin
+            mant_norm = mant_sum << lead_zeros;
+            exp_result = {2'b00, exp_large} - {5'b00000, lead_zeros};
+        end
+
+        // Handle special cases
+        if (exp_large == 8'hFF) begin
+            result = {sign_large, 8'hFF, 23'd0};
+        end else if (mant_sum == 0 || exp_result[9] || exp_result == 0) begin
+            result = 32'h00000000;
+        end else if (exp_result >= 10'd255) begin
+            result = {sign_large, 8'hFF, 23'd0};
+        end else begin
+            result = {sign_large, exp_result[7:0], mant_norm[25:3]};
+        end
+    end
+
+endmodule
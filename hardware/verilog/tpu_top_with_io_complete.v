@@ -5,9 +5,24 @@
 // - UART, SPI, Button/Switch interfaces
 // - Complete matrix multiplication engine
 // - Activation function support
+// - Optional FP32 accumulators (ACC_FP32) with 32-bit result readback
+// - Optional runtime precision register (RUNTIME_PRECISION)
+// - On-device layer chaining: result -> activation copy through an activation unit
+// - Job queue (QUEUE_DEPTH entries) feeding the array, results in RESULT_SLOTS slots
+//   read back in any order (slot_ready bitmap)
+// - Result epilogue in the drain path: per-output bias, residual add, activation
+// - Optional pipelined MACs (MAC_MULT_STAGES / MAC_ADD_STAGES) for a higher clock
 // ============================================================================
 
-module tpu_top_with_io_complete (
+module tpu_top_with_io_complete #(
+    parameter ACC_FP32 = 0,          // FP32 accumulators: keeps long-K sums on device, costs area
+    parameter RUNTIME_PRECISION = 0, // full-width array narrowed per call by the precision register
+    parameter QUEUE_DEPTH = 4,       // queued jobs (power of two), 256 bytes of BRAM each
+    parameter RESULT_SLOTS = 16,     // result slots (power of two, 2-16), 128 bytes each
+    parameter MAC_MULT_STAGES = 1,   // >1: pipelined multipliers (fp16_pipelined_mac_unit.v)
+    parameter MAC_ADD_STAGES = 1,    // >1: pipelined adders, interleaved accumulators (1-4)
+    parameter UART_BAUD_RATE = 115200  // host link (testbenches raise it to shorten simulation)
+)(
     input wire clk,              // 100 MHz system clock
     input wire rst_n,            // Active-low reset
     
@@ -42,17 +57,35 @@ module tpu_top_with_io_complete (
     wire [15:0] mem_data_in;
     wire [15:0] mem_data_out;
     wire mem_we;
-    wire [1:0] mem_select;  // 00=matrix_a, 01=matrix_b, 10=result, 11=reserved
+    wire [1:0] mem_select;  // 00=matrix_a, 01=matrix_b, 10=result, 11=epilogue operands
+                            // result: mem_addr[7:6] = 10/11 reads FP32 result low/high half
+                            // epilogue: mem_addr[6] = 1 bias, 0 residual
     
     // Control signals
     wire tpu_start;
+    wire tpu_accumulate;  // start without clearing the accumulators
     wire tpu_reset;
     wire tpu_busy;
+    wire chain_start;         // copy result_mem into matrix_a_mem
+    wire [2:0] chain_activation;  // activation_functions type applied on the way
+    
+    // Array precision: [3:0] multiplier mantissa bits, [7:4] alignment window.
+    // Resets to the approximate default (6 bits, window 4).
+    reg [7:0] precision_reg;
+    wire [7:0] uart_precision_data;
+    wire uart_precision_we;
     wire tpu_done;
     
+    // Result epilogue: [0] add bias, [1] add residual, [4:2] activation type.
+    // Applied to the FP16 results of every run; resets to off.
+    reg [7:0] epilogue_reg;
+    wire [7:0] uart_epilogue_data;
+    wire uart_epilogue_we;
+    
     // Systolic array signals
     wire systolic_enable;
     wire systolic_start;
+    wire systolic_drain;
     
     // 8x8 systolic array outputs (individual wires)
     wire [15:0] acc_out_00, acc_out_01, acc_out_02, acc_out_03, acc_out_04, acc_out_05, acc_out_06, acc_out_07;
@@ -64,6 +97,9 @@ module tpu_top_with_io_complete (
     wire [15:0] acc_out_60, acc_out_61, acc_out_62, acc_out_63, acc_out_64, acc_out_65, acc_out_66, acc_out_67;
     wire [15:0] acc_out_70, acc_out_71, acc_out_72, acc_out_73, acc_out_74, acc_out_75, acc_out_76, acc_out_77;
     
+    // FP32 accumulator outputs, PE (row, col) at [(row*8+col)*32 +: 32]
+    wire [64*32-1:0] acc_out_wide_flat;
+    
     // Interface signals
     // Button/Switch interface
     wire [7:0] btn_mem_addr;
@@ -79,8 +115,15 @@ module tpu_top_with_io_complete (
     wire uart_mem_we;
     wire [1:0] uart_mem_sel;
     wire uart_tpu_start;
+    wire uart_tpu_accumulate;
     wire uart_tpu_reset;
+    wire uart_chain_start;
+    wire [2:0] uart_chain_activation;
     wire [7:0] uart_status_leds;
+    wire uart_job_we;
+    wire uart_job_push;
+    wire [7:0] uart_job_descriptor;
+    wire [3:0] uart_slot_select;
     
     // ========================================================================
     // Interface Mode Selection and Multiplexing
@@ -93,7 +136,10 @@ module tpu_top_with_io_complete (
     assign mem_we = interface_mode ? uart_mem_we : btn_mem_we;
     assign mem_select = interface_mode ? uart_mem_sel : btn_mem_sel;
     assign tpu_start = interface_mode ? uart_tpu_start : btn_tpu_start;
+    assign tpu_accumulate = interface_mode ? uart_tpu_accumulate : 1'b0;
     assign tpu_reset = interface_mode ? uart_tpu_reset : 1'b0;
+    assign chain_start = interface_mode ? uart_chain_start : 1'b0;
+    assign chain_activation = uart_chain_activation;
     
     // LED output multiplexing
     assign leds = interface_mode ? {uart_status_leds, 8'h00} : btn_leds;
@@ -108,6 +154,31 @@ module tpu_top_with_io_complete (
     reg [15:0] matrix_b_mem [0:63];
     // Result memory (8x8 = 64 FP16 values = 128 bytes)
     reg [15:0] result_mem [0:63];
+    // Wide result memory (8x8 = 64 FP32 accumulators = 256 bytes)
+    reg [31:0] result_wide_mem [0:63];
+    
+    // Epilogue operands: bias per result row (output feature), residual per element
+    reg [15:0] bias_mem [0:7];
+    reg [15:0] residual_mem [0:63];
+    
+    // Job queue: entry e holds matrix B words at [e*128 +: 64] and matrix A
+    // words at [e*128 + 64 +: 64]; descriptors as in uart_protocol_handler.v
+    localparam QUEUE_BITS = $clog2(QUEUE_DEPTH);
+    localparam SLOT_BITS = $clog2(RESULT_SLOTS);
+    reg [15:0] queue_mem [0:QUEUE_DEPTH*128-1];
+    reg [7:0] queue_desc [0:QUEUE_DEPTH-1];
+    reg [QUEUE_BITS-1:0] queue_head;
+    reg [QUEUE_BITS-1:0] queue_tail;
+    reg [QUEUE_BITS:0] queue_count;
+    reg [7:0] jobs_done;  // completed jobs, mod 256
+    // Result slots: slot s at [s*64 +: 64]. slot_ready[s] is set when a job
+    // stores into s and cleared when a new job for s is queued, so the host
+    // can collect completed slots in any order
+    reg [15:0] result_slot_mem [0:RESULT_SLOTS*64-1];
+    reg [15:0] slot_ready;
+    
+    wire queue_push = interface_mode && uart_job_push && (queue_count != QUEUE_DEPTH);
+    wire [7:0] queue_free = QUEUE_DEPTH - queue_count;
     
     // Note: Memory write logic is now integrated in FSM to avoid multiple drivers
     
@@ -117,13 +188,43 @@ module tpu_top_with_io_complete (
         case (mem_select)
             2'b00: mem_read_data = matrix_a_mem[mem_addr[5:0]];
             2'b01: mem_read_data = matrix_b_mem[mem_addr[5:0]];
-            2'b10: mem_read_data = result_mem[mem_addr[5:0]];
-            default: mem_read_data = 16'h0000;
+            2'b10: begin
+                case (mem_addr[7:6])
+                    2'b01: mem_read_data = result_slot_mem[{uart_slot_select[SLOT_BITS-1:0], mem_addr[5:0]}];
+                    2'b10: mem_read_data = result_wide_mem[mem_addr[5:0]][15:0];
+                    2'b11: mem_read_data = result_wide_mem[mem_addr[5:0]][31:16];
+                    default: mem_read_data = result_mem[mem_addr[5:0]];
+                endcase
+            end
+            default: mem_read_data = mem_addr[6] ? bias_mem[mem_addr[2:0]] : residual_mem[mem_addr[5:0]];
         endcase
     end
     
     assign mem_data_out = mem_read_data;
     
+    // Job payload lands in the tail entry before the push
+    always @(posedge clk) begin
+        if (interface_mode && uart_job_we) begin
+            queue_mem[{queue_tail, uart_mem_addr[6:0]}] <= uart_mem_dout;
+        end
+    end
+    
+    always @(posedge clk or negedge rst_n) begin
+        if (!rst_n) begin
+            precision_reg <= 8'h46;
+        end else if (interface_mode && uart_precision_we) begin
+            precision_reg <= uart_precision_data;
+        end
+    end
+    
+    always @(posedge clk or negedge rst_n) begin
+        if (!rst_n) begin
+            epilogue_reg <= 8'h00;
+        end else if (interface_mode && uart_epilogue_we) begin
+            epilogue_reg <= uart_epilogue_data;
+        end
+    end
+    
     // ========================================================================
     // TPU Controller FSM
     // ========================================================================
@@ -132,6 +233,11 @@ module tpu_top_with_io_complete (
     reg [3:0] row_counter;
     reg [3:0] col_counter;
     reg [6:0] compute_counter;
+    reg accumulate_run;  // Current run adds onto the previous accumulators
+    reg [2:0] chain_act;  // Activation of the current chain copy
+    reg [7:0] job_desc;   // Descriptor of the running queued job
+    reg job_active;       // Current run came from the queue
+    wire [15:0] chain_out;  // Activated result_mem[compute_counter - 1]
     
     localparam IDLE = 4'd0;
     localparam LOAD_ROW = 4'd1;
@@ -140,9 +246,26 @@ module tpu_top_with_io_complete (
     localparam APPLY_ACTIVATION = 4'd4;
     localparam STORE_RESULT = 4'd5;
     localparam DONE = 4'd6;
+    localparam CHAIN_COPY = 4'd7;
+    localparam JOB_LOAD = 4'd8;
+    localparam JOB_STORE = 4'd9;
+    localparam EPILOGUE = 4'd10;
+    
+    wire epilogue_on = (epilogue_reg[4:0] != 5'd0);
+    
+    wire job_retire = (state == JOB_STORE) && (compute_counter == 7'd63);
+    
+    // COMPUTE streams for 31 cycles; pipelined PEs then drain their lanes
+    // (DRAIN_CYCLES of fp16_approx_systolic_array.v, TimingModel in tpu_timing.hpp)
+    localparam MAC_PIPELINED = (MAC_MULT_STAGES > 1 || MAC_ADD_STAGES > 1) && !ACC_FP32;
+    localparam MAC_DRAIN_CYCLES = MAC_PIPELINED ?
+        MAC_MULT_STAGES + MAC_ADD_STAGES * (MAC_ADD_STAGES + 1) : 0;
+    localparam COMPUTE_LAST = 30 + MAC_DRAIN_CYCLES;
     
     assign systolic_enable = (state == COMPUTE);
-    assign systolic_start = (state == LOAD_ROW);
+    // Clear accumulators on the first compute cycle unless accumulating
+    assign systolic_start = (state == COMPUTE) && (compute_counter == 0) && !accumulate_run;
+    assign systolic_drain = (state == COMPUTE) && (compute_counter > 30);
     assign tpu_busy = (state != IDLE) && (state != DONE);
     assign tpu_done = (state == DONE);
     
@@ -158,6 +281,15 @@ module tpu_top_with_io_complete (
             col_counter <= 0;
             compute_counter <= 0;
             computing <= 1'b0;
+            accumulate_run <= 1'b0;
+            chain_act <= 3'd0;
+            job_desc <= 8'h00;
+            job_active <= 1'b0;
+            queue_head <= 0;
+            queue_tail <= 0;
+            queue_count <= 0;
+            jobs_done <= 8'h00;
+            slot_ready <= 16'h0000;
         end else begin
             case (state)
                 IDLE: begin
@@ -167,7 +299,10 @@ module tpu_top_with_io_complete (
                             2'b00: matrix_a_mem[mem_addr[5:0]] <= mem_data_in;
                             2'b01: matrix_b_mem[mem_addr[5:0]] <= mem_data_in;
                             2'b10: result_mem[mem_addr[5:0]] <= mem_data_in;
-                            default: ;
+                            default: begin
+                                if (mem_addr[6]) bias_mem[mem_addr[2:0]] <= mem_data_in;
+                                else residual_mem[mem_addr[5:0]] <= mem_data_in;
+                            end
                         endcase
                     end
                     
@@ -175,6 +310,70 @@ module tpu_top_with_io_complete (
                         state <= COMPUTE;
                         compute_counter <= 0;
                         computing <= 1'b1;
+                        accumulate_run <= tpu_accumulate;
+                    end else if (chain_start) begin
+                        state <= CHAIN_COPY;
+                        compute_counter <= 0;
+                        chain_act <= chain_activation;
+                    end else if (queue_count != 0 && !computing) begin
+                        state <= JOB_LOAD;
+                        compute_counter <= 0;
+                        computing <= 1'b1;
+                        job_desc <= queue_desc[queue_head];
+                    end
+                end
+                
+                JOB_LOAD: begin
+                    // Copy the entry's operands into the array memories, one word per cycle
+                    if (job_desc[0]) matrix_b_mem[compute_counter[5:0]] <= queue_mem[{queue_head, 1'b0, compute_counter[5:0]}];
+                    if (job_desc[1]) matrix_a_mem[compute_counter[5:0]] <= queue_mem[{queue_head, 1'b1, compute_counter[5:0]}];
+                    compute_counter <= compute_counter + 1;
+                    if (compute_counter == 7'd63) begin
+                        state <= COMPUTE;
+                        compute_counter <= 0;
+                        accumulate_run <= job_desc[2];
+                        job_active <= 1'b1;
+                    end
+                end
+                
+                JOB_STORE: begin
+                    // Park the result in the job's slot and retire the entry
+                    result_slot_mem[{job_desc[4 +: SLOT_BITS], compute_counter[5:0]}] <= result_mem[compute_counter[5:0]];
+                    compute_counter <= compute_counter + 1;
+                    if (job_retire) begin
+                        queue_head <= queue_head + 1;
+                        jobs_done <= jobs_done + 1;
+                        job_active <= 1'b0;
+                        computing <= 1'b0;
+                        compute_counter <= 0;
+                        state <= IDLE;
+                    end
+                end
+                
+                CHAIN_COPY: begin
+                    // One element per cycle: result_mem[n] enters the
+                    // activation unit at count n and lands in matrix_a_mem[n]
+                    // one cycle later (65 cycles, far below one UART byte)
+                    compute_counter <= compute_counter + 1;
+                    if (compute_counter != 0) begin
+                        matrix_a_mem[compute_counter - 1] <= chain_out;
+                    end
+                    if (compute_counter == 7'd64) begin
+                        state <= IDLE;
+                        compute_counter <= 0;
+                    end
+                end
+                
+                EPILOGUE: begin
+                    // Same pipeline as CHAIN_COPY: result_mem[n] goes through
+                    // the adders and activation unit and is written back at n + 1
+                    compute_counter <= compute_counter + 1;
+                    if (compute_counter != 0) begin
+                        result_mem[compute_counter - 1] <= epilogue_out;
+                    end
+                    if (compute_counter == 7'd64) begin
+                        state <= job_active ? JOB_STORE : DONE;
+                        compute_counter <= 0;
                     end
                 end
                 
@@ -182,7 +381,7 @@ module tpu_top_with_io_complete (
                     // Wait for systolic array computation
                     // FP16 MACs need ~10 cycles to stabilize
                     compute_counter <= compute_counter + 1;
-                    if (compute_counter >= 30) begin
+                    if (compute_counter >= COMPUTE_LAST) begin
                         state <= APPLY_ACTIVATION;
                         row_counter <= 0;
                     end
@@ -234,7 +433,16 @@ module tpu_top_with_io_complete (
                     endcase
                     
                     if (row_counter < 8) begin
+                        for (j = 0; j < 8; j = j + 1) begin
+                            result_wide_mem[row_counter*8 + j] <= acc_out_wide_flat[(row_counter*8 + j)*32 +: 32];
+                        end
                         row_counter <= row_counter + 1;
+                    end else if (epilogue_on) begin
+                        state <= EPILOGUE;
+                        compute_counter <= 0;
+                    end else if (job_active) begin
+                        state <= JOB_STORE;
+                        compute_counter <= 0;
                     end else begin
                         state <= DONE;
                     end
@@ -249,7 +457,10 @@ module tpu_top_with_io_complete (
                             2'b00: matrix_a_mem[mem_addr[5:0]] <= mem_data_in;
                             2'b01: matrix_b_mem[mem_addr[5:0]] <= mem_data_in;
                             2'b10: result_mem[mem_addr[5:0]] <= mem_data_in;
-                            default: ;
+                            default: begin
+                                if (mem_addr[6]) bias_mem[mem_addr[2:0]] <= mem_data_in;
+                                else residual_mem[mem_addr[5:0]] <= mem_data_in;
+                            end
                         endcase
                     end
                     
@@ -263,6 +474,18 @@ module tpu_top_with_io_complete (
                 
                 default: state <= IDLE;
             endcase
+            
+            // Job queue bookkeeping: push from the UART handler, pop on retire
+            if (queue_push) begin
+                queue_desc[queue_tail] <= uart_job_descriptor;
+                queue_tail <= queue_tail + 1;
+            end
+            queue_count <= queue_count + queue_push - job_retire;
+            
+            // A job queued for a slot hides the slot's older result
+            // (the later assignment wins when both hit the same slot)
+            if (job_retire) slot_ready[job_desc[4 +: SLOT_BITS]] <= 1'b1;
+            if (queue_push) slot_ready[uart_job_descriptor[4 +: SLOT_BITS]] <= 1'b0;
         end
     end
     
@@ -271,12 +494,18 @@ module tpu_top_with_io_complete (
     // ========================================================================
     
     fp16_approx_systolic_array #(
-        .SIZE(8)
+        .SIZE(8),
+        .ACC_FP32(ACC_FP32),
+        .RUNTIME_PRECISION(RUNTIME_PRECISION),
+        .MULT_STAGES(MAC_MULT_STAGES),
+        .ADD_STAGES(MAC_ADD_STAGES)
     ) systolic_array (
         .clk(clk),
         .rst_n(rst_n),
         .enable(systolic_enable),
         .acc_clear(systolic_start),
+        .drain(systolic_drain),
+        .precision(precision_reg),
         
         // Connect activations (row inputs) from Matrix A
         .a_in_0(matrix_a_mem[0]),
@@ -314,11 +543,66 @@ module tpu_top_with_io_complete (
         .acc_out_60(acc_out_60), .acc_out_61(acc_out_61), .acc_out_62(acc_out_62), .acc_out_63(acc_out_63),
         .acc_out_64(acc_out_64), .acc_out_65(acc_out_65), .acc_out_66(acc_out_66), .acc_out_67(acc_out_67),
         .acc_out_70(acc_out_70), .acc_out_71(acc_out_71), .acc_out_72(acc_out_72), .acc_out_73(acc_out_73),
-        .acc_out_74(acc_out_74), .acc_out_75(acc_out_75), .acc_out_76(acc_out_76), .acc_out_77(acc_out_77)
+        .acc_out_74(acc_out_74), .acc_out_75(acc_out_75), .acc_out_76(acc_out_76), .acc_out_77(acc_out_77),
+        .acc_out_wide_flat(acc_out_wide_flat)
+    );
+    
+    // Results go from the array to result memory; activations are applied
+    // by the epilogue (drain path) and the chain copy below
+    
+    // ========================================================================
+    // Layer Chaining: result -> activation copy
+    // ========================================================================
+    
+    activation_functions #(
+        .DATA_WIDTH(16),
+        .IS_FLOATING_POINT(1)
+    ) chain_activation_unit (
+        .clk(clk),
+        .rst_n(rst_n),
+        .enable(state == CHAIN_COPY),
+        .activation_type(chain_act),
+        .data_in(result_mem[compute_counter[5:0]]),
+        .data_out(chain_out)
     );
     
-    // Note: Activation functions can be added here if needed
-    // For now, results go directly from systolic array to result memory
+    // ========================================================================
+    // Result epilogue: act(result + bias[row] + residual), one element per cycle
+    // ========================================================================
+    
+    wire [5:0] epi_index = compute_counter[5:0];
+    wire [15:0] epi_bias_sum;
+    wire [15:0] epi_residual_sum;
+    wire [15:0] epi_biased = epilogue_reg[0] ? epi_bias_sum : result_mem[epi_index];
+    wire [15:0] epi_sum = epilogue_reg[1] ? epi_residual_sum : epi_biased;
+    wire [15:0] epilogue_out;
+    
+    // align_max = 15: full alignment, independent of the array precision
+    fp16_selectable_adder epilogue_bias_adder (
+        .a(result_mem[epi_index]),
+        .b(bias_mem[epi_index[5:3]]),
+        .align_max(4'hF),
+        .result(epi_bias_sum)
+    );
+    
+    fp16_selectable_adder epilogue_residual_adder (
+        .a(epi_biased),
+        .b(residual_mem[epi_index]),
+        .align_max(4'hF),
+        .result(epi_residual_sum)
+    );
+    
+    activation_functions #(
+        .DATA_WIDTH(16),
+        .IS_FLOATING_POINT(1)
+    ) epilogue_activation_unit (
+        .clk(clk),
+        .rst_n(rst_n),
+        .enable(state == EPILOGUE),
+        .activation_type(epilogue_reg[4:2]),
+        .data_in(epi_sum),
+        .data_out(epilogue_out)
+    );
     
     // ========================================================================
     // Interface Modules
@@ -339,9 +623,14 @@ module tpu_top_with_io_complete (
     // UART Protocol Handler
     // ========================================================================
     
+    // The controller only takes host writes, starts and chaining in IDLE/DONE
+    // with no job pending; the handler NACKs them otherwise instead of
+    // acknowledging a write that would be dropped
+    wire queue_busy = (queue_count != 0) || computing;
+    
     uart_protocol_handler #(
         .CLK_FREQ(100_000_000),
-        .BAUD_RATE(115200)
+        .BAUD_RATE(UART_BAUD_RATE)
     ) uart_protocol (
         .clk(clk),
         .rst_n(rst_n),
@@ -359,7 +648,22 @@ module tpu_top_with_io_complete (
         
         // TPU control
         .tpu_start(uart_tpu_start),
+        .tpu_accumulate(uart_tpu_accumulate),
         .tpu_reset(uart_tpu_reset),
+        .precision_data(uart_precision_data),
+        .precision_we(uart_precision_we),
+        .epilogue_data(uart_epilogue_data),
+        .epilogue_we(uart_epilogue_we),
+        .chain_start(uart_chain_start),
+        .chain_activation(uart_chain_activation),
+        .job_we(uart_job_we),
+        .job_push(uart_job_push),
+        .job_descriptor(uart_job_descriptor),
+        .slot_select(uart_slot_select),
+        .queue_free(queue_free),
+        .jobs_done(jobs_done),
+        .slot_ready(slot_ready),
+        .queue_busy(queue_busy),
         .tpu_busy(tpu_busy),
         .tpu_done(tpu_done),
         
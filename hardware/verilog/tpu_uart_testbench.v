@@ -0,0 +1,719 @@
+`timescale 1ns / 1ps
+
+// Testbench for tpu_top_with_io_complete over the UART protocol
+// Drives framed commands into uart_rx the way the host driver does and
+// checks the bytes coming back on uart_tx (uart_protocol_handler.v).
+// The array inputs are wired to the first column / row of the operand
+// memories, so the tests use operands whose results are known exactly
+// (zero runs) or compare two readbacks of the same run. ACC_FP32 = 1 so
+// the wide readback returns FP32 accumulators.
+
+module tpu_uart_testbench;
+
+    // Parameters
+    parameter CLK_PERIOD = 10;                  // 100 MHz
+    parameter BAUD_RATE = 6_250_000;            // 16 clocks per bit
+
+    // uart_rx / uart_tx count 0..CLKS_PER_BIT: a bit lasts one clock more
+    localparam CLKS_PER_BIT = 100_000_000 / BAUD_RATE;
+    localparam BIT_TIME = (CLKS_PER_BIT + 1) * CLK_PERIOD;
+
+    // Protocol (uart_protocol_handler.v)
+    localparam CMD_WRITE_MATRIX_A = 8'h01;
+    localparam CMD_WRITE_MATRIX_B = 8'h02;
+    localparam CMD_READ_RESULT    = 8'h03;
+    localparam CMD_START_COMPUTE  = 8'h04;
+    localparam CMD_GET_STATUS     = 8'h05;
+    localparam CMD_READ_MATRIX_A  = 8'h07;
+    localparam CMD_WRITE_ELEMENTS = 8'h0A;
+    localparam CMD_WRITE_RANGE    = 8'h0B;
+    localparam CMD_READ_RESULT_WIDE = 8'h0C;
+    localparam CMD_START_ACCUMULATE = 8'h0D;
+    localparam CMD_SET_PRECISION  = 8'h0E;
+    localparam CMD_CHAIN_RESULT   = 8'h0F;
+    localparam CMD_ENQUEUE_JOB    = 8'h10;
+    localparam CMD_QUEUE_STATUS   = 8'h11;
+    localparam CMD_READ_SLOT      = 8'h12;
+    localparam CMD_SLOT_STATUS    = 8'h13;
+    localparam CMD_SET_EPILOGUE   = 8'h14;
+    localparam CMD_CHECKSUM       = 8'h15;
+    localparam RESP_ACK  = 8'hAA;
+    localparam RESP_NACK = 8'h55;
+
+    // Testbench signals
+    reg clk;
+    reg rst_n;
+    reg uart_rx;
+    reg [7:0] switches;
+    wire uart_tx;
+    wire [15:0] leds;
+
+    // Operand words sent and result words received by the tasks below
+    reg [15:0] tx_words [0:63];
+    reg [15:0] rx_words [0:63];
+    reg [31:0] rx_wide [0:63];
+    reg [15:0] words_prev [0:63];
+    reg [31:0] wide_prev [0:63];
+
+    // Bytes decoded from uart_tx, in arrival order
+    reg [7:0] rx_fifo [0:1023];
+    integer rx_head;
+    integer rx_tail;
+
+    integer i;
+    integer checks;
+    integer errors;
+    reg ok;
+    reg fine;
+    reg [15:0] word;
+
+    // Clock generation
+    initial begin
+        clk = 0;
+        forever #(CLK_PERIOD/2) clk = ~clk;
+    end
+
+    // DUT instantiation
+    tpu_top_with_io_complete #(
+        .ACC_FP32(1),
+        .RUNTIME_PRECISION(1),
+        .UART_BAUD_RATE(BAUD_RATE)
+    ) dut (
+        .clk(clk),
+        .rst_n(rst_n),
+        .uart_rx(uart_rx),
+        .uart_tx(uart_tx),
+        .switches(switches),
+        .btn_up(1'b0),
+        .btn_down(1'b0),
+        .leds(leds)
+    );
+
+    // Host receiver: decode every byte the device sends
+    reg [7:0] rx_byte;
+    integer rb;
+    initial begin
+        rx_tail = 0;
+        forever begin
+            @(negedge uart_tx);
+            #(BIT_TIME + BIT_TIME/2);
+            for (rb = 0; rb < 8; rb = rb + 1) begin
+                rx_byte[rb] = uart_tx;
+                #(BIT_TIME);
+            end
+            rx_fifo[rx_tail % 1024] = rx_byte;
+            rx_tail = rx_tail + 1;
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Host tasks
+    // ------------------------------------------------------------------
+
+    task uart_send;
+        input [7:0] data;
+        integer b;
+        begin
+            uart_rx = 1'b0;
+            #(BIT_TIME);
+            for (b = 0; b < 8; b = b + 1) begin
+                uart_rx = data[b];
+                #(BIT_TIME);
+            end
+            uart_rx = 1'b1;
+            #(BIT_TIME);
+        end
+    endtask
+
+    task uart_recv;
+        output [7:0] data;
+        begin
+            wait (rx_head != rx_tail);
+            data = rx_fifo[rx_head % 1024];
+            rx_head = rx_head + 1;
+        end
+    endtask
+
+    task check;
+        input cond;
+        input [8*56-1:0] what;
+        begin
+            checks = checks + 1;
+            if (cond) begin
+                $display("  PASS: %0s", what);
+            end else begin
+                errors = errors + 1;
+                $display("  FAIL: %0s", what);
+            end
+        end
+    endtask
+
+    task expect_byte;
+        input [7:0] expected;
+        input [8*56-1:0] what;
+        reg [7:0] got;
+        begin
+            uart_recv(got);
+            if (got !== expected) begin
+                errors = errors + 1;
+                $display("  FAIL: %0s: got %h, expected %h", what, got, expected);
+            end
+        end
+    endtask
+
+    // Command with a one-byte argument answered by ACK (precision,
+    // epilogue, chain)
+    task set_register;
+        input [7:0] cmd;
+        input [7:0] value;
+        begin
+            uart_send(cmd);
+            uart_send(value);
+            expect_byte(RESP_ACK, "register write acknowledged");
+        end
+    endtask
+
+    // WRITE_MATRIX_A / _B of tx_words
+    task write_matrix;
+        input [7:0] cmd;
+        begin
+            uart_send(cmd);
+            expect_byte(RESP_ACK, "matrix write acknowledged");
+            for (i = 0; i < 64; i = i + 1) begin
+                uart_send(tx_words[i][7:0]);
+                uart_send(tx_words[i][15:8]);
+            end
+        end
+    endtask
+
+    // WRITE_RANGE of tx_words[0 +: count] to buffer words [offset +: count]
+    // (buffer 0 = matrix A, 1 = matrix B, 2 = residual, 3 = bias)
+    task write_range;
+        input [7:0] buffer;
+        input [7:0] offset;
+        input [7:0] count;
+        begin
+            uart_send(CMD_WRITE_RANGE);
+            uart_send(buffer);
+            uart_send(offset);
+            uart_send(count);
+            expect_byte(RESP_ACK, "range write acknowledged");
+            for (i = 0; i < count; i = i + 1) begin
+                uart_send(tx_words[i][7:0]);
+                uart_send(tx_words[i][15:8]);
+            end
+        end
+    endtask
+
+    // READ_RESULT / READ_MATRIX_A / _B into rx_words
+    task read_words;
+        input [7:0] cmd;
+        reg [7:0] lo;
+        reg [7:0] hi;
+        begin
+            uart_send(cmd);
+            expect_byte(RESP_ACK, "readback acknowledged");
+            for (i = 0; i < 64; i = i + 1) begin
+                uart_recv(lo);
+                uart_recv(hi);
+                rx_words[i] = {hi, lo};
+            end
+        end
+    endtask
+
+    // READ_SLOT of one result slot into rx_words
+    task read_slot;
+        input [7:0] slot;
+        reg [7:0] lo;
+        reg [7:0] hi;
+        begin
+            uart_send(CMD_READ_SLOT);
+            uart_send(slot);
+            expect_byte(RESP_ACK, "slot readback acknowledged");
+            for (i = 0; i < 64; i = i + 1) begin
+                uart_recv(lo);
+                uart_recv(hi);
+                rx_words[i] = {hi, lo};
+            end
+        end
+    endtask
+
+    // CHECKSUM of a buffer (0 = A, 1 = B, 2 = result, 0x10 | slot) as {sum b, sum a}
+    task read_checksum;
+        input [7:0] buffer;
+        output [31:0] sums;
+        reg [7:0] b0, b1, b2, b3;
+        begin
+            uart_send(CMD_CHECKSUM);
+            uart_send(buffer);
+            expect_byte(RESP_ACK, "checksum acknowledged");
+            uart_recv(b0);
+            uart_recv(b1);
+            uart_recv(b2);
+            uart_recv(b3);
+            sums = {b3, b2, b1, b0};
+        end
+    endtask
+
+    // The same sums over rx_words (a += word, b += a, both mod 2^16)
+    function [31:0] fletcher_rx;
+        input dummy;
+        reg [15:0] a;
+        reg [15:0] b;
+        integer k;
+        begin
+            a = 0;
+            b = 0;
+            for (k = 0; k < 64; k = k + 1) begin
+                a = a + rx_words[k];
+                b = b + a;
+            end
+            fletcher_rx = {b, a};
+        end
+    endfunction
+
+    // ENQUEUE_JOB; the payload is the operands the descriptor loads,
+    // matrix B words first (bit 0), then matrix A words (bit 1)
+    task enqueue_job;
+        input [7:0] descriptor;
+        input [15:0] b_word;
+        input [15:0] a_word;
+        begin
+            uart_send(CMD_ENQUEUE_JOB);
+            uart_send(descriptor);
+            expect_byte(RESP_ACK, "job accepted");
+            if (descriptor[0]) begin
+                for (i = 0; i < 64; i = i + 1) begin
+                    uart_send(b_word[7:0]);
+                    uart_send(b_word[15:8]);
+                end
+            end
+            if (descriptor[1]) begin
+                for (i = 0; i < 64; i = i + 1) begin
+                    uart_send(a_word[7:0]);
+                    uart_send(a_word[15:8]);
+                end
+            end
+        end
+    endtask
+
+    // Poll QUEUE_STATUS until every entry is free; returns the completed count
+    task wait_queue;
+        output [7:0] done;
+        integer tries;
+        reg [7:0] free;
+        begin
+            free = 8'h00;
+            tries = 0;
+            while (free != 8'd4 && tries < 100) begin
+                uart_send(CMD_QUEUE_STATUS);
+                expect_byte(RESP_ACK, "queue status acknowledged");
+                uart_recv(free);
+                uart_recv(done);
+                tries = tries + 1;
+            end
+        end
+    endtask
+
+    // SLOT_STATUS: ready bitmap of the 16 result slots
+    task slot_status;
+        output [15:0] ready;
+        reg [7:0] lo;
+        reg [7:0] hi;
+        begin
+            uart_send(CMD_SLOT_STATUS);
+            expect_byte(RESP_ACK, "slot status acknowledged");
+            uart_recv(lo);
+            uart_recv(hi);
+            ready = {hi, lo};
+        end
+    endtask
+
+    // READ_RESULT_WIDE into rx_wide (4 bytes per result, little-endian)
+    task read_wide;
+        reg [7:0] b0;
+        reg [7:0] b1;
+        reg [7:0] b2;
+        reg [7:0] b3;
+        begin
+            uart_send(CMD_READ_RESULT_WIDE);
+            expect_byte(RESP_ACK, "wide readback acknowledged");
+            for (i = 0; i < 64; i = i + 1) begin
+                uart_recv(b0);
+                uart_recv(b1);
+                uart_recv(b2);
+                uart_recv(b3);
+                rx_wide[i] = {b3, b2, b1, b0};
+            end
+        end
+    endtask
+
+    // Poll GET_STATUS until the run is over (busy bit clear)
+    task wait_idle;
+        integer tries;
+        reg [7:0] status;
+        reg [7:0] pad;
+        begin
+            status = 8'h01;
+            tries = 0;
+            while (status[0] && tries < 100) begin
+                uart_send(CMD_GET_STATUS);
+                expect_byte(RESP_ACK, "status acknowledged");
+                uart_recv(status);
+                uart_recv(pad);
+                uart_recv(pad);
+                uart_recv(pad);
+                tries = tries + 1;
+            end
+            if (status[0]) begin
+                errors = errors + 1;
+                $display("  FAIL: run did not finish");
+            end
+        end
+    endtask
+
+    task run;
+        input [7:0] cmd;
+        begin
+            uart_send(cmd);
+            expect_byte(RESP_ACK, "start acknowledged");
+            wait_idle;
+        end
+    endtask
+
+    // Small integers in FP16
+    function [15:0] fp16_int;
+        input integer n;
+        integer mag;
+        integer e;
+        integer mant;
+        reg [4:0] exp_field;
+        begin
+            if (n == 0) begin
+                fp16_int = 16'h0000;
+            end else begin
+                mag = (n < 0) ? -n : n;
+                e = 0;
+                while ((mag >> (e + 1)) != 0) e = e + 1;
+                mant = (mag << (10 - e)) & 32'h3FF;
+                exp_field = e + 15;
+                fp16_int = {(n < 0) ? 1'b1 : 1'b0, exp_field, mant[9:0]};
+            end
+        end
+    endfunction
+
+    // FP32 -> FP16 as the ACC_FP32 PEs narrow acc_out (truncating)
+    function [15:0] fp32_to_fp16;
+        input [31:0] f;
+        begin
+            if (f[30:23] == 8'hFF || f[30:23] > 8'd142)
+                fp32_to_fp16 = {f[31], 5'h1F, (f[30:23] == 8'hFF) ? f[22:13] : 10'd0};
+            else if (f[30:23] < 8'd113)
+                fp32_to_fp16 = {f[31], 15'd0};
+            else
+                fp32_to_fp16 = {f[31], f[27:23] - 5'd16, f[22:13]};
+        end
+    endfunction
+
+    // ------------------------------------------------------------------
+    // Tests
+    // ------------------------------------------------------------------
+
+    // GET_STATUS straight after a payload: byte_count is left at 128 by the
+    // transfer and must not strand the handler in SEND_STATUS
+    task test_status_after_payload;
+        begin
+            $display("\n--- GET_STATUS after WRITE_MATRIX / READ_RESULT ---");
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = 16'h0000;
+            write_matrix(CMD_WRITE_MATRIX_A);
+            wait_idle;
+            read_words(CMD_READ_RESULT);
+            wait_idle;
+            // Back in IDLE: the next command is decoded
+            set_register(CMD_SET_PRECISION, 8'hFB);
+        end
+    endtask
+
+    // Epilogue in the drain path (EPILOGUE state): a zero run leaves
+    // act(bias[row] + residual) in the result memory
+    task test_epilogue;
+        begin
+            $display("\n--- Result epilogue (SET_EPILOGUE, WRITE_RANGE bias/residual) ---");
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = 16'h0000;
+            write_matrix(CMD_WRITE_MATRIX_A);
+            write_matrix(CMD_WRITE_MATRIX_B);
+
+            for (i = 0; i < 8; i = i + 1) tx_words[i] = fp16_int(i);
+            write_range(8'd3, 8'd0, 8'd8);                       // bias[row] = row
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = fp16_int(i % 8 - 4);
+            write_range(8'd2, 8'd0, 8'd64);                      // residual = col - 4
+
+            // Bias + residual + ReLU
+            set_register(CMD_SET_EPILOGUE, {3'b000, 3'd1, 2'b11});
+            run(CMD_START_COMPUTE);
+            read_words(CMD_READ_RESULT);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== fp16_int((i / 8 + i % 8 - 4 > 0) ? i / 8 + i % 8 - 4 : 0)) ok = 0;
+            end
+            check(ok, "relu(0 + bias + residual)");
+
+            // Residual only, no activation: negative sums pass through
+            set_register(CMD_SET_EPILOGUE, {3'b000, 3'd0, 2'b10});
+            run(CMD_START_COMPUTE);
+            read_words(CMD_READ_RESULT);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== fp16_int(i % 8 - 4)) ok = 0;
+            end
+            check(ok, "0 + residual without activation");
+
+            // Disabled epilogue leaves the array results alone
+            set_register(CMD_SET_EPILOGUE, 8'h00);
+            run(CMD_START_COMPUTE);
+            read_words(CMD_READ_RESULT);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== 16'h0000) ok = 0;
+            end
+            check(ok, "Disabled epilogue stores the raw results");
+        end
+    endtask
+
+    // FP32 accumulators: products of 1 + 2^-10 sum to values FP16 cannot
+    // hold; the FP16 result must be the wide value narrowed
+    task test_wide_readback;
+        begin
+            $display("\n--- FP32 accumulators (READ_RESULT_WIDE, START_ACCUMULATE) ---");
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = 16'h3C00;
+            write_matrix(CMD_WRITE_MATRIX_A);
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = 16'h3C01;
+            write_matrix(CMD_WRITE_MATRIX_B);
+
+            run(CMD_START_COMPUTE);
+            read_words(CMD_READ_RESULT);
+            read_wide;
+            ok = 1;
+            fine = 0;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_wide[i] == 32'h0 || rx_wide[i][31] || fp32_to_fp16(rx_wide[i]) !== rx_words[i]) ok = 0;
+                if (rx_wide[i][12:0] != 13'h0) fine = 1;
+                wide_prev[i] = rx_wide[i];
+            end
+            check(ok, "FP16 result is the FP32 accumulator narrowed");
+            check(fine, "FP32 accumulators keep bits FP16 drops");
+
+            // Positive FP32 values order like their bit patterns
+            run(CMD_START_ACCUMULATE);
+            read_wide;
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_wide[i] <= wide_prev[i] || rx_wide[i][31]) ok = 0;
+            end
+            check(ok, "Accumulate start adds onto the previous run");
+        end
+    endtask
+
+    // Layer chaining (CHAIN_COPY state): the result memory is copied into
+    // matrix A through the activation unit and is itself left unchanged
+    task test_chain;
+        begin
+            $display("\n--- Layer chaining (CHAIN_RESULT) ---");
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = 16'h3C00;
+            write_matrix(CMD_WRITE_MATRIX_A);
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = 16'hBC00;   // -1.0
+            write_matrix(CMD_WRITE_MATRIX_B);
+
+            run(CMD_START_COMPUTE);
+            read_words(CMD_READ_RESULT);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (!rx_words[i][15] || rx_words[i][14:0] == 15'h0) ok = 0;
+                words_prev[i] = rx_words[i];
+            end
+            check(ok, "Run leaves negative results");
+
+            // Plain copy (activation 0 = none)
+            set_register(CMD_CHAIN_RESULT, 8'd0);
+            read_words(CMD_READ_MATRIX_A);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== words_prev[i]) ok = 0;
+            end
+            check(ok, "Plain copy puts every result in matrix A");
+
+            // ReLU copy of the same results
+            set_register(CMD_CHAIN_RESULT, 8'd1);
+            read_words(CMD_READ_MATRIX_A);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== 16'h0000) ok = 0;
+            end
+            check(ok, "ReLU applied on the way into matrix A");
+
+            read_words(CMD_READ_RESULT);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== words_prev[i]) ok = 0;
+            end
+            check(ok, "Chaining leaves the result memory alone");
+        end
+    endtask
+
+    // Job queue and result slots: jobs for slots 5 and 9 run through the
+    // epilogue into their slots, which are collected out of order
+    task test_queue;
+        reg [7:0] done;
+        reg [15:0] ready;
+        begin
+            $display("\n--- Job queue and result slots (ENQUEUE_JOB, SLOT_STATUS, READ_SLOT) ---");
+
+            // A zero run first: the PE registers still hold the previous
+            // operands, which the first cycles of the next run pick up
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = 16'h0000;
+            write_matrix(CMD_WRITE_MATRIX_A);
+            write_matrix(CMD_WRITE_MATRIX_B);
+            run(CMD_START_COMPUTE);
+
+            // bias[row] = row + 1 through WRITE_ELEMENTS; queued jobs add it
+            uart_send(CMD_WRITE_ELEMENTS);
+            uart_send(8'd3);
+            uart_send(8'd8);
+            expect_byte(RESP_ACK, "element write acknowledged");
+            for (i = 0; i < 8; i = i + 1) begin
+                word = fp16_int(i + 1);
+                uart_send(i);
+                uart_send(word[7:0]);
+                uart_send(word[15:8]);
+            end
+            set_register(CMD_SET_EPILOGUE, 8'h01);
+
+            // Slot 5: zero operands, so the slot holds the bias alone.
+            // Slot 9: ones times ones
+            enqueue_job({4'd5, 4'b0011}, 16'h0000, 16'h0000);
+            enqueue_job({4'd9, 4'b0011}, 16'h3C00, 16'h3C00);
+            wait_queue(done);
+            check(done == 8'd2, "Queue drains after both jobs");
+
+            slot_status(ready);
+            check(ready == 16'h0220, "Completed jobs flag slots 5 and 9");
+
+            // The last job's result is also in the result memory
+            read_words(CMD_READ_RESULT);
+            for (i = 0; i < 64; i = i + 1) words_prev[i] = rx_words[i];
+
+            read_slot(8'd9);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== words_prev[i] || rx_words[i][15] || rx_words[i] == 16'h0000) ok = 0;
+            end
+            check(ok, "Slot 9 collected first holds its job's result");
+
+            read_slot(8'd5);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== fp16_int(i / 8 + 1)) ok = 0;
+            end
+            check(ok, "Slot 5 holds the bias of its zero job");
+
+            // A job without payload reuses the resident operands; only
+            // its own slot changes
+            enqueue_job({4'd5, 4'b0000}, 16'h0000, 16'h0000);
+            wait_queue(done);
+            check(done == 8'd3, "Job without payload runs");
+            slot_status(ready);
+            check(ready == 16'h0220, "Reused slot is ready again");
+
+            read_slot(8'd5);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i][15] || rx_words[i] == 16'h0000) ok = 0;
+            end
+            check(ok, "Slot 5 now holds the ones product");
+            read_slot(8'd9);
+            ok = 1;
+            for (i = 0; i < 64; i = i + 1) begin
+                if (rx_words[i] !== words_prev[i]) ok = 0;
+            end
+            check(ok, "Slot 9 is untouched");
+
+            set_register(CMD_SET_EPILOGUE, 8'h00);
+        end
+    endtask
+
+    // CHECKSUM answers the sums of what READ_MATRIX_A / READ_RESULT /
+    // READ_SLOT return (runs after test_queue: slot 9 is filled)
+    task test_checksum;
+        reg [31:0] sums;
+        begin
+            $display("\n--- Buffer checksums (CHECKSUM) ---");
+            for (i = 0; i < 64; i = i + 1) tx_words[i] = 16'h3C00 + i * 16'h0101;
+            write_matrix(CMD_WRITE_MATRIX_A);
+            read_words(CMD_READ_MATRIX_A);
+            read_checksum(8'h00, sums);
+            check(sums == fletcher_rx(1'b0), "Matrix A checksum matches its readback");
+
+            read_words(CMD_READ_RESULT);
+            read_checksum(8'h02, sums);
+            check(sums == fletcher_rx(1'b0), "Result checksum matches its readback");
+
+            read_slot(8'd9);
+            read_checksum(8'h19, sums);
+            check(sums == fletcher_rx(1'b0), "Slot 9 checksum matches its readback");
+            check(sums != 32'h0, "Slot checksum covers a non-zero slot");
+
+            // Back in IDLE after the four sum bytes
+            set_register(CMD_SET_PRECISION, 8'hFB);
+        end
+    endtask
+
+    // Test procedure
+    initial begin
+        // Initialize signals
+        rst_n = 0;
+        uart_rx = 1'b1;
+        switches = 8'h80;  // switches[7] = 1: UART mode
+        rx_head = 0;
+        checks = 0;
+        errors = 0;
+
+        // Apply reset
+        #(CLK_PERIOD*5);
+        rst_n = 1;
+        #(CLK_PERIOD*20);
+
+        $display("=== TPU UART Testbench Started ===");
+
+        // Exact datapath so small integer sums are exact
+        set_register(CMD_SET_PRECISION, 8'hFB);
+
+        test_status_after_payload;
+        test_epilogue;
+        test_wide_readback;
+        test_chain;
+        test_queue;
+        test_checksum;
+
+        $display("\n=== Results ===");
+        $display("Checks: %0d, failures: %0d", checks, errors);
+        if (errors == 0)
+            $display("*** TEST PASSED ***");
+        else
+            $display("*** TEST FAILED ***");
+        $finish;
+    end
+
+    // Timeout watchdog
+    initial begin
+        #(CLK_PERIOD*5000000);
+        $display("ERROR: Testbench timeout!");
+        $finish;
+    end
+
+    // Waveform dump for debugging
+    initial begin
+        $dumpfile("tpu_uart_tb.vcd");
+        $dumpvars(0, tpu_uart_testbench);
+    end
+
+endmodule
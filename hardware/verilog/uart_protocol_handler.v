@@ -1,10 +1,11 @@
 // UART Protocol Handler for TPU
 // Implements protocol matching Python driver (tpu_fpga_interface.py)
-// Commands: 0x01-0x08, Responses: 0xAA (ACK), 0x55 (NACK)
+// Commands: 0x01-0x15, Responses: 0xAA (ACK), 0x55 (NACK)
 
 module uart_protocol_handler #(
     parameter CLK_FREQ = 100_000_000,
-    parameter BAUD_RATE = 115200
+    parameter BAUD_RATE = 115200,
+    parameter RX_IDLE_TIMEOUT = 256   // byte times without input before a partial frame is dropped
 )(
     input wire clk,
     input wire rst_n,
@@ -18,14 +19,37 @@ module uart_protocol_handler #(
     output reg [15:0] mem_data_out,
     input wire [15:0] mem_data_in,
     output reg mem_we,
-    output reg [1:0] mem_select,  // 00=matrix_a, 01=matrix_b, 10=result
+    output reg [1:0] mem_select,  // 00=matrix_a, 01=matrix_b, 10=result (addr[7:6]=1x: FP32 result halves)
     
     // TPU control
     output reg tpu_start,
+    output reg tpu_accumulate,  // with tpu_start: keep accumulators (no clear)
     output reg tpu_reset,
     input wire tpu_busy,
     input wire tpu_done,
     
+    // Array precision register (write strobe)
+    output reg [7:0] precision_data,
+    output reg precision_we,
+    
+    // Result epilogue: [0] add bias, [1] add residual, [4:2] activation type
+    output reg [7:0] epilogue_data,
+    output reg epilogue_we,
+    
+    // Layer chaining: copy results into matrix A through an activation
+    output reg chain_start,
+    output reg [2:0] chain_activation,
+    
+    // Job queue: payload words go to the tail entry at mem_addr[6:0]
+    output reg job_we,
+    output reg job_push,
+    output reg [7:0] job_descriptor,  // [7:4] result slot, [2] accumulate, [1] load A, [0] load B
+    output reg [3:0] slot_select,     // result slot read with mem_addr[7:6] = 01
+    input wire [7:0] queue_free,
+    input wire [7:0] jobs_done,
+    input wire [15:0] slot_ready,     // slot holds the result of the last job queued for it
+    input wire queue_busy,            // jobs queued or a run in progress: array memories are in use
+    
     // Status LEDs
     output reg [7:0] status_leds
 );
@@ -41,6 +65,19 @@ module uart_protocol_handler #(
     localparam CMD_RESET          = 8'h06;
     localparam CMD_READ_MATRIX_A  = 8'h07;
     localparam CMD_READ_MATRIX_B  = 8'h08;
+    localparam CMD_READ_RESULT_COMPRESSED = 8'h09;  // 8-byte zero bitmap + non-zero values
+    localparam CMD_WRITE_ELEMENTS = 8'h0A;  // buffer, count, ACK, count x (index, low, high)
+    localparam CMD_WRITE_RANGE    = 8'h0B;  // buffer, offset, count, ACK, count x (low, high)
+    localparam CMD_READ_RESULT_WIDE = 8'h0C;  // ACK, 64 x FP32 accumulator (4 bytes, little-endian)
+    localparam CMD_START_ACCUMULATE = 8'h0D;  // start without clearing the accumulators
+    localparam CMD_SET_PRECISION  = 8'h0E;  // precision byte, ACK
+    localparam CMD_CHAIN_RESULT   = 8'h0F;  // activation type, ACK; result -> matrix A
+    localparam CMD_ENQUEUE_JOB    = 8'h10;  // descriptor, ACK (NACK when full), [B words] [A words]
+    localparam CMD_QUEUE_STATUS   = 8'h11;  // ACK, free entries, jobs completed (mod 256)
+    localparam CMD_READ_SLOT      = 8'h12;  // slot, ACK, 64 FP16 results of that slot
+    localparam CMD_SLOT_STATUS    = 8'h13;  // ACK, slot_ready[7:0], slot_ready[15:8]
+    localparam CMD_SET_EPILOGUE   = 8'h14;  // epilogue byte, ACK
+    localparam CMD_CHECKSUM       = 8'h15;  // buffer, ACK, sum a, sum b (16 bits each, little-endian)
     
     // Response codes
     localparam RESP_ACK  = 8'hAA;
@@ -78,18 +115,36 @@ module uart_protocol_handler #(
     );
     
     // Protocol FSM
-    localparam STATE_IDLE           = 4'd0;
-    localparam STATE_RECV_CMD       = 4'd1;
-    localparam STATE_SEND_ACK       = 4'd2;
-    localparam STATE_RECV_DATA      = 4'd3;
-    localparam STATE_WRITE_MEM      = 4'd4;
-    localparam STATE_READ_MEM       = 4'd5;
-    localparam STATE_SEND_DATA      = 4'd6;
-    localparam STATE_SEND_STATUS    = 4'd7;
-    localparam STATE_WAIT_TX        = 4'd8;
-    localparam STATE_PROCESS_CMD    = 4'd9;
+    localparam STATE_IDLE           = 5'd0;
+    localparam STATE_RECV_CMD       = 5'd1;
+    localparam STATE_SEND_ACK       = 5'd2;
+    localparam STATE_RECV_DATA      = 5'd3;
+    localparam STATE_WRITE_MEM      = 5'd4;
+    localparam STATE_READ_MEM       = 5'd5;
+    localparam STATE_SEND_DATA      = 5'd6;
+    localparam STATE_SEND_STATUS    = 5'd7;
+    localparam STATE_WAIT_TX        = 5'd8;
+    localparam STATE_PROCESS_CMD    = 5'd9;
+    localparam STATE_SCAN_ADDR      = 5'd10;
+    localparam STATE_SCAN_READ      = 5'd11;
+    localparam STATE_SEND_BITMAP    = 5'd12;
+    localparam STATE_NEXT_NONZERO   = 5'd13;
+    localparam STATE_RECV_HEADER    = 5'd14;
+    localparam STATE_RECV_ELEMENT   = 5'd15;
+    localparam STATE_WIDE_ADDR      = 5'd16;
+    localparam STATE_SEND_WIDE      = 5'd17;
+    localparam STATE_RECV_PRECISION = 5'd18;
+    localparam STATE_RECV_CHAIN     = 5'd19;
+    localparam STATE_RECV_JOB       = 5'd20;
+    localparam STATE_RECV_SLOT      = 5'd21;
+    localparam STATE_SEND_QUEUE     = 5'd22;  // two status bytes (queue or slot status)
+    localparam STATE_RECV_EPILOGUE  = 5'd23;
+    localparam STATE_RECV_SUM       = 5'd24;
+    localparam STATE_SUM_ADDR       = 5'd25;
+    localparam STATE_SUM_READ       = 5'd26;
+    localparam STATE_SEND_SUM       = 5'd27;
     
-    reg [3:0] state;
+    reg [4:0] state;
     reg [7:0] cmd_reg;
     reg [7:0] byte_count;
     reg [7:0] total_bytes;
@@ -99,6 +154,50 @@ module uart_protocol_handler #(
     // Data reception for multi-byte commands
     reg data_byte_low;  // Track if receiving low or high byte
     
+    // Compressed readback: bit i set when result[i] is non-zero (-0 counts as zero)
+    reg [63:0] result_bitmap;
+    reg sending_values;  // 0 = bitmap bytes, 1 = non-zero values
+    
+    // Addressed element writes: 0 = index, 1 = low byte, 2 = high byte
+    reg [1:0] elem_phase;
+    
+    // Wide readback: byte of the current FP32 result (0 = LSB)
+    reg [1:0] wide_byte;
+    
+    // Job payload: word addresses [addr_counter, job_end) of the queue entry
+    reg [7:0] job_end;
+    
+    // WRITE_ELEMENTS / WRITE_RANGE to buffer 3: bias bank of mem_select 11
+    reg bias_write;
+    
+    // Checksum: Fletcher-style sums (mod 2^16) of the 64 words of a buffer;
+    // sum_slot reads the result slot half (mem_addr[7:6] = 01)
+    reg [15:0] sum_a;
+    reg [15:0] sum_b;
+    reg sum_slot;
+    
+    // Receive states: a frame stalled here for RX_IDLE_TIMEOUT byte times is
+    // dropped and the FSM returns to IDLE, so the host can resync after a
+    // lost byte (idle flush, CMD_RESET, status probe)
+    localparam RX_IDLE_CLKS = CLKS_PER_BIT * 10 * RX_IDLE_TIMEOUT;
+    wire rx_waiting = (state == STATE_RECV_DATA) || (state == STATE_RECV_HEADER) ||
+                      (state == STATE_RECV_ELEMENT) || (state == STATE_RECV_PRECISION) ||
+                      (state == STATE_RECV_CHAIN) || (state == STATE_RECV_JOB) ||
+                      (state == STATE_RECV_SLOT) || (state == STATE_RECV_EPILOGUE) ||
+                      (state == STATE_RECV_SUM);
+    reg [$clog2(RX_IDLE_CLKS + 1)-1:0] rx_idle_count;
+    wire rx_idle_timeout = (rx_idle_count == RX_IDLE_CLKS);
+    
+    always @(posedge clk or negedge rst_n) begin
+        if (!rst_n) begin
+            rx_idle_count <= 0;
+        end else if (!rx_waiting || rx_valid) begin
+            rx_idle_count <= 0;
+        end else if (!rx_idle_timeout) begin
+            rx_idle_count <= rx_idle_count + 1;
+        end
+    end
+    
     always @(posedge clk or negedge rst_n) begin
         if (!rst_n) begin
             state <= STATE_IDLE;
@@ -110,18 +209,44 @@ module uart_protocol_handler #(
             mem_we <= 1'b0;
             mem_select <= 2'b00;
             tpu_start <= 1'b0;
+            tpu_accumulate <= 1'b0;
             tpu_reset <= 1'b0;
+            precision_data <= 8'h00;
+            precision_we <= 1'b0;
+            epilogue_data <= 8'h00;
+            epilogue_we <= 1'b0;
+            chain_start <= 1'b0;
+            chain_activation <= 3'd0;
+            job_we <= 1'b0;
+            job_push <= 1'b0;
+            job_descriptor <= 8'h00;
+            slot_select <= 4'h0;
+            job_end <= 8'h00;
+            bias_write <= 1'b0;
+            sum_a <= 16'h0000;
+            sum_b <= 16'h0000;
+            sum_slot <= 1'b0;
             tx_data <= 8'h00;
             tx_start <= 1'b0;
             status_leds <= 8'h00;
             data_buffer <= 16'h0000;
             addr_counter <= 8'h00;
             data_byte_low <= 1'b1;
+            result_bitmap <= 64'h0;
+            sending_values <= 1'b0;
+            elem_phase <= 2'd0;
+            wide_byte <= 2'd0;
         end else begin
             // Default values
             mem_we <= 1'b0;
             tpu_start <= 1'b0;
+            tpu_accumulate <= 1'b0;
             tpu_reset <= 1'b0;
+            precision_we <= 1'b0;
+            epilogue_we <= 1'b0;
+            chain_start <= 1'b0;
+            job_we <= 1'b0;
+            job_push <= 1'b0;
             tx_start <= 1'b0;
             
             case (state)
@@ -135,22 +260,33 @@ module uart_protocol_handler #(
                 
                 STATE_PROCESS_CMD: begin
                     case (cmd_reg)
-                        CMD_WRITE_MATRIX_A: begin
-                            mem_select <= 2'b00;  // Matrix A
-                            total_bytes <= 8'd128; // 64 FP16 values * 2 bytes
-                            byte_count <= 8'h00;
-                            addr_counter <= 8'h00;
-                            data_byte_low <= 1'b1;
-                            state <= STATE_SEND_ACK;
-                        end
-                        
-                        CMD_WRITE_MATRIX_B: begin
-                            mem_select <= 2'b01;  // Matrix B
-                            total_bytes <= 8'd128;
-                            byte_count <= 8'h00;
-                            addr_counter <= 8'h00;
-                            data_byte_low <= 1'b1;
-                            state <= STATE_SEND_ACK;
+                        // Direct writes, starts and chaining are refused while
+                        // the array memories belong to queued jobs or a run
+                        CMD_WRITE_MATRIX_A, CMD_WRITE_MATRIX_B, CMD_START_COMPUTE,
+                        CMD_START_ACCUMULATE: begin
+                            if (queue_busy) begin
+                                tx_data <= RESP_NACK;
+                                tx_start <= 1'b1;
+                                state <= STATE_WAIT_TX;
+                            end else if (cmd_reg == CMD_WRITE_MATRIX_A) begin
+                                mem_select <= 2'b00;  // Matrix A
+                                total_bytes <= 8'd128; // 64 FP16 values * 2 bytes
+                                byte_count <= 8'h00;
+                                addr_counter <= 8'h00;
+                                data_byte_low <= 1'b1;
+                                state <= STATE_SEND_ACK;
+                            end else if (cmd_reg == CMD_WRITE_MATRIX_B) begin
+                                mem_select <= 2'b01;  // Matrix B
+                                total_bytes <= 8'd128;
+                                byte_count <= 8'h00;
+                                addr_counter <= 8'h00;
+                                data_byte_low <= 1'b1;
+                                state <= STATE_SEND_ACK;
+                            end else begin
+                                tpu_start <= 1'b1;
+                                tpu_accumulate <= (cmd_reg == CMD_START_ACCUMULATE);
+                                state <= STATE_SEND_ACK;
+                            end
                         end
                         
                         CMD_READ_RESULT: begin
@@ -162,12 +298,8 @@ module uart_protocol_handler #(
                             state <= STATE_SEND_ACK;
                         end
                         
-                        CMD_START_COMPUTE: begin
-                            tpu_start <= 1'b1;
-                            state <= STATE_SEND_ACK;
-                        end
-                        
                         CMD_GET_STATUS: begin
+                            byte_count <= 8'h00;  // left at 128 by a preceding payload
                             state <= STATE_SEND_ACK;
                         end
                         
@@ -194,6 +326,59 @@ module uart_protocol_handler #(
                             state <= STATE_SEND_ACK;
                         end
                         
+                        CMD_READ_RESULT_COMPRESSED: begin
+                            mem_select <= 2'b10;  // Result
+                            byte_count <= 8'h00;
+                            addr_counter <= 8'h00;
+                            data_byte_low <= 1'b1;
+                            result_bitmap <= 64'h0;
+                            sending_values <= 1'b0;
+                            state <= STATE_SEND_ACK;
+                        end
+                        
+                        CMD_READ_RESULT_WIDE: begin
+                            mem_select <= 2'b10;  // Result, wide halves
+                            addr_counter <= 8'h00;
+                            wide_byte <= 2'd0;
+                            state <= STATE_SEND_ACK;
+                        end
+                        
+                        CMD_SET_PRECISION: begin
+                            state <= STATE_RECV_PRECISION;
+                        end
+                        
+                        CMD_CHAIN_RESULT: begin
+                            state <= STATE_RECV_CHAIN;
+                        end
+                        
+                        CMD_SET_EPILOGUE: begin
+                            state <= STATE_RECV_EPILOGUE;
+                        end
+                        
+                        CMD_ENQUEUE_JOB: begin
+                            state <= STATE_RECV_JOB;
+                        end
+                        
+                        CMD_QUEUE_STATUS, CMD_SLOT_STATUS: begin
+                            byte_count <= 8'h00;
+                            state <= STATE_SEND_ACK;
+                        end
+                        
+                        CMD_READ_SLOT: begin
+                            state <= STATE_RECV_SLOT;
+                        end
+                        
+                        CMD_CHECKSUM: begin
+                            state <= STATE_RECV_SUM;
+                        end
+                        
+                        CMD_WRITE_ELEMENTS, CMD_WRITE_RANGE: begin
+                            byte_count <= 8'h00;
+                            elem_phase <= 2'd0;
+                            data_byte_low <= 1'b1;
+                            state <= STATE_RECV_HEADER;
+                        end
+                        
                         default: begin
                             // Unknown command - send NACK
                             tx_data <= RESP_NACK;
@@ -213,12 +398,41 @@ module uart_protocol_handler #(
                             CMD_WRITE_MATRIX_A, CMD_WRITE_MATRIX_B: begin
                                 state <= STATE_RECV_DATA;
                             end
-                            CMD_READ_RESULT, CMD_READ_MATRIX_A, CMD_READ_MATRIX_B: begin
+                            CMD_READ_RESULT, CMD_READ_MATRIX_A, CMD_READ_MATRIX_B, CMD_READ_SLOT: begin
                                 state <= STATE_READ_MEM;
                             end
+                            CMD_QUEUE_STATUS, CMD_SLOT_STATUS: begin
+                                state <= STATE_SEND_QUEUE;
+                            end
+                            CMD_ENQUEUE_JOB: begin
+                                // A job without payload reuses both resident operands
+                                if (addr_counter == job_end) begin
+                                    job_push <= 1'b1;
+                                    state <= STATE_WAIT_TX;
+                                end else begin
+                                    state <= STATE_RECV_DATA;
+                                end
+                            end
                             CMD_GET_STATUS: begin
                                 state <= STATE_SEND_STATUS;
                             end
+                            CMD_READ_RESULT_COMPRESSED: begin
+                                state <= STATE_SCAN_ADDR;
+                            end
+                            CMD_READ_RESULT_WIDE: begin
+                                state <= STATE_WIDE_ADDR;
+                            end
+                            CMD_CHECKSUM: begin
+                                state <= STATE_SUM_ADDR;
+                            end
+                            CMD_WRITE_ELEMENTS: begin
+                                // An empty update is just acknowledged
+                                state <= (total_bytes == 8'h00) ? STATE_WAIT_TX : STATE_RECV_ELEMENT;
+                            end
+                            CMD_WRITE_RANGE: begin
+                                // Burst lands at addr_counter = offset
+                                state <= (total_bytes == 8'h00) ? STATE_WAIT_TX : STATE_RECV_DATA;
+                            end
                             default: begin
                                 state <= STATE_WAIT_TX;
                             end
@@ -236,7 +450,9 @@ module uart_protocol_handler #(
                             // Receive high byte and write to memory
                             data_buffer[15:8] <= rx_data;
                             mem_data_out <= {rx_data, data_buffer[7:0]};
-                            mem_addr <= addr_counter[5:0];
+                            mem_addr <= (cmd_reg == CMD_ENQUEUE_JOB) ? {1'b0, addr_counter[6:0]} :
+                                        (cmd_reg == CMD_WRITE_RANGE) ? {1'b0, bias_write, addr_counter[5:0]} :
+                                        addr_counter[5:0];
                             state <= STATE_WRITE_MEM;
                             data_byte_low <= 1'b1;
                         end
@@ -245,18 +461,89 @@ module uart_protocol_handler #(
                 end
                 
                 STATE_WRITE_MEM: begin
-                    mem_we <= 1'b1;
                     addr_counter <= addr_counter + 1;
                     
-                    if (byte_count >= total_bytes) begin
-                        state <= STATE_IDLE;
+                    if (cmd_reg == CMD_ENQUEUE_JOB) begin
+                        // Payload goes to the queue; the last word pushes the job
+                        job_we <= 1'b1;
+                        if (addr_counter + 1 == job_end) begin
+                            job_push <= 1'b1;
+                            state <= STATE_IDLE;
+                        end else begin
+                            state <= STATE_RECV_DATA;
+                        end
                     end else begin
-                        state <= STATE_RECV_DATA;
+                        mem_we <= 1'b1;
+                        if (byte_count >= total_bytes) begin
+                            state <= STATE_IDLE;
+                        end else if (cmd_reg == CMD_WRITE_ELEMENTS) begin
+                            state <= STATE_RECV_ELEMENT;
+                        end else begin
+                            state <= STATE_RECV_DATA;
+                        end
+                    end
+                end
+                
+                // Write headers: buffer select, [range offset,] element count
+                STATE_RECV_HEADER: begin
+                    if (rx_valid) begin
+                        if (byte_count == 8'h00) begin
+                            // 0 = matrix A, 1 = matrix B, 2 = residual, 3 = bias
+                            mem_select <= rx_data[1] ? 2'b11 : {1'b0, rx_data[0]};
+                            bias_write <= (rx_data[1:0] == 2'b11);
+                            byte_count <= 8'h01;
+                        end else if (cmd_reg == CMD_WRITE_ELEMENTS) begin
+                            total_bytes <= rx_data;  // counts elements for this command
+                            byte_count <= 8'h00;
+                            if (queue_busy) begin
+                                tx_data <= RESP_NACK;
+                                tx_start <= 1'b1;
+                                state <= STATE_WAIT_TX;
+                            end else begin
+                                state <= STATE_SEND_ACK;
+                            end
+                        end else if (byte_count == 8'h01) begin
+                            addr_counter <= rx_data;  // range offset
+                            byte_count <= 8'h02;
+                        end else begin
+                            byte_count <= 8'h00;
+                            if ({1'b0, addr_counter} + {1'b0, rx_data} > 9'd64 || queue_busy) begin
+                                // Range past the end of the buffer, or memories busy
+                                tx_data <= RESP_NACK;
+                                tx_start <= 1'b1;
+                                state <= STATE_WAIT_TX;
+                            end else begin
+                                total_bytes <= {rx_data[6:0], 1'b0};  // payload bytes
+                                state <= STATE_SEND_ACK;
+                            end
+                        end
+                    end
+                end
+                
+                STATE_RECV_ELEMENT: begin
+                    if (rx_valid) begin
+                        case (elem_phase)
+                            2'd0: begin
+                                addr_counter <= rx_data;
+                                elem_phase <= 2'd1;
+                            end
+                            2'd1: begin
+                                data_buffer[7:0] <= rx_data;
+                                elem_phase <= 2'd2;
+                            end
+                            default: begin
+                                mem_data_out <= {rx_data, data_buffer[7:0]};
+                                mem_addr <= {1'b0, bias_write, addr_counter[5:0]};
+                                byte_count <= byte_count + 1;
+                                elem_phase <= 2'd0;
+                                state <= STATE_WRITE_MEM;
+                            end
+                        endcase
                     end
                 end
                 
                 STATE_READ_MEM: begin
-                    mem_addr <= addr_counter[5:0];
+                    mem_addr <= (cmd_reg == CMD_READ_SLOT) ? {2'b01, addr_counter[5:0]} : addr_counter[5:0];
                     state <= STATE_SEND_DATA;
                 end
                 
@@ -306,20 +593,236 @@ module uart_protocol_handler #(
                                     state <= STATE_WAIT_TX;
                                 end
                             end
+                            default: begin
+                                byte_count <= 8'h00;
+                                state <= STATE_IDLE;
+                            end
                         endcase
                     end
                 end
                 
+                // Compressed readback: build the zero bitmap (one word per two cycles)
+                STATE_SCAN_ADDR: begin
+                    mem_addr <= addr_counter[5:0];
+                    state <= STATE_SCAN_READ;
+                end
+                
+                STATE_SCAN_READ: begin
+                    result_bitmap[addr_counter[5:0]] <= (mem_data_in[14:0] != 15'h0);
+                    if (addr_counter == 8'd63) begin
+                        addr_counter <= 8'h00;
+                        state <= STATE_SEND_BITMAP;
+                    end else begin
+                        addr_counter <= addr_counter + 1;
+                        state <= STATE_SCAN_ADDR;
+                    end
+                end
+                
+                // Byte r of the bitmap covers result row r (bit c = column c)
+                STATE_SEND_BITMAP: begin
+                    if (!tx_busy) begin
+                        tx_data <= result_bitmap[byte_count[2:0]*8 +: 8];
+                        tx_start <= 1'b1;
+                        byte_count <= byte_count + 1;
+                        state <= STATE_WAIT_TX;
+                    end
+                end
+                
+                // Skip zero results; send non-zero ones through STATE_SEND_DATA
+                STATE_NEXT_NONZERO: begin
+                    if (addr_counter >= 8'd64) begin
+                        state <= STATE_IDLE;
+                    end else if (result_bitmap[addr_counter[5:0]]) begin
+                        mem_addr <= addr_counter[5:0];
+                        data_byte_low <= 1'b1;
+                        state <= STATE_SEND_DATA;
+                    end else begin
+                        addr_counter <= addr_counter + 1;
+                    end
+                end
+                
+                // {align_max, mult_bits} for the selectable datapath
+                STATE_RECV_PRECISION: begin
+                    if (rx_valid) begin
+                        precision_data <= rx_data;
+                        precision_we <= 1'b1;
+                        state <= STATE_SEND_ACK;
+                    end
+                end
+                
+                STATE_RECV_EPILOGUE: begin
+                    if (rx_valid) begin
+                        epilogue_data <= rx_data;
+                        epilogue_we <= 1'b1;
+                        state <= STATE_SEND_ACK;
+                    end
+                end
+                
+                // Activation type (activation_functions.v encoding) for the copy
+                STATE_RECV_CHAIN: begin
+                    if (rx_valid) begin
+                        chain_activation <= rx_data[2:0];
+                        if (queue_busy) begin
+                            tx_data <= RESP_NACK;
+                            tx_start <= 1'b1;
+                            state <= STATE_WAIT_TX;
+                        end else begin
+                            chain_start <= 1'b1;
+                            state <= STATE_SEND_ACK;
+                        end
+                    end
+                end
+                
+                // Descriptor: refuse when the queue is full, else size the payload
+                STATE_RECV_JOB: begin
+                    if (rx_valid) begin
+                        if (queue_free == 8'h00) begin
+                            tx_data <= RESP_NACK;
+                            tx_start <= 1'b1;
+                            state <= STATE_WAIT_TX;
+                        end else begin
+                            job_descriptor <= rx_data;
+                            addr_counter <= rx_data[0] ? 8'd0 : 8'd64;
+                            job_end <= rx_data[1] ? 8'd128 : 8'd64;
+                            data_byte_low <= 1'b1;
+                            state <= STATE_SEND_ACK;
+                        end
+                    end
+                end
+                
+                STATE_RECV_SLOT: begin
+                    if (rx_valid) begin
+                        slot_select <= rx_data[3:0];
+                        mem_select <= 2'b10;  // Result, slot half
+                        total_bytes <= 8'd128;
+                        byte_count <= 8'h00;
+                        addr_counter <= 8'h00;
+                        data_byte_low <= 1'b1;
+                        state <= STATE_SEND_ACK;
+                    end
+                end
+                
+                // 0 = matrix A, 1 = matrix B, 2 = result, 0x10 | slot = result slot
+                STATE_RECV_SUM: begin
+                    if (rx_valid) begin
+                        mem_select <= (rx_data[4] || rx_data[1]) ? 2'b10 : {1'b0, rx_data[0]};
+                        sum_slot <= rx_data[4];
+                        if (rx_data[4]) slot_select <= rx_data[3:0];
+                        sum_a <= 16'h0000;
+                        sum_b <= 16'h0000;
+                        byte_count <= 8'h00;
+                        addr_counter <= 8'h00;
+                        state <= STATE_SEND_ACK;
+                    end
+                end
+                
+                // Sum the buffer while the ACK goes out (one word per two cycles)
+                STATE_SUM_ADDR: begin
+                    mem_addr <= {1'b0, sum_slot, addr_counter[5:0]};
+                    state <= STATE_SUM_READ;
+                end
+                
+                STATE_SUM_READ: begin
+                    sum_a <= sum_a + mem_data_in;
+                    sum_b <= sum_b + sum_a + mem_data_in;
+                    if (addr_counter == 8'd63) begin
+                        state <= STATE_SEND_SUM;
+                    end else begin
+                        addr_counter <= addr_counter + 1;
+                        state <= STATE_SUM_ADDR;
+                    end
+                end
+                
+                STATE_SEND_SUM: begin
+                    if (!tx_busy) begin
+                        case (byte_count[1:0])
+                            2'd0: tx_data <= sum_a[7:0];
+                            2'd1: tx_data <= sum_a[15:8];
+                            2'd2: tx_data <= sum_b[7:0];
+                            default: tx_data <= sum_b[15:8];
+                        endcase
+                        tx_start <= 1'b1;
+                        byte_count <= byte_count + 1;
+                        state <= STATE_WAIT_TX;
+                    end
+                end
+                
+                STATE_SEND_QUEUE: begin
+                    if (!tx_busy) begin
+                        if (cmd_reg == CMD_SLOT_STATUS)
+                            tx_data <= (byte_count == 8'd0) ? slot_ready[7:0] : slot_ready[15:8];
+                        else
+                            tx_data <= (byte_count == 8'd0) ? queue_free : jobs_done;
+                        tx_start <= 1'b1;
+                        byte_count <= byte_count + 1;
+                        state <= STATE_WAIT_TX;
+                    end
+                end
+                
+                // Wide readback: mem_addr[7] selects the FP32 result, mem_addr[6] its half
+                STATE_WIDE_ADDR: begin
+                    mem_addr <= {1'b1, wide_byte[1], addr_counter[5:0]};
+                    state <= STATE_SEND_WIDE;
+                end
+                
+                STATE_SEND_WIDE: begin
+                    if (!tx_busy) begin
+                        tx_data <= wide_byte[0] ? mem_data_in[15:8] : mem_data_in[7:0];
+                        tx_start <= 1'b1;
+                        state <= STATE_WAIT_TX;
+                    end
+                end
+                
                 STATE_WAIT_TX: begin
                     if (tx_done) begin
-                        if (cmd_reg == CMD_READ_RESULT || 
+                        if (cmd_reg == CMD_READ_RESULT_WIDE) begin
+                            wide_byte <= wide_byte + 1;
+                            if (wide_byte != 2'd3) begin
+                                state <= STATE_WIDE_ADDR;
+                            end else if (addr_counter == 8'd63) begin
+                                state <= STATE_IDLE;
+                            end else begin
+                                addr_counter <= addr_counter + 1;
+                                state <= STATE_WIDE_ADDR;
+                            end
+                        end else if (cmd_reg == CMD_READ_RESULT_COMPRESSED) begin
+                            if (!sending_values) begin
+                                if (byte_count >= 8'd8) begin
+                                    sending_values <= 1'b1;
+                                    addr_counter <= 8'h00;
+                                    state <= STATE_NEXT_NONZERO;
+                                end else begin
+                                    state <= STATE_SEND_BITMAP;
+                                end
+                            end else if (!data_byte_low) begin
+                                // Low byte sent, high byte next
+                                state <= STATE_SEND_DATA;
+                            end else begin
+                                state <= STATE_NEXT_NONZERO;
+                            end
+                        end else if (cmd_reg == CMD_READ_RESULT || 
                             cmd_reg == CMD_READ_MATRIX_A || 
-                            cmd_reg == CMD_READ_MATRIX_B) begin
+                            cmd_reg == CMD_READ_MATRIX_B ||
+                            cmd_reg == CMD_READ_SLOT) begin
                             if (byte_count >= total_bytes) begin
                                 state <= STATE_IDLE;
                             end else begin
                                 state <= STATE_READ_MEM;
                             end
+                        end else if (cmd_reg == CMD_QUEUE_STATUS || cmd_reg == CMD_SLOT_STATUS) begin
+                            if (byte_count >= 8'd2) begin
+                                byte_count <= 8'd0;
+                                state <= STATE_IDLE;
+                            end else begin
+                                state <= STATE_SEND_QUEUE;
+                            end
+                        end else if (cmd_reg == CMD_CHECKSUM) begin
+                            if (byte_count >= 8'd4) begin
+                                byte_count <= 8'd0;
+                                state <= STATE_IDLE;
+                            end else begin
+                                state <= STATE_SEND_SUM;
+                            end
                         end else if (cmd_reg == CMD_GET_STATUS) begin
                             if (byte_count >= 8'd4) begin
                                 byte_count <= 8'd0;
@@ -336,6 +839,11 @@ module uart_protocol_handler #(
                 default: state <= STATE_IDLE;
             endcase
             
+            // Partial frame timed out: drop it (nothing is pushed or started)
+            if (rx_idle_timeout && rx_waiting && !rx_valid) begin
+                state <= STATE_IDLE;
+            end
+            
             // Status LED updates
             status_leds[1] <= tpu_busy;
             status_leds[2] <= tpu_done;
@@ -5,6 +5,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <assert.h>
 #include <math.h>
@@ -44,34 +45,63 @@ TestResult test_result = {0, 0, 0};
         printf("  STATUS: ✗ SOME TESTS FAILED\n"); \
     printf("============================================\n");
 
-// FP16 conversion functions (simplified for testing)
+// FP16 conversion functions (same as tpu_driver.c)
 uint16_t fp32_to_fp16_test(float value) {
-    if (value == 0.0f) return 0;
-    
-    uint32_t bits = *(uint32_t*)&value;
-    uint16_t sign = (bits >> 16) & 0x8000;
-    int32_t exponent = ((bits >> 23) & 0xFF) - 127 + 15;
-    uint32_t mantissa = (bits >> 13) & 0x3FF;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t abs = bits & 0x7FFFFFFF;
+    
+    if (abs > 0x7F800000) return sign | 0x7E00 | ((abs >> 13) & 0x3FF);
+    if (abs >= 0x477FF000) return sign | 0x7C00;
+    if (abs < 0x38800000) {
+        if (abs <= 0x33000000) return sign;
+        uint32_t mant = (abs & 0x7FFFFF) | 0x800000;
+        uint32_t shift = 126 - (abs >> 23);
+        uint32_t half = mant >> shift;
+        uint32_t rest = mant & ((1u << shift) - 1);
+        uint32_t tie = 1u << (shift - 1);
+        if (rest > tie || (rest == tie && (half & 1))) half++;
+        return sign | half;
+    }
     
+    uint32_t rebiased = abs - ((127 - 15) << 23);
+    rebiased += 0xFFF + ((rebiased >> 13) & 1);
+    return sign | (rebiased >> 13);
+}
+
+uint16_t fp32_to_fp16_hw_test(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t abs = bits & 0x7FFFFFFF;
+    
+    if (abs >= 0x7F800000) return sign | (abs > 0x7F800000 ? 0x7E00 | ((abs >> 13) & 0x3FF) : 0x7C00);
+    int32_t exponent = (int32_t)(abs >> 23) - 127 + 15;
     if (exponent <= 0) return sign;
     if (exponent >= 31) return sign | 0x7C00;
-    
-    return sign | (exponent << 10) | mantissa;
+    return sign | (exponent << 10) | ((abs >> 13) & 0x3FF);
 }
 
 float fp16_to_fp32_test(uint16_t value) {
-    if (value == 0) return 0.0f;
-    
-    uint32_t sign = (value & 0x8000) << 16;
-    int32_t exponent = (value >> 10) & 0x1F;
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
     uint32_t mantissa = value & 0x3FF;
+    uint32_t bits;
+    
+    if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent == 0) {
+        float magnitude = (float)mantissa * 5.9604644775390625e-8f;  // 2^-24
+        memcpy(&bits, &magnitude, sizeof(bits));
+        bits |= sign;
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
     
-    if (exponent == 0) return 0.0f;
-    if (exponent == 31) return INFINITY;
-    
-    exponent = exponent - 15 + 127;
-    uint32_t bits = sign | (exponent << 23) | (mantissa << 13);
-    return *(float*)&bits;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
 }
 
 // Test FP16 conversion
@@ -93,6 +123,42 @@ void test_fp16_conversion() {
     // Test reverse conversion
     float back = fp16_to_fp32_test(0x3C00);
     TEST_ASSERT(fabsf(back - 1.0f) < 0.1f, "Convert FP16 back to 1.0");
+    
+    // Rounding and subnormals
+    TEST_ASSERT(fp32_to_fp16_test(1.0f + 0.00073242188f) == 0x3C01, "Rounds to nearest");
+    TEST_ASSERT(fp32_to_fp16_test(1.0f + 0.00073242188f) != fp32_to_fp16_hw_test(1.0f + 0.00073242188f),
+                "Hardware variant truncates");
+    TEST_ASSERT(fp32_to_fp16_test(65520.0f) == 0x7C00, "Overflow rounds to infinity");
+    TEST_ASSERT(fp32_to_fp16_test(5.9604644775390625e-8f) == 0x0001, "Smallest subnormal kept");
+    TEST_ASSERT(fp32_to_fp16_hw_test(5.9604644775390625e-8f) == 0, "Hardware variant flushes subnormals");
+}
+
+// Exhaustive FP16 round trip and tie rounding
+void test_fp16_exhaustive() {
+    TEST_START("FP16 Exhaustive Round Trip");
+    
+    int round_trip = 1, nan_kept = 1, ties = 1;
+    for (uint32_t h = 0; h <= 0xFFFF; h++) {
+        uint16_t w = (uint16_t)h;
+        float f = fp16_to_fp32_test(w);
+        if ((w & 0x7C00) == 0x7C00 && (w & 0x3FF)) {
+            uint16_t back = fp32_to_fp16_test(f);
+            if (!isnan(f) || (back & 0x7FFF) <= 0x7C00 || (back & 0x8000) != (w & 0x8000)) nan_kept = 0;
+            continue;
+        }
+        if (fp32_to_fp16_test(f) != w) round_trip = 0;
+        
+        // Midpoint to the next value up rounds to the even neighbour
+        if (w < 0x7C00) {
+            float hi = (w == 0x7BFF) ? 65536.0f : fp16_to_fp32_test((uint16_t)(w + 1));
+            float mid = f + (hi - f) / 2;
+            uint16_t even = (w & 1) ? (uint16_t)(w + 1) : w;
+            if (fp32_to_fp16_test(mid) != even) ties = 0;
+        }
+    }
+    TEST_ASSERT(round_trip, "All 65,536 non-NaN values round-trip exactly");
+    TEST_ASSERT(nan_kept, "NaNs round-trip as signed NaNs");
+    TEST_ASSERT(ties, "Ties round to even");
 }
 
 // Test matrix operations
@@ -268,6 +334,7 @@ int main(int argc, char* argv[]) {
     
     // Run all tests
     test_fp16_conversion();
+    test_fp16_exhaustive();
     test_matrix_operations();
     test_command_encoding();
     test_data_structures();
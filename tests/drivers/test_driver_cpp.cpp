@@ -0,0 +1,2048 @@
+/*
+ * Test Suite for C++ TPU Driver
+ * Description: Host-side tests for tpu_driver.hpp and the tiled runtime
+ *
+ * Build (from repository root):
+ *   g++ -std=c++17 -O2 -Wall -pthread -Idrivers -o drivers/test_driver_cpp tests/drivers/test_driver_cpp.cpp
+ */
+
+#include "tpu_driver.hpp"
+#include "tpu_gemm.hpp"
+#include "tpu_conv.hpp"
+#include "tpu_emulator.hpp"
+#include "tpu_tuner.hpp"
+#include "tpu_fp16_table.hpp"
+#include "tpu_trace.hpp"
+#include "tpu_faults.hpp"
+#include "tpu_metrics.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Test framework
+struct TestResult {
+    int passed = 0;
+    int failed = 0;
+    int total = 0;
+};
+
+TestResult test_result;
+
+#define TEST_START(name) \
+    printf("\n[Test] %s\n", name); \
+    test_result.total++;
+
+#define TEST_ASSERT(condition, message) \
+    if (condition) { \
+        printf("  ✓ PASSED: %s\n", message); \
+        test_result.passed++; \
+    } else { \
+        printf("  ✗ FAILED: %s\n", message); \
+        test_result.failed++; \
+    }
+
+#define TEST_SUMMARY() \
+    printf("\n"); \
+    printf("============================================\n"); \
+    printf("Test Summary:\n"); \
+    printf("  Total: %d\n", test_result.total); \
+    printf("  PASSED: %d\n", test_result.passed); \
+    printf("  FAILED: %d\n", test_result.failed); \
+    if (test_result.failed == 0) \
+        printf("  STATUS: ✓ ALL TESTS PASSED\n"); \
+    else \
+        printf("  STATUS: ✗ SOME TESTS FAILED\n"); \
+    printf("============================================\n");
+
+/**
+ * Software stand-in for the board: exact FP32 8x8 products
+ */
+struct ReferenceTPU {
+    TPUDriver::Matrix weights{};
+    size_t weightWrites = 0;
+    size_t multiplies = 0;
+
+    void writeWeights(const TPUDriver::Matrix& w) {
+        weights = w;
+        weightWrites++;
+    }
+
+    void writeWeights(const TileView& w) {
+        loadTile(weights, w);
+        weightWrites++;
+    }
+
+    TPUDriver::Matrix multiplyResident(const TileView& a) {
+        TPUDriver::Matrix tile;
+        loadTile(tile, a);
+        return multiplyResident(tile);
+    }
+
+    TPUDriver::Matrix multiplyResident(const TPUDriver::Matrix& a) {
+        TPUDriver::Matrix c{};
+        for (size_t i = 0; i < MATRIX_SIZE; i++) {
+            for (size_t j = 0; j < MATRIX_SIZE; j++) {
+                float sum = 0.0f;
+                for (size_t k = 0; k < MATRIX_SIZE; k++) {
+                    sum += weights[i][k] * a[k][j];
+                }
+                c[i][j] = sum;
+            }
+        }
+        multiplies++;
+        return c;
+    }
+};
+
+static std::vector<float> randomVector(size_t n, unsigned seed) {
+    std::srand(seed);
+    std::vector<float> v(n);
+    for (auto& x : v) {
+        x = static_cast<float>(std::rand() % 200 - 100) / 50.0f;
+    }
+    return v;
+}
+
+static float maxAbsDiff(const std::vector<float>& a, const std::vector<float>& b) {
+    float m = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) {
+        m = std::max(m, std::fabs(a[i] - b[i]));
+    }
+    return m;
+}
+
+/**
+ * Direct convolution used as the reference
+ */
+static std::vector<float> referenceConv(const Conv2DShape& s, const Conv2DParams& p,
+                                        const std::vector<float>& in,
+                                        const std::vector<float>& w) {
+    size_t OH = s.outHeight(p), OW = s.outWidth(p);
+    std::vector<float> out(conv2dOutputSize(s, p), 0.0f);
+    auto inIdx = [&](size_t n, size_t c, size_t h, size_t x) {
+        return s.layout == TensorLayout::NCHW
+            ? ((n * s.channels + c) * s.height + h) * s.width + x
+            : ((n * s.height + h) * s.width + x) * s.channels + c;
+    };
+    auto outIdx = [&](size_t n, size_t o, size_t h, size_t x) {
+        return s.layout == TensorLayout::NCHW
+            ? ((n * s.outChannels + o) * OH + h) * OW + x
+            : ((n * OH + h) * OW + x) * s.outChannels + o;
+    };
+
+    size_t Cg = s.channels / s.groups, Og = s.outChannels / s.groups;
+
+    for (size_t n = 0; n < s.batch; n++)
+    for (size_t o = 0; o < s.outChannels; o++)
+    for (size_t oh = 0; oh < OH; oh++)
+    for (size_t ow = 0; ow < OW; ow++) {
+        float sum = 0.0f;
+        size_t g = o / Og;
+        for (size_t ci = 0; ci < Cg; ci++)
+        for (size_t kh = 0; kh < s.kernelH; kh++)
+        for (size_t kw = 0; kw < s.kernelW; kw++) {
+            long ih = (long)(oh * p.strideH + kh * p.dilationH) - (long)p.padH;
+            long iw = (long)(ow * p.strideW + kw * p.dilationW) - (long)p.padW;
+            if (ih < 0 || iw < 0 || ih >= (long)s.height || iw >= (long)s.width) continue;
+            sum += in[inIdx(n, g * Cg + ci, ih, iw)] *
+                   w[((o * Cg + ci) * s.kernelH + kh) * s.kernelW + kw];
+        }
+        out[outIdx(n, o, oh, ow)] = sum;
+    }
+    return out;
+}
+
+// Test tiled GEMM with ragged edges
+/**
+ * Float with the given bit pattern
+ */
+static float floatFromBits(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void test_fp16_conversion() {
+    TEST_START("FP16 Conversion");
+
+    // Every FP16 value survives decode + encode; NaNs stay NaN with their sign
+    bool roundTrip = true, hardwareRoundTrip = true, nanKept = true;
+    for (uint32_t h = 0; h <= 0xFFFF; h++) {
+        uint16_t w = static_cast<uint16_t>(h);
+        float f = FP16::toFloat(w);
+        bool nan = (w & 0x7C00) == 0x7C00 && (w & 0x3FF);
+        if (nan) {
+            uint16_t back = FP16::fromFloat(f);
+            nanKept = nanKept && std::isnan(f) && (back & 0x7C00) == 0x7C00 && (back & 0x3FF) &&
+                      (back & 0x8000) == (w & 0x8000);
+            continue;
+        }
+        roundTrip = roundTrip && FP16::fromFloat(f) == w;
+        bool subnormal = (w & 0x7C00) == 0 && (w & 0x3FF);
+        uint16_t hw = FP16::fromFloat(FP16::toFloat(w, FP16Mode::Hardware), FP16Mode::Hardware);
+        hardwareRoundTrip = hardwareRoundTrip && hw == (subnormal ? (w & 0x8000) : w);
+    }
+    TEST_ASSERT(roundTrip, "All 65,536 non-NaN values round-trip exactly");
+    TEST_ASSERT(nanKept, "NaNs round-trip as signed NaNs");
+    TEST_ASSERT(hardwareRoundTrip, "Hardware mode round-trips normals and flushes subnormals");
+
+    // Every midpoint between neighbours rounds to the even one; one ulp off
+    // the midpoint rounds to the nearer one
+    bool ties = true, nearest = true;
+    for (uint16_t w = 0; w < 0x7C00; w++) {
+        float lo = FP16::toFloat(w);
+        float hi = w == 0x7BFF ? 65536.0f : FP16::toFloat(static_cast<uint16_t>(w + 1));   // as if unbounded
+        float mid = lo + (hi - lo) / 2;
+        uint16_t even = (w & 1) ? static_cast<uint16_t>(w + 1) : w;
+        ties = ties && FP16::fromFloat(mid) == even && FP16::fromFloat(-mid) == (even | 0x8000);
+        nearest = nearest && FP16::fromFloat(std::nextafter(mid, 0.0f)) == w &&
+                  FP16::fromFloat(std::nextafter(mid, hi)) == w + 1;
+    }
+    TEST_ASSERT(ties, "Ties round to even, subnormals and overflow included");
+    TEST_ASSERT(nearest, "Non-ties round to nearest");
+
+    TEST_ASSERT(FP16::fromFloat(65519.0f) == 0x7BFF && FP16::fromFloat(65520.0f) == 0x7C00,
+                "Overflow threshold at 65520");
+    TEST_ASSERT(FP16::fromFloat(0x1p-24f) == 0x0001 && FP16::toFloat(0x03FF) == 0x3FFp-24f,
+                "Subnormals encode and decode");
+    TEST_ASSERT(FP16::fromFloat(0x1p-25f) == 0 && FP16::fromFloat(-0x1.000002p-25f) == 0x8001,
+                "Half the smallest subnormal ties to zero");
+
+    // Hardware mode is the datapath's truncate / flush
+    std::srand(63);
+    bool hardware = true;
+    for (int i = 0; i < 100000; i++) {
+        uint32_t bits = (static_cast<uint32_t>(std::rand()) << 16) ^ static_cast<uint32_t>(std::rand());
+        float f = floatFromBits(bits);
+        if (std::isnan(f)) continue;
+        uint32_t sign = (bits >> 16) & 0x8000;
+        int32_t exp16 = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+        uint16_t expected = static_cast<uint16_t>(
+            exp16 <= 0 ? sign : exp16 >= 31 ? (sign | 0x7C00) : (sign | (exp16 << 10) | ((bits >> 13) & 0x3FF)));
+        hardware = hardware && FP16::fromFloat(f, FP16Mode::Hardware) == expected;
+    }
+    TEST_ASSERT(hardware, "Hardware mode truncates and flushes");
+    TEST_ASSERT(FP16::fromFloat(1.0f + 0x1.8p-11f) == 0x3C01 &&
+                FP16::fromFloat(1.0f + 0x1.8p-11f, FP16Mode::Hardware) == 0x3C00,
+                "IEEE mode rounds where hardware truncates");
+
+    // Array converters (F16C when present) agree with the scalar code
+    std::vector<float> floats;
+    for (uint32_t h = 0; h <= 0xFFFF; h++) {
+        float f = FP16::toFloat(static_cast<uint16_t>(h));
+        if (std::isnan(f)) continue;
+        floats.push_back(f);
+        floats.push_back(std::nextafter(f, 0.0f));
+        floats.push_back(std::nextafter(f, std::copysign(INFINITY, f)));
+    }
+    for (int i = 0; i < 100000; i++) {
+        float f = floatFromBits((static_cast<uint32_t>(std::rand()) << 16) ^ static_cast<uint32_t>(std::rand()));
+        if (!std::isnan(f)) floats.push_back(f);
+    }
+    std::vector<uint16_t> words(floats.size());
+    FP16::fromFloatArray(floats.data(), words.data(), floats.size());
+    bool encodeMatches = true;
+    for (size_t i = 0; i < floats.size(); i++) {
+        encodeMatches = encodeMatches && words[i] == FP16::fromFloat(floats[i]);
+    }
+    TEST_ASSERT(encodeMatches, FP16::hasF16C() ? "F16C encode matches scalar" : "Array encode matches scalar");
+
+    std::vector<uint16_t> all(0x10000);
+    for (uint32_t h = 0; h <= 0xFFFF; h++) all[h] = static_cast<uint16_t>(h);
+    std::vector<float> decoded(all.size());
+    FP16::toFloatArray(all.data(), decoded.data(), all.size());
+    bool decodeMatches = true;
+    for (size_t i = 0; i < all.size(); i++) {
+        float f = FP16::toFloat(all[i]);
+        decodeMatches = decodeMatches &&
+                        (std::isnan(f) ? std::isnan(decoded[i]) : std::memcmp(&f, &decoded[i], sizeof(f)) == 0);
+    }
+    TEST_ASSERT(decodeMatches, FP16::hasF16C() ? "F16C decode matches scalar" : "Array decode matches scalar");
+}
+
+// Compile-time conversion: constant tensors are encoded by the compiler
+constexpr auto CONST_WEIGHTS = fp16Constants({1.0f, -2.0f, 0.5f, 65520.0f, 0x1p-24f, 1.0f + 0x1.8p-11f});
+static_assert(CONST_WEIGHTS[0] == 0x3C00 && CONST_WEIGHTS[1] == 0xC000 && CONST_WEIGHTS[2] == 0x3800,
+              "constexpr encode");
+static_assert(CONST_WEIGHTS[3] == 0x7C00 && CONST_WEIGHTS[4] == 0x0001 && CONST_WEIGHTS[5] == 0x3C01,
+              "constexpr encode rounds like FP16::fromFloat");
+static_assert(fp16Decode(CONST_WEIGHTS)[1] == -2.0f && FP16_DECODE_TABLE[0x3555] == FP16::toFloat(0x3555),
+              "constexpr decode");
+
+void test_fp16_table() {
+    TEST_START("FP16 Decode Table");
+
+    bool matches = true;
+    for (uint32_t h = 0; h < FP16_VALUES; h++) {
+        float a = FP16Table::toFloat(static_cast<uint16_t>(h));
+        float b = FP16::toFloat(static_cast<uint16_t>(h));
+        matches = matches && std::memcmp(&a, &b, sizeof(a)) == 0;
+    }
+    TEST_ASSERT(matches, "Table matches FP16::toFloat bit for bit, NaN payloads included");
+
+    uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+    float viaTable[MATRIX_SIZE * MATRIX_SIZE], viaScalar[MATRIX_SIZE * MATRIX_SIZE];
+    for (size_t i = 0; i < MATRIX_SIZE * MATRIX_SIZE; i++) {
+        words[i] = static_cast<uint16_t>(i * 977);
+        viaScalar[i] = FP16::toFloat(words[i]);
+    }
+    FP16Table::toFloatArray(words, viaTable, MATRIX_SIZE * MATRIX_SIZE);
+    TEST_ASSERT(std::memcmp(viaTable, viaScalar, sizeof(viaTable)) == 0, "Array decode through the table");
+
+    float runtime[] = {1.0f, -2.0f, 0.5f, 65520.0f, 0x1p-24f, 1.0f + 0x1.8p-11f};
+    bool same = true;
+    for (size_t i = 0; i < CONST_WEIGHTS.size(); i++) {
+        same = same && CONST_WEIGHTS[i] == FP16::fromFloat(runtime[i]);
+    }
+    TEST_ASSERT(same, "Compile-time constants equal run-time encoding");
+}
+
+void test_tiled_gemm() {
+    TEST_START("Tiled GEMM");
+
+    const size_t M = 13, N = 21, K = 10;
+    auto A = randomVector(M * K, 1);
+    auto B = randomVector(K * N, 2);
+    std::vector<float> C(M * N), expected(M * N, 0.0f);
+
+    for (size_t i = 0; i < M; i++)
+        for (size_t j = 0; j < N; j++)
+            for (size_t k = 0; k < K; k++)
+                expected[i * N + j] += A[i * K + k] * B[k * N + j];
+
+    ReferenceTPU tpu;
+    GemmStats stats = tiledGemm(tpu, M, N, K, A.data(), K, B.data(), N, C.data(), N);
+
+    TEST_ASSERT(maxAbsDiff(C, expected) < 1e-4f, "GEMM matches reference");
+    TEST_ASSERT(stats.weightUploads == 2 * 2, "One weight upload per (M, K) tile");
+    TEST_ASSERT(stats.tileMultiplies == 2 * 2 * 3, "One multiply per (M, K, N) tile");
+}
+
+// Test conv2d lowering in both layouts
+void test_conv2d() {
+    TEST_START("Conv2D via lazy im2col");
+
+    Conv2DShape shape;
+    shape.batch = 2;
+    shape.channels = 3;
+    shape.height = 11;
+    shape.width = 9;
+    shape.outChannels = 10;
+    shape.kernelH = 3;
+    shape.kernelW = 3;
+
+    Conv2DParams params;
+    params.strideH = 2;
+    params.strideW = 1;
+    params.padH = 1;
+    params.padW = 2;
+    params.dilationH = 1;
+    params.dilationW = 2;
+
+    auto input = randomVector(shape.batch * shape.channels * shape.height * shape.width, 3);
+    auto weights = randomVector(shape.outChannels * shape.channels * 9, 4);
+
+    for (TensorLayout layout : {TensorLayout::NCHW, TensorLayout::NHWC}) {
+        shape.layout = layout;
+        std::vector<float> out(conv2dOutputSize(shape, params));
+        auto expected = referenceConv(shape, params, input, weights);
+
+        ReferenceTPU tpu;
+        GemmStats stats = conv2d(tpu, shape, params, input.data(), weights.data(), out.data());
+
+        size_t K = shape.channels * 9;
+        size_t P = shape.batch * shape.outHeight(params) * shape.outWidth(params);
+        bool nchw = layout == TensorLayout::NCHW;
+
+        TEST_ASSERT(maxAbsDiff(out, expected) < 1e-4f,
+                    nchw ? "NCHW output matches direct conv" : "NHWC output matches direct conv");
+        TEST_ASSERT(stats.weightUploads == tileCount(10) * tileCount(K),
+                    "Weight tiles uploaded once per (O, K) tile");
+        TEST_ASSERT(stats.tileMultiplies == tileCount(10) * tileCount(K) * tileCount(P),
+                    "Activation tiles streamed for every output position");
+    }
+
+    for (size_t Conv2DShape::*field : {&Conv2DShape::channels, &Conv2DShape::outChannels}) {
+        Conv2DShape empty = shape;
+        empty.*field = 0;
+        std::vector<float> out(conv2dOutputSize(empty, params) + 1);
+        ReferenceTPU tpu;
+        bool threw = false;
+        try {
+            conv2d(tpu, empty, params, input.data(), weights.data(), out.data());
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        TEST_ASSERT(threw, field == &Conv2DShape::channels ? "Zero input channels are rejected"
+                                                           : "Zero output channels are rejected");
+    }
+}
+
+// Test grouped and depthwise packing
+void test_grouped_conv() {
+    TEST_START("Grouped / Depthwise Conv2D");
+
+    Conv2DShape shape;
+    shape.batch = 1;
+    shape.channels = 8;
+    shape.height = 10;
+    shape.width = 10;
+    shape.outChannels = 8;
+    shape.kernelH = 3;
+    shape.kernelW = 3;
+    shape.groups = 8;
+    shape.layout = TensorLayout::NHWC;
+
+    Conv2DParams params;
+    params.padH = 1;
+    params.padW = 1;
+
+    auto input = randomVector(shape.channels * shape.height * shape.width, 5);
+    auto weights = randomVector(shape.outChannels * 9, 6);
+
+    std::vector<float> out(conv2dOutputSize(shape, params));
+    ReferenceTPU tpu;
+    GemmStats stats = conv2d(tpu, shape, params, input.data(), weights.data(), out.data());
+    auto expected = referenceConv(shape, params, input, weights);
+    size_t pTiles = tileCount(100);
+
+    std::cout << "  depthwise 3x3x8: " << stats << std::endl;
+    TEST_ASSERT(maxAbsDiff(out, expected) < 1e-4f, "Depthwise output matches direct conv");
+    // 8 channels x 9 taps packed as 9 diagonal tiles instead of 8 x 2 padded ones
+    TEST_ASSERT(stats.tileMultiplies == 9 * pTiles, "Depthwise channels packed into shared tiles");
+    TEST_ASSERT(stats.utilization() > 9.0 / (2 * 64) * 0.99, "Utilization beats one group per tile");
+
+    // Grouped conv with several output channels per group
+    shape.channels = 6;
+    shape.outChannels = 4;
+    shape.groups = 2;
+    shape.layout = TensorLayout::NCHW;
+    input = randomVector(shape.channels * shape.height * shape.width, 7);
+    weights = randomVector(shape.outChannels * 3 * 9, 8);
+    out.assign(conv2dOutputSize(shape, params), 0.0f);
+    stats = conv2d(tpu, shape, params, input.data(), weights.data(), out.data());
+    expected = referenceConv(shape, params, input, weights);
+
+    std::cout << "  grouped 2x(3->2) 3x3: " << stats << std::endl;
+    TEST_ASSERT(maxAbsDiff(out, expected) < 1e-4f, "Grouped output matches direct conv");
+
+    bool threw = false;
+    try {
+        chooseGroupPacking(2, 0, 27);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Packing an empty group is rejected");
+}
+
+// Test Strassen levels above the tiler
+void test_strassen_gemm() {
+    TEST_START("Strassen GEMM");
+
+    const size_t S = 32;
+    auto A = randomVector(S * S, 9);
+    auto B = randomVector(S * S, 10);
+    std::vector<float> C(S * S);
+
+    ReferenceTPU tpu;
+    GemmOptions options;
+    GemmErrorReport report;
+
+    GemmStats tiled = gemm(tpu, S, S, S, A.data(), S, B.data(), S, C.data(), S, options, &report);
+    TEST_ASSERT(tiled.tileMultiplies == 64, "Tiled 32x32x32 uses 64 tile multiplies");
+
+    options.algorithm = GemmAlgorithm::Strassen1;
+    GemmStats s1 = gemm(tpu, S, S, S, A.data(), S, B.data(), S, C.data(), S, options, &report);
+    std::cout << "  strassen1: " << report << std::endl;
+    TEST_ASSERT(s1.tileMultiplies == 56, "One Strassen level saves 12.5% of tiles");
+    TEST_ASSERT(report.relativeRms < 1e-5, "One Strassen level matches reference");
+
+    options.algorithm = GemmAlgorithm::Strassen2;
+    GemmStats s2 = gemm(tpu, S, S, S, A.data(), S, B.data(), S, C.data(), S, options, &report);
+    std::cout << "  strassen2: " << report << std::endl;
+    TEST_ASSERT(s2.tileMultiplies == 49, "Two Strassen levels use 49/64 of tiles");
+    TEST_ASSERT(report.relativeRms < 1e-5, "Two Strassen levels match reference");
+
+    // Ragged shapes are padded on the host
+    const size_t M = 20, N = 12, K = 28;
+    options.algorithm = GemmAlgorithm::Strassen1;
+    std::vector<float> Cr(M * N);
+    gemm(tpu, M, N, K, A.data(), K, B.data(), N, Cr.data(), N, options, &report);
+    TEST_ASSERT(report.relativeRms < 1e-5, "Ragged Strassen GEMM matches reference");
+}
+
+// Test compressed result readback against the emulator
+void test_compressed_readback() {
+    TEST_START("Compressed Readback");
+
+    // Codec round trip, including -0 which the hardware treats as zero
+    uint16_t words[MATRIX_SIZE * MATRIX_SIZE] = {};
+    words[0] = 0x3C00;
+    words[9] = 0x8000;
+    words[63] = 0xC200;
+    uint8_t frame[ResultCodec::BITMAP_BYTES + MATRIX_SIZE * MATRIX_SIZE * 2];
+    size_t n = ResultCodec::encode(words, frame);
+    uint16_t decoded[MATRIX_SIZE * MATRIX_SIZE];
+    ResultCodec::decode(frame, frame + ResultCodec::BITMAP_BYTES, decoded);
+    TEST_ASSERT(n == ResultCodec::BITMAP_BYTES + 2 * 2, "Frame holds bitmap + 2 non-zeros");
+    TEST_ASSERT(frame[0] == 0x01 && frame[7] == 0x80 && frame[1] == 0x00, "Bitmap is row-major, bit c = column c");
+    TEST_ASSERT(decoded[0] == 0x3C00 && decoded[63] == 0xC200 && decoded[9] == 0, "Decode restores values");
+
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+
+    // ReLU-like input: half of the weight rows are zero
+    TPUDriver::Matrix w{}, a{};
+    auto values = randomVector(2 * MATRIX_SIZE * MATRIX_SIZE, 11);
+    for (size_t i = 0; i < MATRIX_SIZE; i++) {
+        for (size_t j = 0; j < MATRIX_SIZE; j++) {
+            w[i][j] = (i % 2 == 0) ? values[i * MATRIX_SIZE + j] : 0.0f;
+            a[i][j] = values[64 + i * MATRIX_SIZE + j];
+        }
+    }
+
+    TPUDriver::Matrix dense = tpu.matrixMultiply(w, a);
+    TPUStatus status = tpu.getStatus();
+    TEST_ASSERT(!status.busy && !status.done, "Finished run reads idle; done is not sticky");
+    uint64_t before = tpu.linkStats().bytesReceived;
+    TPUDriver::Matrix compressed = tpu.readResults(ReadbackFormat::Compressed);
+    uint64_t compressedBytes = tpu.linkStats().bytesReceived - before;
+
+    TEST_ASSERT(dense == compressed, "Compressed readback matches dense readback");
+    TEST_ASSERT(emu.computeCount() == 1, "Emulator computed once");
+    TEST_ASSERT(compressedBytes == 1 + ResultCodec::BITMAP_BYTES + 32 * 2,
+                "Only non-zero rows cross the link");
+}
+
+// Test delta activation uploads against the emulator
+void test_delta_upload() {
+    TEST_START("Delta Activation Upload");
+
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+    tpu.setUploadMode(UploadMode::Delta);
+
+    auto values = randomVector(MATRIX_SIZE * MATRIX_SIZE + MATRIX_SIZE, 12);
+    TPUDriver::Matrix a{};
+    for (size_t i = 0; i < MATRIX_SIZE; i++)
+        for (size_t j = 0; j < MATRIX_SIZE; j++)
+            a[i][j] = values[i * MATRIX_SIZE + j];
+
+    auto deviceMatches = [&]() {
+        for (size_t i = 0; i < MATRIX_SIZE; i++)
+            for (size_t j = 0; j < MATRIX_SIZE; j++)
+                if (emu.activations()[i * MATRIX_SIZE + j] != FP16::fromFloat(a[i][j])) return false;
+        return true;
+    };
+
+    // No shadow yet: everything changed, so a framed full write is cheaper
+    uint64_t before = tpu.linkStats().bytesSent;
+    tpu.writeActivations(a);
+    TEST_ASSERT(tpu.linkStats().bytesSent - before == 1 + 128, "First upload falls back to a full write");
+    TEST_ASSERT(deviceMatches(), "Device holds the full upload");
+
+    // Sliding window: one new row
+    for (size_t j = 0; j < MATRIX_SIZE; j++) a[3][j] = values[64 + j];
+    before = tpu.linkStats().bytesSent;
+    tpu.writeActivations(a);
+    TEST_ASSERT(tpu.linkStats().bytesSent - before == 4 + 2 * MATRIX_SIZE, "Changed row is sent as one burst");
+    TEST_ASSERT(deviceMatches(), "Device holds the delta update");
+
+    // Scattered changes go out as addressed elements
+    a[0][0] += 1.0f;
+    a[5][2] += 1.0f;
+    before = tpu.linkStats().bytesSent;
+    tpu.writeActivations(a);
+    TEST_ASSERT(tpu.linkStats().bytesSent - before == 3 + 3 * 2, "Scattered elements are sent individually");
+    TEST_ASSERT(deviceMatches(), "Device holds the scattered update");
+
+    before = tpu.linkStats().bytesSent;
+    tpu.writeActivations(a);
+    TEST_ASSERT(tpu.linkStats().bytesSent == before, "Unchanged tile sends nothing");
+
+    const UploadStats& stats = tpu.uploadStats();
+    TEST_ASSERT(stats.fullWrites == 1 && stats.deltaWrites == 2 && stats.skippedWrites == 1,
+                "Upload counters track each path");
+    TEST_ASSERT(stats.bytesSent == tpu.linkStats().bytesSent, "Upload bytes match link bytes");
+
+    // tpu_top_with_io_complete has no byte protocol: 'A' is NACKed
+    TPUDriver framedOnly(std::make_unique<TPUEmulator>());
+    framedOnly.setVerbose(false);
+    bool refused = false;
+    try {
+        framedOnly.writeByte(ACTIVATION_BASE, 0x00);
+    } catch (const LinkError&) {
+        refused = true;
+    }
+    TEST_ASSERT(refused, "Byte protocol is refused unless enabled");
+
+    // Byte-protocol writes bypass the shadow and must invalidate it
+    emu.setByteProtocol(true);
+    tpu.writeFP16(ACTIVATION_BASE, 7.0f);
+    tpu.writeActivations(a);
+    TEST_ASSERT(deviceMatches(), "Direct writes invalidate the shadow");
+
+    // Full mode uses the same framed write as the delta fallback
+    tpu.setUploadMode(UploadMode::Full);
+    a[1][1] += 1.0f;
+    before = tpu.linkStats().bytesSent;
+    tpu.writeActivations(a);
+    TEST_ASSERT(tpu.linkStats().bytesSent - before == 1 + 128, "Full upload is one framed write");
+    TEST_ASSERT(deviceMatches(), "Device holds the full upload");
+
+    // Weights take the same framed write (WriteMatrixB)
+    before = tpu.linkStats().bytesSent;
+    tpu.writeWeights(a);
+    TEST_ASSERT(tpu.linkStats().bytesSent - before == 1 + 128 && emu.weights() == emu.activations(),
+                "Weight upload is one framed write");
+}
+
+// Test burst range writes
+void test_write_range() {
+    TEST_START("Range Write");
+
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+
+    // Rows 2..3 of the weight tile
+    auto values = randomVector(2 * MATRIX_SIZE, 13);
+    uint64_t before = tpu.linkStats().bytesSent;
+    tpu.writeRange(DeviceBuffer::Weights, 2 * MATRIX_SIZE, values.data(), values.size());
+    bool ok = true;
+    for (size_t i = 0; i < values.size(); i++) {
+        ok = ok && emu.weights()[2 * MATRIX_SIZE + i] == FP16::fromFloat(values[i]);
+    }
+    TEST_ASSERT(ok, "Burst lands at the requested offset");
+    TEST_ASSERT(emu.weights()[0] == 0 && emu.weights()[4 * MATRIX_SIZE] == 0, "Neighbouring elements untouched");
+    TEST_ASSERT(tpu.linkStats().bytesSent - before == 4 + 2 * values.size(), "One transaction for the whole range");
+
+    bool threw = false;
+    try {
+        tpu.writeRange(DeviceBuffer::Activations, 60, values.data(), 8);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Range past the buffer end is rejected");
+}
+
+// Test strided / transposed tile encoding
+void test_tile_views() {
+    TEST_START("Strided and Transposed Tile Views");
+
+    // 20 x 12 row-major source
+    const size_t R = 20, Cn = 12;
+    auto src = randomVector(R * Cn, 14);
+    auto expectWords = [&](size_t r0, size_t c0, size_t rows, size_t cols, bool transposed,
+                           const uint16_t* words) {
+        for (size_t i = 0; i < MATRIX_SIZE; i++)
+            for (size_t j = 0; j < MATRIX_SIZE; j++) {
+                float x = 0.0f;
+                if (i < rows && j < cols)
+                    x = transposed ? src[(r0 + j) * Cn + c0 + i] : src[(r0 + i) * Cn + c0 + j];
+                if (words[i * MATRIX_SIZE + j] != FP16::fromFloat(x)) return false;
+            }
+        return true;
+    };
+
+    uint16_t words[MATRIX_SIZE * MATRIX_SIZE];
+    TileView v;
+    v.base = src.data() + 3 * Cn + 2;
+    v.rowStride = Cn;
+    TileEncoder::encode(v, words);
+    TEST_ASSERT(expectWords(3, 2, 8, 8, false, words), "Sub-block of a large matrix");
+
+    v.rows = 5;
+    v.cols = 3;
+    TileEncoder::encode(v, words);
+    TEST_ASSERT(expectWords(3, 2, 5, 3, false, words), "Ragged edge is zero-padded");
+
+    // Transposed: tile(i, j) = src[j][i], source rows are contiguous
+    v.base = src.data() + 4 * Cn + 1;
+    v.rows = 8;
+    v.cols = 8;
+    v.transpose = true;
+    TileEncoder::encode(v, words);
+    TEST_ASSERT(expectWords(4, 1, 8, 8, true, words), "Transposed block (SIMD path)");
+
+    v.rows = 6;
+    v.cols = 7;
+    TileEncoder::encode(v, words);
+    TEST_ASSERT(expectWords(4, 1, 6, 7, true, words), "Ragged transposed block");
+
+    uint16_t in[64], simd[64], scalar[64];
+    for (int i = 0; i < 64; i++) in[i] = static_cast<uint16_t>(i * 997);
+    TileEncoder::transpose8x8(in, simd);
+    TileEncoder::transpose8x8Scalar(in, scalar);
+    TEST_ASSERT(std::equal(simd, simd + 64, scalar), "8x8 transpose matches scalar reference");
+
+    // Tiler with transposed operands: C = A^T * B^T
+    const size_t M = 11, N = 9, K = 13;
+    auto At = randomVector(K * M, 15);   // K x M
+    auto Bt = randomVector(N * K, 16);   // N x K
+    std::vector<float> C(M * N), expected(M * N, 0.0f);
+    for (size_t i = 0; i < M; i++)
+        for (size_t j = 0; j < N; j++)
+            for (size_t k = 0; k < K; k++)
+                expected[i * N + j] += At[k * M + i] * Bt[j * K + k];
+
+    ReferenceTPU tpu;
+    tiledGemm(tpu, M, N, K, At.data(), M, Bt.data(), K, C.data(), N, true, true);
+    TEST_ASSERT(maxAbsDiff(C, expected) < 1e-4f, "Transposed-operand GEMM matches reference");
+}
+
+// Test scratch arena reuse
+void test_arena() {
+    TEST_START("Scratch Arena");
+
+    Arena arena(256);
+    void* first;
+    {
+        Arena::Scope scope(arena);
+        first = arena.allocate(3, 1);
+        double* d = arena.allocateArray<double>(4);
+        TEST_ASSERT(reinterpret_cast<uintptr_t>(d) % alignof(double) == 0, "Allocations are aligned");
+        arena.allocateArray<float>(1000);   // spills into a larger block
+    }
+    size_t warm = arena.capacity();
+    {
+        Arena::Scope scope(arena);
+        TEST_ASSERT(arena.allocate(3, 1) == first, "Rewound memory is reused");
+        arena.allocateArray<double>(4);
+        arena.allocateArray<float>(1000);
+    }
+    TEST_ASSERT(arena.capacity() == warm, "Repeated pattern needs no new blocks");
+
+    // Strassen scratch from a caller-provided workspace
+    const size_t S = 24;
+    auto A = randomVector(S * S, 17);
+    auto B = randomVector(S * S, 18);
+    std::vector<float> C(S * S);
+    ReferenceTPU tpu;
+    GemmOptions options;
+    options.algorithm = GemmAlgorithm::Strassen1;
+    options.workspace = &arena;
+    GemmErrorReport report;
+    gemm(tpu, S, S, S, A.data(), S, B.data(), S, C.data(), S, options, &report);
+    warm = arena.capacity();
+    gemm(tpu, S, S, S, A.data(), S, B.data(), S, C.data(), S, options, &report);
+    TEST_ASSERT(report.relativeRms < 1e-5, "Strassen with workspace matches reference");
+    TEST_ASSERT(arena.capacity() == warm, "Workspace does not grow across calls");
+}
+
+// Test huge-page staging memory (falls back to plain pages / heap)
+void test_staging_memory() {
+    TEST_START("Staging Memory");
+
+    StagingOptions options;
+    options.backing = PageBacking::HugePages;
+    StagingBuffer<float> buffer(300000, options);
+    for (size_t i = 0; i < buffer.size(); i++) buffer[i] = static_cast<float>(i);
+    std::cout << "  staging pages: " << buffer.pageKind()
+              << ", node " << buffer.numaNode() << std::endl;
+    TEST_ASSERT(buffer[299999] == 299999.0f, "Staging buffer is usable");
+
+    StagingBuffer<float> moved(std::move(buffer));
+    TEST_ASSERT(moved.size() == 300000 && buffer.data() == nullptr, "Staging buffer moves ownership");
+
+    Arena arena(4096, options);
+    float* p = arena.allocateArray<float>(1024);
+    p[1023] = 1.0f;
+    TEST_ASSERT(arena.capacity() >= 4096, "Arena draws blocks from staging memory");
+    arena.reset();
+    arena.setStaging(StagingOptions());
+    TEST_ASSERT(arena.capacity() == 0 && arena.pageKind() == PageKind::Heap, "Arena can switch backing when idle");
+}
+
+// Test long-K reductions kept in the device accumulators
+void test_device_accumulation() {
+    TEST_START("Device FP32 Accumulation");
+
+    const size_t M = 8, N = 8, K = 256;
+    auto A = randomVector(M * K, 13);
+    auto B = randomVector(K * N, 14);
+    std::vector<float> C(M * N);
+
+    auto run = [&](AccumulatorMode mode, bool onDevice, uint64_t* linkBytes) {
+        auto emulator = std::make_unique<TPUEmulator>(mode);
+        TPUDriver tpu(std::move(emulator));
+        tpu.setVerbose(false);
+        GemmStats stats = onDevice
+            ? deviceAccumulatedGemm(tpu, M, N, K, A.data(), K, B.data(), N, C.data(), N)
+            : tiledGemm(tpu, M, N, K, A.data(), K, B.data(), N, C.data(), N);
+        TEST_ASSERT(stats.tileMultiplies == K / MATRIX_SIZE, "One pass per K tile");
+        *linkBytes = tpu.linkStats().bytesSent + tpu.linkStats().bytesReceived;
+        return measureGemmError(M, N, K, A.data(), K, B.data(), N, C.data(), N);
+    };
+
+    uint64_t hostBytes, fp32Bytes, fp16Bytes;
+    GemmErrorReport host = run(AccumulatorMode::FP32, false, &hostBytes);
+    GemmErrorReport fp32 = run(AccumulatorMode::FP32, true, &fp32Bytes);
+    GemmErrorReport fp16 = run(AccumulatorMode::FP16, true, &fp16Bytes);
+    std::cout << "  host " << host << "\n  fp32 " << fp32 << "\n  fp16 " << fp16 << std::endl;
+
+    TEST_ASSERT(fp32.relativeRms < 1e-3, "FP32 accumulators match the reference");
+    TEST_ASSERT(fp32.maxAbsError < host.maxAbsError, "No FP16 rounding of partial sums");
+    TEST_ASSERT(fp16.maxAbsError > 10 * fp32.maxAbsError, "FP16 accumulators lose precision over long K");
+    TEST_ASSERT(fp32Bytes < hostBytes, "One wide readback instead of one per K tile");
+
+    // Wide readback carries the accumulators bit for bit
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+    TPUDriver::Matrix w{}, a{};
+    for (size_t i = 0; i < MATRIX_SIZE; i++)
+        for (size_t j = 0; j < MATRIX_SIZE; j++) {
+            w[i][j] = A[i * K + j];
+            a[i][j] = B[i * N + j];
+        }
+    tpu.multiplyAccumulate(TPUDriver::view(w), TPUDriver::view(a), true);
+    tpu.multiplyAccumulate(TPUDriver::view(w), TPUDriver::view(a), false);
+    TPUDriver::Matrix wide = tpu.readResults(ReadbackFormat::Wide);
+    bool exact = true;
+    for (size_t i = 0; i < MATRIX_SIZE * MATRIX_SIZE; i++)
+        exact = exact && wide[i / MATRIX_SIZE][i % MATRIX_SIZE] == emu.accumulators()[i];
+    TEST_ASSERT(exact, "Wide readback returns the FP32 accumulators");
+
+    TPUDriver::Matrix once = tpu.matrixMultiply(w, a);
+    TEST_ASSERT(std::fabs(2.0f * once[1][2] - wide[1][2]) < 0.05f, "Accumulate start adds onto the previous run");
+}
+
+// Test runtime precision selection on the bit-accurate datapath model
+void test_precision_selection() {
+    TEST_START("Runtime Precision Selection");
+
+    const uint16_t onePlusUlp = 0x3C01, one = 0x3C00;
+    TEST_ASSERT(ApproxFP16::multiply(onePlusUlp, one, 11) == onePlusUlp, "Exact multiplier keeps every bit");
+    TEST_ASSERT(ApproxFP16::multiply(onePlusUlp, one, 6) == one, "Narrow multiplier drops low mantissa bits");
+    TEST_ASSERT(ApproxFP16::multiply(FP16::fromFloat(1.5f), FP16::fromFloat(-2.0f), 6) == FP16::fromFloat(-3.0f),
+                "Short mantissas multiply exactly");
+    const uint16_t big = FP16::fromFloat(1024.0f);
+    TEST_ASSERT(ApproxFP16::add(big, one, 15) == FP16::fromFloat(1025.0f), "Full window aligns distant operands");
+    TEST_ASSERT(ApproxFP16::add(big, one, 4) == big, "Narrow window drops distant operands");
+    TEST_ASSERT(ApproxFP16::add(FP16::fromFloat(3.0f), FP16::fromFloat(-3.0f), 4) == 0, "Cancellation gives +0");
+    TEST_ASSERT(ArrayPrecision::decode(ArrayPrecision::exact().encode()) == ArrayPrecision::exact(),
+                "Precision byte round-trips");
+
+    auto emulator = std::make_unique<TPUEmulator>(AccumulatorMode::FP16, EmulatedArithmetic::BitAccurate);
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+
+    auto values = randomVector(2 * MATRIX_SIZE * MATRIX_SIZE, 15);
+    TPUDriver::Matrix w{}, a{};
+    for (size_t i = 0; i < MATRIX_SIZE; i++)
+        for (size_t j = 0; j < MATRIX_SIZE; j++) {
+            w[i][j] = values[i * MATRIX_SIZE + j] + 1.0f / 1024.0f;
+            a[i][j] = values[64 + i * MATRIX_SIZE + j];
+        }
+
+    auto error = [&](const TPUDriver::Matrix& c) {
+        double err = 0.0;
+        for (size_t i = 0; i < MATRIX_SIZE; i++)
+            for (size_t j = 0; j < MATRIX_SIZE; j++) {
+                double ref = 0.0;
+                for (size_t k = 0; k < MATRIX_SIZE; k++) ref += double(w[i][k]) * a[k][j];
+                err = std::max(err, std::fabs(c[i][j] - ref));
+            }
+        return err;
+    };
+
+    double exactErr = error(tpu.matrixMultiply(w, a, ArrayPrecision::exact()));
+    TEST_ASSERT(emu.precision() == ArrayPrecision::exact(), "Per-call precision reaches the device");
+    uint64_t before = tpu.linkStats().bytesSent;
+    tpu.multiplyResident(a, ArrayPrecision::exact());
+    uint64_t sameSetting = tpu.linkStats().bytesSent - before;
+    double approxErr = error(tpu.matrixMultiply(w, a, ArrayPrecision::approximate()));
+    std::cout << "  max error exact " << exactErr << ", approximate " << approxErr << std::endl;
+
+    TEST_ASSERT(emu.precision() == ArrayPrecision::approximate(), "Switching back to approximate");
+    TEST_ASSERT(exactErr < 0.05 && exactErr < approxErr, "Exact mode is more accurate");
+    before = tpu.linkStats().bytesSent;
+    tpu.multiplyResident(a);
+    TEST_ASSERT(sameSetting == tpu.linkStats().bytesSent - before, "Unchanged precision is not re-sent");
+}
+
+// Test the per-layer precision tuner and the plan-driven MLP runner
+void test_precision_tuner() {
+    TEST_START("Precision Tuner");
+
+    const size_t sizes[] = {16, 32, 32, 8};
+    const size_t batch = 16;
+    MlpModel model;
+    for (size_t l = 0; l < 3; l++) {
+        DenseLayer layer;
+        layer.inputs = sizes[l];
+        layer.outputs = sizes[l + 1];
+        layer.weights = randomVector(layer.inputs * layer.outputs, 20 + l);
+        for (float& w : layer.weights) w /= std::sqrt(static_cast<float>(layer.inputs));
+        layer.bias = randomVector(layer.outputs, 30 + l);
+        layer.relu = l + 1 < 3;
+        model.push_back(layer);
+    }
+    auto calibration = randomVector(batch * sizes[0], 40);
+
+    TunerOptions options;
+    options.errorBudget = 0.02;
+    TunerReport report = tunePrecision(model, calibration.data(), batch, options);
+    std::cout << "  " << report << std::endl;
+
+    TEST_ASSERT(report.plan.layers.size() == model.size(), "One setting per layer");
+    TEST_ASSERT(report.withinBudget && report.measuredError <= options.errorBudget, "Plan meets the error budget");
+    TEST_ASSERT(report.relativeCost < 1.0, "Plan is cheaper than running everything exact");
+
+    options.errorBudget = 0.002;
+    TunerReport tight = tunePrecision(model, calibration.data(), batch, options);
+    TEST_ASSERT(tight.relativeCost >= report.relativeCost, "Tighter budget costs more");
+
+    std::stringstream text;
+    report.plan.save(text);
+    PrecisionPlan loaded = PrecisionPlan::load(text);
+    TEST_ASSERT(loaded.layers == report.plan.layers, "Plan survives save/load");
+
+    // The runner consumes the plan and reproduces the tuner's measurement
+    TPUDriver tpu(std::make_unique<TPUEmulator>(AccumulatorMode::FP16, EmulatedArithmetic::BitAccurate));
+    tpu.setVerbose(false);
+    auto out = runMlp(tpu, model, loaded, calibration.data(), batch);
+    auto ref = runMlpReference(model, calibration.data(), batch);
+    TEST_ASSERT(std::fabs(relativeRmsError(out, ref) - report.measuredError) < 1e-9, "Runner matches the tuned error");
+
+    PrecisionPlan wrong;
+    wrong.layers.resize(2);
+    bool threw = false;
+    try {
+        runMlp(tpu, model, wrong, calibration.data(), batch);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Mismatched plan is rejected");
+}
+
+void test_layer_chaining() {
+    TEST_START("On-Device Layer Chaining");
+
+    const size_t sizes[] = {8, 8, 6, 4};
+    const size_t batch = 8;
+    MlpModel model;
+    for (size_t l = 0; l < 3; l++) {
+        DenseLayer layer;
+        layer.inputs = sizes[l];
+        layer.outputs = sizes[l + 1];
+        layer.weights = randomVector(layer.inputs * layer.outputs, 50 + l);
+        layer.relu = l + 1 < 3;
+        model.push_back(layer);
+    }
+    auto input = randomVector(batch * sizes[0], 60);
+    PrecisionPlan plan;
+    plan.layers = {ArrayPrecision::exact(), ArrayPrecision::approximate(), ArrayPrecision::exact()};
+
+    TEST_ASSERT(chainableOnDevice(model, batch), "Single-tile model without bias chains");
+
+    TPUDriver host(std::make_unique<TPUEmulator>(AccumulatorMode::FP16, EmulatedArithmetic::BitAccurate));
+    host.setVerbose(false);
+    auto viaHost = runMlp(host, model, plan, input.data(), batch);
+
+    TPUDriver chained(std::make_unique<TPUEmulator>(AccumulatorMode::FP16, EmulatedArithmetic::BitAccurate));
+    chained.setVerbose(false);
+    auto viaDevice = runMlpChained(chained, model, plan, input.data(), batch);
+
+    TEST_ASSERT(viaDevice == viaHost, "Chained run matches the host round trip bit for bit");
+    uint64_t hostBytes = host.linkStats().bytesSent + host.linkStats().bytesReceived;
+    uint64_t chainBytes = chained.linkStats().bytesSent + chained.linkStats().bytesReceived;
+    printf("  link bytes: host round trip %llu, chained %llu\n",
+           static_cast<unsigned long long>(hostBytes), static_cast<unsigned long long>(chainBytes));
+    TEST_ASSERT(hostBytes - chainBytes >= 2 * 240, "Saves a readback and an upload per chained layer");
+
+    // Device ReLU on the copy
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+    emu.results()[0] = FP16::fromFloat(-1.5f);
+    emu.results()[1] = FP16::fromFloat(2.5f);
+    tpu.chainResults(DeviceActivation::ReLU);
+    TEST_ASSERT(emu.activations()[0] == 0 && emu.activations()[1] == FP16::fromFloat(2.5f),
+                "ReLU applied on the way into the activation buffer");
+    tpu.chainResults(DeviceActivation::None);
+    TEST_ASSERT(emu.activations() == emu.results(), "Plain copy keeps every result");
+
+    model[1].bias.assign(model[1].outputs, 0.5f);
+    TEST_ASSERT(chainableOnDevice(model, batch), "Bias is added by the device epilogue");
+    auto biasedHost = runMlp(host, model, plan, input.data(), batch);
+    auto biasedDevice = runMlpChained(chained, model, plan, input.data(), batch);
+    TEST_ASSERT(biasedDevice != viaDevice && maxAbsDiff(biasedDevice, biasedHost) < 0.02f,
+                "Device bias matches the host epilogue to FP16 rounding");
+
+    model[1].outputs = 12;
+    model[1].weights.resize(12 * model[1].inputs);
+    TEST_ASSERT(!chainableOnDevice(model, batch), "Layer wider than a tile does not chain");
+    bool threw = false;
+    try {
+        runMlpChained(chained, model, plan, input.data(), batch);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Unchainable model is rejected");
+}
+
+// Test the device job queue and result slots
+void test_job_queue() {
+    TEST_START("Device Job Queue");
+
+    const size_t M = 20, N = 28, K = 24;
+    auto A = randomVector(M * K, 66);
+    auto B = randomVector(K * N, 67);
+    std::vector<float> tiled(M * N), queued(M * N);
+
+    TPUDriver stopAndWait(std::make_unique<TPUEmulator>());
+    stopAndWait.setVerbose(false);
+    GemmStats s1 = tiledGemm(stopAndWait, M, N, K, A.data(), K, B.data(), N, tiled.data(), N);
+
+    TPUDriver streamed(std::make_unique<TPUEmulator>());
+    streamed.setVerbose(false);
+    GemmStats s2 = queuedGemm(streamed, M, N, K, A.data(), K, B.data(), N, queued.data(), N);
+
+    TEST_ASSERT(queued == tiled, "Queued GEMM matches tiledGemm bit for bit");
+    TEST_ASSERT(s2.weightUploads == s1.weightUploads && s2.tileMultiplies == s1.tileMultiplies,
+                "Same weight uploads and tile multiplies");
+    uint64_t tiledBytes = stopAndWait.linkStats().bytesSent + stopAndWait.linkStats().bytesReceived;
+    uint64_t queuedBytes = streamed.linkStats().bytesSent + streamed.linkStats().bytesReceived;
+    printf("  link bytes: stop-and-wait %llu, queued %llu\n",
+           static_cast<unsigned long long>(tiledBytes), static_cast<unsigned long long>(queuedBytes));
+    TEST_ASSERT(queuedBytes <= tiledBytes, "Framed jobs send no more than stop-and-wait");
+
+    // A full queue refuses jobs until the device drains it
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+    TPUDriver::Matrix w{}, a{};
+    for (size_t i = 0; i < MATRIX_SIZE; i++)
+        for (size_t j = 0; j < MATRIX_SIZE; j++) {
+            w[i][j] = A[i * K + j];
+            a[i][j] = B[i * N + j];
+        }
+    TPUDriver::Matrix expected = tpu.matrixMultiply(w, a);
+
+    emu.holdQueue(true);
+    DeviceJob job;
+    job.weights = TPUDriver::view(w);
+    job.activations = TPUDriver::view(a);
+    std::vector<JobTicket> tickets;
+    for (uint8_t slot = 0; slot < JOB_QUEUE_DEPTH; slot++) {
+        job.slot = slot;
+        tickets.push_back(tpu.submit(job));
+        job.weights.base = nullptr;   // later jobs reuse the resident weights
+    }
+    job.slot = DeviceJob::ANY_SLOT;
+    TEST_ASSERT(tpu.queueStatus().freeEntries == 0 && !tpu.tryEnqueue(job), "Full queue answers NACK");
+    TEST_ASSERT(emu.queuedJobs() == JOB_QUEUE_DEPTH, "Refused job is not queued");
+
+    emu.holdQueue(false);
+    QueueStatus status = tpu.queueStatus();
+    TEST_ASSERT(status.freeEntries == JOB_QUEUE_DEPTH && status.jobsCompleted == JOB_QUEUE_DEPTH,
+                "Released queue runs every job");
+    bool slotsMatch = true;
+    for (const JobTicket& t : tickets) {
+        slotsMatch = slotsMatch && tpu.collect(t) == expected;
+    }
+    TEST_ASSERT(slotsMatch, "Every result slot holds its job's product");
+
+    job.accumulate = true;
+    job.slot = 1;
+    TPUDriver::Matrix twice = tpu.collect(tpu.submit(job));
+    TEST_ASSERT(std::fabs(twice[2][3] - 2.0f * expected[2][3]) < 0.01f && tpu.readSlot(0) == expected,
+                "Accumulating job adds onto the previous run without touching other slots");
+}
+
+// Test tagged jobs collected out of submission order
+void test_out_of_order_readback() {
+    TEST_START("Out-of-Order Slot Readback");
+
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+
+    // Job i scales the identity weights by i + 1
+    std::vector<TPUDriver::Matrix> weights(6);
+    TPUDriver::Matrix a{};
+    for (size_t i = 0; i < MATRIX_SIZE; i++)
+        for (size_t j = 0; j < MATRIX_SIZE; j++)
+            a[i][j] = static_cast<float>(i * MATRIX_SIZE + j) / 16.0f;
+    for (size_t n = 0; n < weights.size(); n++)
+        for (size_t i = 0; i < MATRIX_SIZE; i++)
+            weights[n][i][i] = static_cast<float>(n + 1);
+
+    emu.holdQueue(true);
+    std::vector<JobTicket> tickets;
+    for (size_t n = 0; n < weights.size(); n++) {
+        DeviceJob job;
+        job.weights = TPUDriver::view(weights[n]);
+        job.activations = TPUDriver::view(a);
+        if (n >= JOB_QUEUE_DEPTH) emu.holdQueue(false);
+        tickets.push_back(tpu.submit(job));
+        if (n + 1 == JOB_QUEUE_DEPTH) {
+            TEST_ASSERT(tpu.readySlots() == 0, "No slot is ready while the queue is held");
+        }
+    }
+    TEST_ASSERT(tickets[0].slot == 0 && tickets[5].slot == 5, "ANY_SLOT picks free slots in order");
+    TEST_ASSERT(tpu.readySlots() == 0x3F && tpu.jobsInFlight() == 6, "Completed jobs flag their slots");
+
+    auto scaledBy = [&](const TPUDriver::Matrix& m, float f) {
+        return m[3][5] == f * a[3][5] && m[7][1] == f * a[7][1];
+    };
+    TEST_ASSERT(scaledBy(tpu.collect(tickets[4]), 5.0f) && scaledBy(tpu.collect(tickets[1]), 2.0f),
+                "Any ticket can be collected first");
+
+    JobTicket t;
+    TPUDriver::Matrix r;
+    size_t collected = 0;
+    bool inOrder = true;
+    while (tpu.collectAny(t, r)) {
+        inOrder = inOrder && scaledBy(r, static_cast<float>(t.sequence + 1));
+        collected++;
+    }
+    TEST_ASSERT(collected == 4 && inOrder && tpu.jobsInFlight() == 0, "collectAny drains the remaining slots");
+
+    bool threw = false;
+    try {
+        tpu.collect(tickets[4]);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "A ticket is collected only once");
+
+    DeviceJob job;
+    job.slot = 9;
+    tpu.submit(job);
+    threw = false;
+    try {
+        tpu.submit(job);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw && (tpu.readySlots() & (1u << 9)), "An uncollected slot cannot be reused");
+    for (size_t n = 1; n < RESULT_SLOTS; n++) {
+        tpu.submit(DeviceJob());
+    }
+    threw = false;
+    try {
+        tpu.submit(DeviceJob());
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw && tpu.jobsInFlight() == RESULT_SLOTS, "Submitting with every slot busy fails");
+}
+
+// Test direct writes issued while earlier jobs are still queued
+void test_writes_between_jobs() {
+    TEST_START("Direct Writes Between Queued Jobs");
+
+    auto values = randomVector(4 * 64, 105);
+    TPUDriver::Matrix w1{}, w2{}, a1{}, a2{};
+    for (size_t i = 0; i < 64; i++) {
+        w1[i / 8][i % 8] = values[i];
+        w2[i / 8][i % 8] = values[64 + i];
+        a1[i / 8][i % 8] = values[128 + i];
+        a2[i / 8][i % 8] = values[192 + i];
+    }
+    TPUDriver reference(std::make_unique<TPUEmulator>());
+    reference.setVerbose(false);
+    TPUDriver::Matrix w1a1 = reference.matrixMultiply(w1, a1);
+    TPUDriver::Matrix w2a1 = reference.matrixMultiply(w2, a1);
+    TPUDriver::Matrix w2a2 = reference.matrixMultiply(w2, a2);
+
+    for (bool cached : {false, true}) {
+        auto emulator = std::make_unique<TPUEmulator>();
+        TPUEmulator& emu = *emulator;
+        emu.deferJobs(true);
+        TPUDriver tpu(std::move(emulator));
+        tpu.setVerbose(false);
+        if (cached) tpu.enableResultCache(1 << 16);
+
+        DeviceJob job;
+        job.weights = TPUDriver::view(w1);
+        job.activations = TPUDriver::view(a1);
+        JobTicket first = tpu.submit(job);
+        if (!cached) {
+            uint8_t cmd = static_cast<uint8_t>(ProtocolCommand::WriteMatrixB), resp = 0;
+            emu.write(&cmd, 1);
+            emu.read(&resp, 1);
+            TEST_ASSERT(resp == RESP_NACK && emu.queuedJobs() == 1, "Device refuses direct writes while a job is pending");
+        }
+
+        // New weights, then a job on the resident ones: with the cache the
+        // upload happens inside submit()
+        tpu.writeWeights(w2);
+        job.weights.base = nullptr;
+        JobTicket second = tpu.submit(job);
+        tpu.writeActivations(a2);
+        job.activations.base = nullptr;
+        JobTicket third = tpu.submit(job);
+        TEST_ASSERT(emu.queuedJobs() == 1, cached ? "Staged upload drains the queue first"
+                                                  : "Direct writes drain the queue first");
+        TEST_ASSERT(tpu.collect(first) == w1a1 && tpu.collect(second) == w2a1 && tpu.collect(third) == w2a2,
+                    cached ? "Each job keeps its operands (cached driver)" : "Each job keeps its operands");
+    }
+
+    // Start and chaining also wait for pending jobs
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    emu.deferJobs(true);
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+    JobTicket ticket = tpu.submit(DeviceJob{TPUDriver::view(w1), TPUDriver::view(a1)});
+    TEST_ASSERT(tpu.matrixMultiply(w2, a2) == w2a2 && tpu.collect(ticket) == w1a1,
+                "Stop-and-wait multiply after a submit");
+    tpu.submit(DeviceJob{TPUDriver::view(w1), TPUDriver::view(a1)});
+    tpu.chainResults();
+    TEST_ASSERT(emu.queuedJobs() == 0 && emu.activations() == emu.results(), "Chaining runs after the queue drains");
+}
+
+// Test bias, residual and activation applied in the drain path
+void test_result_epilogue() {
+    TEST_START("Result Epilogue");
+
+    auto emulator = std::make_unique<TPUEmulator>();
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+
+    auto wv = randomVector(64, 70), av = randomVector(64, 71), rv = randomVector(64, 72);
+    auto bias = randomVector(6, 73);
+    TPUDriver::Matrix w{}, a{}, r{};
+    for (size_t i = 0; i < 64; i++) {
+        w[i / 8][i % 8] = wv[i];
+        a[i / 8][i % 8] = av[i];
+        r[i / 8][i % 8] = rv[i];
+    }
+    TPUDriver::Matrix plain = tpu.matrixMultiply(w, a);
+
+    tpu.writeBias(bias.data(), bias.size());
+    tpu.writeResidual(TPUDriver::view(r));
+    DeviceEpilogue epilogue;
+    epilogue.bias = true;
+    epilogue.residual = true;
+    epilogue.activation = DeviceActivation::ReLU;
+    tpu.setEpilogue(epilogue);
+    TPUDriver::Matrix fused = tpu.matrixMultiply(w, a);
+
+    bool exact = true, hostClose = true;
+    for (size_t i = 0; i < MATRIX_SIZE; i++) {
+        for (size_t j = 0; j < MATRIX_SIZE; j++) {
+            uint16_t v = FP16::fromFloat(plain[i][j]);
+            v = ApproxFP16::add(v, FP16::fromFloat(i < bias.size() ? bias[i] : 0.0f), 15);
+            v = ApproxFP16::add(v, FP16::fromFloat(r[i][j]), 15);
+            float expected = (v & 0x8000) ? 0.0f : FP16::toFloat(v);
+            exact = exact && fused[i][j] == expected;
+            float host = std::max(plain[i][j] + (i < bias.size() ? bias[i] : 0.0f) + r[i][j], 0.0f);
+            hostClose = hostClose && std::fabs(fused[i][j] - host) < 0.02f;
+        }
+    }
+    TEST_ASSERT(exact, "Epilogue matches the FP16 drain-path model bit for bit");
+    TEST_ASSERT(hostClose, "Fused output matches relu(W·A + b + R) on the host");
+    TEST_ASSERT(emu.bias()[6] == 0 && emu.bias()[7] == 0, "Bias is zero-padded to the tile");
+
+    uint64_t before = tpu.linkStats().bytesSent;
+    tpu.setEpilogue(epilogue);
+    TEST_ASSERT(tpu.linkStats().bytesSent == before, "Unchanged epilogue is not re-sent");
+
+    // Accumulators and wide readback are not touched
+    TPUDriver::Matrix wide = tpu.readResults(ReadbackFormat::Wide);
+    TEST_ASSERT(std::fabs(wide[1][1] - plain[1][1]) < 1e-2f, "Wide results bypass the epilogue");
+
+    // Queued jobs drain through it as well
+    DeviceJob job;
+    job.weights = TPUDriver::view(w);
+    job.activations = TPUDriver::view(a);
+    TEST_ASSERT(tpu.collect(tpu.submit(job)) == fused, "Queued jobs get the epilogue");
+    tpu.setEpilogue(DeviceEpilogue());
+    TEST_ASSERT(tpu.collect(tpu.submit(job)) == plain, "Disabled epilogue leaves results alone");
+
+    bool threw = false;
+    try {
+        float tooMany[MATRIX_SIZE + 1] = {};
+        tpu.writeBias(tooMany, MATRIX_SIZE + 1);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Bias longer than a tile is rejected");
+}
+
+// Test result memoization in front of the device
+void test_result_cache() {
+    TEST_START("Result Cache");
+
+    TEST_ASSERT(xxh64("", 0) == 0xEF46DB3751D8E999ULL, "XXH64 of the empty input");
+    TEST_ASSERT(xxh64("abc", 3) == 0x44BC2CF5AD770999ULL, "XXH64 of \"abc\"");
+
+    // Known answers from the reference libxxhash over bytes 0, 1, 2, ...:
+    // every tail path (8/4/1-byte), the 32-byte stripe loop, and seeds
+    struct { size_t offset, len; uint64_t seed, hash; } vectors[] = {
+        {0, 1, 0, 0xE934A84ADB052768ULL},
+        {0, 7, 0, 0x14CC643F630C72D2ULL},
+        {0, 14, 0, 0x5CDA8B69BBFC1D45ULL},
+        {0, 31, 0, 0xC346D2B59B4D8EE1ULL},
+        {0, 32, 0, 0xCBF59C5116FF32B4ULL},
+        {0, 33, 0, 0x0C535D1ACAFB8EADULL},
+        {0, 67, 0, 0x37D336F497002EE1ULL},
+        {0, 255, 0, 0x0F7D97507CAAD693ULL},
+        {3, 45, 0, 0x967DB06BF8E0AD8DULL},
+        {0, 37, 1, 0x31FE76EB4FF1CF74ULL},
+        {0, 128, 0x9E3779B97F4A7C15ULL, 0xA505233797BE6D6EULL},
+    };
+    uint8_t bytes[256];
+    for (size_t i = 0; i < sizeof(bytes); i++) bytes[i] = static_cast<uint8_t>(i);
+    bool allMatch = true;
+    for (const auto& v : vectors) {
+        allMatch = allMatch && xxh64(bytes + v.offset, v.len, v.seed) == v.hash;
+    }
+    TEST_ASSERT(allMatch, "XXH64 matches reference vectors (long, ragged, unaligned, seeded)");
+
+    TPUDriver tpu(std::make_unique<TPUEmulator>());
+    TPUDriver plain(std::make_unique<TPUEmulator>());
+    tpu.setVerbose(false);
+    plain.setVerbose(false);
+    tpu.enableResultCache(1 << 20);
+
+    auto values = randomVector(4 * 64, 80);
+    TPUDriver::Matrix w{}, a{}, w2{}, a2{};
+    for (size_t i = 0; i < 64; i++) {
+        w[i / 8][i % 8] = values[i];
+        a[i / 8][i % 8] = values[64 + i];
+        w2[i / 8][i % 8] = values[128 + i];
+        a2[i / 8][i % 8] = values[192 + i];
+    }
+
+    TPUDriver::Matrix first = tpu.matrixMultiply(w, a);
+    tpu.matrixMultiply(w2, a2);
+    uint64_t before = tpu.linkStats().bytesSent + tpu.linkStats().bytesReceived;
+    TPUDriver::Matrix again = tpu.matrixMultiply(w, a);
+    TEST_ASSERT(again == first, "Hit returns the device result");
+    TEST_ASSERT(tpu.linkStats().bytesSent + tpu.linkStats().bytesReceived == before, "Hit does no device I/O");
+    TEST_ASSERT(tpu.resultCacheStats().hits == 1 && tpu.resultCacheStats().misses == 2, "Hits and misses counted");
+
+    // The skipped run is caught up on when device state is relied on
+    TEST_ASSERT(tpu.multiplyResident(a2) == plain.matrixMultiply(w, a2),
+                "Resident weights after a hit are the hit's weights");
+    tpu.matrixMultiply(w, a);
+    TEST_ASSERT(tpu.readResults() == first, "Result buffer after a hit holds the hit's result");
+
+    tpu.setPrecision(ArrayPrecision::exact());
+    uint64_t misses = tpu.resultCacheStats().misses;
+    tpu.matrixMultiply(w, a);
+    TEST_ASSERT(tpu.resultCacheStats().misses == misses + 1, "Precision is part of the key");
+
+    DeviceEpilogue epilogue;
+    epilogue.bias = true;
+    tpu.setEpilogue(epilogue);
+    CacheStats bypassed = tpu.resultCacheStats();
+    tpu.matrixMultiply(w, a);
+    tpu.matrixMultiply(w, a);
+    TEST_ASSERT(tpu.resultCacheStats().hits == bypassed.hits &&
+                tpu.resultCacheStats().misses == bypassed.misses, "Bias epilogue bypasses the cache");
+    tpu.setEpilogue(DeviceEpilogue());
+
+    // Memory cap: two entries, least recently used goes first
+    tpu.disableResultCache();
+    tpu.enableResultCache(2 * ResultCache::ENTRY_BYTES);
+    tpu.matrixMultiply(w, a);
+    tpu.matrixMultiply(w, a2);
+    tpu.matrixMultiply(w, a);
+    tpu.matrixMultiply(w2, a2);
+    CacheStats capped = tpu.resultCacheStats();
+    TEST_ASSERT(capped.entries == 2 && capped.evictions == 1 && capped.bytes <= 2 * ResultCache::ENTRY_BYTES,
+                "Budget evicts down to the cap");
+    tpu.matrixMultiply(w, a);
+    TEST_ASSERT(tpu.resultCacheStats().hits == capped.hits + 1, "Recently used entry survives");
+
+    // A repeated tiled GEMM is answered without the link, weights included
+    const size_t M = 16, N = 24, K = 16;
+    auto A = randomVector(M * K, 81), B = randomVector(K * N, 82);
+    std::vector<float> C1(M * N), C2(M * N);
+    tpu.enableResultCache(1 << 20);
+    tiledGemm(tpu, M, N, K, A.data(), K, B.data(), N, C1.data(), N);
+    before = tpu.linkStats().bytesSent;
+    tiledGemm(tpu, M, N, K, A.data(), K, B.data(), N, C2.data(), N);
+    TEST_ASSERT(C1 == C2 && tpu.linkStats().bytesSent == before, "Repeated GEMM sends nothing");
+    std::cout << "  " << tpu.resultCacheStats() << std::endl;
+}
+
+// Test link trace recording and replay
+void test_trace_replay() {
+    TEST_START("Trace Recording and Replay");
+
+    std::FILE* file = std::tmpfile();
+    TEST_ASSERT(file != nullptr, "Temporary trace file");
+    if (!file) return;
+
+    auto values = randomVector(128, 90);
+    TPUDriver::Matrix w{}, a{};
+    for (size_t i = 0; i < 64; i++) {
+        w[i / 8][i % 8] = values[i];
+        a[i / 8][i % 8] = values[64 + i];
+    }
+
+    LinkStats link;
+    TraceStats traced;
+    {
+        TraceRecorder recorder(file);
+        TPUDriver tpu(std::make_unique<TracingTransport>(std::make_unique<TPUEmulator>(), recorder));
+        tpu.setVerbose(false);
+        tpu.setPrecision(ArrayPrecision::exact());
+        tpu.matrixMultiply(w, a);
+        tpu.readResults(ReadbackFormat::Compressed);
+        link = tpu.linkStats();
+        recorder.stop();
+        traced = recorder.stats();
+    }
+    std::rewind(file);
+    std::vector<TraceRecord> records = readTrace(file);
+    std::fclose(file);
+
+    uint64_t tx = 0, rx = 0;
+    size_t commands = 0;
+    bool ordered = true;
+    for (size_t i = 0; i < records.size(); i++) {
+        (records[i].direction == TraceDirection::Tx ? tx : rx) += records[i].bytes.size();
+        commands += (records[i].flags & TraceFlags::COMMAND) != 0;
+        ordered = ordered && (i == 0 || records[i].timeNs >= records[i - 1].timeNs);
+    }
+    TEST_ASSERT(traced.dropped == 0 && records.size() == traced.records, "Every record reaches the file");
+    TEST_ASSERT(tx == link.bytesSent && rx == link.bytesReceived, "Trace holds every byte on the link");
+    TEST_ASSERT(ordered, "Timestamps are monotonic");
+    TEST_ASSERT(records.front().flags & TraceFlags::COMMAND &&
+                records.front().bytes[0] == static_cast<uint8_t>(ProtocolCommand::SetPrecision),
+                "Command boundaries are marked");
+
+    TPUEmulator target;
+    ReplayReport report = replayTrace(records, target);
+    TEST_ASSERT(report.commands.size() == commands && report.mismatches == 0,
+                "Replay against the emulator reproduces every response");
+
+    // A response that differs from the recording is reported
+    for (auto& r : records) {
+        if (r.direction == TraceDirection::Rx && r.bytes.size() > 1) {
+            r.bytes[1] ^= 0x01;
+            break;
+        }
+    }
+    TPUEmulator other;
+    TEST_ASSERT(replayTrace(records, other).mismatches == 1, "Replay flags a changed response");
+
+    // A full ring drops records instead of blocking, and says so
+    std::FILE* small = std::tmpfile();
+    if (small) {
+        TraceRecorder recorder(small, 64, std::chrono::milliseconds(1000));
+        uint8_t payload[40] = {};
+        recorder.record(TraceDirection::Tx, TraceFlags::COMMAND, payload, sizeof(payload));
+        recorder.record(TraceDirection::Tx, 0, payload, sizeof(payload));
+        TEST_ASSERT(recorder.stats().dropped == 1, "Full ring drops the record");
+        recorder.stop();
+        recorder.record(TraceDirection::Rx, 0, payload, 1);
+        std::rewind(small);
+        TEST_ASSERT(readTrace(small).size() == 1, "Stopped recorder keeps what was buffered");
+        std::fclose(small);
+    }
+}
+
+// Test the fault-injecting link
+void test_fault_injection() {
+    TEST_START("Fault Injection");
+
+    auto values = randomVector(128, 95);
+    TPUDriver::Matrix w{}, a{};
+    for (size_t i = 0; i < 64; i++) {
+        w[i / 8][i % 8] = values[i];
+        a[i / 8][i % 8] = values[64 + i];
+    }
+    TPUDriver reference(std::make_unique<TPUEmulator>());
+    reference.setVerbose(false);
+    TPUDriver::Matrix expected = reference.matrixMultiply(w, a);
+
+    auto faulty = [](const FaultProfile& profile, FaultInjectingTransport*& link) {
+        auto wrapped = std::make_unique<FaultInjectingTransport>(
+            std::make_unique<TPUEmulator>(), profile, std::chrono::microseconds(200));
+        link = wrapped.get();
+        auto tpu = std::make_unique<TPUDriver>(std::move(wrapped));
+        tpu->setVerbose(false);
+        return tpu;
+    };
+    auto fails = [&](TPUDriver& tpu) {
+        try {
+            tpu.matrixMultiply(w, a);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+
+    FaultInjectingTransport* link = nullptr;
+    auto clean = faulty(FaultProfile::clean(), link);
+    TEST_ASSERT(clean->matrixMultiply(w, a) == expected && link->stats().total() == 0,
+                "Clean profile is transparent");
+
+    auto lossy = faulty(FaultProfile::lossy(1.0), link);
+    TEST_ASSERT(fails(*lossy) && link->stats().droppedBytes > 0, "Dropped bytes break the transaction");
+
+    FaultProfile flips = FaultProfile::noisy(0.01);
+    flips.seed = 7;
+    FaultStats first, second;
+    bool corrupted = false;
+    for (FaultStats* stats : {&first, &second}) {
+        auto noisy = faulty(flips, link);
+        for (int i = 0; i < 4; i++) {
+            try {
+                bool wrong = noisy->matrixMultiply(w, a) != expected;
+                corrupted = corrupted || wrong;
+            } catch (const std::runtime_error&) {
+                corrupted = true;
+            }
+        }
+        *stats = link->stats();
+    }
+    TEST_ASSERT(first.flippedBytes > 0 && corrupted, "Bit flips corrupt the traffic");
+    TEST_ASSERT(first.flippedBytes == second.flippedBytes, "Same seed, same faults");
+
+    auto slow = faulty(FaultProfile::slow(1.0, std::chrono::microseconds(50)), link);
+    TEST_ASSERT(slow->matrixMultiply(w, a) == expected && link->stats().delays > 0,
+                "Delayed responses still complete");
+
+    auto stalled = faulty(FaultProfile::stalling(1.0, std::chrono::microseconds(5000)), link);
+    TEST_ASSERT(fails(*stalled) && link->stats().timeouts > 0, "Stall longer than the read timeout times out");
+}
+
+void test_pipelined_mac() {
+    TEST_START("Pipelined MAC Model");
+
+    // Cycle model of the RTL against the lane-order bit model, every build
+    bool cycleExact = true;
+    for (unsigned m = 1; m <= 4; m++) {
+        for (unsigned a = 1; a <= 4; a++) {
+            MacPipeline pipeline{m, a};
+            if (!pipeline.pipelined()) continue;   // fp16_approx_mac_unit
+            PipelinedMac mac(pipeline);
+            uint16_t total = 0;
+            for (int run = 0; run < 3; run++) {
+                size_t n = 5 + run * 7;
+                auto av = randomVector(n, 80 + run), wv = randomVector(n, 90 + run);
+                std::vector<uint16_t> act(n), wt(n), prods(n);
+                for (size_t k = 0; k < n; k++) {
+                    act[k] = FP16::fromFloat(av[k], FP16Mode::Hardware);
+                    wt[k] = FP16::fromFloat(wv[k], FP16Mode::Hardware);
+                    prods[k] = ApproxFP16::multiply(act[k], wt[k], 11);
+                }
+                bool clear = run != 1;   // run 1 accumulates onto run 0
+                for (size_t k = 0; k < n; k++) {
+                    mac.clock(true, clear && k == 0, false, act[k], wt[k]);
+                }
+                for (unsigned c = 0; c < pipeline.drainCycles(); c++) {
+                    mac.clock(true, false, true, 0, 0);
+                }
+                total = accumulateLanes(prods.data(), n, a, 15, clear ? 0 : total);
+                cycleExact = cycleExact && mac.parked() && mac.accOut() == total;
+            }
+        }
+    }
+    TEST_ASSERT(cycleExact, "Cycle model folds to the lane-order sum within drainCycles()");
+
+    // Emulator in the pipelined build's summation order
+    auto emulator = std::make_unique<TPUEmulator>(AccumulatorMode::FP16, EmulatedArithmetic::BitAccurate);
+    TPUEmulator& emu = *emulator;
+    TPUDriver tpu(std::move(emulator));
+    tpu.setVerbose(false);
+    tpu.setPrecision(ArrayPrecision::exact());
+
+    auto wv = randomVector(64, 81), av = randomVector(64, 82);
+    TPUDriver::Matrix w{}, x{};
+    for (size_t i = 0; i < 64; i++) {
+        w[i / 8][i % 8] = wv[i];
+        x[i / 8][i % 8] = av[i];
+    }
+    TPUDriver::Matrix single = tpu.matrixMultiply(w, x);
+    emu.setMacPipeline({2, 4});
+    TPUDriver::Matrix laned = tpu.matrixMultiply(w, x);
+
+    bool laneExact = true, close = true;
+    for (size_t i = 0; i < MATRIX_SIZE; i++) {
+        for (size_t j = 0; j < MATRIX_SIZE; j++) {
+            uint16_t prods[MATRIX_SIZE];
+            for (size_t k = 0; k < MATRIX_SIZE; k++) {
+                prods[k] = ApproxFP16::multiply(emu.weights()[i * 8 + k], emu.activations()[k * 8 + j], 11);
+            }
+            laneExact = laneExact &&
+                        laned[i][j] == FP16::toFloat(accumulateLanes(prods, MATRIX_SIZE, 4, 15));
+            close = close && std::fabs(laned[i][j] - single[i][j]) < 0.02f;
+        }
+    }
+    TEST_ASSERT(laneExact, "Emulator sums in 4 interleaved lanes");
+    TEST_ASSERT(close, "Lane order changes results by FP16 rounding only");
+
+    // Throughput predictions
+    TimingModel base;
+    TEST_ASSERT(base.computeCycles() == 31 && base.runCycles() == 42, "Single-cycle PEs: 31-cycle COMPUTE");
+    TimingModel fast;
+    fast.pipeline = {2, 2};
+    fast.clockHz = 150e6;
+    TEST_ASSERT(fast.computeCycles() == 31 + 8, "Drain adds multStages + lanes * (lanes + 1) cycles");
+    TEST_ASSERT(fast.macsPerSecond() > base.macsPerSecond(), "Higher clock outweighs the drain");
+
+    bool threw = false;
+    try {
+        emu.setMacPipeline({1, 5});
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "More than 4 adder stages is rejected");
+}
+
+// Main test runner
+void test_link_recovery() {
+    TEST_START("Link Recovery");
+
+    auto values = randomVector(128, 97);
+    TPUDriver::Matrix w{}, a{};
+    for (size_t i = 0; i < 64; i++) {
+        w[i / 8][i % 8] = values[i];
+        a[i / 8][i % 8] = values[64 + i];
+    }
+    TPUDriver reference(std::make_unique<TPUEmulator>());
+    reference.setVerbose(false);
+    TPUDriver::Matrix expected = reference.matrixMultiply(w, a);
+    TPUDriver::Matrix expectedWide = reference.matrixMultiply(w, a, ReadbackFormat::Wide);
+
+    auto emulator = std::make_unique<TPUEmulator>();
+    emulator->setIdleTimeout(std::chrono::microseconds(1000));
+    TPUEmulator* device = emulator.get();
+    auto wrapped = std::make_unique<FaultInjectingTransport>(
+        std::move(emulator), FaultProfile::lossy(2e-3), std::chrono::microseconds(200));
+    FaultInjectingTransport* link = wrapped.get();
+    TPUDriver tpu(std::move(wrapped));
+    tpu.setVerbose(false);
+    RecoveryPolicy policy;
+    policy.enabled = true;
+    policy.maxRetries = 8;
+    policy.idleFlush = std::chrono::microseconds(2000);
+    tpu.setRecovery(policy);
+    tpu.setPrecision(ArrayPrecision::exact());
+
+    bool allMatch = true;
+    for (int i = 0; i < 12; i++) {
+        bool match = i % 2 ? tpu.matrixMultiply(w, a, ReadbackFormat::Wide) == expectedWide
+                           : tpu.matrixMultiply(w, a) == expected;
+        allMatch = allMatch && match;
+    }
+    DeviceJob job;
+    job.weights = TPUDriver::view(w);
+    job.activations = TPUDriver::view(a);
+    std::vector<JobTicket> tickets;
+    for (int i = 0; i < 4; i++) tickets.push_back(tpu.submit(job));
+    for (const JobTicket& t : tickets) {
+        bool match = tpu.collect(t) == expected;
+        allMatch = allMatch && match;
+    }
+    const RecoveryStats& stats = tpu.recoveryStats();
+    TEST_ASSERT(link->stats().droppedBytes > 0 && stats.retries > 0, "Dropped bytes are retried");
+    TEST_ASSERT(allMatch && stats.failedOperations == 0, "Every operation completes with the right result");
+    TEST_ASSERT(stats.resyncs == stats.linkErrors && device->droppedFrames() > 0,
+                "Each link error resyncs; the device drops the partial frame");
+    TEST_ASSERT(device->precision() == ArrayPrecision::exact(), "Precision survives the resync");
+
+    // An accumulating run is not repeated: resync, then report
+    link->setProfile(FaultProfile::lossy(1.0));
+    bool threw = false;
+    try {
+        tpu.startAccumulate();
+    } catch (const LinkError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw && tpu.recoveryStats().failedResyncs > 0, "Unreachable device is reported");
+    link->setProfile(FaultProfile::clean());
+    tpu.resync();
+    TEST_ASSERT(tpu.matrixMultiply(w, a, ReadbackFormat::Wide) == expectedWide,
+                "Manual resync restores the link");
+}
+
+/**
+ * Damages the next transaction that starts with `cmd`: loses host byte
+ * `index` (dropSent) or the device's whole reply (dropReply), or inverts
+ * bit 0 of host byte `index` (flipSent) or of reply byte `index` (flipReply)
+ */
+class FaultOnceTransport : public Transport {
+public:
+    explicit FaultOnceTransport(std::unique_ptr<Transport> inner) : inner_(std::move(inner)) {}
+
+    void dropSent(uint8_t cmd, size_t index) { arm(cmd, index, Fault::DropSent); }
+    void dropReply(uint8_t cmd) { arm(cmd, 0, Fault::DropReply); }
+    void flipSent(uint8_t cmd, size_t index) { arm(cmd, index, Fault::FlipSent); }
+    void flipReply(uint8_t cmd, size_t index) { arm(cmd, index, Fault::FlipReply); }
+
+    void beginCommand() override {
+        inner_->beginCommand();
+        starting_ = true;
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        if (starting_ && len > 0) {
+            active_ = armed_ && data[0] == cmd_;
+            sent_ = received_ = 0;
+            starting_ = false;
+        }
+        if (!active_ || fault_ == Fault::FlipReply) {
+            return inner_->write(data, len);
+        }
+        for (size_t i = 0; i < len; i++, sent_++) {
+            uint8_t b = data[i];
+            if (fault_ != Fault::DropReply && sent_ == index_) {
+                armed_ = active_ = false;
+                if (fault_ == Fault::DropSent) continue;
+                b ^= 0x01;
+            }
+            inner_->write(&b, 1);
+        }
+        if (fault_ == Fault::DropReply) {
+            inner_->discardInput();
+            armed_ = active_ = false;
+        }
+        return len;
+    }
+
+    size_t read(uint8_t* buffer, size_t len) override {
+        size_t n = inner_->read(buffer, len);
+        if (active_ && fault_ == Fault::FlipReply) {
+            for (size_t i = 0; i < n; i++, received_++) {
+                if (received_ == index_) {
+                    buffer[i] ^= 0x01;
+                    armed_ = active_ = false;
+                    break;
+                }
+            }
+        }
+        return n;
+    }
+
+private:
+    enum class Fault { DropSent, DropReply, FlipSent, FlipReply };
+
+    void arm(uint8_t cmd, size_t index, Fault fault) {
+        cmd_ = cmd;
+        index_ = index;
+        fault_ = fault;
+        armed_ = true;
+    }
+
+    std::unique_ptr<Transport> inner_;
+    uint8_t cmd_ = 0;
+    size_t index_ = 0;
+    Fault fault_ = Fault::DropSent;
+    size_t sent_ = 0;
+    size_t received_ = 0;
+    bool armed_ = false;
+    bool active_ = false;
+    bool starting_ = false;
+};
+
+// Test that a retried enqueue never leaves the device a job ahead of the tickets
+void test_enqueue_recovery() {
+    TEST_START("Enqueue Recovery");
+
+    auto values = randomVector(192, 98);
+    TPUDriver::Matrix w{}, w2{}, a{};
+    for (size_t i = 0; i < 64; i++) {
+        w[i / 8][i % 8] = values[i];
+        w2[i / 8][i % 8] = values[64 + i];
+        a[i / 8][i % 8] = values[128 + i];
+    }
+    TPUDriver reference(std::make_unique<TPUEmulator>());
+    reference.setVerbose(false);
+    TPUDriver::Matrix expected = reference.matrixMultiply(w, a);
+    TPUDriver::Matrix expected2 = reference.matrixMultiply(w2, a);
+
+    // Deferred jobs: each status poll runs one, so stale slots are visible
+    auto emulator = std::make_unique<TPUEmulator>();
+    emulator->deferJobs(true);
+    TPUEmulator* device = emulator.get();
+    auto wrapped = std::make_unique<FaultOnceTransport>(std::move(emulator));
+    FaultOnceTransport* link = wrapped.get();
+    TPUDriver tpu(std::move(wrapped));
+    tpu.setVerbose(false);
+    RecoveryPolicy policy;
+    policy.enabled = true;
+    policy.idleFlush = std::chrono::microseconds(200);
+    tpu.setRecovery(policy);
+    tpu.writeWeights(w);
+    tpu.writeActivations(a);
+
+    const uint8_t enqueue = static_cast<uint8_t>(ProtocolCommand::EnqueueJob);
+    DeviceJob resident;
+    resident.slot = 1;
+    DeviceJob loaded;
+    loaded.weights = TPUDriver::view(w2);
+    loaded.activations = TPUDriver::view(a);
+    loaded.slot = 2;
+
+    // Lost ACK of a job without payload: the device has queued it already
+    link->dropReply(enqueue);
+    JobTicket t1 = tpu.submit(resident);
+    JobTicket t2 = tpu.submit(loaded);
+    TEST_ASSERT(device->computeCount() + device->queuedJobs() == 2, "Lost ACK does not queue the job twice");
+    tpu.queueStatus();
+    tpu.queueStatus();
+    bool inOrder = tpu.collect(t2) == expected2;
+    TEST_ASSERT(inOrder && tpu.collect(t1) == expected, "Tickets stay in step with the device's jobs");
+
+    // Lost payload byte: the status probe completes the frame, so a job
+    // with shifted operands is queued; it is discarded and sent again
+    link->dropSent(enqueue, 2 + 10);
+    loaded.slot = 3;
+    JobTicket t3 = tpu.submit(loaded);
+    TEST_ASSERT(tpu.collect(t3) == expected2, "Damaged job is sent again; collect waits for the resend");
+    loaded.slot = 4;
+    JobTicket t4 = tpu.submit(loaded);
+    TEST_ASSERT(tpu.collect(t4) == expected2 && tpu.recoveryStats().failedOperations == 0,
+                "Later jobs are collected after their own run");
+
+    // An accumulating job must not run twice
+    link->dropSent(enqueue, 2 + 10);
+    loaded.accumulate = true;
+    bool threw = false;
+    try {
+        tpu.submit(loaded);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw && tpu.jobsInFlight() == 0, "Accumulating job that may have run damaged is reported");
+}
+
+// Test that flipped payload and readback bytes fail the checksum and are repeated
+void test_payload_check() {
+    TEST_START("Payload Checksums");
+
+    auto values = randomVector(64 * 8, 99);
+    TPUDriver::Matrix m[8];
+    for (size_t k = 0; k < 8; k++) {
+        for (size_t i = 0; i < 64; i++) m[k][i / 8][i % 8] = values[64 * k + i];
+    }
+    TPUDriver reference(std::make_unique<TPUEmulator>());
+    reference.setVerbose(false);
+    TPUDriver::Matrix expected[4];
+    for (size_t k = 0; k < 4; k++) expected[k] = reference.matrixMultiply(m[2 * k], m[2 * k + 1]);
+
+    auto checksum = [](const TPUEmulator::Memory& mem) { return bufferChecksum(mem.data(), mem.size()); };
+    TPUEmulator::Memory words{};
+    for (size_t i = 0; i < words.size(); i++) words[i] = static_cast<uint16_t>(i * 0x0101);
+    uint32_t sums = checksum(words);
+    words[17] ^= 0x0100;
+    TEST_ASSERT(checksum(words) != sums, "One flipped bit changes the checksum");
+
+    auto emulator = std::make_unique<TPUEmulator>();
+    auto wrapped = std::make_unique<FaultOnceTransport>(std::move(emulator));
+    FaultOnceTransport* link = wrapped.get();
+    TPUDriver tpu(std::move(wrapped));
+    tpu.setVerbose(false);
+    RecoveryPolicy policy;
+    policy.enabled = true;
+    policy.idleFlush = std::chrono::microseconds(200);
+    tpu.setRecovery(policy);
+
+    // Payload byte 1 + 20 is the low byte of word 10
+    link->flipSent(static_cast<uint8_t>(ProtocolCommand::WriteMatrixB), 1 + 20);
+    TEST_ASSERT(tpu.matrixMultiply(m[0], m[1]) == expected[0] && tpu.recoveryStats().retries == 1,
+                "Flipped weight byte is caught and the upload repeated");
+
+    link->flipSent(static_cast<uint8_t>(ProtocolCommand::WriteMatrixA), 1 + 7);
+    TEST_ASSERT(tpu.matrixMultiply(m[2], m[3]) == expected[1] && tpu.recoveryStats().retries == 2,
+                "Flipped activation byte is caught and the upload repeated");
+
+    // Reply byte 0 is the ACK
+    link->flipReply(static_cast<uint8_t>(ProtocolCommand::ReadResult), 1 + 33);
+    TEST_ASSERT(tpu.matrixMultiply(m[4], m[5]) == expected[2] && tpu.recoveryStats().retries == 3,
+                "Flipped result byte is caught and the readback repeated");
+
+    DeviceJob job;
+    job.weights = TPUDriver::view(m[6]);
+    job.activations = TPUDriver::view(m[7]);
+    job.slot = 6;
+    JobTicket ticket = tpu.submit(job);
+    link->flipReply(static_cast<uint8_t>(ProtocolCommand::ReadSlot), 1 + 100);
+    TEST_ASSERT(tpu.collect(ticket) == expected[3], "Flipped slot byte is caught and the readback repeated");
+
+    // Delta upload of one changed element: a four-byte range header, then the word
+    tpu.setUploadMode(UploadMode::Delta);
+    TPUDriver::Matrix a = m[1];
+    tpu.writeActivations(a);
+    a[3][5] += 1.0f;
+    link->flipSent(static_cast<uint8_t>(ProtocolCommand::WriteRange), 4 + 1);
+    uint64_t retries = tpu.recoveryStats().retries;
+    TEST_ASSERT(tpu.matrixMultiply(m[0], a) == reference.matrixMultiply(m[0], a) &&
+                tpu.recoveryStats().retries == retries + 1,
+                "Flipped delta byte is caught against the whole tile");
+    TEST_ASSERT(tpu.recoveryStats().failedOperations == 0, "No operation fails");
+
+    // Without a RecoveryPolicy nothing is checked
+    tpu.setRecovery(RecoveryPolicy{});
+    link->flipReply(static_cast<uint8_t>(ProtocolCommand::ReadResult), 1 + 33);
+    TEST_ASSERT(tpu.matrixMultiply(m[4], m[5]) != expected[2], "Unchecked flip reaches the caller");
+}
+
+#ifndef _WIN32
+/**
+ * One HTTP GET against a metrics endpoint; the raw response
+ */
+static std::string httpGet(const sockaddr* addr, socklen_t len, const char* path) {
+    int fd = ::socket(addr->sa_family, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, addr, len) < 0) {
+        if (fd >= 0) ::close(fd);
+        return "";
+    }
+    std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ::send(fd, request.data(), request.size(), 0);
+    std::string response;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return response;
+}
+#endif
+
+void test_metrics() {
+    TEST_START("Metrics Exporter");
+
+    MetricsRegistry registry;
+    Counter& events = registry.counter("test_events_total", "Events");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&events] {
+            for (int i = 0; i < 10000; i++) events.add();
+        });
+    }
+    for (auto& t : threads) t.join();
+    TEST_ASSERT(events.value() == 40000, "Per-thread shards sum on scrape");
+    TEST_ASSERT(&registry.counter("test_events_total", "Events") == &events, "Registering again returns the series");
+    bool typeThrew = false, scaleThrew = false;
+    try {
+        registry.histogram("test_events_total", "Events");
+    } catch (const std::invalid_argument&) {
+        typeThrew = true;
+    }
+    try {
+        registry.counter("test_events_total", "Events", "", 1e-6);
+    } catch (const std::invalid_argument&) {
+        scaleThrew = true;
+    }
+    TEST_ASSERT(typeThrew && scaleThrew, "Re-registering with another type or scale is rejected");
+
+    Histogram& latency = registry.histogram("test_seconds", "Latency", "op=\"x\"", {0.001, 0.01});
+    latency.observe(std::chrono::microseconds(500));
+    latency.observe(std::chrono::milliseconds(5));
+    latency.observe(std::chrono::milliseconds(50));
+    std::string text = registry.render();
+    TEST_ASSERT(text.find("# TYPE test_events_total counter\ntest_events_total 40000\n") != std::string::npos,
+                "Counter in text format");
+    TEST_ASSERT(text.find("test_seconds_bucket{op=\"x\",le=\"0.001\"} 1\n") != std::string::npos &&
+                text.find("test_seconds_bucket{op=\"x\",le=\"0.01\"} 2\n") != std::string::npos &&
+                text.find("test_seconds_bucket{op=\"x\",le=\"+Inf\"} 3\n") != std::string::npos &&
+                text.find("test_seconds_sum{op=\"x\"} 0.0555\n") != std::string::npos &&
+                text.find("test_seconds_count{op=\"x\"} 3\n") != std::string::npos,
+                "Histogram buckets are cumulative, sum in seconds");
+
+    auto values = randomVector(128, 99);
+    TPUDriver::Matrix w{}, a{};
+    for (size_t i = 0; i < 64; i++) {
+        w[i / 8][i % 8] = values[i];
+        a[i / 8][i % 8] = values[64 + i];
+    }
+    auto metrics = std::make_shared<DriverMetrics>(registry);
+    TPUDriver tpu(std::make_unique<TPUEmulator>());
+    tpu.setVerbose(false);
+    tpu.setMetrics(metrics);
+    tpu.enableResultCache(64 * 1024);
+    for (int i = 0; i < 3; i++) tpu.matrixMultiply(w, a);
+    JobTicket ticket = tpu.submit(DeviceJob{TPUDriver::view(w), TPUDriver::view(a)});
+    tpu.collect(ticket);
+    TEST_ASSERT(metrics->matmuls.value() == 3 && metrics->tiles.value() == 2 &&
+                metrics->cacheHits.value() == 2 && metrics->cacheMisses.value() == 1,
+                "Multiplies, array runs and cache lookups counted");
+    TEST_ASSERT(metrics->bytesTx.value() == tpu.linkStats().bytesSent &&
+                metrics->bytesRx.value() == tpu.linkStats().bytesReceived, "Link bytes match LinkStats");
+    TEST_ASSERT(metrics->upload.sumSeconds() > 0 && metrics->compute.sumSeconds() > 0 && metrics->readback.sumSeconds() > 0,
+                "Phases timed");
+
+#ifndef _WIN32
+    MetricsServer http(registry, 0);
+    sockaddr_in inet{};
+    inet.sin_family = AF_INET;
+    inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    inet.sin_port = htons(http.port());
+    std::string response = httpGet(reinterpret_cast<sockaddr*>(&inet), sizeof(inet), "/metrics");
+    TEST_ASSERT(response.compare(0, 15, "HTTP/1.1 200 OK") == 0 &&
+                response.find("tpu_matmuls_total 3\n") != std::string::npos &&
+                response.find("tpu_phase_seconds_count{phase=\"compute\"}") != std::string::npos &&
+                response.find("tpu_device_utilization ") != std::string::npos,
+                "Scrape over TCP");
+    response = httpGet(reinterpret_cast<sockaddr*>(&inet), sizeof(inet), "/other");
+    TEST_ASSERT(response.compare(0, 12, "HTTP/1.1 404") == 0, "Unknown path is 404");
+
+    std::string path = "/tmp/tpu_metrics_test_" + std::to_string(::getpid()) + ".sock";
+    {
+        MetricsServer local(registry, path);
+        sockaddr_un unixAddr{};
+        unixAddr.sun_family = AF_UNIX;
+        std::strncpy(unixAddr.sun_path, path.c_str(), sizeof(unixAddr.sun_path) - 1);
+        response = httpGet(reinterpret_cast<sockaddr*>(&unixAddr), sizeof(unixAddr), "/metrics");
+        TEST_ASSERT(response.find("tpu_link_bytes_total{direction=\"tx\"}") != std::string::npos &&
+                    local.scrapes() == 1, "Scrape over a Unix socket");
+    }
+    TEST_ASSERT(::access(path.c_str(), F_OK) != 0, "Socket file removed on stop");
+#endif
+}
+
+int main() {
+    printf("============================================\n");
+    printf("C++ TPU Driver Test Suite\n");
+    printf("============================================\n");
+
+    test_fp16_conversion();
+    test_fp16_table();
+    test_tiled_gemm();
+    test_conv2d();
+    test_grouped_conv();
+    test_strassen_gemm();
+    test_compressed_readback();
+    test_delta_upload();
+    test_write_range();
+    test_tile_views();
+    test_arena();
+    test_staging_memory();
+    test_device_accumulation();
+    test_precision_selection();
+    test_precision_tuner();
+    test_layer_chaining();
+    test_job_queue();
+    test_out_of_order_readback();
+    test_writes_between_jobs();
+    test_result_epilogue();
+    test_result_cache();
+    test_trace_replay();
+    test_fault_injection();
+    test_pipelined_mac();
+    test_link_recovery();
+    test_enqueue_recovery();
+    test_payload_check();
+    test_metrics();
+
+    TEST_SUMMARY();
+
+    return (test_result.failed == 0) ? 0 : 1;
+}
@@ -39,6 +39,10 @@ run_hardware_test() {
         -o "hardware/${output_file}" \
         "hardware/$test_file" \
         hardware/verilog/fp16_approximate_multiplier.v \
+        hardware/verilog/fp16_approximate_adder.v \
+        hardware/verilog/fp32_adder.v \
+        hardware/verilog/fp16_selectable_multiplier.v \
+        hardware/verilog/fp16_selectable_adder.v \
         hardware/verilog/fp16_approx_mac_unit.v \
         hardware/verilog/fp16_approx_systolic_array.v \
         hardware/verilog/uart_interface.v \
@@ -182,6 +186,30 @@ else
     echo ""
 fi
 
+# Test 7: C++ Driver (host-side runtime, no board needed)
+if command -v g++ &> /dev/null; then
+    echo -e "${BLUE}[Driver Test]${NC} C++ Driver"
+    echo "  Compiling test..."
+    
+    g++ -std=c++17 -O2 -Wall -Idrivers -o drivers/test_driver_cpp \
+        tests/drivers/test_driver_cpp.cpp
+    
+    if [ $? -eq 0 ]; then
+        run_driver_test \
+            "cpp_driver" \
+            "drivers/test_driver_cpp"
+    else
+        echo -e "  ${RED}✗ FAILED${NC}: Compilation error"
+        FAILED_TESTS=$((FAILED_TESTS + 1))
+        TOTAL_TESTS=$((TOTAL_TESTS + 1))
+        TEST_RESULTS+=("C++ Driver: FAILED (compilation)")
+    fi
+    echo ""
+else
+    echo -e "${YELLOW}⚠ SKIPPED${NC}: G++ not found"
+    echo ""
+fi
+
 ################################################################################
 # INTEGRATION TESTS
 ################################################################################
@@ -189,7 +217,7 @@ fi
 echo -e "${GREEN}=== Phase 3: Integration Tests ===${NC}"
 echo ""
 
-# Test 7: Build System Test
+# Test 8: Build System Test
 echo -e "${BLUE}[Integration Test]${NC} Build System"
 echo "  Testing driver build system..."
 
@@ -214,7 +242,7 @@ fi
 TOTAL_TESTS=$((TOTAL_TESTS + 1))
 echo ""
 
-# Test 8: Documentation Check
+# Test 9: Documentation Check
 echo -e "${BLUE}[Integration Test]${NC} Documentation"
 echo "  Checking documentation files..."
 